@@ -14,6 +14,8 @@
 
 #pragma once
 
+#include <cstdint>
+#include <optional>
 #include <vector>
 
 #include "IR/instruction.hpp"
@@ -27,13 +29,28 @@ namespace fun::IR {
  * A block is a sequence of instructions that are executed in order,
  * without any branches or jumps. Branches and Jump instructions target
  * blocks. They do not target individual instructions.
+ *
+ * The first branch or ret of a block ends it; when a block ends in a
+ * conditional branch, or in no branch at all, control may fall through
+ * to the next block of the body, or out of the lambda from the last one.
  */
 class Block {
 public:
     using Data = std::vector<Instruction>;
 
+    /**
+     * @brief how often the conditional branch which ends a block is taken,
+     * relative to how often it falls through, as the source weighs it.
+     * Lowered to !prof metadata.
+     */
+    struct Weights {
+        std::uint32_t taken;
+        std::uint32_t fallthrough;
+    };
+
 private:
     Data data_;
+    std::optional<Weights> weights_;
 
 public:
     constexpr void append(Instruction::Opcode opcode, Operand A) {
@@ -49,12 +66,31 @@ public:
         data_.emplace_back(opcode, A, B, C);
     }
 
+    constexpr Data::iterator erase(Data::const_iterator position) {
+        return data_.erase(position);
+    }
+
     constexpr std::uint64_t size() const noexcept { return data_.size(); }
 
+    constexpr bool empty() const noexcept { return data_.empty(); }
+
+    constexpr std::optional<Weights> const &weights() const noexcept {
+        return weights_;
+    }
+
+    constexpr void weights(std::optional<Weights> weights) noexcept {
+        weights_ = weights;
+    }
+
     constexpr Data::reference operator[](std::size_t index) noexcept {
         return data_[index];
     }
 
+    constexpr Data::const_reference
+    operator[](std::size_t index) const noexcept {
+        return data_[index];
+    }
+
     constexpr Data::iterator begin() noexcept { return data_.begin(); }
 
     constexpr Data::iterator end() noexcept { return data_.end(); }
@@ -0,0 +1,46 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file block_handle.hpp
+ * @brief Defines [BlockHandle](@ref BlockHandle)
+ */
+
+#pragma once
+
+#include <compare>
+#include <ostream>
+
+#include "IR/scalar.hpp"
+
+namespace fun::IR {
+
+/**
+ * @struct BlockHandle
+ * @brief Represents a handle to a block of the body of a lambda, which is
+ * the target of a branch.
+ */
+struct BlockHandle {
+    Scalar::u64 index;
+
+    constexpr bool operator==(BlockHandle const &other) const noexcept {
+        return index == other.index;
+    }
+
+    constexpr std::partial_ordering
+    operator<=>(BlockHandle const &other) const noexcept {
+        return index <=> other.index;
+    }
+};
+
+inline std::ostream &operator<<(std::ostream &out, BlockHandle const &block) {
+    return out << "#" << block.index;
+}
+
+} // namespace fun::IR
@@ -0,0 +1,71 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file fast_math.hpp
+ * @brief Defines [FastMath](@ref FastMath)
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <utility>
+
+namespace fun::IR {
+
+/**
+ * @brief The assumptions the floating point arithmetic of a lambda may
+ * make, as a set of flags. None is strict IEEE 754.
+ *
+ * The flags are LLVM's: reassoc may reassociate, contract may fuse a
+ * multiply and an add, nnan and ninf assume no operand or result is a NaN
+ * or an infinity, and arcp may divide by multiplying by the reciprocal.
+ */
+enum class FastMath : std::uint8_t {
+    None        = 0,
+    Reassociate = 1 << 0,
+    Contract    = 1 << 1,
+    NoNaNs      = 1 << 2,
+    NoInfs      = 1 << 3,
+    Reciprocal  = 1 << 4,
+    All         = (1 << 5) - 1,
+};
+
+constexpr FastMath operator|(FastMath left, FastMath right) noexcept {
+    return static_cast<FastMath>(std::to_underlying(left) |
+                                 std::to_underlying(right));
+}
+
+/// whether @p flags includes @p flag
+constexpr bool has(FastMath flags, FastMath flag) noexcept {
+    return (std::to_underlying(flags) & std::to_underlying(flag)) != 0;
+}
+
+/// prints @p flags as the annotation of a lambda spells them
+inline std::ostream &operator<<(std::ostream &out, FastMath flags) {
+    if (flags == FastMath::None) { return out << "strict"; }
+    if (flags == FastMath::All) { return out << "fast"; }
+    constexpr std::pair<FastMath, char const *> names[] = {
+        {FastMath::Reassociate, "reassoc"},
+        {FastMath::Contract, "contract"},
+        {FastMath::NoNaNs, "nnan"},
+        {FastMath::NoInfs, "ninf"},
+        {FastMath::Reciprocal, "arcp"},
+    };
+    char const *separator = "fast(";
+    for (auto [flag, name] : names) {
+        if (!has(flags, flag)) { continue; }
+        out << separator << name;
+        separator = ", ";
+    }
+    return out << ")";
+}
+
+} // namespace fun::IR
@@ -0,0 +1,51 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file field_handle.hpp
+ * @brief Defines [FieldHandle](@ref FieldHandle)
+ */
+
+#pragma once
+
+#include <compare>
+#include <ostream>
+
+#include "IR/local.hpp"
+
+namespace fun::IR {
+
+/**
+ * @struct FieldHandle
+ * @brief Represents a handle to a field of a local of a struct or tuple
+ * type, %local.field, which is a cell of its own.
+ *
+ * The field is numbered as it was declared, whatever its place in the
+ * [layout](@ref layout) of the struct.
+ */
+struct FieldHandle {
+    LocalHandle local;
+    Scalar::u64 field;
+
+    constexpr bool operator==(FieldHandle const &other) const noexcept {
+        return local == other.local && field == other.field;
+    }
+
+    constexpr std::partial_ordering
+    operator<=>(FieldHandle const &other) const noexcept {
+        if (auto order = local <=> other.local; order != 0) { return order; }
+        return field <=> other.field;
+    }
+};
+
+inline std::ostream &operator<<(std::ostream &out, FieldHandle const &field) {
+    return out << "%" << field.local.index << "." << field.field;
+}
+
+} // namespace fun::IR
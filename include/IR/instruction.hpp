@@ -28,17 +28,65 @@ public:
      * @enum Opcode
      * @brief Represents the operation to be performed
      *
-     * @todo jmp, jeq, jne, jlt, jle, jgt, jge, jz, jnz,
-     * store, as, is, subscript, slice, dot, and, or, xor, not,
-     * shl, shr, eq, ne, lt, le, gt, ge
+     * A branch names the block it jumps to as its first operand, and
+     * ends its block: when a conditional branch is not taken control
+     * falls through to the next block of the body.
+     *
+     *     jmp #t           jumps to block t
+     *     jz  #t, B        jumps if B is zero (or false)
+     *     jnz #t, B        jumps if B is not zero (or true)
+     *     jeq #t, B, C     jumps if B == C, as do jne, jlt, jle, jgt, jge
+     *     eq  %d, B, C     sets the bool %d to B == C, as do ne ... ge
+     *
+     * Operands are compared by their type: integers as signed or unsigned
+     * and floating point values as IEEE 754 does, so that every comparison
+     * involving a NaN is false but ne.
+     *
+     * Every argument and local of a lambda is a cell of memory, holding a
+     * value of its type, which no other cell overlaps. Instructions read
+     * their operands from cells, and write their result to the cell A:
+     *
+     *     load %d, B       reads B, a cell or a constant, into %d
+     *
+     * The elements of an array, or of the array a slice points to, are
+     * read and written by index; B of subscript and A of insert may be an
+     * array or a slice:
+     *
+     *     subscript %d, B, I   reads element I of B into %d
+     *     insert    A, I, C    writes C to element I of A
+     *     slice     %s, B      sets %s to point to every element of B
+     *     length    %n, B      sets the u64 %n to the number of elements
+     *
+     * An index is checked against the length, and one out of bounds
+     * traps. unchecked_subscript and unchecked_insert do not check; they
+     * are what subscript and insert become once the index is proven in
+     * bounds. A slice points into the cell it was made from, and must not
+     * outlive it.
+     *
+     * @todo as, is, dot, and, or, xor, not, shl, shr
      *
      */
     enum class Opcode {
         // Control flow
         Ret,
         Call,
+        Jmp,
+        Jeq,
+        Jne,
+        Jlt,
+        Jle,
+        Jgt,
+        Jge,
+        Jz,
+        Jnz,
         // Memory
         Load,
+        Subscript,
+        Insert,
+        UncheckedSubscript,
+        UncheckedInsert,
+        Slice,
+        Length,
         // Arithmetic
         Neg,
         Add,
@@ -46,6 +94,13 @@ public:
         Mul,
         Div,
         Rem,
+        // Comparison
+        Eq,
+        Ne,
+        Lt,
+        Le,
+        Gt,
+        Ge,
     };
 
     enum class Format {
@@ -86,11 +141,102 @@ public:
                                     Instruction const &instruction);
 };
 
+/// @return true if @p opcode transfers control to a block
+constexpr bool is_branch(Instruction::Opcode opcode) noexcept {
+    return opcode >= Instruction::Opcode::Jmp &&
+           opcode <= Instruction::Opcode::Jnz;
+}
+
+/// @return true if @p opcode is a branch which may fall through
+constexpr bool is_conditional(Instruction::Opcode opcode) noexcept {
+    return is_branch(opcode) && opcode != Instruction::Opcode::Jmp;
+}
+
+/// @return true if @p opcode compares two operands into a bool
+constexpr bool is_comparison(Instruction::Opcode opcode) noexcept {
+    return opcode >= Instruction::Opcode::Eq &&
+           opcode <= Instruction::Opcode::Ge;
+}
+
+/// @return true if @p opcode reads or writes an element, by its index
+constexpr bool is_element_access(Instruction::Opcode opcode) noexcept {
+    return opcode >= Instruction::Opcode::Subscript &&
+           opcode <= Instruction::Opcode::UncheckedInsert;
+}
+
+/// @return true if @p opcode traps on an index out of bounds
+constexpr bool is_bounds_checked(Instruction::Opcode opcode) noexcept {
+    return opcode == Instruction::Opcode::Subscript ||
+           opcode == Instruction::Opcode::Insert;
+}
+
+/// the element access @p opcode, without its bounds check
+constexpr Instruction::Opcode unchecked(Instruction::Opcode opcode) noexcept {
+    switch (opcode) {
+    case Instruction::Opcode::Subscript:
+        return Instruction::Opcode::UncheckedSubscript;
+    case Instruction::Opcode::Insert:
+        return Instruction::Opcode::UncheckedInsert;
+    default: return opcode;
+    }
+}
+
+/// @return true if no instruction after @p opcode in its block runs
+constexpr bool is_terminator(Instruction::Opcode opcode) noexcept {
+    return opcode == Instruction::Opcode::Ret || is_branch(opcode);
+}
+
+/**
+ * @brief the conditional branch which is taken exactly when @p opcode is
+ * not, for integer operands.
+ *
+ * This does not hold of floating point operands, as neither jlt nor jge
+ * jumps if either is NaN.
+ */
+constexpr Instruction::Opcode inverse(Instruction::Opcode opcode) noexcept {
+    switch (opcode) {
+    case Instruction::Opcode::Jeq: return Instruction::Opcode::Jne;
+    case Instruction::Opcode::Jne: return Instruction::Opcode::Jeq;
+    case Instruction::Opcode::Jlt: return Instruction::Opcode::Jge;
+    case Instruction::Opcode::Jle: return Instruction::Opcode::Jgt;
+    case Instruction::Opcode::Jgt: return Instruction::Opcode::Jle;
+    case Instruction::Opcode::Jge: return Instruction::Opcode::Jlt;
+    case Instruction::Opcode::Jz:  return Instruction::Opcode::Jnz;
+    case Instruction::Opcode::Jnz: return Instruction::Opcode::Jz;
+    default:                       std::unreachable();
+    }
+}
+
+/**
+ * @brief the comparison which a conditional branch @p opcode with two
+ * operands makes.
+ */
+constexpr Instruction::Opcode comparison(Instruction::Opcode opcode) noexcept {
+    switch (opcode) {
+    case Instruction::Opcode::Jeq: return Instruction::Opcode::Eq;
+    case Instruction::Opcode::Jne: return Instruction::Opcode::Ne;
+    case Instruction::Opcode::Jlt: return Instruction::Opcode::Lt;
+    case Instruction::Opcode::Jle: return Instruction::Opcode::Le;
+    case Instruction::Opcode::Jgt: return Instruction::Opcode::Gt;
+    case Instruction::Opcode::Jge: return Instruction::Opcode::Ge;
+    default:                       std::unreachable();
+    }
+}
+
 inline std::ostream &operator<<(std::ostream &out,
                                 Instruction::Opcode const &opcode) {
     switch (opcode) {
     case Instruction::Opcode::Ret:  out << "ret "; break;
     case Instruction::Opcode::Call: out << "call"; break;
+    case Instruction::Opcode::Jmp:  out << "jmp "; break;
+    case Instruction::Opcode::Jeq:  out << "jeq "; break;
+    case Instruction::Opcode::Jne:  out << "jne "; break;
+    case Instruction::Opcode::Jlt:  out << "jlt "; break;
+    case Instruction::Opcode::Jle:  out << "jle "; break;
+    case Instruction::Opcode::Jgt:  out << "jgt "; break;
+    case Instruction::Opcode::Jge:  out << "jge "; break;
+    case Instruction::Opcode::Jz:   out << "jz  "; break;
+    case Instruction::Opcode::Jnz:  out << "jnz "; break;
     case Instruction::Opcode::Load: out << "load"; break;
     case Instruction::Opcode::Neg:  out << "neg "; break;
     case Instruction::Opcode::Add:  out << "add "; break;
@@ -98,7 +244,24 @@ inline std::ostream &operator<<(std::ostream &out,
     case Instruction::Opcode::Mul:  out << "mul "; break;
     case Instruction::Opcode::Div:  out << "div "; break;
     case Instruction::Opcode::Rem:  out << "rem "; break;
-    default:                        std::unreachable();
+    case Instruction::Opcode::Eq:   out << "eq  "; break;
+    case Instruction::Opcode::Ne:   out << "ne  "; break;
+    case Instruction::Opcode::Lt:   out << "lt  "; break;
+    case Instruction::Opcode::Le:   out << "le  "; break;
+    case Instruction::Opcode::Gt:   out << "gt  "; break;
+    case Instruction::Opcode::Ge:   out << "ge  "; break;
+
+    case Instruction::Opcode::Subscript: out << "subscript"; break;
+    case Instruction::Opcode::Insert:    out << "insert"; break;
+    case Instruction::Opcode::UncheckedSubscript:
+        out << "unchecked_subscript";
+        break;
+    case Instruction::Opcode::UncheckedInsert:
+        out << "unchecked_insert";
+        break;
+    case Instruction::Opcode::Slice:  out << "slice"; break;
+    case Instruction::Opcode::Length: out << "length"; break;
+    default:                          std::unreachable();
     }
 
     return out;
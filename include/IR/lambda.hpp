@@ -14,15 +14,41 @@
 
 #pragma once
 
+#include <optional>
 #include <vector>
 
 #include "IR/block.hpp"
+#include "IR/fast_math.hpp"
+#include "IR/field_handle.hpp"
 #include "IR/label.hpp"
 #include "IR/local.hpp"
 #include "IR/type.hpp"
 
 namespace fun::IR {
 
+/**
+ * @class Lambda
+ * @brief Represents a function
+ *
+ * A lambda is a named sequence of [Blocks](@ref Block), together with the
+ * locals those blocks operate on.
+ *
+ * Arguments and locals share one index space: LocalHandle{i} names the
+ * i-th argument when i < arguments().size(), and otherwise names
+ * locals()[i - arguments().size()].
+ *
+ * A lambda may be annotated with the [FastMath](@ref FastMath) flags its
+ * floating point arithmetic is lowered and folded with. One which is not
+ * takes whatever the driver chooses, which is strict unless told not to.
+ * A lambda may also be checked, in which case integer arithmetic which
+ * overflows its type traps, rather than wraps around, as does division by
+ * zero.
+ *
+ * A lambda may be generic over [type parameters](@ref Type::Parameter),
+ * which its arguments, locals and return type may name. A generic lambda
+ * is never lowered itself; each call of it is given an instance, in which
+ * the parameters are the types of the call, see pass::Monomorphize.
+ */
 class Lambda {
 public:
     struct Argument {
@@ -34,10 +60,105 @@ public:
     using Body      = std::vector<Block>;
 
 private:
+    Label name_;
     Type::Ptr return_type_;
     Arguments arguments_;
     Locals locals_;
     Body body_;
+    std::optional<FastMath> fast_math_;
+    bool checked_ = false;
+    std::vector<Label> type_parameters_;
+
+public:
+    Lambda(Label name, Type::Ptr return_type, Arguments arguments) noexcept
+        : name_{name}, return_type_{std::move(return_type)},
+          arguments_{std::move(arguments)} {}
+
+    constexpr Label name() const noexcept { return name_; }
+
+    constexpr Type::Ptr const &return_type() const noexcept {
+        return return_type_;
+    }
+
+    constexpr Arguments const &arguments() const noexcept {
+        return arguments_;
+    }
+
+    constexpr Locals &locals() noexcept { return locals_; }
+    constexpr Locals const &locals() const noexcept { return locals_; }
+
+    /**
+     * @brief the number of arguments and locals together
+     */
+    constexpr std::uint64_t frame_size() const noexcept {
+        return arguments_.size() + locals_.size();
+    }
+
+    constexpr bool is_argument(LocalHandle handle) const noexcept {
+        return handle.index < arguments_.size();
+    }
+
+    Local &local(LocalHandle handle) noexcept {
+        assert(!is_argument(handle) && handle.index < frame_size());
+        return locals_[handle.index - arguments_.size()];
+    }
+
+    Local const &local(LocalHandle handle) const noexcept {
+        assert(!is_argument(handle) && handle.index < frame_size());
+        return locals_[handle.index - arguments_.size()];
+    }
+
+    Type const &type_of(LocalHandle handle) const noexcept {
+        assert(handle.index < frame_size());
+        if (is_argument(handle)) { return *arguments_[handle.index].type; }
+        return *local(handle).type_;
+    }
+
+    /// whether @p handle names a field of a local of a struct or tuple
+    bool has_field(FieldHandle handle) const noexcept {
+        if (handle.local.index >= frame_size()) { return false; }
+        Type const &type = type_of(handle.local);
+        return type.is<Type::Struct>() &&
+               handle.field < type.as<Type::Struct>().fields.size();
+    }
+
+    Type const &type_of(FieldHandle handle) const noexcept {
+        assert(has_field(handle));
+        Type const &record = type_of(handle.local);
+        return *record.as<Type::Struct>().fields[handle.field].type;
+    }
+
+    LocalHandle declare(Local local) {
+        locals_.emplace_back(std::move(local));
+        return LocalHandle{frame_size() - 1};
+    }
+
+    constexpr Body &body() noexcept { return body_; }
+    constexpr Body const &body() const noexcept { return body_; }
+
+    constexpr std::optional<FastMath> fast_math() const noexcept {
+        return fast_math_;
+    }
+
+    constexpr void fast_math(std::optional<FastMath> flags) noexcept {
+        fast_math_ = flags;
+    }
+
+    constexpr bool checked() const noexcept { return checked_; }
+
+    constexpr void checked(bool checked) noexcept { checked_ = checked; }
+
+    constexpr std::vector<Label> const &type_parameters() const noexcept {
+        return type_parameters_;
+    }
+
+    void type_parameters(std::vector<Label> parameters) noexcept {
+        type_parameters_ = std::move(parameters);
+    }
+
+    constexpr bool generic() const noexcept {
+        return !type_parameters_.empty();
+    }
 };
 
 } // namespace fun::IR
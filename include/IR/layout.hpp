@@ -0,0 +1,134 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file layout.hpp
+ * @brief Defines [layout](@ref layout), [size_of](@ref size_of) and
+ * [align_of](@ref align_of)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include "IR/type.hpp"
+
+namespace fun::IR {
+
+/**
+ * @struct Layout
+ * @brief Where the fields of a struct are placed in memory.
+ */
+struct Layout {
+    std::uint64_t size  = 0;
+    std::uint64_t align = 1;
+    /// the offset of each field, in the order they are declared
+    std::vector<std::uint64_t> offsets;
+    /// the declared index of each field, in the order of their offsets
+    std::vector<std::size_t> order;
+
+    /// the place of the declared field @p field among the fields in memory
+    std::size_t position(std::size_t field) const noexcept {
+        return static_cast<std::size_t>(
+            std::ranges::find(order, field) - order.begin());
+    }
+};
+
+Layout layout(Type::Struct const &record);
+
+/**
+ * @brief the size of @p type in bytes, a multiple of its alignment.
+ *
+ * A function is a pointer to it, a slice is a pointer and a u64 length,
+ * and a type parameter, which is never lowered, takes no room.
+ */
+inline std::uint64_t size_of(Type const &type) {
+    switch (type.index()) {
+    case 0:
+    case 1:
+    case 2:
+    case 6:  return 1;
+    case 3:
+    case 7:  return 2;
+    case 4:
+    case 8:
+    case 10: return 4;
+    case 5:
+    case 9:
+    case 11:
+    case 12: return 8;
+    case 14: return layout(type.as<Type::Struct>()).size;
+    case 15:
+        return type.as<Type::Array>().length *
+               size_of(*type.as<Type::Array>().element);
+    case 16: return 16;
+    default: return 0;
+    }
+}
+
+/// the alignment of @p type in bytes, its natural alignment
+inline std::uint64_t align_of(Type const &type) {
+    if (type.is<Type::Struct>()) {
+        return layout(type.as<Type::Struct>()).align;
+    }
+    if (type.is<Type::Array>()) {
+        return align_of(*type.as<Type::Array>().element);
+    }
+    if (type.is<Type::Slice>()) { return 8; }
+    return std::max<std::uint64_t>(size_of(type), 1);
+}
+
+/**
+ * @brief lays out the fields of @p record.
+ *
+ * Unless the struct is Ordered or Packed its fields are placed by
+ * alignment, largest first, and those of equal alignment as they are
+ * declared; as each size is a multiple of its alignment, this leaves no
+ * padding between fields. A Packed struct places each field right after
+ * the last, and has an alignment of one.
+ */
+inline Layout layout(Type::Struct const &record) {
+    using Order = Type::Struct::Order;
+    Layout result;
+    std::size_t const count = record.fields.size();
+    result.offsets.resize(count);
+    result.order.resize(count);
+    std::iota(result.order.begin(), result.order.end(), std::size_t{0});
+
+    auto align_up = [](std::uint64_t offset, std::uint64_t align) {
+        return (offset + align - 1) / align * align;
+    };
+    std::vector<std::uint64_t> aligns(count, 1);
+    if (record.order != Order::Packed) {
+        for (std::size_t index = 0; index < count; ++index) {
+            aligns[index] = align_of(*record.fields[index].type);
+        }
+    }
+    if (record.order == Order::Reordered) {
+        std::ranges::stable_sort(result.order,
+                                 [&](std::size_t left, std::size_t right) {
+                                     return aligns[left] > aligns[right];
+                                 });
+    }
+
+    for (std::size_t field : result.order) {
+        std::uint64_t const align = aligns[field];
+        result.size = align_up(result.size, align);
+        result.offsets[field] = result.size;
+        result.size += size_of(*record.fields[field].type);
+        result.align = std::max(result.align, align);
+    }
+    result.size = align_up(result.size, result.align);
+    return result;
+}
+
+} // namespace fun::IR
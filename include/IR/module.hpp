@@ -0,0 +1,100 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file module.hpp
+ * @brief Defines [Module](@ref Module)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <vector>
+
+#include "IR/lambda.hpp"
+
+namespace fun::IR {
+
+/**
+ * @class Module
+ * @brief Represents the lambdas of a single translation unit
+ *
+ * Lambdas are identified by name, which is unique within a module.
+ */
+class Module {
+public:
+    using Data = std::vector<Lambda>;
+
+private:
+    Data data_;
+
+public:
+    Lambda &append(Lambda lambda) {
+        assert(find(lambda.name()) == nullptr);
+        return data_.emplace_back(std::move(lambda));
+    }
+
+    /**
+     * @brief removes the lambdas @p predicate holds for from the module,
+     * keeping the order of the rest
+     *
+     * @return the lambdas removed, in their order
+     */
+    template <class Predicate> Data extract(Predicate predicate) {
+        auto kept = std::stable_partition(
+            data_.begin(), data_.end(), [&](Lambda const &lambda) {
+                return !predicate(lambda);
+            });
+        Data removed{std::make_move_iterator(kept),
+                     std::make_move_iterator(data_.end())};
+        data_.erase(kept, data_.end());
+        return removed;
+    }
+
+    Lambda *find(Label name) noexcept {
+        for (Lambda &lambda : data_) {
+            if (lambda.name() == name) { return &lambda; }
+        }
+        return nullptr;
+    }
+
+    Lambda const *find(Label name) const noexcept {
+        for (Lambda const &lambda : data_) {
+            if (lambda.name() == name) { return &lambda; }
+        }
+        return nullptr;
+    }
+
+    constexpr std::uint64_t size() const noexcept { return data_.size(); }
+
+    constexpr bool empty() const noexcept { return data_.empty(); }
+
+    constexpr Data::reference operator[](std::size_t index) noexcept {
+        return data_[index];
+    }
+
+    constexpr Data::const_reference
+    operator[](std::size_t index) const noexcept {
+        return data_[index];
+    }
+
+    constexpr Data::iterator begin() noexcept { return data_.begin(); }
+
+    constexpr Data::iterator end() noexcept { return data_.end(); }
+
+    constexpr Data::const_iterator begin() const noexcept {
+        return data_.begin();
+    }
+
+    constexpr Data::const_iterator end() const noexcept { return data_.end(); }
+};
+
+} // namespace fun::IR
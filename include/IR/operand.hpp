@@ -16,6 +16,8 @@
 
 #include <string_view>
 
+#include "IR/block_handle.hpp"
+#include "IR/field_handle.hpp"
 #include "IR/local.hpp"
 #include "IR/scalar.hpp"
 
@@ -41,7 +43,9 @@ private:
                               Scalar::f32,
                               Scalar::f64,
                               Label,
-                              LocalHandle>;
+                              LocalHandle,
+                              BlockHandle,
+                              FieldHandle>;
     Data data_;
 
 public:
@@ -77,6 +81,8 @@ public:
     }
     constexpr Operand(Label value) noexcept : data_{value} {}
     constexpr Operand(LocalHandle value) noexcept : data_{value} {}
+    constexpr Operand(BlockHandle value) noexcept : data_{value} {}
+    constexpr Operand(FieldHandle value) noexcept : data_{value} {}
 
     template <class T>
     constexpr Operand &operator=(T const &value) noexcept
@@ -123,6 +129,8 @@ public:
         case 11: return as<Scalar::f64>() <=> other.as<Scalar::f64>();
         case 12: return as<Label>() <=> other.as<Label>();
         case 13: return as<LocalHandle>() <=> other.as<LocalHandle>();
+        case 14: return as<BlockHandle>() <=> other.as<BlockHandle>();
+        case 15: return as<FieldHandle>() <=> other.as<FieldHandle>();
         default: std::unreachable();
         }
     }
@@ -144,6 +152,8 @@ public:
         case 11: return as<Scalar::f64>() == other.as<Scalar::f64>();
         case 12: return as<Label>() == other.as<Label>();
         case 13: return as<LocalHandle>() == other.as<LocalHandle>();
+        case 14: return as<BlockHandle>() == other.as<BlockHandle>();
+        case 15: return as<FieldHandle>() == other.as<FieldHandle>();
         default: std::unreachable();
         }
     }
@@ -218,6 +228,8 @@ inline std::ostream &operator<<(std::ostream &out, Operand const &operand) {
     case 11: return out << operand.as<Scalar::f64>();
     case 12: return out << "@" << operand.as<Label>().name;
     case 13: return out << "%" << operand.as<LocalHandle>().index;
+    case 14: return out << operand.as<BlockHandle>();
+    case 15: return out << operand.as<FieldHandle>();
     default: std::unreachable();
     }
 }
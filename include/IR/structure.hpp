@@ -0,0 +1,328 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file structure.hpp
+ * @brief Defines [structural_hash](@ref structural_hash) and
+ * [same_structure](@ref same_structure)
+ */
+
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+#include "IR/lambda.hpp"
+
+namespace fun::IR {
+
+/**
+ * The structure of IR is what it computes, regardless of what its lambda,
+ * arguments and locals are named: two lambdas of the same structure give
+ * the same results, and may be lowered to one function.
+ *
+ * Floating point constants are compared by their bits, rather than by
+ * Scalar::operator==, which is within epsilon. A call of a lambda by
+ * itself is structurally a call to itself, whatever its name, so that two
+ * recursive lambdas may match.
+ */
+namespace detail {
+
+inline void combine(std::uint64_t &seed, std::uint64_t value) noexcept {
+    seed ^= value + 0x9e37'79b9'7f4a'7c15 + (seed << 6) + (seed >> 2);
+}
+
+/// the bits of @p scalar, which are equal only for identical scalars
+inline std::uint64_t bits(Scalar const &scalar) noexcept {
+    switch (scalar.index()) {
+    case 0:  return 0;
+    case 1:  return scalar.as<Scalar::Bool>() ? 1 : 0;
+    case 2:  return scalar.as<Scalar::u8>();
+    case 3:  return scalar.as<Scalar::u16>();
+    case 4:  return scalar.as<Scalar::u32>();
+    case 5:  return scalar.as<Scalar::u64>();
+    case 6:  return static_cast<std::uint8_t>(scalar.as<Scalar::i8>());
+    case 7:  return static_cast<std::uint16_t>(scalar.as<Scalar::i16>());
+    case 8:  return static_cast<std::uint32_t>(scalar.as<Scalar::i32>());
+    case 9:  return static_cast<std::uint64_t>(scalar.as<Scalar::i64>());
+    case 10: return std::bit_cast<std::uint32_t>(scalar.as<Scalar::f32>());
+    case 11: return std::bit_cast<std::uint64_t>(scalar.as<Scalar::f64>());
+    default: std::unreachable();
+    }
+}
+
+/**
+ * @brief @p operand as a kind and a payload: the index of its alternative
+ * in Operand, and its bits, a hash of its label, or its index. A label of
+ * @p self is kind 16.
+ */
+inline std::pair<std::uint64_t, std::uint64_t> key(Operand operand,
+                                                   Label self) noexcept {
+    if (operand.is<Scalar>()) {
+        Scalar scalar = operand.as<Scalar>();
+        return {scalar.index(), bits(scalar)};
+    }
+    if (operand.is<Label>()) {
+        Label label = operand.as<Label>();
+        if (label == self) { return {16, 0}; }
+        return {12, std::hash<std::string_view>{}(label.name)};
+    }
+    if (operand.is<LocalHandle>()) {
+        return {13, operand.as<LocalHandle>().index};
+    }
+    if (operand.is<FieldHandle>()) {
+        FieldHandle field  = operand.as<FieldHandle>();
+        std::uint64_t seed = field.local.index;
+        combine(seed, field.field);
+        return {15, seed};
+    }
+    return {14, operand.as<BlockHandle>().index};
+}
+
+inline bool same_operand(Operand left,
+                         Label left_self,
+                         Operand right,
+                         Label right_self) noexcept {
+    auto const [kind, payload] = key(left, left_self);
+    if (key(right, right_self) != std::pair{kind, payload}) { return false; }
+    // distinct labels, and fields, may hash alike.
+    if (kind == 15) {
+        return left.as<FieldHandle>() == right.as<FieldHandle>();
+    }
+    return kind != 12 || left.as<Label>() == right.as<Label>();
+}
+
+inline std::uint64_t operand_count(Instruction const &instruction) noexcept {
+    switch (instruction.format()) {
+    case Instruction::Format::Unary:   return 1;
+    case Instruction::Format::Binary:  return 2;
+    case Instruction::Format::Ternary: return 3;
+    default:                           std::unreachable();
+    }
+}
+
+inline Operand operand(Instruction const &instruction,
+                       std::uint64_t index) noexcept {
+    switch (index) {
+    case 0:  return instruction.A();
+    case 1:  return instruction.B();
+    default: return instruction.C();
+    }
+}
+
+} // namespace detail
+
+inline std::uint64_t structural_hash(Type const &type) noexcept {
+    std::uint64_t seed = type.index();
+    if (type.is<Type::Parameter>()) {
+        std::string_view name = type.as<Type::Parameter>().name.name;
+        detail::combine(seed, std::hash<std::string_view>{}(name));
+    }
+    if (type.is<Type::Function>()) {
+        Type::Function const &function = type.as<Type::Function>();
+        detail::combine(seed, structural_hash(*function.return_type));
+        for (Type::Function::Argument const &argument : function.arguments) {
+            detail::combine(seed, structural_hash(*argument.type));
+        }
+    }
+    if (type.is<Type::Struct>()) {
+        Type::Struct const &record = type.as<Type::Struct>();
+        detail::combine(seed, static_cast<std::uint64_t>(record.order));
+        for (Type::Struct::Field const &field : record.fields) {
+            detail::combine(seed,
+                            std::hash<std::string_view>{}(field.name.name));
+            detail::combine(seed, structural_hash(*field.type));
+        }
+    }
+    if (type.is<Type::Array>()) {
+        detail::combine(seed, type.as<Type::Array>().length);
+        detail::combine(seed,
+                        structural_hash(*type.as<Type::Array>().element));
+    }
+    if (type.is<Type::Slice>()) {
+        detail::combine(seed,
+                        structural_hash(*type.as<Type::Slice>().element));
+    }
+    return seed;
+}
+
+inline bool same_structure(Type const &left, Type const &right) noexcept {
+    if (left.index() != right.index()) { return false; }
+    // parameters are told apart by name, as they are declared.
+    if (left.is<Type::Parameter>()) {
+        return left.as<Type::Parameter>().name ==
+               right.as<Type::Parameter>().name;
+    }
+    // fields are told apart by name, so two structs of the same types are
+    // not the same struct.
+    if (left.is<Type::Struct>()) {
+        Type::Struct const &first  = left.as<Type::Struct>();
+        Type::Struct const &second = right.as<Type::Struct>();
+        if (first.order != second.order ||
+            first.fields.size() != second.fields.size()) {
+            return false;
+        }
+        for (std::size_t index = 0; index < first.fields.size(); ++index) {
+            if (first.fields[index].name != second.fields[index].name ||
+                !same_structure(*first.fields[index].type,
+                                *second.fields[index].type)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    if (left.is<Type::Array>()) {
+        return left.as<Type::Array>().length ==
+                   right.as<Type::Array>().length &&
+               same_structure(*left.as<Type::Array>().element,
+                              *right.as<Type::Array>().element);
+    }
+    if (left.is<Type::Slice>()) {
+        return same_structure(*left.as<Type::Slice>().element,
+                              *right.as<Type::Slice>().element);
+    }
+    if (!left.is<Type::Function>()) { return true; }
+    Type::Function const &first  = left.as<Type::Function>();
+    Type::Function const &second = right.as<Type::Function>();
+    if (first.arguments.size() != second.arguments.size() ||
+        !same_structure(*first.return_type, *second.return_type)) {
+        return false;
+    }
+    for (std::size_t index = 0; index < first.arguments.size(); ++index) {
+        if (!same_structure(*first.arguments[index].type,
+                            *second.arguments[index].type)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief hashes the instructions and weights of @p block, which belongs to
+ * the lambda @p self
+ */
+inline std::uint64_t structural_hash(Block const &block,
+                                     Label self = {}) noexcept {
+    std::uint64_t seed = block.size();
+    for (Instruction const &instruction : block) {
+        detail::combine(seed, static_cast<std::uint64_t>(instruction.opcode()));
+        for (std::uint64_t index = 0;
+             index < detail::operand_count(instruction);
+             ++index) {
+            auto [kind, payload] =
+                detail::key(detail::operand(instruction, index), self);
+            detail::combine(seed, kind);
+            detail::combine(seed, payload);
+        }
+    }
+    if (block.weights()) {
+        detail::combine(seed, block.weights()->taken);
+        detail::combine(seed, block.weights()->fallthrough);
+    }
+    return seed;
+}
+
+inline bool same_structure(Block const &left,
+                           Label left_self,
+                           Block const &right,
+                           Label right_self) noexcept {
+    if (left.size() != right.size()) { return false; }
+    if (left.weights().has_value() != right.weights().has_value() ||
+        (left.weights() &&
+         (left.weights()->taken != right.weights()->taken ||
+          left.weights()->fallthrough != right.weights()->fallthrough))) {
+        return false;
+    }
+    for (std::size_t at = 0; at < left.size(); ++at) {
+        Instruction const &first  = left[at];
+        Instruction const &second = right[at];
+        if (first.opcode() != second.opcode() ||
+            first.format() != second.format()) {
+            return false;
+        }
+        for (std::uint64_t index = 0; index < detail::operand_count(first);
+             ++index) {
+            if (!detail::same_operand(detail::operand(first, index),
+                                      left_self,
+                                      detail::operand(second, index),
+                                      right_self)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief hashes the signature, frame, floating point mode and body of
+ * @p lambda, but not its name
+ */
+inline std::uint64_t structural_hash(Lambda const &lambda) noexcept {
+    std::uint64_t seed = structural_hash(*lambda.return_type());
+    detail::combine(seed, lambda.type_parameters().size());
+    for (Lambda::Argument const &argument : lambda.arguments()) {
+        detail::combine(seed, structural_hash(*argument.type));
+    }
+    for (Local const &local : lambda.locals()) {
+        detail::combine(seed, structural_hash(*local.type_));
+        Scalar initializer = local.value_.as<Scalar>();
+        detail::combine(seed, initializer.index());
+        detail::combine(seed, detail::bits(initializer));
+    }
+    std::optional<FastMath> fast_math = lambda.fast_math();
+    detail::combine(seed,
+                    fast_math ? std::to_underlying(*fast_math) + 1U : 0U);
+    detail::combine(seed, lambda.checked());
+    for (Block const &block : lambda.body()) {
+        detail::combine(seed, structural_hash(block, lambda.name()));
+    }
+    return seed;
+}
+
+inline bool same_structure(Lambda const &left, Lambda const &right) noexcept {
+    if (left.arguments().size() != right.arguments().size() ||
+        left.type_parameters() != right.type_parameters() ||
+        left.locals().size() != right.locals().size() ||
+        left.body().size() != right.body().size() ||
+        left.fast_math() != right.fast_math() ||
+        left.checked() != right.checked() ||
+        !same_structure(*left.return_type(), *right.return_type())) {
+        return false;
+    }
+    for (std::size_t index = 0; index < left.arguments().size(); ++index) {
+        if (!same_structure(*left.arguments()[index].type,
+                            *right.arguments()[index].type)) {
+            return false;
+        }
+    }
+    for (std::size_t index = 0; index < left.locals().size(); ++index) {
+        Local const &first  = left.locals()[index];
+        Local const &second = right.locals()[index];
+        Scalar const one    = first.value_.as<Scalar>();
+        Scalar const other  = second.value_.as<Scalar>();
+        if (!same_structure(*first.type_, *second.type_) ||
+            one.index() != other.index() ||
+            detail::bits(one) != detail::bits(other)) {
+            return false;
+        }
+    }
+    for (std::size_t index = 0; index < left.body().size(); ++index) {
+        if (!same_structure(left.body()[index],
+                            left.name(),
+                            right.body()[index],
+                            right.name())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace fun::IR
@@ -15,8 +15,11 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
 #include <memory>
 #include <ostream>
+#include <string>
+#include <type_traits>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -55,6 +58,42 @@ public:
             : return_type{std::move(return_type)},
               arguments{std::move(arguments)} {}
     };
+    /// a type a generic lambda is given at each call, by name
+    struct Parameter {
+        Label name;
+    };
+    /// a struct, or a tuple, whose fields are named by their positions
+    struct Struct {
+        /// how the fields are placed in memory, see IR::layout
+        enum class Order {
+            /// by alignment, largest first, to leave the least padding
+            Reordered,
+            /// as they are declared, each at its alignment
+            Ordered,
+            /// as they are declared, without any padding
+            Packed,
+        };
+        struct Field {
+            Label name;
+            Ptr type;
+        };
+        using Fields = std::vector<Field>;
+
+        Fields fields;
+        Order order;
+
+        Struct(Fields fields, Order order) noexcept
+            : fields{std::move(fields)}, order{order} {}
+    };
+    /// a fixed number of elements, held in place
+    struct Array {
+        Ptr element;
+        std::uint64_t length;
+    };
+    /// a pointer to elements held elsewhere, and their number
+    struct Slice {
+        Ptr element;
+    };
 
 private:
     using Data = std::variant<Nil,
@@ -69,7 +108,11 @@ private:
                               i64,
                               f32,
                               f64,
-                              Function>;
+                              Function,
+                              Parameter,
+                              Struct,
+                              Array,
+                              Slice>;
 
     Data data_;
 
@@ -91,6 +134,11 @@ public:
         : data_{std::in_place_type<Function>,
                 std::move(return_type),
                 std::move(arguments)} {}
+    Type(Parameter parameter) noexcept : data_{parameter} {}
+    Type(Struct::Fields fields, Struct::Order order) noexcept
+        : data_{std::in_place_type<Struct>, std::move(fields), order} {}
+    Type(Array array) noexcept : data_{std::move(array)} {}
+    Type(Slice slice) noexcept : data_{std::move(slice)} {}
 
     constexpr std::uint64_t index() const noexcept { return data_.index(); }
 
@@ -102,6 +150,43 @@ public:
         assert(is<T>());
         return std::get<T>(data_);
     }
+
+    /// a deep copy of this type
+    Ptr clone() const {
+        return std::visit(
+            [](auto const &type) -> Ptr {
+                if constexpr (std::is_same_v<decltype(type),
+                                             Function const &>) {
+                    Function::Arguments arguments;
+                    for (Function::Argument const &argument :
+                         type.arguments) {
+                        arguments.emplace_back(argument.name,
+                                               argument.type->clone());
+                    }
+                    return std::make_unique<Type>(type.return_type->clone(),
+                                                  std::move(arguments));
+                } else if constexpr (std::is_same_v<decltype(type),
+                                                    Struct const &>) {
+                    Struct::Fields fields;
+                    for (Struct::Field const &field : type.fields) {
+                        fields.emplace_back(field.name, field.type->clone());
+                    }
+                    return std::make_unique<Type>(std::move(fields),
+                                                  type.order);
+                } else if constexpr (std::is_same_v<decltype(type),
+                                                    Array const &>) {
+                    return std::make_unique<Type>(
+                        Array{type.element->clone(), type.length});
+                } else if constexpr (std::is_same_v<decltype(type),
+                                                    Slice const &>) {
+                    return std::make_unique<Type>(
+                        Slice{type.element->clone()});
+                } else {
+                    return std::make_unique<Type>(type);
+                }
+            },
+            data_);
+    }
 };
 
 inline std::ostream &operator<<(std::ostream &out, Type const &type) {
@@ -130,6 +215,34 @@ inline std::ostream &operator<<(std::ostream &out, Type const &type) {
         out << ") -> " << *function.return_type;
         return out;
     }
+    case 13: return out << type.as<Type::Parameter>().name.name;
+    case 14: {
+        Type::Struct const &record = type.as<Type::Struct>();
+        bool tuple = record.order == Type::Struct::Order::Reordered;
+        for (std::size_t index = 0; tuple && index < record.fields.size();
+             ++index) {
+            tuple = record.fields[index].name.name == std::to_string(index);
+        }
+        if (tuple) { out << "("; }
+        if (!tuple) {
+            out << "struct "
+                << (record.order == Type::Struct::Order::Packed ? "packed "
+                    : record.order == Type::Struct::Order::Ordered
+                        ? "ordered "
+                        : "")
+                << "{";
+        }
+        for (std::size_t index = 0; index < record.fields.size(); ++index) {
+            if (index != 0) { out << ", "; }
+            if (!tuple) { out << record.fields[index].name.name << ": "; }
+            out << *record.fields[index].type;
+        }
+        return out << (tuple ? ")" : "}");
+    }
+    case 15:
+        return out << "[" << *type.as<Type::Array>().element << "; "
+                   << type.as<Type::Array>().length << "]";
+    case 16: return out << "[" << *type.as<Type::Slice>().element << "]";
     default: std::unreachable();
     }
 }
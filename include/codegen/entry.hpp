@@ -0,0 +1,54 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file entry.hpp
+ * @brief Declares [emit_entry](@ref emit_entry) and
+ * [emit_adapter](@ref emit_adapter)
+ */
+
+#pragma once
+
+#include <llvm/IR/Function.h>
+
+#include "IR/label.hpp"
+#include "env/context.hpp"
+
+namespace fun::codegen {
+
+/**
+ * @brief Defines _start, the entry point of a static executable, which
+ * calls the lambda @p main with no arguments and exits the process with
+ * its result as the status.
+ *
+ * Programs do not depend on a C runtime, so _start sets up thread local
+ * storage if the module uses any, calls the functions of
+ * llvm.global_ctors before @p main and those of llvm.global_dtors once it
+ * returns, and exits the process with a system call directly. Only
+ * x86-64 and AArch64 Linux are supported.
+ *
+ * @return nullptr if @p main is not defined, takes arguments, or the
+ * target is not supported; the reason has been printed to llvm::errs().
+ */
+llvm::Function *emit_entry(IR::Label main, env::Context &ctx);
+
+/**
+ * @brief Defines void @p name(ptr arguments, ptr result), which calls
+ * @p function with arguments read from consecutive 64 bit cells, and
+ * writes its result to the cell @p result.
+ *
+ * This gives every lambda the same signature, so that the
+ * [Engine](@ref exec::Engine) can call any of them through one function
+ * pointer type, see [Native](@ref exec::Native).
+ */
+llvm::Function *emit_adapter(llvm::Function *function,
+                             llvm::StringRef name,
+                             env::Context &ctx);
+
+} // namespace fun::codegen
@@ -0,0 +1,49 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file instrument.hpp
+ * @brief Declares [instrument](@ref instrument)
+ */
+
+#pragma once
+
+#include "env/context.hpp"
+
+namespace fun::codegen {
+
+/**
+ * @brief Counts the calls to, and the time spent within, every lambda
+ * defined by the module of @p ctx, and writes a flat profile of them to
+ * standard error when the program exits.
+ *
+ * Each function gets a thread local pair of counters, so that threads
+ * never contend for them. On entry a function bumps its call counter and
+ * reads the cycle counter of the processor (rdtsc on x86-64, cntvct_el0
+ * on AArch64), and at every return it adds the ticks since to its total.
+ * The time of a function includes the time of its callees, and is counted
+ * again by each active frame of a recursive function. The counters are
+ * memory, so every lambda loses its memory attributes.
+ *
+ * The profile is written by a function in llvm.global_dtors, which
+ * [emit_entry](@ref emit_entry) calls before the process exits. Each line
+ * holds the calls, the ticks and the name of a function, separated by
+ * tabs, in the order the functions were defined. It reads the counters
+ * of the exiting thread alone, and those of any other thread are lost.
+ * A program only ever has the one thread _start sets up the thread
+ * pointer of, so nothing is lost today; a runtime which starts threads
+ * must merge their counters into those of the exiting thread as each
+ * of them ends.
+ *
+ * @return false if the target is not supported, in which case the reason
+ * has been printed to llvm::errs().
+ */
+bool instrument(env::Context &ctx);
+
+} // namespace fun::codegen
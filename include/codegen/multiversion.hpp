@@ -0,0 +1,54 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file multiversion.hpp
+ * @brief Declares [multiversion](@ref multiversion)
+ */
+
+#pragma once
+
+#include <string>
+
+#include <llvm/ADT/ArrayRef.h>
+
+#include "env/context.hpp"
+
+namespace fun::codegen {
+
+/**
+ * @brief Compiles each of @p lambdas once for the baseline x86-64, and
+ * once more for each x86-64 microarchitecture level of @p levels, as
+ * target_clones does, so that a program built for any x86-64 runs at the
+ * best level of the machine it runs on.
+ *
+ * The levels are x86-64-v2, x86-64-v3 and x86-64-v4, and all of them are
+ * cloned for if @p levels is empty. Each lambda becomes a dispatcher,
+ * which is always inlined, that calls the version a function pointer
+ * holds. As there is no C runtime to resolve an ifunc, a resolver in
+ * llvm.global_ctors, which [emit_entry](@ref emit_entry) calls before the
+ * entry lambda, checks cpuid and xgetbv once, and points each function
+ * pointer at the best version the machine supports. Until then they hold
+ * the baseline version, which the resolver is compiled for as well.
+ *
+ * Everything else is compiled for the target of @p ctx, which should be
+ * the baseline, as --cpu x86-64 selects, for the program to run on any
+ * x86-64 rather than only on machines like the host.
+ *
+ * This must run after any instrumentation, which the clones then share.
+ *
+ * @return false if the target is not x86-64, a level is unknown, or a
+ * lambda is not defined, in which case the reason has been printed to
+ * llvm::errs().
+ */
+bool multiversion(llvm::ArrayRef<std::string> lambdas,
+                  llvm::ArrayRef<std::string> levels,
+                  env::Context &ctx);
+
+} // namespace fun::codegen
@@ -0,0 +1,68 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file pgo.hpp
+ * @brief Declares [generate_profile](@ref generate_profile),
+ * [read_profile](@ref read_profile) and [use_profile](@ref use_profile)
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <optional>
+
+#include <llvm/ADT/StringRef.h>
+
+#include "codegen/profile.hpp"
+#include "env/context.hpp"
+
+namespace fun::codegen {
+
+/**
+ * @brief Counts the executions of every block of every lambda defined by
+ * the module of @p ctx, and how often each of their conditional branches
+ * is taken, and appends a run of a raw [Profile](@ref Profile) to the
+ * file @p path when the program exits.
+ *
+ * The run is written with a single write, so that the runs of programs
+ * which exit at once do not interleave; a run which cannot be written
+ * whole is reported on stderr.
+ *
+ * This must run on the module as it was lowered, before any other pass,
+ * as [use_profile](@ref use_profile) must see the same blocks. Counters
+ * are not atomic, as LLVM's own instrumentation is by default, and the
+ * lambdas which bump them lose their memory attributes.
+ *
+ * @return false if the target is not supported, in which case the reason
+ * has been printed to llvm::errs().
+ */
+bool generate_profile(llvm::StringRef path, env::Context &ctx);
+
+/**
+ * @brief reads and merges every run of the raw profile @p path
+ *
+ * @return std::nullopt if the profile cannot be read, in which case the
+ * reason has been printed to llvm::errs().
+ */
+std::optional<Profile> read_profile(std::filesystem::path const &path);
+
+/**
+ * @brief Annotates the module of @p ctx, as it was lowered, with the
+ * counts of @p profile, for the optimization pipeline and code generation.
+ *
+ * Every function with counts gets an entry count, and every conditional
+ * branch gets branch weights, from how often it was taken. The module gets
+ * a profile summary, from which LLVM decides what is hot or cold, and its
+ * functions are laid out hottest first. Functions whose code changed since the
+ * profile was recorded are left alone, with a warning.
+ */
+void use_profile(Profile const &profile, env::Context &ctx);
+
+} // namespace fun::codegen
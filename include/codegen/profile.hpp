@@ -0,0 +1,182 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file profile.hpp
+ * @brief Defines [Profile](@ref Profile)
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace fun::codegen {
+
+/**
+ * @class Profile
+ * @brief The block counts of every function of a program, as written by
+ * the runs of a program built with --profile-generate.
+ *
+ * A raw profile is a sequence of runs, each appended to the file by one
+ * process as it exits. All fields are 64 bit words, in the byte order of
+ * the host:
+ *
+ *     run:    magic, records, record...
+ *     record: name size, name (padded to a word), hash, counts, count...
+ *
+ * The counts of a function are those of its blocks, in order, followed
+ * by how often each of its conditional branches was taken, in the order
+ * of their blocks.
+ *
+ * The hash identifies the lowered code of the function, so that counts of
+ * a function which has since changed are not applied to it. The counts of
+ * a function in several runs are summed, unless its hash changed between
+ * them, in which case the later run replaces the earlier.
+ */
+class Profile {
+public:
+    static constexpr std::uint64_t magic = 0x31464f5250'4e5546; // FUNPROF1
+
+    struct Function {
+        std::uint64_t hash = 0;
+        /// the counts of the blocks, then of the branches taken
+        std::vector<std::uint64_t> blocks;
+    };
+
+private:
+    std::map<std::string, Function, std::less<>> functions_;
+
+    static void append_word(std::string &bytes, std::uint64_t word) {
+        char buffer[sizeof(word)];
+        std::memcpy(buffer, &word, sizeof(word));
+        bytes.append(buffer, sizeof(word));
+    }
+
+    static bool read_word(std::string_view &bytes, std::uint64_t &word) {
+        if (bytes.size() < sizeof(word)) { return false; }
+        std::memcpy(&word, bytes.data(), sizeof(word));
+        bytes.remove_prefix(sizeof(word));
+        return true;
+    }
+
+    static std::uint64_t padded(std::uint64_t size) noexcept {
+        return (size + sizeof(std::uint64_t) - 1) &
+               ~(sizeof(std::uint64_t) - 1);
+    }
+
+    void add(std::string_view name, Function function) {
+        auto found = functions_.find(name);
+        if (found == functions_.end()) {
+            functions_.emplace(name, std::move(function));
+            return;
+        }
+        Function &merged = found->second;
+        if (merged.hash != function.hash ||
+            merged.blocks.size() != function.blocks.size()) {
+            merged = std::move(function);
+            return;
+        }
+        for (std::size_t index = 0; index < merged.blocks.size(); ++index) {
+            std::uint64_t &count = merged.blocks[index];
+            std::uint64_t room = std::numeric_limits<std::uint64_t>::max() -
+                                 count;
+            count += function.blocks[index] < room ? function.blocks[index]
+                                                   : room;
+        }
+    }
+
+public:
+    /// the words which start a run of @p records records
+    static std::string run_header(std::uint64_t records) {
+        std::string bytes;
+        append_word(bytes, magic);
+        append_word(bytes, records);
+        return bytes;
+    }
+
+    /**
+     * @brief the words which start the record of the function @p name,
+     * and which are followed by the @p blocks counts.
+     */
+    static std::string record_header(std::string_view name,
+                                     std::uint64_t hash,
+                                     std::uint64_t blocks) {
+        std::string bytes;
+        append_word(bytes, name.size());
+        bytes.append(name);
+        bytes.resize(sizeof(std::uint64_t) + padded(name.size()), '\0');
+        append_word(bytes, hash);
+        append_word(bytes, blocks);
+        return bytes;
+    }
+
+    /**
+     * @brief adds the runs in @p bytes to the profile
+     *
+     * @return false if @p bytes is not a raw profile; the runs before the
+     * first malformed one have been added.
+     */
+    bool merge(std::string_view bytes) {
+        while (!bytes.empty()) {
+            std::uint64_t word = 0;
+            std::uint64_t records = 0;
+            if (!read_word(bytes, word) || word != magic ||
+                !read_word(bytes, records)) {
+                return false;
+            }
+
+            std::vector<std::pair<std::string_view, Function>> run;
+            for (std::uint64_t record = 0; record < records; ++record) {
+                std::uint64_t size = 0;
+                if (!read_word(bytes, size) || bytes.size() < padded(size)) {
+                    return false;
+                }
+                std::string_view name = bytes.substr(0, size);
+                bytes.remove_prefix(padded(size));
+
+                Function function;
+                std::uint64_t blocks = 0;
+                if (!read_word(bytes, function.hash) ||
+                    !read_word(bytes, blocks) ||
+                    bytes.size() / sizeof(std::uint64_t) < blocks) {
+                    return false;
+                }
+                function.blocks.resize(blocks);
+                for (std::uint64_t &count : function.blocks) {
+                    read_word(bytes, count);
+                }
+                run.emplace_back(name, std::move(function));
+            }
+
+            // a run is only added once it has been read whole.
+            for (auto &[name, function] : run) {
+                add(name, std::move(function));
+            }
+        }
+        return true;
+    }
+
+    /// the counts of the function @p name, or nullptr if it never ran
+    Function const *find(std::string_view name) const {
+        auto found = functions_.find(name);
+        return found == functions_.end() ? nullptr : &found->second;
+    }
+
+    std::size_t size() const noexcept { return functions_.size(); }
+};
+
+} // namespace fun::codegen
@@ -0,0 +1,51 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file syscall.hpp
+ * @brief Declares [emit_syscall](@ref emit_syscall)
+ */
+
+#pragma once
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/IR/Value.h>
+
+#include "env/context.hpp"
+
+namespace fun::codegen {
+
+/**
+ * @enum Syscall
+ * @brief The Linux system calls which generated code makes itself, as
+ * programs do not depend on a C runtime.
+ */
+enum class Syscall {
+    Write,     ///< write(fd, buffer, size)
+    ExitGroup, ///< exit_group(status)
+    ArchPrctl, ///< arch_prctl(code, address), which only x86-64 has
+    Openat,    ///< openat(directory, path, flags, mode)
+    Close,     ///< close(fd)
+};
+
+/**
+ * @brief Emits the system call @p call, with up to four 64 bit
+ * @p arguments, at the insertion point of the builder of @p ctx.
+ *
+ * Only x86-64 and AArch64 Linux are supported.
+ *
+ * @return the result of the call, or nullptr if the target is not
+ * supported or does not have the call; the reason has been printed to
+ * llvm::errs().
+ */
+llvm::Value *emit_syscall(Syscall call,
+                          llvm::ArrayRef<llvm::Value *> arguments,
+                          env::Context &ctx);
+
+} // namespace fun::codegen
@@ -14,18 +14,89 @@
 
 #pragma once
 
+#include <llvm/IR/Function.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Value.h>
 
 #include "env/context.hpp"
 
+#include "IR/lambda.hpp"
+#include "IR/module.hpp"
 #include "IR/scalar.hpp"
 #include "IR/type.hpp"
+#include "pass/purity.hpp"
 
 namespace fun::codegen {
 
+llvm::Type *to_llvm(IR::Type const &type, env::Context &ctx);
 llvm::Type *to_llvm(IR::Type::Ptr const &type, env::Context &ctx);
 
 llvm::Constant *to_llvm(IR::Scalar const &scalar, env::Context &ctx);
 
+/**
+ * @brief Declares the function of @p lambda in the module of @p ctx,
+ * without a body, so that it may be called before it is defined.
+ *
+ * @return the declaration, or nullptr if a function of the same name and
+ * a different type was already declared.
+ */
+llvm::Function *declare(IR::Lambda const &lambda, env::Context &ctx);
+
+/**
+ * @brief Defines the function of @p lambda in the module of @p ctx.
+ *
+ * Every argument and local is given a stack slot, which mem2reg promotes
+ * to registers. The lowering only reads @p lambda, so the caller may drop
+ * it as soon as this returns. Callees must already be declared.
+ *
+ * The function, and each call in it, is [annotated](@ref annotate) with
+ * the effects [inferred](@ref pass::Purity::infer) from those of the
+ * functions it calls, as they are annotated so far.
+ *
+ * @return the definition, or nullptr if @p lambda could not be lowered,
+ * in which case the reason has been printed to llvm::errs().
+ */
+llvm::Function *to_llvm(IR::Lambda const &lambda, env::Context &ctx);
+
+/**
+ * @brief Declares every lambda of @p module, then defines each of them,
+ * so that lambdas may call each other regardless of their order.
+ *
+ * The declarations are annotated with the effects of their lambdas, as
+ * [Purity](@ref pass::Purity) infers them from the whole of @p module.
+ *
+ * @return false if any lambda could not be lowered
+ */
+bool to_llvm(IR::Module const &module, env::Context &ctx);
+
+/**
+ * @brief Attaches the attributes which @p effects imply to @p function:
+ * memory(none) or memory(read), nounwind and willreturn.
+ */
+void annotate(llvm::Function &function, pass::Effects effects);
+
+/**
+ * @brief the effects of calling @p function, as its attributes state them
+ */
+pass::Effects effects(llvm::Function const &function);
+
+/**
+ * @brief Drops the memory attributes of every lambda defined by @p module,
+ * and of the calls within them, once instrumentation has made the lambdas
+ * write to memory.
+ */
+void forget_memory(llvm::Module &module);
+
+/**
+ * @brief true if @p function was lowered from a lambda, rather than
+ * generated to support one, as the runtime of a program is.
+ *
+ * Generated functions are named with a fun. prefix, which no identifier
+ * can spell.
+ */
+inline bool is_lambda(llvm::Function const &function) {
+    return !function.isDeclaration() &&
+           !function.getName().starts_with("fun.");
+}
+
 } // namespace fun::codegen
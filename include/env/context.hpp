@@ -15,17 +15,26 @@
 #pragma once
 
 #include <filesystem>
+#include <memory>
+#include <utility>
+#include <vector>
 
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/ADT/StringSet.h>
+#include <llvm/CodeGen/ParallelCG.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/LegacyPassManager.h>
 #include <llvm/IR/Module.h>
-#include <llvm/MC/TargetRegistry.h>
-#include <llvm/Support/TargetSelect.h>
+#include <llvm/Passes/OptimizationLevel.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/raw_ostream.h>
 #include <llvm/Target/TargetMachine.h>
-#include <llvm/TargetParser/Host.h>
 
 #include "IR/label.hpp"
+#include "IR/module.hpp"
+#include "env/interner.hpp"
+#include "env/target.hpp"
 
 namespace fs = std::filesystem;
 
@@ -36,70 +45,159 @@ namespace fun::env {
  * @brief Represents the context in which code is generated
  * we consider it to be equivalent to a single translation unit.
  * one context per file essentially.
+ *
+ * [intern_string](@ref Context::intern_string) may be called from any
+ * thread, everything else belongs to the thread which owns the context,
+ * which may hand it to another thread. The TargetMachine is borrowed from
+ * the [registry](@ref env::target_machine) of whichever thread uses it,
+ * and is shared with the other contexts of that thread.
  */
 class Context {
-    llvm::LLVMContext context_;
-    llvm::Module module_;
+    // held by pointer, so that they can be released to a JIT
+    std::unique_ptr<llvm::LLVMContext> context_;
+    std::unique_ptr<llvm::Module> module_;
     llvm::IRBuilder<> builder_;
-    llvm::TargetMachine *target_machine_;
-    llvm::StringSet<> string_interner_;
+    TargetKey target_;
+    Interner string_interner_;
+    IR::Module ir_;
 
 public:
-    std::string HostCPUFeatures() {
-        std::string features;
-        llvm::StringMap<bool> host_features = llvm::sys::getHostCPUFeatures();
-
-        auto cursor = host_features.begin();
-        auto end    = host_features.end();
-        auto length = host_features.getNumItems();
-        auto index  = 0U;
-
-        while (cursor != end) {
-            if (cursor->getValue()) {
-                features += "+";
-            } else {
-                features += "-";
-            }
+    /**
+     * @param path the name of the module
+     * @param target the machine to generate code for, the host by default
+     */
+    Context(fs::path path, TargetKey const &target = TargetKey::native())
+        : context_{std::make_unique<llvm::LLVMContext>()},
+          module_{std::make_unique<llvm::Module>(path.string(), *context_)},
+          builder_{*context_}, target_{target} {
+        llvm::TargetMachine *machine = env::target_machine(target_);
+        if (machine == nullptr) { std::exit(1); }
+
+        module_->setDataLayout(machine->createDataLayout());
+        module_->setTargetTriple(target.triple);
+    }
 
-            features += cursor->getKeyData();
+    /// the TargetMachine of the calling thread for the target
+    llvm::TargetMachine &target_machine() {
+        // the target was found when the context was created, so every
+        // thread finds it.
+        return *env::target_machine(target_);
+    }
 
-            if (index < (length - 1)) { features += ","; }
+    IR::Label intern_string(std::string_view string) {
+        return IR::Label{string_interner_.intern(string)};
+    }
 
-            ++cursor;
-            ++index;
+    IR::Module &ir() noexcept { return ir_; }
+
+    llvm::LLVMContext &llvm_context() noexcept { return *context_; }
+    llvm::Module &llvm_module() noexcept { return *module_; }
+    llvm::IRBuilder<> &llvm_builder() noexcept { return builder_; }
+
+    /**
+     * @brief Emits the module as an object file for the target, into
+     * @p object rather than onto disk, so it can be handed straight to the
+     * linker.
+     *
+     * @return false if the target cannot emit object files
+     */
+    bool emit_object(llvm::SmallVectorImpl<char> &object) {
+        llvm::raw_svector_ostream out{object};
+        llvm::legacy::PassManager passes;
+        if (target_machine().addPassesToEmitFile(
+                passes, out, nullptr, llvm::CodeGenFileType::ObjectFile)) {
+            llvm::errs() << "the target cannot emit object files\n";
+            return false;
         }
-
-        return features;
+        passes.run(*module_);
+        return true;
     }
 
-    Context(fs::path path)
-        : context_{}, module_{path.string(), context_}, builder_{context_},
-          target_machine_{nullptr} {
-        std::string target_triple = llvm::sys::getDefaultTargetTriple();
-
-        std::string error;
-        auto target = llvm::TargetRegistry::lookupTarget(target_triple, error);
-        if (!target) {
-            llvm::errs() << error;
-            std::exit(1);
+    /**
+     * @brief Emits the module as up to @p parts object files, into
+     * @p objects, which together define what the module does.
+     *
+     * The module, once optimized, is split by llvm::SplitModule into parts
+     * which keep the functions that call each other together, and each
+     * part is selected and emitted on a thread of its own, with a
+     * TargetMachine of its own. Functions which are local to the module
+     * may be made hidden globals so that the parts can refer to each other,
+     * so the objects are meant to be linked together, and the module
+     * should not be emitted again.
+     *
+     * @return false if the target cannot emit object files
+     */
+    bool emit_objects(unsigned parts,
+                      std::vector<llvm::SmallVector<char, 0>> &objects) {
+        objects.clear();
+        if (parts <= 1) { return emit_object(objects.emplace_back()); }
+
+        // a target which cannot emit object files would be a fatal error
+        // on the threads of the split.
+        llvm::legacy::PassManager check;
+        llvm::SmallVector<char, 0> discard;
+        llvm::raw_svector_ostream sink{discard};
+        if (target_machine().addPassesToEmitFile(
+                check, sink, nullptr, llvm::CodeGenFileType::ObjectFile)) {
+            llvm::errs() << "the target cannot emit object files\n";
+            return false;
         }
 
-        target_machine_ =
-            target->createTargetMachine(target_triple,
-                                        llvm::sys::getHostCPUName(),
-                                        HostCPUFeatures(),
-                                        llvm::TargetOptions{},
-                                        llvm::Reloc::Model::PIC_,
-                                        llvm::CodeModel::Small,
-                                        llvm::CodeGenOptLevel::Default,
-                                        false);
+        objects.resize(parts);
+        std::vector<std::unique_ptr<llvm::raw_svector_ostream>> streams;
+        std::vector<llvm::raw_pwrite_stream *> outputs;
+        for (llvm::SmallVector<char, 0> &object : objects) {
+            outputs.push_back(
+                streams
+                    .emplace_back(
+                        std::make_unique<llvm::raw_svector_ostream>(object))
+                    .get());
+        }
+        llvm::splitCodeGen(*module_, outputs, {}, [this] {
+            return create_target_machine(target_);
+        });
+        return true;
+    }
 
-        module_.setDataLayout(target_machine_->createDataLayout());
-        module_.setTargetTriple(target_triple);
+    /**
+     * @brief Runs LLVM's default optimization pipeline for @p level over
+     * the module, tuned for the target.
+     *
+     * At -Os and -Oz, functions which are the same once lowered, such as
+     * lambdas which differ only in the signedness of their integers, are
+     * merged as well.
+     */
+    void optimize(llvm::OptimizationLevel level) {
+        llvm::LoopAnalysisManager loops;
+        llvm::FunctionAnalysisManager functions;
+        llvm::CGSCCAnalysisManager sccs;
+        llvm::ModuleAnalysisManager modules;
+
+        llvm::PipelineTuningOptions tuning;
+        tuning.MergeFunctions = level.getSizeLevel() > 0;
+
+        llvm::PassBuilder builder{&target_machine(), tuning};
+        builder.registerModuleAnalyses(modules);
+        builder.registerCGSCCAnalyses(sccs);
+        builder.registerFunctionAnalyses(functions);
+        builder.registerLoopAnalyses(loops);
+        builder.crossRegisterProxies(loops, functions, sccs, modules);
+
+        llvm::ModulePassManager passes =
+            level == llvm::OptimizationLevel::O0
+                ? builder.buildO0DefaultPipeline(level)
+                : builder.buildPerModuleDefaultPipeline(level);
+        passes.run(*module_, modules);
     }
 
-    IR::Label intern_string(std::string_view string) {
-        return IR::Label{string_interner_.insert(string).first->getKey()};
+    /**
+     * @brief Gives up the module, and the LLVMContext it lives in, to
+     * hand them to a JIT. No more code may be generated afterwards.
+     */
+    std::pair<std::unique_ptr<llvm::LLVMContext>,
+              std::unique_ptr<llvm::Module>>
+    release() noexcept {
+        return {std::move(context_), std::move(module_)};
     }
 
     llvm::Type *llvm_Int1Ty() { return builder_.getInt1Ty(); }
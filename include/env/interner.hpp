@@ -0,0 +1,52 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file interner.hpp
+ * @brief Defines [Interner](@ref Interner)
+ */
+
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <string_view>
+
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Support/xxhash.h>
+
+namespace fun::env {
+
+/**
+ * @class Interner
+ * @brief A thread safe set of strings with stable storage.
+ *
+ * The set is split into shards by hash, each behind its own lock, so
+ * threads interning different strings rarely contend. Interned strings
+ * live as long as the interner.
+ */
+class Interner {
+    static constexpr std::size_t shard_count = 32;
+
+    struct Shard {
+        std::mutex mutex;
+        llvm::StringSet<> strings;
+    };
+
+    std::array<Shard, shard_count> shards_;
+
+public:
+    std::string_view intern(std::string_view string) {
+        Shard &shard = shards_[llvm::xxh3_64bits(string) % shard_count];
+        std::lock_guard lock{shard.mutex};
+        return shard.strings.insert(string).first->getKey();
+    }
+};
+
+} // namespace fun::env
@@ -0,0 +1,179 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file target.hpp
+ * @brief Defines [host](@ref host) and
+ * [target_machine](@ref target_machine)
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/TargetParser/Host.h>
+
+namespace fun::env {
+
+/**
+ * @struct Host
+ * @brief What the compiler knows about the machine it runs on.
+ */
+struct Host {
+    std::string triple;
+    std::string cpu;
+    /// the features of the cpu, as "+feature,-feature,..."
+    std::string features;
+};
+
+/**
+ * @brief the host, which is queried once per process, by whichever thread
+ * asks first.
+ */
+inline Host const &host() {
+    static Host const queried = [] {
+        Host result{llvm::sys::getDefaultTargetTriple(),
+                    llvm::sys::getHostCPUName().str(),
+                    {}};
+
+        llvm::StringMap<bool> features = llvm::sys::getHostCPUFeatures();
+        for (auto const &feature : features) {
+            if (!result.features.empty()) { result.features += ","; }
+            result.features += feature.getValue() ? "+" : "-";
+            result.features += feature.getKey();
+        }
+        return result;
+    }();
+    return queried;
+}
+
+/**
+ * @struct TargetKey
+ * @brief Everything which distinguishes one TargetMachine from another.
+ */
+struct TargetKey {
+    std::string triple;
+    std::string cpu;
+    std::string features;
+    llvm::CodeGenOptLevel opt_level = llvm::CodeGenOptLevel::Default;
+    /**
+     * @brief whether every function and global is emitted into a section
+     * of its own, with an address significance table, so that the linker
+     * may fold identical code and drop what is never referenced.
+     */
+    bool sections = false;
+
+    /// the host, at the given optimization level
+    static TargetKey
+    native(llvm::CodeGenOptLevel opt_level = llvm::CodeGenOptLevel::Default) {
+        Host const &machine = host();
+        return {machine.triple, machine.cpu, machine.features, opt_level};
+    }
+
+    /**
+     * @brief the triple of the host, for any machine with @p cpu rather
+     * than for the features of this one, at the given optimization level
+     */
+    static TargetKey
+    generic(std::string cpu,
+            llvm::CodeGenOptLevel opt_level = llvm::CodeGenOptLevel::Default) {
+        return {host().triple, std::move(cpu), {}, opt_level};
+    }
+
+    auto operator<=>(TargetKey const &) const = default;
+};
+
+namespace detail {
+
+/**
+ * @brief looks up the llvm::Target of @p triple, once per triple per
+ * process. Targets are immutable, so they are shared between threads.
+ */
+inline llvm::Target const *lookup_target(std::string const &triple) {
+    static std::mutex mutex;
+    static std::map<std::string, llvm::Target const *, std::less<>> targets;
+
+    std::lock_guard lock{mutex};
+    if (auto found = targets.find(triple); found != targets.end()) {
+        return found->second;
+    }
+
+    std::string error;
+    llvm::Target const *target =
+        llvm::TargetRegistry::lookupTarget(triple, error);
+    if (target == nullptr) { llvm::errs() << error << "\n"; }
+    targets.emplace(triple, target);
+    return target;
+}
+
+} // namespace detail
+
+/**
+ * @brief creates a TargetMachine for @p key, which belongs to the caller.
+ *
+ * @return nullptr if there is no target for the triple of @p key, in
+ * which case the reason has been printed to llvm::errs().
+ */
+inline std::unique_ptr<llvm::TargetMachine>
+create_target_machine(TargetKey const &key) {
+    llvm::Target const *target = detail::lookup_target(key.triple);
+    if (target == nullptr) { return nullptr; }
+
+    llvm::TargetOptions options;
+    options.FunctionSections   = key.sections;
+    options.DataSections       = key.sections;
+    options.UniqueSectionNames = key.sections;
+    options.EmitAddrsig        = key.sections;
+
+    return std::unique_ptr<llvm::TargetMachine>{
+        target->createTargetMachine(key.triple,
+                                    key.cpu,
+                                    key.features,
+                                    options,
+                                    llvm::Reloc::Model::PIC_,
+                                    llvm::CodeModel::Small,
+                                    key.opt_level,
+                                    false)};
+}
+
+/**
+ * @brief a TargetMachine for @p key, owned by the calling thread.
+ *
+ * A TargetMachine may not be used by two threads at once, so each thread
+ * gets its own, created the first time that thread asks for @p key and
+ * destroyed when the thread exits. Every later request on the same thread
+ * returns the same machine, so creating a Context per file is cheap.
+ *
+ * @return nullptr if there is no target for the triple of @p key, in
+ * which case the reason has been printed to llvm::errs().
+ */
+inline llvm::TargetMachine *target_machine(TargetKey const &key) {
+    thread_local std::map<TargetKey, std::unique_ptr<llvm::TargetMachine>>
+        machines;
+
+    if (auto found = machines.find(key); found != machines.end()) {
+        return found->second.get();
+    }
+
+    std::unique_ptr<llvm::TargetMachine> machine =
+        create_target_machine(key);
+    if (machine == nullptr) { return nullptr; }
+    return machines.emplace(key, std::move(machine)).first->second.get();
+}
+
+} // namespace fun::env
@@ -0,0 +1,396 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file evaluator.hpp
+ * @brief Defines [Evaluator](@ref Evaluator)
+ */
+
+#pragma once
+
+#include <bit>
+#include <compare>
+#include <cstdint>
+#include <map>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "IR/lambda.hpp"
+#include "IR/module.hpp"
+#include "eval/fold.hpp"
+
+namespace fun::eval {
+
+/**
+ * @struct Budget
+ * @brief Limits on a single evaluation, so that compiling a program cannot
+ * hang or exhaust memory on a lambda which does not terminate.
+ */
+struct Budget {
+    /// instructions executed, counting those of every nested call
+    std::uint64_t steps = 1 << 20;
+    /// bytes of call frames live at once
+    std::uint64_t memory = 1 << 20;
+    /// calls nested at once
+    std::uint64_t depth = 256;
+};
+
+/**
+ * @class Evaluator
+ * @brief Runs the lambdas of a module at compile time.
+ *
+ * The result of every successful call is memoized by the callee and the
+ * values of its arguments, including calls nested within an evaluation,
+ * so repeated and recursive evaluations share their work. Lambdas have no
+ * side effects, so a result depends on nothing else. The memo must be
+ * [cleared](@ref Evaluator::clear) when a lambda of the module changes.
+ *
+ * Each lambda is folded under its own fast math flags, and as checked
+ * arithmetic if it is checked, which a driver default must already have
+ * been applied to.
+ */
+class Evaluator {
+public:
+    struct Result {
+        Error error;
+        IR::Scalar value;
+    };
+
+private:
+    struct Key {
+        std::string_view lambda;
+        /// the type and bits of each argument, so that floating point
+        /// arguments compare by representation, and NaN can be a key.
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> arguments;
+
+        auto operator<=>(Key const &) const = default;
+    };
+
+    static std::uint64_t bits(IR::Scalar const &scalar) noexcept {
+        using IR::Scalar;
+        switch (scalar.index()) {
+        case 0:  return 0;
+        case 1:  return scalar.as<Scalar::Bool>();
+        case 2:  return scalar.as<Scalar::u8>();
+        case 3:  return scalar.as<Scalar::u16>();
+        case 4:  return scalar.as<Scalar::u32>();
+        case 5:  return scalar.as<Scalar::u64>();
+        case 6:  return static_cast<std::uint64_t>(scalar.as<Scalar::i8>());
+        case 7:  return static_cast<std::uint64_t>(scalar.as<Scalar::i16>());
+        case 8:  return static_cast<std::uint64_t>(scalar.as<Scalar::i32>());
+        case 9:  return static_cast<std::uint64_t>(scalar.as<Scalar::i64>());
+        case 10: return std::bit_cast<std::uint32_t>(scalar.as<float>());
+        case 11: return std::bit_cast<std::uint64_t>(scalar.as<double>());
+        default: std::unreachable();
+        }
+    }
+
+    static Key key(IR::Lambda const &lambda,
+                   std::span<IR::Scalar const> arguments) {
+        Key key{lambda.name().name, {}};
+        key.arguments.reserve(arguments.size());
+        for (IR::Scalar const &argument : arguments) {
+            key.arguments.emplace_back(argument.index(), bits(argument));
+        }
+        return key;
+    }
+
+    /// the memory charged for the frame of @p lambda
+    static std::uint64_t frame_bytes(IR::Lambda const &lambda) noexcept {
+        return sizeof(std::vector<IR::Scalar>) +
+               lambda.frame_size() * sizeof(IR::Scalar);
+    }
+
+    std::unordered_map<std::string_view, IR::Lambda const *> lambdas_;
+    std::map<Key, IR::Scalar> memo_;
+    Budget budget_;
+
+    // the state of the current evaluation
+    std::uint64_t steps_  = 0;
+    std::uint64_t memory_ = 0;
+    std::uint64_t depth_  = 0;
+
+    Result run(IR::Lambda const &lambda,
+               std::span<IR::Scalar const> arguments) {
+        if (arguments.size() != lambda.arguments().size()) {
+            return {Error::TypeMismatch, {}};
+        }
+        for (std::size_t index = 0; index < arguments.size(); ++index) {
+            if (arguments[index].index() !=
+                lambda.arguments()[index].type->index()) {
+                return {Error::TypeMismatch, {}};
+            }
+        }
+
+        Key memo_key = key(lambda, arguments);
+        if (auto found = memo_.find(memo_key); found != memo_.end()) {
+            return {Error::None, found->second};
+        }
+
+        std::uint64_t const bytes = frame_bytes(lambda);
+        if (depth_ == budget_.depth) { return {Error::DepthLimit, {}}; }
+        if (budget_.memory - memory_ < bytes) {
+            return {Error::MemoryLimit, {}};
+        }
+        ++depth_;
+        memory_ += bytes;
+        Result result = execute(lambda, arguments);
+        memory_ -= bytes;
+        --depth_;
+
+        if (result.error == Error::None) {
+            memo_.emplace(std::move(memo_key), result.value);
+        }
+        return result;
+    }
+
+    Result execute(IR::Lambda const &lambda,
+                   std::span<IR::Scalar const> arguments) {
+        using IR::Instruction;
+        using Opcode = Instruction::Opcode;
+
+        IR::FastMath const flags =
+            lambda.fast_math().value_or(IR::FastMath::None);
+        std::vector<IR::Scalar> slots;
+        slots.reserve(lambda.frame_size());
+        slots.assign(arguments.begin(), arguments.end());
+        for (IR::Local const &local : lambda.locals()) {
+            IR::Scalar initializer = local.value_.as<IR::Scalar>();
+            slots.push_back(initializer.index() == local.type_->index()
+                                ? initializer
+                                : zero(*local.type_));
+        }
+
+        auto value = [&](IR::Operand operand, IR::Scalar &result) {
+            if (operand.is<IR::Scalar>()) {
+                result = operand.as<IR::Scalar>();
+                return Error::None;
+            }
+            if (!operand.is<IR::LocalHandle>()) {
+                return Error::NotConstant;
+            }
+            std::uint64_t index = operand.as<IR::LocalHandle>().index;
+            if (index >= slots.size()) { return Error::NotConstant; }
+            result = slots[index];
+            return Error::None;
+        };
+
+        auto store = [&](IR::Operand operand, IR::Scalar result) {
+            if (!operand.is<IR::LocalHandle>()) {
+                return Error::NotConstant;
+            }
+            std::uint64_t index = operand.as<IR::LocalHandle>().index;
+            if (index >= slots.size()) { return Error::NotConstant; }
+            if (result.index() != slots[index].index()) {
+                return Error::TypeMismatch;
+            }
+            slots[index] = result;
+            return Error::None;
+        };
+
+        // a branch sets the block which runs next, which is otherwise the
+        // one after the current block.
+        auto branch = [&](Instruction const &instruction, std::size_t &next) {
+            if (!instruction.A().is<IR::BlockHandle>()) {
+                return Error::TypeMismatch;
+            }
+            std::uint64_t target = instruction.A().as<IR::BlockHandle>().index;
+            if (target >= lambda.body().size()) { return Error::NoSuchBlock; }
+
+            bool jump = true;
+            if (IR::is_conditional(instruction.opcode())) {
+                if (instruction.format() == Instruction::Format::Unary) {
+                    return Error::TypeMismatch;
+                }
+                IR::Scalar B;
+                IR::Scalar C;
+                Error error = value(instruction.B(), B);
+                if (error == Error::None &&
+                    instruction.format() == Instruction::Format::Ternary) {
+                    error = value(instruction.C(), C);
+                }
+                if (error == Error::None) {
+                    error =
+                        taken(instruction.opcode(), B, C, jump, flags);
+                }
+                if (error != Error::None) { return error; }
+            }
+            if (jump) { next = target; }
+            return Error::None;
+        };
+
+        IR::Lambda::Body const &body = lambda.body();
+        for (std::size_t current = 0; current < body.size();) {
+            std::size_t next = current + 1;
+            for (Instruction const &instruction : body[current]) {
+                if (++steps_ > budget_.steps) {
+                    return {Error::StepLimit, {}};
+                }
+
+                if (IR::is_branch(instruction.opcode())) {
+                    Error error = branch(instruction, next);
+                    if (error != Error::None) { return {error, {}}; }
+                    break;
+                }
+
+                IR::Scalar B;
+                IR::Scalar C;
+                IR::Scalar result;
+                Error error = Error::None;
+                switch (instruction.opcode()) {
+                case Opcode::Ret: {
+                    error = value(instruction.A(), result);
+                    if (error != Error::None) { return {error, {}}; }
+                    if (result.index() != lambda.return_type()->index()) {
+                        return {Error::TypeMismatch, {}};
+                    }
+                    return {Error::None, result};
+                }
+
+                case Opcode::Call: {
+                    Result called = call(instruction, slots);
+                    if (called.error != Error::None) { return called; }
+                    result = called.value;
+                    break;
+                }
+
+                case Opcode::Load: {
+                    if (instruction.format() == Instruction::Format::Unary) {
+                        return {Error::TypeMismatch, {}};
+                    }
+                    error = value(instruction.B(), result);
+                    break;
+                }
+
+                // arrays and slices have no value at compile time.
+                case Opcode::Subscript:
+                case Opcode::Insert:
+                case Opcode::UncheckedSubscript:
+                case Opcode::UncheckedInsert:
+                case Opcode::Slice:
+                case Opcode::Length: return {Error::NotConstant, {}};
+
+                case Opcode::Neg: {
+                    if (instruction.format() == Instruction::Format::Unary) {
+                        return {Error::TypeMismatch, {}};
+                    }
+                    error = value(instruction.B(), B);
+                    if (error == Error::None) {
+                        error = fold(Opcode::Neg,
+                                     B,
+                                     B,
+                                     result,
+                                     flags,
+                                     lambda.checked());
+                    }
+                    break;
+                }
+
+                default: {
+                    if (instruction.format() !=
+                        Instruction::Format::Ternary) {
+                        return {Error::TypeMismatch, {}};
+                    }
+                    error = value(instruction.B(), B);
+                    if (error == Error::None) {
+                        error = value(instruction.C(), C);
+                    }
+                    if (error == Error::None) {
+                        error = fold(instruction.opcode(),
+                                     B,
+                                     C,
+                                     result,
+                                     flags,
+                                     lambda.checked());
+                    }
+                    break;
+                }
+                }
+
+                if (error == Error::None) {
+                    error = store(instruction.A(), result);
+                }
+                if (error != Error::None) { return {error, {}}; }
+            }
+            current = next;
+        }
+
+        // falling off the end of a lambda returns zero, as it does once
+        // the lambda is lowered.
+        return {Error::None, zero(*lambda.return_type())};
+    }
+
+    /**
+     * @brief call %result, @callee, %first; the arguments are held by
+     * consecutive locals, starting with %first.
+     */
+    Result call(IR::Instruction const &instruction,
+                std::span<IR::Scalar const> slots) {
+        if (!instruction.B().is<IR::Label>()) {
+            return {Error::NotConstant, {}};
+        }
+        auto found = lambdas_.find(instruction.B().as<IR::Label>().name);
+        if (found == lambdas_.end()) { return {Error::UndefinedLambda, {}}; }
+        IR::Lambda const &callee = *found->second;
+
+        std::uint64_t count = callee.arguments().size();
+        if (count == 0) { return run(callee, {}); }
+        if (instruction.format() != IR::Instruction::Format::Ternary ||
+            !instruction.C().is<IR::LocalHandle>()) {
+            return {Error::TypeMismatch, {}};
+        }
+        std::uint64_t first = instruction.C().as<IR::LocalHandle>().index;
+        if (first > slots.size() || slots.size() - first < count) {
+            return {Error::TypeMismatch, {}};
+        }
+        return run(callee, slots.subspan(first, count));
+    }
+
+public:
+    explicit Evaluator(IR::Module const &module, Budget budget = {})
+        : budget_{budget} {
+        for (IR::Lambda const &lambda : module) {
+            lambdas_.emplace(lambda.name().name, &lambda);
+        }
+    }
+
+    /**
+     * @brief evaluates @p lambda applied to @p arguments, within the
+     * budget of the evaluator.
+     */
+    Result call(IR::Lambda const &lambda,
+                std::span<IR::Scalar const> arguments) {
+        steps_  = 0;
+        memory_ = 0;
+        depth_  = 0;
+        return run(lambda, arguments);
+    }
+
+    /**
+     * @brief evaluates the lambda named @p name applied to @p arguments
+     */
+    Result call(IR::Label name, std::span<IR::Scalar const> arguments) {
+        auto found = lambdas_.find(name.name);
+        if (found == lambdas_.end()) { return {Error::UndefinedLambda, {}}; }
+        return call(*found->second, arguments);
+    }
+
+    /// the number of calls whose results are memoized
+    std::size_t memoized() const noexcept { return memo_.size(); }
+
+    /// the instructions executed by the last evaluation
+    std::uint64_t steps() const noexcept { return steps_; }
+
+    void clear() noexcept { memo_.clear(); }
+};
+
+} // namespace fun::eval
@@ -0,0 +1,307 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file fold.hpp
+ * @brief Defines [fold](@ref fold)
+ */
+
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <type_traits>
+
+#include "IR/fast_math.hpp"
+#include "IR/instruction.hpp"
+#include "IR/scalar.hpp"
+#include "IR/type.hpp"
+
+namespace fun::eval {
+
+enum class Error {
+    None,
+    /// the operands of an instruction do not have the types it requires
+    TypeMismatch,
+    /// integer division or remainder by zero
+    DivideByZero,
+    /// signed division of the minimum value by -1, or checked arithmetic
+    /// whose result does not fit its type
+    Overflow,
+    /// an operand which has no value at compile time
+    NotConstant,
+    /// a call to a lambda which is declared but not defined
+    UndefinedLambda,
+    /// the evaluation executed more instructions than its budget allows
+    StepLimit,
+    /// the evaluation needed more memory than its budget allows
+    MemoryLimit,
+    /// the evaluation nested more calls than its budget allows
+    DepthLimit,
+    /// a branch to a block which the lambda does not have
+    NoSuchBlock,
+    /// a NaN or an infinity, where fast math assumes there is none
+    Poison,
+    /// an element of an array or a slice, by an index past its length
+    OutOfBounds,
+};
+
+inline std::ostream &operator<<(std::ostream &out, Error error) {
+    switch (error) {
+    case Error::None:            return out << "none";
+    case Error::TypeMismatch:    return out << "type mismatch";
+    case Error::DivideByZero:    return out << "division by zero";
+    case Error::Overflow:        return out << "signed division overflow";
+    case Error::NotConstant:     return out << "not a constant";
+    case Error::UndefinedLambda: return out << "call to an undefined lambda";
+    case Error::StepLimit:       return out << "step limit exceeded";
+    case Error::MemoryLimit:     return out << "memory limit exceeded";
+    case Error::DepthLimit:      return out << "call depth limit exceeded";
+    case Error::NoSuchBlock:     return out << "branch to no such block";
+    case Error::Poison:          return out << "poison under fast math";
+    case Error::OutOfBounds:     return out << "index out of bounds";
+    default:                     std::unreachable();
+    }
+}
+
+/**
+ * @brief the zero value of @p type, which a local without an initializer
+ * holds. Function types have no scalar zero, and give nil.
+ */
+inline IR::Scalar zero(IR::Type const &type) noexcept {
+    switch (type.index()) {
+    case 1:  return IR::Scalar{IR::Scalar::Bool{false}};
+    case 2:  return IR::Scalar{IR::Scalar::u8{0}};
+    case 3:  return IR::Scalar{IR::Scalar::u16{0}};
+    case 4:  return IR::Scalar{IR::Scalar::u32{0}};
+    case 5:  return IR::Scalar{IR::Scalar::u64{0}};
+    case 6:  return IR::Scalar{IR::Scalar::i8{0}};
+    case 7:  return IR::Scalar{IR::Scalar::i16{0}};
+    case 8:  return IR::Scalar{IR::Scalar::i32{0}};
+    case 9:  return IR::Scalar{IR::Scalar::i64{0}};
+    case 10: return IR::Scalar{IR::Scalar::f32{0}};
+    case 11: return IR::Scalar{IR::Scalar::f64{0}};
+    default: return IR::Scalar{};
+    }
+}
+
+/// the zero value of the type of @p scalar
+inline IR::Scalar zero_like(IR::Scalar const &scalar) noexcept {
+    switch (scalar.index()) {
+    case 1:  return IR::Scalar{IR::Scalar::Bool{false}};
+    case 2:  return IR::Scalar{IR::Scalar::u8{0}};
+    case 3:  return IR::Scalar{IR::Scalar::u16{0}};
+    case 4:  return IR::Scalar{IR::Scalar::u32{0}};
+    case 5:  return IR::Scalar{IR::Scalar::u64{0}};
+    case 6:  return IR::Scalar{IR::Scalar::i8{0}};
+    case 7:  return IR::Scalar{IR::Scalar::i16{0}};
+    case 8:  return IR::Scalar{IR::Scalar::i32{0}};
+    case 9:  return IR::Scalar{IR::Scalar::i64{0}};
+    case 10: return IR::Scalar{IR::Scalar::f32{0}};
+    case 11: return IR::Scalar{IR::Scalar::f64{0}};
+    default: return IR::Scalar{};
+    }
+}
+
+namespace detail {
+
+/// compares @p B to @p C as the comparison @p opcode does
+template <class T>
+bool compare(IR::Instruction::Opcode opcode, T B, T C) noexcept {
+    using Opcode = IR::Instruction::Opcode;
+    switch (opcode) {
+    case Opcode::Eq: return B == C;
+    case Opcode::Ne: return B != C;
+    case Opcode::Lt: return B < C;
+    case Opcode::Le: return B <= C;
+    case Opcode::Gt: return B > C;
+    case Opcode::Ge: return B >= C;
+    default:         std::unreachable();
+    }
+}
+
+/// whether @p value is one which @p flags assume there is none of
+template <class T> bool poison(T value, IR::FastMath flags) noexcept {
+    return (IR::has(flags, IR::FastMath::NoNaNs) && std::isnan(value)) ||
+           (IR::has(flags, IR::FastMath::NoInfs) && std::isinf(value));
+}
+
+/**
+ * @brief folds one arithmetic instruction on operands of type T, with the
+ * semantics the instruction is lowered to in LLVM IR: integers wrap, and
+ * floating point follows IEEE 754, under the fast math @p flags.
+ *
+ * A NaN or an infinity which @p flags assume away is poison, which LLVM
+ * may replace with any value, so it is not folded to any one of them.
+ * The other flags only permit LLVM to round differently, and the IEEE 754
+ * result is one of those they permit. If @p checked, integer arithmetic
+ * which would wrap around overflows instead, as it traps once lowered.
+ */
+template <class T>
+Error fold(IR::Instruction::Opcode opcode,
+           T B,
+           T C,
+           IR::Scalar &result,
+           IR::FastMath flags,
+           bool checked) noexcept {
+    using Opcode = IR::Instruction::Opcode;
+    if constexpr (std::is_floating_point_v<T>) {
+        if (poison(B, flags) || poison(C, flags)) { return Error::Poison; }
+    }
+    if (IR::is_comparison(opcode)) {
+        result = IR::Scalar::Bool{compare(opcode, B, C)};
+        return Error::None;
+    }
+    if constexpr (std::is_floating_point_v<T>) {
+        T value{};
+        switch (opcode) {
+        case Opcode::Neg: value = T(-B); break;
+        case Opcode::Add: value = T(B + C); break;
+        case Opcode::Sub: value = T(B - C); break;
+        case Opcode::Mul: value = T(B * C); break;
+        case Opcode::Div: value = T(B / C); break;
+        case Opcode::Rem: value = T(std::fmod(B, C)); break;
+        default:          return Error::TypeMismatch;
+        }
+        if (poison(value, flags)) { return Error::Poison; }
+        result = value;
+    } else {
+        if (checked && opcode != Opcode::Div && opcode != Opcode::Rem) {
+            T value{};
+            bool wraps = false;
+            switch (opcode) {
+            case Opcode::Neg:
+                wraps = __builtin_sub_overflow(T{}, B, &value);
+                break;
+            case Opcode::Add:
+                wraps = __builtin_add_overflow(B, C, &value);
+                break;
+            case Opcode::Sub:
+                wraps = __builtin_sub_overflow(B, C, &value);
+                break;
+            case Opcode::Mul:
+                wraps = __builtin_mul_overflow(B, C, &value);
+                break;
+            default: return Error::TypeMismatch;
+            }
+            if (wraps) { return Error::Overflow; }
+            result = value;
+            return Error::None;
+        }
+        // wrapping arithmetic, computed in 64 bit unsigned integers so
+        // that neither overflow nor integer promotion is undefined.
+        auto const X = static_cast<std::uint64_t>(B);
+        auto const Y = static_cast<std::uint64_t>(C);
+        switch (opcode) {
+        case Opcode::Neg: result = static_cast<T>(0 - X); break;
+        case Opcode::Add: result = static_cast<T>(X + Y); break;
+        case Opcode::Sub: result = static_cast<T>(X - Y); break;
+        case Opcode::Mul: result = static_cast<T>(X * Y); break;
+        case Opcode::Div:
+        case Opcode::Rem: {
+            if (C == 0) { return Error::DivideByZero; }
+            if constexpr (std::is_signed_v<T>) {
+                if (B == std::numeric_limits<T>::min() && C == -1) {
+                    return Error::Overflow;
+                }
+            }
+            result = static_cast<T>(opcode == Opcode::Div ? B / C : B % C);
+            break;
+        }
+        default: return Error::TypeMismatch;
+        }
+    }
+    return Error::None;
+}
+
+} // namespace detail
+
+/**
+ * @brief folds the arithmetic or comparison instruction @p opcode applied
+ * to @p B and @p C, under the fast math @p flags of its lambda, and as
+ * checked arithmetic if it is @p checked. Neg ignores @p C.
+ *
+ * Both operands must have the same numeric type, which is the type of
+ * the result of arithmetic; a comparison gives a bool, and may also
+ * compare two bools.
+ */
+inline Error fold(IR::Instruction::Opcode opcode,
+                  IR::Scalar const &B,
+                  IR::Scalar const &C,
+                  IR::Scalar &result,
+                  IR::FastMath flags = IR::FastMath::None,
+                  bool checked       = false) noexcept {
+    using IR::Scalar;
+    if (opcode != IR::Instruction::Opcode::Neg && B.index() != C.index()) {
+        return Error::TypeMismatch;
+    }
+
+    auto apply = [&]<class T>() {
+        T const other = opcode == IR::Instruction::Opcode::Neg ? T{}
+                                                               : C.as<T>();
+        return detail::fold<T>(
+            opcode, B.as<T>(), other, result, flags, checked);
+    };
+
+    switch (B.index()) {
+    case 1:
+        if (!IR::is_comparison(opcode)) { return Error::TypeMismatch; }
+        result = Scalar::Bool{detail::compare(
+            opcode, B.as<Scalar::Bool>(), C.as<Scalar::Bool>())};
+        return Error::None;
+    case 2:  return apply.template operator()<Scalar::u8>();
+    case 3:  return apply.template operator()<Scalar::u16>();
+    case 4:  return apply.template operator()<Scalar::u32>();
+    case 5:  return apply.template operator()<Scalar::u64>();
+    case 6:  return apply.template operator()<Scalar::i8>();
+    case 7:  return apply.template operator()<Scalar::i16>();
+    case 8:  return apply.template operator()<Scalar::i32>();
+    case 9:  return apply.template operator()<Scalar::i64>();
+    case 10: return apply.template operator()<Scalar::f32>();
+    case 11: return apply.template operator()<Scalar::f64>();
+    default: return Error::TypeMismatch;
+    }
+}
+
+/**
+ * @brief decides whether the conditional branch @p opcode on @p B and
+ * @p C is @p taken, under the fast math @p flags of its lambda. Jz and Jnz
+ * compare @p B to zero, and ignore @p C.
+ */
+inline Error taken(IR::Instruction::Opcode opcode,
+                   IR::Scalar const &B,
+                   IR::Scalar const &C,
+                   bool &taken,
+                   IR::FastMath flags = IR::FastMath::None) noexcept {
+    using Opcode = IR::Instruction::Opcode;
+    IR::Scalar result;
+    Error error = Error::None;
+    switch (opcode) {
+    case Opcode::Jz:
+    case Opcode::Jnz: {
+        if (B.index() == 0) { return Error::TypeMismatch; }
+        error = fold(opcode == Opcode::Jz ? Opcode::Eq : Opcode::Ne,
+                     B,
+                     zero_like(B),
+                     result,
+                     flags);
+        break;
+    }
+    default:
+        error = fold(IR::comparison(opcode), B, C, result, flags);
+        break;
+    }
+    if (error == Error::None) { taken = result.as<IR::Scalar::Bool>(); }
+    return error;
+}
+
+} // namespace fun::eval
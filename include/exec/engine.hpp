@@ -0,0 +1,882 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file engine.hpp
+ * @brief Defines [Engine](@ref Engine)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "IR/lambda.hpp"
+#include "IR/module.hpp"
+#include "IR/structure.hpp"
+#include "eval/evaluator.hpp"
+#include "eval/fold.hpp"
+#include "pass/cfg.hpp"
+#include "pass/ranges.hpp"
+#include "support/thread_pool.hpp"
+
+namespace fun::exec {
+
+/**
+ * @brief the native code of a lambda, called through an adapter which
+ * reads each argument from a 64 bit cell of @p arguments and writes the
+ * result to the cell @p result. A value occupies the low addressed bytes
+ * of its cell, as if copied there by memcpy.
+ */
+using Native = void (*)(std::uint64_t const *arguments,
+                        std::uint64_t *result);
+
+/**
+ * @class Compiler
+ * @brief Compiles hot lambdas to [Native](@ref Native) code for the
+ * [Engine](@ref Engine).
+ */
+class Compiler {
+public:
+    virtual ~Compiler() = default;
+
+    /**
+     * @brief compiles @p lambda, which is a lambda of @p module.
+     *
+     * Called once per lambda, from the background compile thread of the
+     * engine. The native code must live as long as the compiler.
+     *
+     * @return nullptr if @p lambda could not be compiled, in which case it
+     * keeps being interpreted.
+     */
+    virtual Native compile(IR::Module const &module,
+                           IR::Lambda const &lambda) = 0;
+};
+
+/**
+ * @class Engine
+ * @brief Runs the lambdas of a module, interpreting them until they are
+ * hot, and then calling native code.
+ *
+ * Every lambda starts out interpreted, directly from its
+ * [Blocks](@ref IR::Block), and counts its calls and the branches back to
+ * an earlier block. Once either count reaches the threshold, the lambda is
+ * queued to be compiled on a background thread while the interpreter
+ * carries on. Every call after the native code is published dispatches to
+ * it, including calls made from interpreted lambdas.
+ *
+ * There is no bytecode of its own: an instruction of the IR is already of
+ * a fixed size, so the interpreter walks the instructions as they are.
+ * The arguments and locals of each frame are laid out on a stack of
+ * scalar cells, one for each call into the engine: a struct or an array
+ * takes a cell for each of its scalars, in the order its type declares
+ * them, and a slice takes two, the index of the cell of its first element
+ * and its length. Native code only passes scalars, so a lambda which
+ * takes or returns anything else is only compiled along with a lambda
+ * which calls it, and cannot be [called](@ref Engine::call) from outside.
+ *
+ * Native code must give what the interpreter gives, but it cannot report
+ * an error: division by zero, or of the least signed integer by -1, is
+ * undefined there, and checked arithmetic, or an index out of bounds,
+ * traps. So a lambda which may fail so, or calls one which may, as its
+ * [Ranges](@ref pass::Ranges) tell, or as an index which was not proven
+ * in bounds does, is never compiled, and keeps reporting the error.
+ *
+ * Calls may be made from any number of threads at once.
+ */
+class Engine {
+public:
+    struct Options {
+        /// calls, or backward branches, after which a lambda is compiled
+        std::uint64_t threshold = 1000;
+        /// compile on a background thread, rather than during the call
+        /// which crossed the threshold
+        bool background = true;
+        /// interpreted calls nested at once
+        std::uint64_t depth = 4096;
+        /// cells the frames of a call may take on the stack at once
+        std::uint64_t cells = std::uint64_t{1} << 24;
+    };
+
+    using Result = eval::Evaluator::Result;
+
+    struct Profile {
+        std::uint64_t calls;
+        std::uint64_t backedges;
+        bool native;
+    };
+
+private:
+    struct Entry {
+        IR::Lambda const *lambda;
+        /// the first cell of each argument and local in a frame, and the
+        /// cells of the whole frame last
+        std::vector<std::uint64_t> offsets;
+        std::atomic<std::uint64_t> calls{0};
+        std::atomic<std::uint64_t> backedges{0};
+        std::atomic<Native> native{nullptr};
+        std::atomic<bool> queued{false};
+    };
+
+    IR::Module const &module_;
+    Options options_;
+    std::unique_ptr<Compiler> compiler_;
+    std::unordered_map<std::string_view, std::unique_ptr<Entry>> entries_;
+    std::mutex pending_mutex_;
+    std::vector<std::future<void>> pending_;
+    // declared last, so that queued compiles finish before anything they
+    // use is destroyed.
+    std::optional<support::ThreadPool> pool_;
+
+    /// the cells of every frame of a call
+    using Stack = std::vector<IR::Scalar>;
+
+    template <class T> static std::uint64_t to_cell(T value) noexcept {
+        std::uint64_t cell = 0;
+        std::memcpy(&cell, &value, sizeof(T));
+        return cell;
+    }
+
+    template <class T> static T from_cell(std::uint64_t cell) noexcept {
+        T value;
+        std::memcpy(&value, &cell, sizeof(T));
+        return value;
+    }
+
+    static std::uint64_t pack(IR::Scalar const &scalar) noexcept {
+        using IR::Scalar;
+        switch (scalar.index()) {
+        case 0:  return 0;
+        case 1:  return to_cell(scalar.as<Scalar::Bool>());
+        case 2:  return to_cell(scalar.as<Scalar::u8>());
+        case 3:  return to_cell(scalar.as<Scalar::u16>());
+        case 4:  return to_cell(scalar.as<Scalar::u32>());
+        case 5:  return to_cell(scalar.as<Scalar::u64>());
+        case 6:  return to_cell(scalar.as<Scalar::i8>());
+        case 7:  return to_cell(scalar.as<Scalar::i16>());
+        case 8:  return to_cell(scalar.as<Scalar::i32>());
+        case 9:  return to_cell(scalar.as<Scalar::i64>());
+        case 10: return to_cell(scalar.as<Scalar::f32>());
+        case 11: return to_cell(scalar.as<Scalar::f64>());
+        default: std::unreachable();
+        }
+    }
+
+    static IR::Scalar unpack(std::uint64_t cell,
+                             IR::Type const &type) noexcept {
+        using IR::Scalar;
+        switch (type.index()) {
+        case 1:  return Scalar{from_cell<Scalar::Bool>(cell)};
+        case 2:  return Scalar{from_cell<Scalar::u8>(cell)};
+        case 3:  return Scalar{from_cell<Scalar::u16>(cell)};
+        case 4:  return Scalar{from_cell<Scalar::u32>(cell)};
+        case 5:  return Scalar{from_cell<Scalar::u64>(cell)};
+        case 6:  return Scalar{from_cell<Scalar::i8>(cell)};
+        case 7:  return Scalar{from_cell<Scalar::i16>(cell)};
+        case 8:  return Scalar{from_cell<Scalar::i32>(cell)};
+        case 9:  return Scalar{from_cell<Scalar::i64>(cell)};
+        case 10: return Scalar{from_cell<Scalar::f32>(cell)};
+        case 11: return Scalar{from_cell<Scalar::f64>(cell)};
+        default: return Scalar{};
+        }
+    }
+
+    /// the cells of the stack which a value of @p type takes
+    static std::uint64_t cells(IR::Type const &type) noexcept {
+        if (type.is<IR::Type::Struct>()) {
+            std::uint64_t total = 0;
+            for (auto const &field : type.as<IR::Type::Struct>().fields) {
+                total += cells(*field.type);
+            }
+            return total;
+        }
+        if (type.is<IR::Type::Array>()) {
+            IR::Type::Array const &array = type.as<IR::Type::Array>();
+            return array.length * cells(*array.element);
+        }
+        return type.is<IR::Type::Slice>() ? 2 : 1;
+    }
+
+    /// writes the zero of @p type to the cells of @p stack from @p at on
+    static void zero(IR::Type const &type, Stack &stack, std::uint64_t at) {
+        if (type.is<IR::Type::Struct>()) {
+            for (auto const &field : type.as<IR::Type::Struct>().fields) {
+                zero(*field.type, stack, at);
+                at += cells(*field.type);
+            }
+        } else if (type.is<IR::Type::Array>()) {
+            IR::Type::Array const &array = type.as<IR::Type::Array>();
+            std::uint64_t const size     = cells(*array.element);
+            for (std::uint64_t index = 0; index < array.length; ++index) {
+                zero(*array.element, stack, at + index * size);
+            }
+        } else if (type.is<IR::Type::Slice>()) {
+            stack[at]     = IR::Scalar{IR::Scalar::u64{0}};
+            stack[at + 1] = IR::Scalar{IR::Scalar::u64{0}};
+        } else {
+            stack[at] = eval::zero(type);
+        }
+    }
+
+    /// copies @p count cells of @p stack from @p from to @p to, which may
+    /// overlap
+    static void copy(Stack &stack,
+                     std::uint64_t from,
+                     std::uint64_t to,
+                     std::uint64_t count) noexcept {
+        IR::Scalar *data = stack.data();
+        if (to <= from) {
+            std::copy(data + from, data + from + count, data + to);
+        } else {
+            std::copy_backward(
+                data + from, data + from + count, data + to + count);
+        }
+    }
+
+    /// @p scalar as an index, where a negative one is past any length
+    static std::optional<std::uint64_t>
+    index_of(IR::Scalar const &scalar) noexcept {
+        using IR::Scalar;
+        auto widen = [](std::int64_t value) {
+            return value < 0 ? std::numeric_limits<std::uint64_t>::max()
+                             : static_cast<std::uint64_t>(value);
+        };
+        switch (scalar.index()) {
+        case 2:  return scalar.as<Scalar::u8>();
+        case 3:  return scalar.as<Scalar::u16>();
+        case 4:  return scalar.as<Scalar::u32>();
+        case 5:  return scalar.as<Scalar::u64>();
+        case 6:  return widen(scalar.as<Scalar::i8>());
+        case 7:  return widen(scalar.as<Scalar::i16>());
+        case 8:  return widen(scalar.as<Scalar::i32>());
+        case 9:  return widen(scalar.as<Scalar::i64>());
+        default: return std::nullopt;
+        }
+    }
+
+    /// whether each argument of @p lambda, and its result, fits a cell
+    /// of [Native](@ref Native) code
+    static bool passes_scalars(IR::Lambda const &lambda) noexcept {
+        return lambda.return_type()->index() < 12 &&
+               std::ranges::all_of(
+                   lambda.arguments(),
+                   [](auto const &argument) {
+                       return argument.type->index() < 12;
+                   });
+    }
+
+    /**
+     * @brief whether @p root, or any lambda of the module it calls,
+     * directly or not, may fail on arithmetic, or on an index which was
+     * not proven in bounds, where it is reached
+     */
+    bool may_fail(IR::Lambda const &root) const {
+        std::vector<IR::Lambda const *> lambdas{&root};
+        std::unordered_set<std::string_view> seen{root.name().name};
+        for (std::size_t index = 0; index < lambdas.size(); ++index) {
+            IR::Lambda const &lambda = *lambdas[index];
+            pass::CFG const cfg{lambda};
+            if (pass::Ranges{lambda, cfg}.may_fail(lambda, cfg)) {
+                return true;
+            }
+            for (IR::Block const &block : lambda.body()) {
+                for (IR::Instruction const &instruction : block) {
+                    if (IR::is_bounds_checked(instruction.opcode())) {
+                        return true;
+                    }
+                    if (instruction.opcode() != IR::Instruction::Opcode::Call ||
+                        !instruction.B().is<IR::Label>()) {
+                        continue;
+                    }
+                    IR::Label callee = instruction.B().as<IR::Label>();
+                    if (!seen.insert(callee.name).second) { continue; }
+                    if (IR::Lambda const *found = module_.find(callee)) {
+                        lambdas.push_back(found);
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    Entry *find(IR::Label name) const noexcept {
+        auto found = entries_.find(name.name);
+        return found == entries_.end() ? nullptr : found->second.get();
+    }
+
+    bool hot(Entry const &entry) const noexcept {
+        return entry.calls.load(std::memory_order_relaxed) >=
+                   options_.threshold ||
+               entry.backedges.load(std::memory_order_relaxed) >=
+                   options_.threshold;
+    }
+
+    void tier_up(Entry &entry) {
+        if (compiler_ == nullptr || entry.queued.exchange(true)) { return; }
+
+        auto compile = [this, &entry] {
+            if (!passes_scalars(*entry.lambda) || may_fail(*entry.lambda)) {
+                return;
+            }
+            Native native = compiler_->compile(module_, *entry.lambda);
+            if (native != nullptr) {
+                entry.native.store(native, std::memory_order_release);
+            }
+        };
+
+        if (!options_.background) {
+            compile();
+            return;
+        }
+
+        std::lock_guard lock{pending_mutex_};
+        if (!pool_) { pool_.emplace(1); }
+        pending_.push_back(pool_->submit(compile));
+    }
+
+    /**
+     * @brief the first cell of @p operand, an argument or local of the
+     * frame of @p entry from @p base on, or a field of one, and its type
+     */
+    static eval::Error cell(Entry const &entry,
+                            std::uint64_t base,
+                            IR::Operand operand,
+                            std::uint64_t &at,
+                            IR::Type const *&type) noexcept {
+        IR::Lambda const &lambda = *entry.lambda;
+        if (operand.is<IR::LocalHandle>()) {
+            IR::LocalHandle const local = operand.as<IR::LocalHandle>();
+            if (local.index >= lambda.frame_size()) {
+                return eval::Error::NotConstant;
+            }
+            at   = base + entry.offsets[local.index];
+            type = &lambda.type_of(local);
+            return eval::Error::None;
+        }
+        if (!operand.is<IR::FieldHandle>() ||
+            !lambda.has_field(operand.as<IR::FieldHandle>())) {
+            return eval::Error::NotConstant;
+        }
+        // the fields are laid out as they are declared.
+        IR::FieldHandle const field = operand.as<IR::FieldHandle>();
+        auto const &fields =
+            lambda.type_of(field.local).as<IR::Type::Struct>().fields;
+        at = base + entry.offsets[field.local.index];
+        for (std::uint64_t index = 0; index < field.field; ++index) {
+            at += cells(*fields[index].type);
+        }
+        type = &lambda.type_of(field);
+        return eval::Error::None;
+    }
+
+    /**
+     * @brief calls the lambda of @p entry, whose arguments are held by the
+     * cells of @p stack from @p arguments on. A result which is not a
+     * scalar is written to the cells from @p returned on.
+     */
+    Result invoke(Entry &entry,
+                  std::uint64_t arguments,
+                  std::uint64_t returned,
+                  std::uint64_t depth,
+                  Stack &stack) {
+        IR::Lambda const &lambda = *entry.lambda;
+        entry.calls.fetch_add(1, std::memory_order_relaxed);
+        if (Native native = entry.native.load(std::memory_order_acquire)) {
+            std::vector<std::uint64_t> packed(lambda.arguments().size());
+            for (std::size_t index = 0; index < packed.size(); ++index) {
+                packed[index] = pack(stack[arguments + index]);
+            }
+            std::uint64_t result = 0;
+            native(packed.data(), &result);
+            return {eval::Error::None, unpack(result, *lambda.return_type())};
+        }
+
+        if (hot(entry)) { tier_up(entry); }
+        if (depth == options_.depth) { return {eval::Error::DepthLimit, {}}; }
+        return interpret(entry, arguments, returned, depth + 1, stack);
+    }
+
+    /// pushes the frame of @p entry onto @p stack, runs it, and pops it
+    Result interpret(Entry &entry,
+                     std::uint64_t arguments,
+                     std::uint64_t returned,
+                     std::uint64_t depth,
+                     Stack &stack) {
+        IR::Lambda const &lambda = *entry.lambda;
+        std::uint64_t const base = stack.size();
+        std::uint64_t const size = entry.offsets.back();
+        if (size > options_.cells || base > options_.cells - size) {
+            return {eval::Error::MemoryLimit, {}};
+        }
+        stack.resize(base + size);
+        copy(stack, arguments, base, entry.offsets[lambda.arguments().size()]);
+        for (std::uint64_t index = lambda.arguments().size();
+             index < lambda.frame_size();
+             ++index) {
+            IR::Local const &local = lambda.local(IR::LocalHandle{index});
+            IR::Scalar initializer = local.value_.as<IR::Scalar>();
+            std::uint64_t const at = base + entry.offsets[index];
+            if (initializer.index() == local.type_->index()) {
+                stack[at] = initializer;
+            } else {
+                zero(*local.type_, stack, at);
+            }
+        }
+
+        Result result = run(entry, base, returned, depth, stack);
+        stack.resize(base);
+        return result;
+    }
+
+    /// runs the lambda of @p entry, whose frame starts at @p base
+    Result run(Entry &entry,
+               std::uint64_t base,
+               std::uint64_t returned,
+               std::uint64_t depth,
+               Stack &stack) {
+        using eval::Error;
+        using IR::Instruction;
+        using Opcode = Instruction::Opcode;
+
+        IR::Lambda const &lambda = *entry.lambda;
+        IR::FastMath const flags =
+            lambda.fast_math().value_or(IR::FastMath::None);
+
+        auto value = [&](IR::Operand operand, IR::Scalar &result) {
+            if (operand.is<IR::Scalar>()) {
+                result = operand.as<IR::Scalar>();
+                return Error::None;
+            }
+            std::uint64_t at     = 0;
+            IR::Type const *type = nullptr;
+            Error const error    = cell(entry, base, operand, at, type);
+            if (error != Error::None) { return error; }
+            if (type->index() >= 12) { return Error::TypeMismatch; }
+            result = stack[at];
+            return Error::None;
+        };
+
+        // copies the cells of a value of @p type from @p from to the cell
+        // @p operand, which must be of the same type.
+        auto assign = [&](IR::Operand operand,
+                          std::uint64_t from,
+                          IR::Type const &type) {
+            std::uint64_t at   = 0;
+            IR::Type const *to = nullptr;
+            if (cell(entry, base, operand, at, to) != Error::None ||
+                !IR::same_structure(*to, type)) {
+                return Error::TypeMismatch;
+            }
+            copy(stack, from, at, cells(type));
+            return Error::None;
+        };
+
+        // the first cell of the elements of the array or slice @p operand,
+        // their number, and their type.
+        auto sequence = [&](IR::Operand operand,
+                            std::uint64_t &first,
+                            std::uint64_t &length,
+                            IR::Type const *&element) {
+            IR::Type const *type = nullptr;
+            Error const error    = cell(entry, base, operand, first, type);
+            if (error != Error::None) { return error; }
+            if (type->is<IR::Type::Array>()) {
+                length  = type->as<IR::Type::Array>().length;
+                element = type->as<IR::Type::Array>().element.get();
+                return Error::None;
+            }
+            if (!type->is<IR::Type::Slice>()) { return Error::TypeMismatch; }
+            length  = stack[first + 1].as<IR::Scalar::u64>();
+            first   = stack[first].as<IR::Scalar::u64>();
+            element = type->as<IR::Type::Slice>().element.get();
+            return Error::None;
+        };
+
+        // the first cell of the element @p position of @p operand, and its
+        // type. An unchecked access is checked all the same: its index was
+        // proven in bounds, but a slice may outlive the frame it points
+        // into, and the stack must not be overrun.
+        auto element = [&](IR::Operand operand,
+                           IR::Operand position,
+                           std::uint64_t &at,
+                           IR::Type const *&type) {
+            std::uint64_t first  = 0;
+            std::uint64_t length = 0;
+            IR::Scalar index;
+            Error error = sequence(operand, first, length, type);
+            if (error == Error::None) { error = value(position, index); }
+            if (error != Error::None) { return error; }
+            std::optional<std::uint64_t> const offset = index_of(index);
+            if (!offset) { return Error::TypeMismatch; }
+            std::uint64_t const size = cells(*type);
+            if (*offset >= length ||
+                first + (*offset + 1) * size > stack.size()) {
+                return Error::OutOfBounds;
+            }
+            at = first + *offset * size;
+            return Error::None;
+        };
+
+        // a branch to the block it is in, or to an earlier one, is a
+        // backedge; a loop which runs long enough makes its lambda hot, and
+        // the calls after it is compiled run native code.
+        auto branch = [&](Instruction const &instruction,
+                          std::size_t block,
+                          std::size_t &next) {
+            if (!instruction.A().is<IR::BlockHandle>()) {
+                return Error::TypeMismatch;
+            }
+            std::uint64_t target = instruction.A().as<IR::BlockHandle>().index;
+            if (target >= lambda.body().size()) { return Error::NoSuchBlock; }
+
+            bool jump = true;
+            if (IR::is_conditional(instruction.opcode())) {
+                IR::Scalar B;
+                IR::Scalar C;
+                Error error = value(instruction.B(), B);
+                if (error == Error::None &&
+                    instruction.format() == Instruction::Format::Ternary) {
+                    error = value(instruction.C(), C);
+                }
+                if (error == Error::None) {
+                    error = eval::taken(instruction.opcode(), B, C, jump);
+                }
+                if (error != Error::None) { return error; }
+            }
+            if (!jump) { return Error::None; }
+            next = target;
+            if (target <= block) {
+                entry.backedges.fetch_add(1, std::memory_order_relaxed);
+                if (hot(entry)) { tier_up(entry); }
+            }
+            return Error::None;
+        };
+
+        bool const scalar            = lambda.return_type()->index() < 12;
+        IR::Lambda::Body const &body = lambda.body();
+        for (std::size_t block = 0; block < body.size();) {
+            std::size_t next = block + 1;
+            for (Instruction const &instruction : body[block]) {
+                if (IR::is_branch(instruction.opcode())) {
+                    Error error = branch(instruction, block, next);
+                    if (error != Error::None) { return {error, {}}; }
+                    break;
+                }
+
+                IR::Scalar B;
+                IR::Scalar C;
+                IR::Scalar result;
+                Error error          = Error::None;
+                std::uint64_t at     = 0;
+                IR::Type const *type = nullptr;
+
+                switch (instruction.opcode()) {
+                case Opcode::Ret: {
+                    if (!scalar) {
+                        error = cell(entry, base, instruction.A(), at, type);
+                        if (error == Error::None &&
+                            !IR::same_structure(*type,
+                                                *lambda.return_type())) {
+                            error = Error::TypeMismatch;
+                        }
+                        if (error != Error::None) { return {error, {}}; }
+                        copy(stack, at, returned, cells(*type));
+                        return {Error::None, {}};
+                    }
+                    error = value(instruction.A(), result);
+                    if (error != Error::None) { return {error, {}}; }
+                    if (result.index() != lambda.return_type()->index()) {
+                        return {Error::TypeMismatch, {}};
+                    }
+                    return {Error::None, result};
+                }
+
+                case Opcode::Call: {
+                    error = call(instruction, entry, base, depth, stack);
+                    if (error != Error::None) { return {error, {}}; }
+                    continue;
+                }
+
+                case Opcode::Load: {
+                    // a struct or an array is copied cell by cell.
+                    if (cell(entry, base, instruction.B(), at, type) ==
+                            Error::None &&
+                        type->index() >= 12) {
+                        error = assign(instruction.A(), at, *type);
+                        if (error != Error::None) { return {error, {}}; }
+                        continue;
+                    }
+                    error = value(instruction.B(), result);
+                    break;
+                }
+
+                case Opcode::Subscript:
+                case Opcode::UncheckedSubscript: {
+                    if (instruction.format() != Instruction::Format::Ternary) {
+                        return {Error::TypeMismatch, {}};
+                    }
+                    error = element(instruction.B(), instruction.C(), at, type);
+                    if (error == Error::None && type->index() >= 12) {
+                        error = assign(instruction.A(), at, *type);
+                        if (error != Error::None) { return {error, {}}; }
+                        continue;
+                    }
+                    if (error == Error::None) { result = stack[at]; }
+                    break;
+                }
+
+                case Opcode::Insert:
+                case Opcode::UncheckedInsert: {
+                    if (instruction.format() != Instruction::Format::Ternary) {
+                        return {Error::TypeMismatch, {}};
+                    }
+                    error = element(instruction.A(), instruction.B(), at, type);
+                    std::uint64_t from    = 0;
+                    IR::Type const *given = nullptr;
+                    if (error == Error::None && type->index() >= 12) {
+                        error = cell(entry, base, instruction.C(), from, given);
+                        if (error == Error::None &&
+                            !IR::same_structure(*given, *type)) {
+                            error = Error::TypeMismatch;
+                        }
+                        if (error == Error::None) {
+                            copy(stack, from, at, cells(*type));
+                        }
+                    } else if (error == Error::None) {
+                        error = value(instruction.C(), C);
+                        if (error == Error::None &&
+                            C.index() != type->index()) {
+                            error = Error::TypeMismatch;
+                        }
+                        if (error == Error::None) { stack[at] = C; }
+                    }
+                    if (error != Error::None) { return {error, {}}; }
+                    continue;
+                }
+
+                case Opcode::Slice:
+                case Opcode::Length: {
+                    if (instruction.format() == Instruction::Format::Unary) {
+                        return {Error::TypeMismatch, {}};
+                    }
+                    std::uint64_t first  = 0;
+                    std::uint64_t length = 0;
+                    error = sequence(instruction.B(), first, length, type);
+                    if (error != Error::None) { return {error, {}}; }
+                    if (instruction.opcode() == Opcode::Length) {
+                        result = IR::Scalar{IR::Scalar::u64{length}};
+                        break;
+                    }
+                    IR::Type const *slice = nullptr;
+                    if (cell(entry, base, instruction.A(), at, slice) !=
+                            Error::None ||
+                        !slice->is<IR::Type::Slice>() ||
+                        !IR::same_structure(
+                            *slice->as<IR::Type::Slice>().element, *type)) {
+                        return {Error::TypeMismatch, {}};
+                    }
+                    stack[at]     = IR::Scalar{IR::Scalar::u64{first}};
+                    stack[at + 1] = IR::Scalar{IR::Scalar::u64{length}};
+                    continue;
+                }
+
+                case Opcode::Neg: {
+                    error = value(instruction.B(), B);
+                    if (error == Error::None) {
+                        error = eval::fold(Opcode::Neg,
+                                           B,
+                                           B,
+                                           result,
+                                           flags,
+                                           lambda.checked());
+                    }
+                    break;
+                }
+
+                default: {
+                    error = value(instruction.B(), B);
+                    if (error == Error::None) {
+                        error = value(instruction.C(), C);
+                    }
+                    if (error == Error::None) {
+                        error = eval::fold(instruction.opcode(),
+                                           B,
+                                           C,
+                                           result,
+                                           flags,
+                                           lambda.checked());
+                    }
+                    break;
+                }
+                }
+                if (error != Error::None) { return {error, {}}; }
+
+                if (cell(entry, base, instruction.A(), at, type) !=
+                        Error::None ||
+                    type->index() != result.index()) {
+                    return {Error::TypeMismatch, {}};
+                }
+                stack[at] = result;
+            }
+            block = next;
+        }
+
+        if (!scalar) {
+            zero(*lambda.return_type(), stack, returned);
+            return {Error::None, {}};
+        }
+        return {Error::None, eval::zero(*lambda.return_type())};
+    }
+
+    /**
+     * @brief call %result, @callee, %first; the arguments are held by
+     * consecutive locals of the frame of @p caller, starting with %first.
+     */
+    eval::Error call(IR::Instruction const &instruction,
+                     Entry const &caller,
+                     std::uint64_t base,
+                     std::uint64_t depth,
+                     Stack &stack) {
+        using eval::Error;
+        if (!instruction.B().is<IR::Label>()) { return Error::NotConstant; }
+        Entry *callee = find(instruction.B().as<IR::Label>());
+        if (callee == nullptr) { return Error::UndefinedLambda; }
+        IR::Lambda const &lambda = *caller.lambda;
+        IR::Lambda const &called = *callee->lambda;
+
+        // the callee writes a result which is not a scalar in place.
+        std::uint64_t at     = 0;
+        IR::Type const *type = nullptr;
+        if (cell(caller, base, instruction.A(), at, type) != Error::None ||
+            (called.return_type()->index() >= 12 &&
+             !IR::same_structure(*type, *called.return_type()))) {
+            return Error::TypeMismatch;
+        }
+
+        std::uint64_t count     = called.arguments().size();
+        std::uint64_t arguments = stack.size();
+        if (count != 0) {
+            if (instruction.format() != IR::Instruction::Format::Ternary ||
+                !instruction.C().is<IR::LocalHandle>()) {
+                return Error::TypeMismatch;
+            }
+            std::uint64_t first = instruction.C().as<IR::LocalHandle>().index;
+            if (first > lambda.frame_size() ||
+                lambda.frame_size() - first < count) {
+                return Error::TypeMismatch;
+            }
+            for (std::uint64_t index = 0; index < count; ++index) {
+                if (!IR::same_structure(
+                        lambda.type_of(IR::LocalHandle{first + index}),
+                        *called.arguments()[index].type)) {
+                    return Error::TypeMismatch;
+                }
+            }
+            arguments = base + caller.offsets[first];
+        }
+
+        Result result = invoke(*callee, arguments, at, depth, stack);
+        if (result.error != Error::None || type->index() >= 12) {
+            return result.error;
+        }
+        if (type->index() != result.value.index()) {
+            return Error::TypeMismatch;
+        }
+        stack[at] = result.value;
+        return Error::None;
+    }
+
+public:
+    /**
+     * @param compiler compiles hot lambdas, or nullptr to only interpret
+     */
+    Engine(IR::Module const &module, std::unique_ptr<Compiler> compiler)
+        : Engine{module, std::move(compiler), Options{}} {}
+
+    Engine(IR::Module const &module,
+           std::unique_ptr<Compiler> compiler,
+           Options options)
+        : module_{module}, options_{options}, compiler_{std::move(compiler)} {
+        for (IR::Lambda const &lambda : module) {
+            auto entry           = std::make_unique<Entry>();
+            entry->lambda        = &lambda;
+            std::uint64_t offset = 0;
+            for (std::uint64_t index = 0; index < lambda.frame_size();
+                 ++index) {
+                entry->offsets.push_back(offset);
+                offset += cells(lambda.type_of(IR::LocalHandle{index}));
+            }
+            entry->offsets.push_back(offset);
+            entries_.emplace(lambda.name().name, std::move(entry));
+        }
+    }
+
+    /**
+     * @brief calls the lambda named @p name with @p arguments, which, as
+     * its result, must be scalars
+     */
+    Result call(IR::Label name, std::span<IR::Scalar const> arguments) {
+        Entry *entry = find(name);
+        if (entry == nullptr) { return {eval::Error::UndefinedLambda, {}}; }
+        IR::Lambda const &lambda = *entry->lambda;
+        if (!passes_scalars(lambda) ||
+            arguments.size() != lambda.arguments().size()) {
+            return {eval::Error::TypeMismatch, {}};
+        }
+        for (std::size_t index = 0; index < arguments.size(); ++index) {
+            if (arguments[index].index() !=
+                lambda.arguments()[index].type->index()) {
+                return {eval::Error::TypeMismatch, {}};
+            }
+        }
+        Stack stack{arguments.begin(), arguments.end()};
+        return invoke(*entry, 0, 0, 0, stack);
+    }
+
+    /**
+     * @brief the counters of the lambda named @p name, and whether calls
+     * to it run native code yet.
+     */
+    std::optional<Profile> profile(IR::Label name) const noexcept {
+        Entry const *entry = find(name);
+        if (entry == nullptr) { return std::nullopt; }
+        return Profile{entry->calls.load(std::memory_order_relaxed),
+                       entry->backedges.load(std::memory_order_relaxed),
+                       entry->native.load(std::memory_order_acquire) !=
+                           nullptr};
+    }
+
+    /**
+     * @brief waits until every queued compile has finished
+     */
+    void wait() {
+        std::vector<std::future<void>> pending;
+        {
+            std::lock_guard lock{pending_mutex_};
+            pending.swap(pending_);
+        }
+        for (auto &task : pending) {
+            task.get();
+        }
+    }
+};
+
+} // namespace fun::exec
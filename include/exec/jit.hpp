@@ -0,0 +1,70 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file jit.hpp
+ * @brief Declares [JitCompiler](@ref JitCompiler)
+ */
+
+#pragma once
+
+#include <memory>
+#include <string_view>
+
+#include "exec/engine.hpp"
+
+namespace llvm::orc {
+class LLJIT;
+} // namespace llvm::orc
+
+namespace fun::exec {
+
+class PerfMapListener;
+
+/// the prefix of the symbol of the adapter compiled for each lambda
+inline constexpr std::string_view native_prefix = "fun.native.";
+
+/**
+ * @class JitCompiler
+ * @brief Compiles hot lambdas for the [Engine](@ref Engine) with LLVM's
+ * ORC LLJIT, through the same lowering as ahead of time compilation.
+ *
+ * Each compiled lambda is lowered, together with every lambda it calls,
+ * into a module of its own, on the thread which asked for it. Only the
+ * adapter of each module is visible to the JIT, so copies of the same
+ * callee in different modules do not collide.
+ */
+class JitCompiler : public Compiler {
+    // declared before the JIT, which notifies it until it is destroyed.
+    std::unique_ptr<PerfMapListener> perf_map_;
+    std::unique_ptr<llvm::orc::LLJIT> jit_;
+
+    JitCompiler(std::unique_ptr<PerfMapListener> perf_map,
+                std::unique_ptr<llvm::orc::LLJIT> jit) noexcept;
+
+public:
+    ~JitCompiler() override;
+
+    /**
+     * @param perf if true, every compiled lambda is described to perf, in
+     * /tmp/perf-<pid>.map and in a jitdump file, which perf inject --jit
+     * merges into a recorded profile. A jitdump file is only written if
+     * LLVM was built with LLVM_USE_PERF. Neither has line information, as
+     * lambdas do not keep where in their source they were defined.
+     *
+     * @return nullptr if the host cannot JIT, in which case the reason has
+     * been printed to llvm::errs().
+     */
+    static std::unique_ptr<JitCompiler> create(bool perf = false);
+
+    Native compile(IR::Module const &module,
+                   IR::Lambda const &lambda) override;
+};
+
+} // namespace fun::exec
@@ -0,0 +1,66 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file perf.hpp
+ * @brief Declares [PerfMapListener](@ref PerfMapListener)
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <llvm/ExecutionEngine/JITEventListener.h>
+#include <llvm/Support/raw_ostream.h>
+
+namespace fun::exec {
+
+/**
+ * @class PerfMapListener
+ * @brief Writes a line to /tmp/perf-<pid>.map for every function of every
+ * object the JIT loads, which is how perf names the frames of code it
+ * did not find in a file.
+ *
+ * Each line is written and flushed as the object is loaded, so a profile
+ * of a process which is killed still resolves the code it ran. Functions
+ * are named by their symbols: the [Lambda](@ref IR::Lambda) they were
+ * lowered from, or fun.native. and the lambda for an adapter. Every
+ * address is mapped once, and the copies of a lambda which later modules
+ * hold are named lambda#2, lambda#3 and so on, so no symbol is mapped
+ * twice.
+ */
+class PerfMapListener : public llvm::JITEventListener {
+    std::mutex mutex_;
+    std::unique_ptr<llvm::raw_fd_ostream> out_;
+    /// the addresses mapped so far
+    std::unordered_set<std::uint64_t> mapped_;
+    /// how many functions of each symbol have been mapped
+    std::unordered_map<std::string, unsigned> copies_;
+
+    explicit PerfMapListener(std::unique_ptr<llvm::raw_fd_ostream> out);
+
+public:
+    /**
+     * @return nullptr if the map cannot be opened, in which case the reason
+     * has been printed to llvm::errs().
+     */
+    static std::unique_ptr<PerfMapListener> create();
+
+    void notifyObjectLoaded(
+        ObjectKey key,
+        llvm::object::ObjectFile const &object,
+        llvm::RuntimeDyld::LoadedObjectInfo const &loaded) override;
+};
+
+} // namespace fun::exec
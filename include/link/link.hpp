@@ -0,0 +1,63 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file link.hpp
+ * @brief Declares [link_executable](@ref link_executable) and
+ * [link_object](@ref link_object)
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <span>
+
+#include <llvm/ADT/StringRef.h>
+
+namespace fs = std::filesystem;
+
+namespace fun::link {
+
+/**
+ * @brief Links the object files @p objects, which are held in memory, into
+ * the static ELF executable @p output, with lld running in this process.
+ *
+ * Each object is handed to lld as an anonymous in-memory file, named
+ * through /proc/<pid>/fd, so the executable is the only file written and
+ * no linker process is spawned, unless lld has said it cannot run again
+ * in this process, after which ld.lld is run from the PATH. The executable
+ * enters at _start, see [emit_entry](@ref codegen::emit_entry).
+ *
+ * lld is not reentrant, so links from several threads, including those of
+ * [link_object](@ref link_object), run one at a time.
+ *
+ * If @p fold, lld folds identical functions whose addresses are never
+ * compared, and drops every section nothing refers to, which needs the
+ * objects to have been emitted with a section per function and an
+ * address significance table, see [TargetKey](@ref env::TargetKey).
+ *
+ * @return false if linking failed, in which case lld has printed why
+ */
+bool link_executable(std::span<llvm::StringRef const> objects,
+                     fs::path const &output,
+                     bool fold = false);
+
+/**
+ * @brief Links the object files @p objects, which are held in memory, into
+ * the one relocatable object file @p output, as `ld -r` would, so that the
+ * parts of a module emitted on several threads can be written as one.
+ * Like [link_executable](@ref link_executable), it waits for any other
+ * link in the process to finish first.
+ *
+ * @return false if linking failed, in which case lld has printed why
+ */
+bool link_object(std::span<llvm::StringRef const> objects,
+                 fs::path const &output);
+
+} // namespace fun::link
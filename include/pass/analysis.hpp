@@ -0,0 +1,205 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file analysis.hpp
+ * @brief Defines [Preserved](@ref Preserved),
+ * [FunctionAnalyses](@ref FunctionAnalyses) and
+ * [AnalysisManager](@ref AnalysisManager)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+#include "IR/lambda.hpp"
+
+namespace fun::pass {
+
+/**
+ * @class Preserved
+ * @brief The set of analyses which remain valid after a pass has run.
+ */
+class Preserved {
+    bool all_;
+    std::vector<std::type_index> analyses_;
+
+    explicit Preserved(bool all) noexcept : all_{all} {}
+
+public:
+    static Preserved all() noexcept { return Preserved{true}; }
+    static Preserved none() noexcept { return Preserved{false}; }
+
+    template <class A> Preserved &preserve() {
+        if (!all_) { analyses_.emplace_back(typeid(A)); }
+        return *this;
+    }
+
+    bool preserves_all() const noexcept { return all_; }
+
+    bool preserves(std::type_index analysis) const noexcept {
+        return all_ ||
+               std::ranges::find(analyses_, analysis) != analyses_.end();
+    }
+
+    template <class A> bool preserves() const noexcept {
+        return preserves(typeid(A));
+    }
+
+    /**
+     * @brief keeps only the analyses preserved by both this and @p other
+     */
+    Preserved &intersect(Preserved const &other) {
+        if (other.all_) { return *this; }
+        if (all_) { return *this = other; }
+        std::erase_if(analyses_, [&other](std::type_index analysis) {
+            return !other.preserves(analysis);
+        });
+        return *this;
+    }
+};
+
+class FunctionAnalyses;
+
+/**
+ * @brief An analysis computes a Result from a single lambda.
+ *
+ * The result is cached by the [AnalysisManager](@ref AnalysisManager) until
+ * a pass which does not preserve the analysis runs over the lambda.
+ * Analyses may request other analyses of the same lambda through
+ * @p analyses. An analysis which does so must be preserved only when its
+ * dependencies are.
+ */
+template <class A>
+concept Analysis =
+    requires(IR::Lambda const &lambda, FunctionAnalyses &analyses) {
+        typename A::Result;
+        {
+            A::run(lambda, analyses)
+        } -> std::convertible_to<typename A::Result>;
+    };
+
+/**
+ * @class FunctionAnalyses
+ * @brief The cached analysis results of a single lambda.
+ *
+ * Not thread safe. The [PassManager](@ref PassManager) guarantees that at
+ * most one thread works on any given lambda at a time.
+ */
+class FunctionAnalyses {
+    struct Concept {
+        virtual ~Concept() = default;
+    };
+
+    template <class Result> struct Model : Concept {
+        Result result;
+
+        explicit Model(Result result) : result{std::move(result)} {}
+    };
+
+    IR::Lambda const *lambda_;
+    std::unordered_map<std::type_index, std::unique_ptr<Concept>> results_;
+
+public:
+    explicit FunctionAnalyses(IR::Lambda const &lambda) noexcept
+        : lambda_{&lambda} {}
+
+    /**
+     * @brief Rebinds the cache to @p lambda, which may have been moved
+     * since the cache was last used.
+     */
+    void rebind(IR::Lambda const &lambda) noexcept { lambda_ = &lambda; }
+
+    IR::Lambda const &lambda() const noexcept { return *lambda_; }
+
+    template <Analysis A> typename A::Result const &get() {
+        using Result = typename A::Result;
+        auto found   = results_.find(typeid(A));
+        if (found == results_.end()) {
+            // #NOTE: A::run may request further analyses, which may rehash
+            // results_, so we must not hold an iterator across the call.
+            auto model =
+                std::make_unique<Model<Result>>(A::run(*lambda_, *this));
+            found = results_.emplace(typeid(A), std::move(model)).first;
+        }
+        return static_cast<Model<Result> const &>(*found->second).result;
+    }
+
+    template <Analysis A> typename A::Result const *cached() const noexcept {
+        using Result = typename A::Result;
+        auto found   = results_.find(typeid(A));
+        if (found == results_.end()) { return nullptr; }
+        return &static_cast<Model<Result> const &>(*found->second).result;
+    }
+
+    void invalidate(Preserved const &preserved) {
+        if (preserved.preserves_all()) { return; }
+        std::erase_if(results_, [&preserved](auto const &entry) {
+            return !preserved.preserves(entry.first);
+        });
+    }
+
+    std::uint64_t size() const noexcept { return results_.size(); }
+};
+
+/**
+ * @class AnalysisManager
+ * @brief Caches analysis results per lambda, keyed by the lambda's name.
+ *
+ * Looking up the cache of a lambda is thread safe, using the cache is not.
+ * Code which mutates a lambda outside of a pass must call
+ * [invalidate](@ref AnalysisManager::invalidate) itself.
+ */
+class AnalysisManager {
+    std::mutex mutex_;
+    std::unordered_map<std::string_view, FunctionAnalyses> caches_;
+
+public:
+    FunctionAnalyses &on(IR::Lambda const &lambda) {
+        std::lock_guard lock{mutex_};
+        auto [cursor, inserted] =
+            caches_.try_emplace(lambda.name().name, lambda);
+        if (!inserted) { cursor->second.rebind(lambda); }
+        return cursor->second;
+    }
+
+    template <Analysis A>
+    typename A::Result const &get(IR::Lambda const &lambda) {
+        return on(lambda).get<A>();
+    }
+
+    void invalidate(IR::Lambda const &lambda,
+                    Preserved const &preserved = Preserved::none()) {
+        on(lambda).invalidate(preserved);
+    }
+
+    void invalidate(Preserved const &preserved = Preserved::none()) {
+        std::lock_guard lock{mutex_};
+        for (auto &[name, cache] : caches_) {
+            cache.invalidate(preserved);
+        }
+    }
+
+    /**
+     * @brief Drops the cache of a lambda which was removed from its module.
+     */
+    void forget(IR::Lambda const &lambda) {
+        std::lock_guard lock{mutex_};
+        caches_.erase(lambda.name().name);
+    }
+};
+
+} // namespace fun::pass
@@ -0,0 +1,130 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file bounds_checks.hpp
+ * @brief Defines [EliminateBoundsChecks](@ref EliminateBoundsChecks)
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+
+#include "pass/cfg.hpp"
+#include "pass/pass.hpp"
+#include "pass/ranges.hpp"
+
+namespace fun::pass {
+
+/**
+ * @class EliminateBoundsChecks
+ * @brief Removes the bounds check of each subscript and insert whose index
+ * is proven in bounds by the [Ranges](@ref Ranges) of its lambda.
+ *
+ * An index into an array is in bounds if its range lies below the length
+ * of the array, which is part of its type. An index into a slice is in
+ * bounds if it is not negative and a branch on the length of the slice,
+ * as a loop over it has, found it below, with neither written since.
+ */
+class EliminateBoundsChecks : public FunctionPass {
+    std::atomic<std::uint64_t> eliminated_{0};
+
+public:
+    /**
+     * @brief whether the index of the element access @p access of
+     * @p lambda is in bounds in @p state
+     */
+    static bool in_bounds(IR::Lambda const &lambda,
+                          Ranges::State const &state,
+                          IR::Instruction const &access) {
+        using Opcode = IR::Instruction::Opcode;
+        if (access.format() != IR::Instruction::Format::Ternary) {
+            return false;
+        }
+        bool const reads = access.opcode() == Opcode::Subscript ||
+                           access.opcode() == Opcode::UncheckedSubscript;
+        IR::Operand const sequence = reads ? access.B() : access.A();
+        IR::Operand const index    = reads ? access.C() : access.B();
+
+        IR::Type const *type = nullptr;
+        if (sequence.is<IR::LocalHandle>() &&
+            sequence.as<IR::LocalHandle>().index < lambda.frame_size()) {
+            type = &lambda.type_of(sequence.as<IR::LocalHandle>());
+        } else if (sequence.is<IR::FieldHandle>() &&
+                   lambda.has_field(sequence.as<IR::FieldHandle>())) {
+            type = &lambda.type_of(sequence.as<IR::FieldHandle>());
+        }
+        if (type == nullptr) { return false; }
+
+        Range const range = state.range(lambda, index);
+        if (type->is<IR::Type::Array>()) {
+            std::uint64_t const length = type->as<IR::Type::Array>().length;
+            return length != 0 &&
+                   length - 1 <= static_cast<std::uint64_t>(Range::above) &&
+                   range.within(0, static_cast<std::int64_t>(length - 1));
+        }
+        return type->is<IR::Type::Slice>() &&
+               sequence.is<IR::LocalHandle>() &&
+               index.is<IR::LocalHandle>() && range.lo >= 0 &&
+               state.is_below(index.as<IR::LocalHandle>().index,
+                              sequence.as<IR::LocalHandle>().index);
+    }
+
+    /// the number of bounds checks removed, over every lambda run on
+    std::uint64_t eliminated() const noexcept { return eliminated_; }
+
+    std::string_view name() const noexcept override {
+        return "eliminate-bounds-checks";
+    }
+
+    Preserved run(IR::Lambda &lambda, FunctionAnalyses &analyses) override {
+        bool checked = false;
+        for (IR::Block const &block : lambda.body()) {
+            for (IR::Instruction const &instruction : block) {
+                checked =
+                    checked || IR::is_bounds_checked(instruction.opcode());
+            }
+        }
+        if (!checked) { return Preserved::all(); }
+
+        Ranges const &ranges  = analyses.get<ValueRanges>();
+        CFG const &cfg        = analyses.get<ControlFlow>();
+        std::uint64_t removed = 0;
+        for (std::uint64_t block = 0; block < cfg.size(); ++block) {
+            if (!ranges.entry(block)) { continue; }
+            Ranges::State state     = *ranges.entry(block);
+            IR::Block &instructions = lambda.body()[block];
+            std::uint64_t const end =
+                cfg[block].terminator.value_or(instructions.size());
+            for (std::uint64_t index = 0; index < end; ++index) {
+                IR::Instruction const instruction = instructions[index];
+                if (IR::is_bounds_checked(instruction.opcode()) &&
+                    in_bounds(lambda, state, instruction)) {
+                    instructions[index] =
+                        IR::Instruction{IR::unchecked(instruction.opcode()),
+                                        instruction.A(),
+                                        instruction.B(),
+                                        instruction.C()};
+                    ++removed;
+                }
+                Ranges::step(lambda, state, instruction);
+            }
+        }
+        if (removed == 0) { return Preserved::all(); }
+        eliminated_ += removed;
+        // an unchecked access changes neither control flow nor ranges.
+        return Preserved::none()
+            .preserve<ControlFlow>()
+            .preserve<ValueRanges>();
+    }
+};
+
+} // namespace fun::pass
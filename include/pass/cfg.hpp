@@ -0,0 +1,139 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file cfg.hpp
+ * @brief Defines [CFG](@ref CFG) and the [ControlFlow](@ref ControlFlow)
+ * analysis
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "IR/lambda.hpp"
+#include "pass/analysis.hpp"
+
+namespace fun::pass {
+
+/**
+ * @class CFG
+ * @brief The control flow graph of a lambda, with a node per block of its
+ * body.
+ *
+ * A block which ends in a conditional branch has up to two successors:
+ * the block the branch targets, and the next block, which it falls through
+ * to. A branch to a block the lambda does not have adds no edge; it is
+ * reported when the lambda is run or lowered.
+ */
+class CFG {
+public:
+    struct Node {
+        /// the index of the first branch or ret of the block, if any
+        std::optional<std::uint64_t> terminator;
+        /// the block targeted by that branch
+        std::optional<std::uint64_t> taken;
+        /// whether control may run past the end of the block, into the
+        /// next block or, from the last block, out of the lambda
+        bool falls_through = true;
+        std::vector<std::uint64_t> predecessors;
+    };
+
+private:
+    std::vector<Node> nodes_;
+
+public:
+    explicit CFG(IR::Lambda const &lambda) {
+        IR::Lambda::Body const &body = lambda.body();
+        nodes_.resize(body.size());
+        for (std::uint64_t block = 0; block < body.size(); ++block) {
+            Node &node = nodes_[block];
+            for (std::uint64_t index = 0; index < body[block].size();
+                 ++index) {
+                IR::Instruction const &instruction = body[block][index];
+                if (!IR::is_terminator(instruction.opcode())) { continue; }
+                node.terminator    = index;
+                node.falls_through = IR::is_conditional(instruction.opcode());
+                if (IR::is_branch(instruction.opcode()) &&
+                    instruction.A().is<IR::BlockHandle>() &&
+                    instruction.A().as<IR::BlockHandle>().index <
+                        body.size()) {
+                    node.taken = instruction.A().as<IR::BlockHandle>().index;
+                }
+                break;
+            }
+        }
+
+        for (std::uint64_t block = 0; block < nodes_.size(); ++block) {
+            for (std::uint64_t successor : successors(block)) {
+                nodes_[successor].predecessors.push_back(block);
+            }
+        }
+    }
+
+    std::uint64_t size() const noexcept { return nodes_.size(); }
+
+    Node const &operator[](std::uint64_t block) const noexcept {
+        return nodes_[block];
+    }
+
+    /**
+     * @brief the block control falls through to from @p block, if it may
+     * fall through to a block at all.
+     */
+    std::optional<std::uint64_t>
+    fallthrough(std::uint64_t block) const noexcept {
+        if (!nodes_[block].falls_through || block + 1 == nodes_.size()) {
+            return std::nullopt;
+        }
+        return block + 1;
+    }
+
+    /**
+     * @brief the successors of @p block: the target of its branch first,
+     * and then the block it falls through to. A conditional branch to the
+     * next block gives it only once.
+     */
+    std::vector<std::uint64_t> successors(std::uint64_t block) const {
+        std::vector<std::uint64_t> result;
+        if (nodes_[block].taken) { result.push_back(*nodes_[block].taken); }
+        if (auto next = fallthrough(block);
+            next && (result.empty() || result.front() != *next)) {
+            result.push_back(*next);
+        }
+        return result;
+    }
+
+    std::vector<std::uint64_t> const &
+    predecessors(std::uint64_t block) const noexcept {
+        return nodes_[block].predecessors;
+    }
+
+    /// whether control may leave the lambda from @p block
+    bool exits(std::uint64_t block) const noexcept {
+        Node const &node = nodes_[block];
+        if (node.falls_through) { return block + 1 == nodes_.size(); }
+        return !node.taken.has_value();
+    }
+};
+
+/**
+ * @brief The analysis which builds the [CFG](@ref CFG) of a lambda.
+ */
+struct ControlFlow {
+    using Result = CFG;
+
+    static Result run(IR::Lambda const &lambda, FunctionAnalyses &) {
+        return CFG{lambda};
+    }
+};
+
+} // namespace fun::pass
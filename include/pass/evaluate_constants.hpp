@@ -0,0 +1,227 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file evaluate_constants.hpp
+ * @brief Defines [EvaluateConstants](@ref EvaluateConstants)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "eval/evaluator.hpp"
+#include "pass/pass.hpp"
+
+namespace fun::pass {
+
+/**
+ * @class EvaluateConstants
+ * @brief Evaluates calls whose arguments are all constants at compile
+ * time, and stores their results into the [Local](@ref IR::Local) they
+ * were assigned to.
+ *
+ * A local is constant when no instruction writes it, so it holds its
+ * initializer for the whole lambda. A call in the first block, before any
+ * branch, which is the only write to its destination, and which no
+ * earlier instruction reads, is replaced by the initializer it computes,
+ * which makes the destination constant in turn. The result is lowered as
+ * an LLVM constant, so the call costs nothing at run time.
+ *
+ * Calls which fail to evaluate, or exceed the budget, are left to run.
+ */
+class EvaluateConstants : public ModulePass {
+    eval::Budget budget_;
+    std::uint64_t evaluated_ = 0;
+
+    /**
+     * @brief the number of instructions which write each local of
+     * @p lambda, or a field of it
+     */
+    static std::vector<std::uint64_t> writes(IR::Lambda const &lambda) {
+        std::vector<std::uint64_t> counts(lambda.frame_size(), 0);
+        for (IR::Block const &block : lambda.body()) {
+            for (IR::Instruction const &instruction : block) {
+                if (instruction.opcode() == IR::Instruction::Opcode::Ret) {
+                    continue;
+                }
+                IR::LocalHandle local{};
+                if (instruction.A().is<IR::LocalHandle>()) {
+                    local = instruction.A().as<IR::LocalHandle>();
+                } else if (instruction.A().is<IR::FieldHandle>()) {
+                    local = instruction.A().as<IR::FieldHandle>().local;
+                } else {
+                    continue;
+                }
+                if (local.index < counts.size()) { ++counts[local.index]; }
+            }
+        }
+        return counts;
+    }
+
+    /**
+     * @brief whether @p instruction reads @p handle; a call reads each
+     * argument of its callee, the locals from its C on.
+     */
+    static bool reads(IR::Module const &module,
+                      IR::Instruction const &instruction,
+                      IR::LocalHandle handle) noexcept {
+        auto is = [&](IR::Operand operand) {
+            return operand.is<IR::LocalHandle>() &&
+                   operand.as<IR::LocalHandle>() == handle;
+        };
+        if (instruction.opcode() == IR::Instruction::Opcode::Call &&
+            instruction.format() == IR::Instruction::Format::Ternary &&
+            instruction.C().is<IR::LocalHandle>()) {
+            std::uint64_t first = instruction.C().as<IR::LocalHandle>().index;
+            IR::Lambda const *callee =
+                instruction.B().is<IR::Label>()
+                    ? module.find(instruction.B().as<IR::Label>())
+                    : nullptr;
+            // a callee which is not defined may read any local from C on.
+            return handle.index >= first &&
+                   (callee == nullptr ||
+                    handle.index - first < callee->arguments().size());
+        }
+        switch (instruction.format()) {
+        case IR::Instruction::Format::Unary:
+            return instruction.opcode() == IR::Instruction::Opcode::Ret &&
+                   is(instruction.A());
+        case IR::Instruction::Format::Binary: return is(instruction.B());
+        case IR::Instruction::Format::Ternary:
+            return is(instruction.B()) || is(instruction.C());
+        default: std::unreachable();
+        }
+    }
+
+    /**
+     * @brief the values of the arguments of @p call, if every one of them
+     * is a constant local.
+     */
+    static bool arguments(IR::Lambda const &lambda,
+                          IR::Lambda const &callee,
+                          IR::Instruction const &call,
+                          std::vector<std::uint64_t> const &counts,
+                          std::vector<IR::Scalar> &values) {
+        values.clear();
+        std::uint64_t count = callee.arguments().size();
+        if (count == 0) { return true; }
+        if (call.format() != IR::Instruction::Format::Ternary ||
+            !call.C().is<IR::LocalHandle>()) {
+            return false;
+        }
+
+        std::uint64_t first = call.C().as<IR::LocalHandle>().index;
+        for (std::uint64_t index = first; index < first + count; ++index) {
+            IR::LocalHandle handle{index};
+            // a struct is not a constant the evaluator can pass.
+            if (index >= lambda.frame_size() || lambda.is_argument(handle) ||
+                counts[index] != 0 || lambda.type_of(handle).index() >= 12) {
+                return false;
+            }
+            IR::Local const &local = lambda.local(handle);
+            IR::Scalar value       = local.value_.as<IR::Scalar>();
+            values.push_back(value.index() == local.type_->index()
+                                 ? value
+                                 : eval::zero(*local.type_));
+        }
+        return true;
+    }
+
+    /// @return true if any call of @p lambda was evaluated
+    bool run(IR::Lambda &lambda,
+             IR::Module const &module,
+             eval::Evaluator &evaluator) {
+        if (lambda.body().empty()) { return false; }
+
+        bool changed = false;
+        std::vector<IR::Scalar> values;
+        // every evaluated call may make the arguments of a later one
+        // constant, so repeat until nothing changes.
+        for (bool progress = true; progress;) {
+            progress                          = false;
+            std::vector<std::uint64_t> counts = writes(lambda);
+            IR::Block &block                  = lambda.body().front();
+
+            for (auto it = block.begin(); it != block.end(); ++it) {
+                IR::Instruction const &call = *it;
+                // a call after a branch may not run at all.
+                if (IR::is_terminator(call.opcode())) { break; }
+                if (call.opcode() != IR::Instruction::Opcode::Call ||
+                    !call.A().is<IR::LocalHandle>() ||
+                    !call.B().is<IR::Label>()) {
+                    continue;
+                }
+
+                IR::LocalHandle result = call.A().as<IR::LocalHandle>();
+                if (lambda.is_argument(result) ||
+                    result.index >= lambda.frame_size() ||
+                    counts[result.index] != 1) {
+                    continue;
+                }
+                if (std::any_of(block.begin(), it, [&](auto const &before) {
+                        return reads(module, before, result);
+                    })) {
+                    continue;
+                }
+
+                IR::Lambda const *callee =
+                    module.find(call.B().as<IR::Label>());
+                if (callee == nullptr ||
+                    !arguments(lambda, *callee, call, counts, values)) {
+                    continue;
+                }
+
+                eval::Evaluator::Result evaluated =
+                    evaluator.call(*callee, values);
+                if (evaluated.error != eval::Error::None ||
+                    evaluated.value.index() !=
+                        lambda.type_of(result).index()) {
+                    continue;
+                }
+
+                lambda.local(result).value_ = evaluated.value;
+                block.erase(it);
+                ++evaluated_;
+                changed  = true;
+                progress = true;
+                break;
+            }
+        }
+        return changed;
+    }
+
+public:
+    EvaluateConstants() noexcept = default;
+    explicit EvaluateConstants(eval::Budget budget) noexcept
+        : budget_{budget} {}
+
+    std::string_view name() const noexcept override {
+        return "evaluate-constants";
+    }
+
+    /// the number of calls evaluated so far
+    std::uint64_t evaluated() const noexcept { return evaluated_; }
+
+    Preserved run(IR::Module &module, AnalysisManager &analyses) override {
+        // the evaluator reads lambdas as they are on entry to the pass;
+        // evaluating a call never changes the result of any lambda, so
+        // its memo stays valid while calls are replaced.
+        eval::Evaluator evaluator{module, budget_};
+        for (IR::Lambda &lambda : module) {
+            if (run(lambda, module, evaluator)) {
+                analyses.invalidate(lambda, Preserved::none());
+            }
+        }
+        return Preserved::all();
+    }
+};
+
+} // namespace fun::pass
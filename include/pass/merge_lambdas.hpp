@@ -0,0 +1,144 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file merge_lambdas.hpp
+ * @brief Defines [MergeLambdas](@ref MergeLambdas)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <set>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "IR/structure.hpp"
+#include "pass/pass.hpp"
+
+namespace fun::pass {
+
+/**
+ * @class MergeLambdas
+ * @brief Folds lambdas of the same [structure](@ref IR::same_structure)
+ * into the first of them, so that their code is emitted once.
+ *
+ * Lambdas are grouped by their structural hash, and each one is compared
+ * with the first of its group, so a collision never merges two lambdas
+ * which differ. Calls of a duplicate are retargeted to the lambda it is
+ * the same as, and the duplicate is left as a thunk which calls it, as it
+ * may still be called by name, from the entry point or another module.
+ *
+ * Retargeting calls may make their callers the same in turn, so this
+ * repeats until nothing merges. Thunks are never merged again.
+ *
+ * Lambdas which differ only in types which are lowered alike, such as u64
+ * and i64, are not the same here; LLVM's MergeFunctions folds those.
+ */
+class MergeLambdas : public ModulePass {
+    std::uint64_t merged_ = 0;
+
+    /// replaces the body of @p lambda with a call of @p target
+    static void thunk(IR::Lambda &lambda, IR::Label target) {
+        using Opcode = IR::Instruction::Opcode;
+        lambda.locals().clear();
+        lambda.body().clear();
+        IR::LocalHandle result = lambda.declare(
+            IR::Local{IR::Label{"r"}, lambda.return_type()->clone(), {}});
+        IR::Block &block = lambda.body().emplace_back();
+        if (lambda.arguments().empty()) {
+            block.append(Opcode::Call, result, target);
+        } else {
+            block.append(Opcode::Call, result, target, IR::LocalHandle{0});
+        }
+        block.append(Opcode::Ret, result);
+    }
+
+    /// @return true if any call of @p lambda was retargeted
+    static bool
+    retarget(IR::Lambda &lambda,
+             std::unordered_map<std::string_view, IR::Label> const &into) {
+        bool changed = false;
+        for (IR::Block &block : lambda.body()) {
+            for (IR::Instruction &instruction : block) {
+                if (instruction.opcode() != IR::Instruction::Opcode::Call ||
+                    !instruction.B().is<IR::Label>()) {
+                    continue;
+                }
+                auto found = into.find(instruction.B().as<IR::Label>().name);
+                if (found == into.end()) { continue; }
+                instruction = instruction.format() ==
+                                      IR::Instruction::Format::Ternary
+                                  ? IR::Instruction{instruction.opcode(),
+                                                    instruction.A(),
+                                                    found->second,
+                                                    instruction.C()}
+                                  : IR::Instruction{instruction.opcode(),
+                                                    instruction.A(),
+                                                    found->second};
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+public:
+    std::string_view name() const noexcept override { return "merge-lambdas"; }
+
+    /// the number of lambdas merged so far
+    std::uint64_t merged() const noexcept { return merged_; }
+
+    Preserved run(IR::Module &module, AnalysisManager &analyses) override {
+        std::set<std::string_view> thunks;
+        for (bool progress = true; progress;) {
+            progress = false;
+            // the duplicates found this round, by name, and the lambda each
+            // of them is the same as.
+            std::unordered_map<std::string_view, IR::Label> into;
+            std::unordered_map<std::uint64_t, std::vector<IR::Lambda *>>
+                groups;
+            for (IR::Lambda &lambda : module) {
+                if (lambda.body().empty() ||
+                    thunks.contains(lambda.name().name)) {
+                    continue;
+                }
+                std::vector<IR::Lambda *> &group =
+                    groups[IR::structural_hash(lambda)];
+                auto same = std::find_if(
+                    group.begin(), group.end(), [&](IR::Lambda *first) {
+                        return IR::same_structure(*first, lambda);
+                    });
+                if (same == group.end()) {
+                    group.push_back(&lambda);
+                    continue;
+                }
+                into.emplace(lambda.name().name, (*same)->name());
+            }
+            if (into.empty()) { break; }
+
+            for (IR::Lambda &lambda : module) {
+                auto found = into.find(lambda.name().name);
+                if (found != into.end()) {
+                    thunk(lambda, found->second);
+                    thunks.insert(lambda.name().name);
+                    ++merged_;
+                } else if (!retarget(lambda, into)) {
+                    continue;
+                }
+                analyses.invalidate(lambda, Preserved::none());
+                progress = true;
+            }
+        }
+        return Preserved::all();
+    }
+};
+
+} // namespace fun::pass
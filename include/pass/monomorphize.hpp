@@ -0,0 +1,464 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file monomorphize.hpp
+ * @brief Defines [Monomorphize](@ref Monomorphize) and
+ * [SpecializationCache](@ref SpecializationCache)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "IR/structure.hpp"
+#include "pass/pass.hpp"
+
+namespace fun::pass {
+
+/// gives a string storage which lives as long as the module it names
+using Intern = std::function<IR::Label(std::string_view)>;
+
+namespace detail {
+
+/**
+ * @brief @p type, with each parameter of @p parameters replaced by the
+ * type at the same position of @p bindings, and every name interned by
+ * @p intern
+ */
+inline IR::Type::Ptr substitute(IR::Type const &type,
+                                std::span<IR::Label const> parameters,
+                                std::span<IR::Type const *const> bindings,
+                                Intern const &intern) {
+    if (type.is<IR::Type::Parameter>()) {
+        IR::Label name = type.as<IR::Type::Parameter>().name;
+        for (std::size_t index = 0; index < parameters.size(); ++index) {
+            if (parameters[index] == name) { return bindings[index]->clone(); }
+        }
+        return std::make_unique<IR::Type>(
+            IR::Type::Parameter{intern(name.name)});
+    }
+    if (type.is<IR::Type::Struct>()) {
+        IR::Type::Struct const &record = type.as<IR::Type::Struct>();
+        IR::Type::Struct::Fields fields;
+        for (IR::Type::Struct::Field const &field : record.fields) {
+            fields.emplace_back(
+                intern(field.name.name),
+                substitute(*field.type, parameters, bindings, intern));
+        }
+        return std::make_unique<IR::Type>(std::move(fields), record.order);
+    }
+    if (type.is<IR::Type::Array>()) {
+        IR::Type::Array const &array = type.as<IR::Type::Array>();
+        return std::make_unique<IR::Type>(IR::Type::Array{
+            substitute(*array.element, parameters, bindings, intern),
+            array.length});
+    }
+    if (type.is<IR::Type::Slice>()) {
+        return std::make_unique<IR::Type>(IR::Type::Slice{
+            substitute(*type.as<IR::Type::Slice>().element,
+                       parameters,
+                       bindings,
+                       intern)});
+    }
+    if (!type.is<IR::Type::Function>()) { return type.clone(); }
+
+    IR::Type::Function const &function = type.as<IR::Type::Function>();
+    IR::Type::Function::Arguments arguments;
+    for (IR::Type::Function::Argument const &argument : function.arguments) {
+        arguments.emplace_back(
+            intern(argument.name.name),
+            substitute(*argument.type, parameters, bindings, intern));
+    }
+    return std::make_unique<IR::Type>(
+        substitute(*function.return_type, parameters, bindings, intern),
+        std::move(arguments));
+}
+
+/// @p operand, with its label, if it has one, interned by @p intern
+inline IR::Operand relabel(IR::Operand operand, Intern const &intern) {
+    if (!operand.is<IR::Label>()) { return operand; }
+    return intern(operand.as<IR::Label>().name);
+}
+
+/**
+ * @brief a copy of @p lambda named @p name, with its type parameters
+ * bound to @p bindings, and every label interned by @p intern, so that the
+ * copy does not refer to the strings of @p lambda
+ */
+inline IR::Lambda instantiate(IR::Lambda const &lambda,
+                              IR::Label name,
+                              std::span<IR::Type const *const> bindings,
+                              Intern const &intern) {
+    std::span<IR::Label const> parameters = lambda.type_parameters();
+    IR::Lambda::Arguments arguments;
+    for (IR::Lambda::Argument const &argument : lambda.arguments()) {
+        arguments.emplace_back(
+            intern(argument.name.name),
+            substitute(*argument.type, parameters, bindings, intern));
+    }
+    IR::Lambda instance{
+        intern(name.name),
+        substitute(*lambda.return_type(), parameters, bindings, intern),
+        std::move(arguments)};
+    instance.fast_math(lambda.fast_math());
+    instance.checked(lambda.checked());
+    if (bindings.empty()) {
+        std::vector<IR::Label> unbound;
+        for (IR::Label parameter : parameters) {
+            unbound.push_back(intern(parameter.name));
+        }
+        instance.type_parameters(std::move(unbound));
+    }
+
+    for (IR::Local const &local : lambda.locals()) {
+        instance.declare(IR::Local{
+            intern(local.name_.name),
+            substitute(*local.type_, parameters, bindings, intern),
+            local.value_});
+    }
+    for (IR::Block const &block : lambda.body()) {
+        IR::Block &copy = instance.body().emplace_back(block);
+        for (IR::Instruction &instruction : copy) {
+            switch (instruction.format()) {
+            case IR::Instruction::Format::Unary:
+                instruction = {instruction.opcode(),
+                               relabel(instruction.A(), intern)};
+                break;
+            case IR::Instruction::Format::Binary:
+                instruction = {instruction.opcode(),
+                               relabel(instruction.A(), intern),
+                               relabel(instruction.B(), intern)};
+                break;
+            default:
+                instruction = {instruction.opcode(),
+                               relabel(instruction.A(), intern),
+                               relabel(instruction.B(), intern),
+                               relabel(instruction.C(), intern)};
+            }
+        }
+    }
+    return instance;
+}
+
+} // namespace detail
+
+/**
+ * @class SpecializationCache
+ * @brief The instances of generic lambdas, by the lambda and the types its
+ * parameters are bound to, which may be shared by the modules of a build.
+ *
+ * A generic lambda is keyed on its name and its structural hash, so that
+ * two modules which define different lambdas of the same name do not
+ * share instances, and its bindings on their structural hashes; as two
+ * types may hash alike, the bindings of an instance are kept, and must
+ * have the same structure as those asked for. Instances are held with
+ * labels of their own, so they outlive the module they were first made
+ * for. Lookups may come from any thread.
+ */
+class SpecializationCache {
+public:
+    struct Key {
+        std::string lambda;
+        std::uint64_t structure;
+        /// the structural hash of the type each parameter is bound to
+        std::vector<std::uint64_t> types;
+
+        auto operator<=>(Key const &) const = default;
+    };
+
+private:
+    struct Instance {
+        std::vector<IR::Type::Ptr> bindings;
+        IR::Lambda lambda;
+    };
+
+    std::mutex mutex_;
+    std::multimap<Key, Instance> instances_;
+    std::set<std::string, std::less<>> strings_;
+    std::uint64_t hits_ = 0;
+
+public:
+    /// the key of @p generic, with its parameters bound to @p bindings
+    static Key key(IR::Lambda const &generic,
+                   std::span<IR::Type const *const> bindings) {
+        Key key{std::string{generic.name().name},
+                IR::structural_hash(generic),
+                {}};
+        for (IR::Type const *type : bindings) {
+            key.types.push_back(IR::structural_hash(*type));
+        }
+        return key;
+    }
+
+    /**
+     * @brief the instance of @p generic for @p bindings, which is made by
+     * @p make, given an Intern of the cache, the first time it is asked
+     * for
+     */
+    template <class Make>
+    IR::Lambda const &instance(IR::Lambda const &generic,
+                               std::span<IR::Type const *const> bindings,
+                               Make make) {
+        Key key = SpecializationCache::key(generic, bindings);
+        std::lock_guard lock{mutex_};
+        auto [first, last] = instances_.equal_range(key);
+        for (auto found = first; found != last; ++found) {
+            std::vector<IR::Type::Ptr> const &bound = found->second.bindings;
+            if (std::ranges::equal(
+                    bound, bindings, [](auto const &left, auto right) {
+                        return IR::same_structure(*left, *right);
+                    })) {
+                ++hits_;
+                return found->second.lambda;
+            }
+        }
+        Intern intern = [this](std::string_view string) {
+            return IR::Label{*strings_.emplace(string).first};
+        };
+        Instance made{{}, make(intern)};
+        for (IR::Type const *type : bindings) {
+            made.bindings.push_back(
+                detail::substitute(*type, {}, {}, intern));
+        }
+        return instances_.emplace(std::move(key), std::move(made))
+            ->second.lambda;
+    }
+
+    /// the number of instances made
+    std::uint64_t size() {
+        std::lock_guard lock{mutex_};
+        return instances_.size();
+    }
+
+    /// the number of lookups which found an instance made before
+    std::uint64_t hits() {
+        std::lock_guard lock{mutex_};
+        return hits_;
+    }
+};
+
+/**
+ * @class Monomorphize
+ * @brief Gives each call of a generic lambda an instance of it, in which
+ * its type parameters are the types of the call, and removes the generic
+ * lambdas from the module.
+ *
+ * The parameters of a call are inferred from the locals it passes and
+ * returns into, which are consecutive from its last operand. Each
+ * instance is named for its lambda and types, as in max<i32>, and is made
+ * once per module however often it is called; instances are searched for
+ * calls in turn. With a [cache](@ref SpecializationCache), an instance
+ * made for another module is copied, rather than made again.
+ *
+ * Generic lambdas are kept by the pass, so that a stream of lambdas may be
+ * monomorphized a module at a time: calls in a later module are given the
+ * instances made for an earlier one, which are not made again.
+ */
+class Monomorphize : public ModulePass {
+    Intern intern_;
+    SpecializationCache *cache_;
+    std::unordered_map<std::string_view, IR::Lambda> generics_;
+    /// the names of the instances made so far
+    std::unordered_set<std::string_view> instances_;
+    std::vector<std::string> errors_;
+
+    void error(IR::Lambda const &lambda, std::string message) {
+        errors_.push_back("in " + std::string{lambda.name().name} + ": " +
+                          std::move(message));
+    }
+
+    /**
+     * @brief binds the parameters of @p generic to the types of the call
+     * @p call of @p caller, into @p bindings
+     *
+     * @return false if a parameter is not bound, or bound twice
+     */
+    bool bind(IR::Lambda const &caller,
+              IR::Instruction const &call,
+              IR::Lambda const &generic,
+              std::vector<IR::Type const *> &bindings) {
+        std::vector<IR::Label> const &parameters = generic.type_parameters();
+        bindings.assign(parameters.size(), nullptr);
+        std::string const callee{generic.name().name};
+
+        auto unify = [&](IR::Type const &declared, IR::Operand operand) {
+            if (!operand.is<IR::LocalHandle>() ||
+                operand.as<IR::LocalHandle>().index >= caller.frame_size()) {
+                error(caller, "a call of " + callee + " passes a non-local");
+                return false;
+            }
+            if (!declared.is<IR::Type::Parameter>()) { return true; }
+            IR::Type const &actual =
+                caller.type_of(operand.as<IR::LocalHandle>());
+            IR::Label parameter = declared.as<IR::Type::Parameter>().name;
+            for (std::size_t index = 0; index < parameters.size(); ++index) {
+                if (parameters[index] != parameter) { continue; }
+                if (bindings[index] == nullptr) {
+                    bindings[index] = &actual;
+                } else if (!IR::same_structure(*bindings[index], actual)) {
+                    std::ostringstream message;
+                    message << parameter.name << " of " << callee
+                            << " is both " << *bindings[index] << " and "
+                            << actual;
+                    error(caller, message.str());
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        if (!unify(*generic.return_type(), call.A())) { return false; }
+        std::uint64_t const count = generic.arguments().size();
+        if (count != 0 &&
+            (call.format() != IR::Instruction::Format::Ternary ||
+             !call.C().is<IR::LocalHandle>())) {
+            error(caller, "a call of " + callee + " passes no arguments");
+            return false;
+        }
+        for (std::uint64_t index = 0; index < count; ++index) {
+            IR::LocalHandle argument{call.C().as<IR::LocalHandle>().index +
+                                     index};
+            if (!unify(*generic.arguments()[index].type, argument)) {
+                return false;
+            }
+        }
+
+        for (std::size_t index = 0; index < parameters.size(); ++index) {
+            if (bindings[index] == nullptr) {
+                error(caller,
+                      "cannot infer " + std::string{parameters[index].name} +
+                          " of " + callee + " from its arguments");
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief the name of the instance of @p generic for @p bindings, and
+     * the instance, appended to @p module, if it is the first
+     */
+    IR::Label instance(IR::Module &module,
+                       IR::Lambda const &generic,
+                       std::span<IR::Type const *const> bindings) {
+        std::ostringstream mangled;
+        mangled << generic.name().name << "<";
+        for (std::size_t index = 0; index < bindings.size(); ++index) {
+            mangled << (index == 0 ? "" : ",") << *bindings[index];
+        }
+        mangled << ">";
+        IR::Label name = intern_(mangled.str());
+        if (!instances_.insert(name.name).second) { return name; }
+
+        if (cache_ == nullptr) {
+            module.append(
+                detail::instantiate(generic, name, bindings, intern_));
+            return name;
+        }
+        IR::Lambda const &cached = cache_->instance(
+            generic, bindings, [&](Intern const &intern) {
+                return detail::instantiate(generic, name, bindings, intern);
+            });
+        module.append(detail::instantiate(cached, name, {}, intern_));
+        return name;
+    }
+
+    /// @return true if any call of @p module[index] was retargeted
+    bool specialize(IR::Module &module, std::size_t index) {
+        bool changed = false;
+        std::vector<IR::Type const *> bindings;
+        // appending an instance may move the caller, so it is indexed.
+        for (std::size_t at = 0; at < module[index].body().size(); ++at) {
+            for (std::size_t offset = 0;
+                 offset < module[index].body()[at].size();
+                 ++offset) {
+                IR::Instruction const call =
+                    module[index].body()[at][offset];
+                if (call.opcode() != IR::Instruction::Opcode::Call ||
+                    !call.B().is<IR::Label>()) {
+                    continue;
+                }
+                auto found = generics_.find(call.B().as<IR::Label>().name);
+                if (found == generics_.end() ||
+                    !bind(module[index], call, found->second, bindings)) {
+                    continue;
+                }
+                IR::Label name = instance(module, found->second, bindings);
+                module[index].body()[at][offset] =
+                    call.format() == IR::Instruction::Format::Ternary
+                        ? IR::Instruction{call.opcode(),
+                                          call.A(),
+                                          name,
+                                          call.C()}
+                        : IR::Instruction{call.opcode(), call.A(), name};
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+public:
+    /**
+     * @param intern interns the names of instances into the strings of
+     * the modules this runs over
+     * @param cache where instances are shared with other modules, if any
+     */
+    explicit Monomorphize(Intern intern,
+                          SpecializationCache *cache = nullptr) noexcept
+        : intern_{std::move(intern)}, cache_{cache} {}
+
+    std::string_view name() const noexcept override { return "monomorphize"; }
+
+    /// keeps @p generic, to give the calls of later modules instances of
+    void add_generic(IR::Lambda generic) {
+        std::string_view name = generic.name().name;
+        generics_.insert_or_assign(name, std::move(generic));
+    }
+
+    /// the number of instances made so far
+    std::uint64_t instantiated() const noexcept { return instances_.size(); }
+
+    /// what could not be instantiated, as messages without a severity
+    std::vector<std::string> const &errors() const noexcept {
+        return errors_;
+    }
+
+    Preserved run(IR::Module &module, AnalysisManager &analyses) override {
+        for (IR::Lambda &generic : module.extract(
+                 [](IR::Lambda const &lambda) { return lambda.generic(); })) {
+            analyses.forget(generic);
+            add_generic(std::move(generic));
+        }
+        if (generics_.empty()) { return Preserved::all(); }
+
+        // instances are appended as they are made, and searched in turn.
+        for (std::size_t index = 0; index < module.size(); ++index) {
+            if (specialize(module, index)) {
+                analyses.invalidate(module[index], Preserved::none());
+            }
+        }
+        return Preserved::all();
+    }
+};
+
+} // namespace fun::pass
@@ -0,0 +1,66 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file pass.hpp
+ * @brief Defines [FunctionPass](@ref FunctionPass) and
+ * [ModulePass](@ref ModulePass)
+ */
+
+#pragma once
+
+#include <string_view>
+
+#include "IR/module.hpp"
+#include "pass/analysis.hpp"
+
+namespace fun::pass {
+
+/**
+ * @class FunctionPass
+ * @brief A transformation or analysis of a single lambda.
+ *
+ * A function pass may only read and write the lambda it is given. The
+ * same pass object may be run on distinct lambdas concurrently, so any
+ * state a pass keeps across calls to run must be synchronized.
+ */
+class FunctionPass {
+public:
+    virtual ~FunctionPass() = default;
+
+    virtual std::string_view name() const noexcept = 0;
+
+    /**
+     * @return the analyses of @p lambda which are still valid
+     */
+    virtual Preserved run(IR::Lambda &lambda, FunctionAnalyses &analyses) = 0;
+};
+
+/**
+ * @class ModulePass
+ * @brief A transformation or analysis of a whole module.
+ *
+ * Module passes run on a single thread, and act as a barrier between the
+ * function passes scheduled before and after them.
+ */
+class ModulePass {
+public:
+    virtual ~ModulePass() = default;
+
+    virtual std::string_view name() const noexcept = 0;
+
+    /**
+     * @return the analyses of every lambda in @p module which are still
+     * valid. A pass which adds or removes lambdas is responsible for the
+     * caches of those lambdas.
+     */
+    virtual Preserved run(IR::Module &module, AnalysisManager &analyses) = 0;
+};
+
+} // namespace fun::pass
@@ -0,0 +1,231 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file pass_manager.hpp
+ * @brief Defines [PassManager](@ref PassManager)
+ */
+
+#pragma once
+
+#include <chrono>
+#include <future>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <variant>
+#include <vector>
+
+#include "pass/pass.hpp"
+#include "support/thread_pool.hpp"
+
+namespace fun::pass {
+
+/**
+ * @struct Timing
+ * @brief The time spent in a single pass, summed over every run of it.
+ *
+ * When function passes run in parallel this is the sum over all threads,
+ * and so may exceed the wall time of the pipeline.
+ */
+struct Timing {
+    std::string_view name;
+    std::chrono::nanoseconds elapsed;
+    std::uint64_t runs;
+};
+
+/**
+ * @class PassManager
+ * @brief Runs a pipeline of module and function passes over a module.
+ *
+ * Consecutive function passes form a group. Each lambda is run through the
+ * whole group before the next module pass, which keeps a lambda hot in
+ * cache across passes and, in parallel mode, lets every lambda proceed
+ * independently of the others.
+ */
+class PassManager {
+public:
+    struct Options {
+        /// run each function pass group over distinct lambdas concurrently
+        bool parallel = false;
+        /// the number of worker threads, zero selects the hardware default
+        unsigned threads = 0;
+    };
+
+private:
+    using Clock = std::chrono::steady_clock;
+    using Pass  = std::variant<std::unique_ptr<ModulePass>,
+                               std::unique_ptr<FunctionPass>>;
+
+    Options options_;
+    std::vector<Pass> passes_;
+    std::vector<Timing> timings_;
+    std::chrono::nanoseconds elapsed_;
+    std::mutex timings_mutex_;
+    std::optional<support::ThreadPool> pool_;
+
+    /**
+     * @brief runs the function passes [first, last) over @p lambda
+     *
+     * timings are accumulated locally and merged once, so that parallel
+     * runs contend on timings_mutex_ once per lambda rather than per pass.
+     */
+    void run(IR::Lambda &lambda,
+             AnalysisManager &analyses,
+             std::size_t first,
+             std::size_t last) {
+        FunctionAnalyses &cache = analyses.on(lambda);
+        std::vector<std::chrono::nanoseconds> elapsed(last - first);
+
+        for (std::size_t index = first; index < last; ++index) {
+            FunctionPass &pass =
+                *std::get<std::unique_ptr<FunctionPass>>(passes_[index]);
+            auto start          = Clock::now();
+            Preserved preserved = pass.run(lambda, cache);
+            elapsed[index - first] += Clock::now() - start;
+            cache.invalidate(preserved);
+        }
+
+        std::lock_guard lock{timings_mutex_};
+        for (std::size_t index = first; index < last; ++index) {
+            timings_[index].elapsed += elapsed[index - first];
+            timings_[index].runs += 1;
+        }
+    }
+
+    void run(IR::Module &module,
+             AnalysisManager &analyses,
+             std::size_t first,
+             std::size_t last) {
+        if (!options_.parallel || module.size() < 2) {
+            for (IR::Lambda &lambda : module) {
+                run(lambda, analyses, first, last);
+            }
+            return;
+        }
+
+        if (!pool_) {
+            pool_.emplace(options_.threads == 0
+                              ? support::ThreadPool::default_size()
+                              : options_.threads);
+        }
+
+        std::vector<std::future<void>> pending;
+        pending.reserve(module.size());
+        for (IR::Lambda &lambda : module) {
+            pending.push_back(pool_->submit([&, first, last] {
+                run(lambda, analyses, first, last);
+            }));
+        }
+        // wait for every task before rethrowing, so no task outlives the
+        // lambdas it refers to.
+        for (auto &task : pending) {
+            task.wait();
+        }
+        for (auto &task : pending) {
+            task.get();
+        }
+    }
+
+public:
+    PassManager() noexcept : options_{}, elapsed_{0} {}
+
+    explicit PassManager(Options options) noexcept
+        : options_{options}, elapsed_{0} {}
+
+    void add(std::unique_ptr<ModulePass> pass) {
+        timings_.push_back(Timing{pass->name(), {}, 0});
+        passes_.emplace_back(std::move(pass));
+    }
+
+    void add(std::unique_ptr<FunctionPass> pass) {
+        timings_.push_back(Timing{pass->name(), {}, 0});
+        passes_.emplace_back(std::move(pass));
+    }
+
+    template <class P, class... Args> P &add(Args &&...args) {
+        auto pass  = std::make_unique<P>(std::forward<Args>(args)...);
+        P &result  = *pass;
+        using Base = std::conditional_t<std::derived_from<P, ModulePass>,
+                                        ModulePass,
+                                        FunctionPass>;
+        add(std::unique_ptr<Base>{std::move(pass)});
+        return result;
+    }
+
+    std::uint64_t size() const noexcept { return passes_.size(); }
+
+    void run(IR::Module &module, AnalysisManager &analyses) {
+        auto start = Clock::now();
+
+        std::size_t index = 0;
+        while (index < passes_.size()) {
+            if (auto *pass =
+                    std::get_if<std::unique_ptr<ModulePass>>(&passes_[index])) {
+                auto begin          = Clock::now();
+                Preserved preserved = (*pass)->run(module, analyses);
+                timings_[index].elapsed += Clock::now() - begin;
+                timings_[index].runs += 1;
+                analyses.invalidate(preserved);
+                ++index;
+                continue;
+            }
+
+            std::size_t last = index;
+            while (last < passes_.size() &&
+                   std::holds_alternative<std::unique_ptr<FunctionPass>>(
+                       passes_[last])) {
+                ++last;
+            }
+            run(module, analyses, index, last);
+            index = last;
+        }
+
+        elapsed_ += Clock::now() - start;
+    }
+
+    std::span<Timing const> timings() const noexcept { return timings_; }
+
+    /**
+     * @brief the wall time spent in [run](@ref PassManager::run)
+     */
+    std::chrono::nanoseconds elapsed() const noexcept { return elapsed_; }
+
+    /**
+     * @brief prints the time spent in each pass, in pipeline order.
+     */
+    void print_timings(std::ostream &out) const {
+        using Milliseconds = std::chrono::duration<double, std::milli>;
+        std::chrono::nanoseconds total{0};
+        for (Timing const &timing : timings_) {
+            total += timing.elapsed;
+        }
+
+        out << "pass timings (wall "
+            << Milliseconds{elapsed_}.count() << "ms, passes "
+            << Milliseconds{total}.count() << "ms)\n";
+        for (Timing const &timing : timings_) {
+            double percent =
+                total.count() == 0
+                    ? 0.0
+                    : 100.0 * static_cast<double>(timing.elapsed.count()) /
+                          static_cast<double>(total.count());
+            out << std::fixed << std::setprecision(3) << std::setw(12)
+                << Milliseconds{timing.elapsed}.count() << "ms "
+                << std::setprecision(1) << std::setw(6) << percent << "% "
+                << std::setw(8) << timing.runs << "  " << timing.name << '\n';
+        }
+        out << std::defaultfloat;
+    }
+};
+
+} // namespace fun::pass
@@ -0,0 +1,273 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file place_blocks.hpp
+ * @brief Defines [PlaceBlocks](@ref PlaceBlocks)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "eval/fold.hpp"
+#include "pass/cfg.hpp"
+#include "pass/pass.hpp"
+
+namespace fun::pass {
+
+/**
+ * @class PlaceBlocks
+ * @brief Orders the blocks of a lambda so that the likelier successor of
+ * each block falls through from it.
+ *
+ * Blocks are chained greedily from the entry block, which stays first:
+ * each block is followed by its heaviest successor which is not yet
+ * placed, or, when it has none, by the first block which is not. The
+ * weights of a conditional branch are those of its block, when it has
+ * any, as the source weighs the branch. Otherwise they are estimated: a
+ * branch back to its own or an earlier block loops again (31:1), values
+ * are seldom equal (12:20 for jeq and jz, 20:12 for jne and jnz), and
+ * anything else is even. Estimates are only used to place blocks; they
+ * are not attached to the blocks, so LLVM makes its own.
+ *
+ * Once placed, branches are retargeted, and every fall through which was
+ * lost is restored: a conditional branch whose target now follows it is
+ * inverted, where that preserves its meaning for its operands, a block
+ * without a branch gets a jmp, or a ret of zero where it used to fall out
+ * of the lambda, and otherwise a block holding that jmp or ret is placed
+ * after the branch.
+ */
+class PlaceBlocks : public FunctionPass {
+    static bool is_float(IR::Lambda const &lambda, IR::Operand operand) {
+        std::uint64_t type = 0;
+        if (operand.is<IR::Scalar>()) {
+            type = operand.as<IR::Scalar>().index();
+        } else if (operand.is<IR::LocalHandle>() &&
+                   operand.as<IR::LocalHandle>().index <
+                       lambda.frame_size()) {
+            type = lambda.type_of(operand.as<IR::LocalHandle>()).index();
+        } else if (operand.is<IR::FieldHandle>() &&
+                   lambda.has_field(operand.as<IR::FieldHandle>())) {
+            type = lambda.type_of(operand.as<IR::FieldHandle>()).index();
+        }
+        return type == 10 || type == 11;
+    }
+
+    /**
+     * @brief whether the conditional branch @p branch may be replaced by
+     * its inverse: NaN is neither less than nor at least anything, unless
+     * the lambda assumes there is no NaN.
+     */
+    static bool invertible(IR::Lambda const &lambda,
+                           IR::Instruction const &branch) {
+        using Opcode = IR::Instruction::Opcode;
+        switch (branch.opcode()) {
+        case Opcode::Jz:
+        case Opcode::Jnz:
+        case Opcode::Jeq:
+        case Opcode::Jne: return true;
+        default:
+            return !is_float(lambda, branch.B()) ||
+                   IR::has(lambda.fast_math().value_or(IR::FastMath::None),
+                           IR::FastMath::NoNaNs);
+        }
+    }
+
+    static IR::Instruction retarget(IR::Instruction const &branch,
+                                    IR::Instruction::Opcode opcode,
+                                    std::uint64_t target) {
+        IR::BlockHandle handle{target};
+        switch (branch.format()) {
+        case IR::Instruction::Format::Unary: return {opcode, handle};
+        case IR::Instruction::Format::Binary:
+            return {opcode, handle, branch.B()};
+        case IR::Instruction::Format::Ternary:
+            return {opcode, handle, branch.B(), branch.C()};
+        default: std::unreachable();
+        }
+    }
+
+public:
+    /**
+     * @brief the weights of the conditional branch which ends @p block:
+     * its own, or else an estimate.
+     */
+    static IR::Block::Weights
+    weights(IR::Lambda const &lambda, CFG const &cfg, std::uint64_t block) {
+        using Opcode = IR::Instruction::Opcode;
+        IR::Block const &instructions = lambda.body()[block];
+        if (instructions.weights()) { return *instructions.weights(); }
+
+        CFG::Node const &node = cfg[block];
+        if (node.taken && *node.taken <= block) { return {31, 1}; }
+        switch (instructions[*node.terminator].opcode()) {
+        case Opcode::Jeq:
+        case Opcode::Jz:  return {12, 20};
+        case Opcode::Jne:
+        case Opcode::Jnz: return {20, 12};
+        default:          return {16, 16};
+        }
+    }
+
+    /**
+     * @brief the order in which to place the blocks of @p lambda, as the
+     * indices of its blocks; the first is always the entry block.
+     */
+    static std::vector<std::uint64_t> order(IR::Lambda const &lambda,
+                                            CFG const &cfg) {
+        std::vector<std::uint64_t> order;
+        if (cfg.size() == 0) { return order; }
+        std::vector<bool> placed(cfg.size(), false);
+        order.push_back(0);
+        placed[0] = true;
+
+        while (order.size() < cfg.size()) {
+            std::uint64_t last = order.back();
+            std::optional<std::uint64_t> best;
+            std::uint64_t heaviest = 0;
+            // the fall through is considered first, so that it wins ties.
+            auto consider = [&](std::optional<std::uint64_t> successor,
+                                std::uint64_t weight) {
+                if (!successor || placed[*successor]) { return; }
+                if (!best || weight > heaviest) {
+                    best     = successor;
+                    heaviest = weight;
+                }
+            };
+
+            CFG::Node const &node = cfg[last];
+            std::optional<std::uint64_t> next = cfg.fallthrough(last);
+            if (node.taken && node.falls_through) {
+                IR::Block::Weights weight = weights(lambda, cfg, last);
+                consider(next, weight.fallthrough);
+                consider(node.taken, weight.taken);
+            } else {
+                consider(next, 1);
+                consider(node.taken, 1);
+            }
+
+            if (!best) {
+                best = static_cast<std::uint64_t>(
+                    std::ranges::find(placed, false) - placed.begin());
+            }
+            placed[*best] = true;
+            order.push_back(*best);
+        }
+        return order;
+    }
+
+    std::string_view name() const noexcept override { return "place-blocks"; }
+
+    Preserved run(IR::Lambda &lambda, FunctionAnalyses &analyses) override {
+        using Opcode               = IR::Instruction::Opcode;
+        IR::Lambda::Body &body     = lambda.body();
+        std::uint64_t const blocks = body.size();
+        if (blocks < 2) { return Preserved::all(); }
+
+        CFG const &cfg = analyses.get<ControlFlow>();
+        for (std::uint64_t block = 0; block < blocks; ++block) {
+            // a branch to no such block is an error, reported where the
+            // lambda is run or lowered; retargeting could hide it.
+            if (cfg[block].terminator && !cfg[block].taken &&
+                IR::is_branch(body[block][*cfg[block].terminator].opcode())) {
+                return Preserved::all();
+            }
+        }
+
+        std::vector<std::uint64_t> placement = order(lambda, cfg);
+        if (std::ranges::is_sorted(placement)) { return Preserved::all(); }
+
+        // how each block restores a fall through it lost, decided before
+        // anything moves, as a new block shifts the index of every block
+        // placed after it.
+        enum class Repair { None, Append, Invert, Split };
+        std::vector<Repair> repairs(blocks, Repair::None);
+        std::vector<std::uint64_t> position(blocks);
+        std::uint64_t placed = 0;
+        for (std::uint64_t at = 0; at < blocks; ++at) {
+            std::uint64_t block   = placement[at];
+            CFG::Node const &node = cfg[block];
+            position[block]       = placed++;
+            if (!node.falls_through) { continue; }
+
+            bool const exits = block + 1 == blocks;
+            bool const kept  = exits ? at + 1 == blocks
+                                     : at + 1 < blocks &&
+                                          placement[at + 1] == block + 1;
+            if (kept) { continue; }
+            if (!node.terminator) {
+                repairs[block] = Repair::Append;
+            } else if (!exits && at + 1 < blocks &&
+                       placement[at + 1] == *node.taken &&
+                       invertible(lambda, body[block][*node.terminator])) {
+                repairs[block] = Repair::Invert;
+            } else {
+                repairs[block] = Repair::Split;
+                ++placed;
+            }
+        }
+
+        IR::Operand const zero = eval::zero(*lambda.return_type());
+        // the jmp, or ret, which takes the place of the fall through
+        auto resume = [&](IR::Block &into, std::uint64_t block) {
+            if (block + 1 == blocks) {
+                into.append(Opcode::Ret, zero);
+            } else {
+                into.append(Opcode::Jmp, IR::BlockHandle{position[block + 1]});
+            }
+        };
+
+        IR::Lambda::Body result;
+        result.reserve(placed);
+        for (std::uint64_t block : placement) {
+            CFG::Node const &node = cfg[block];
+            IR::Block moved       = std::move(body[block]);
+            if (node.taken) {
+                IR::Instruction &branch = moved[*node.terminator];
+                branch =
+                    retarget(branch, branch.opcode(), position[*node.taken]);
+            }
+
+            switch (repairs[block]) {
+            case Repair::None: result.push_back(std::move(moved)); break;
+            case Repair::Append:
+                resume(moved, block);
+                result.push_back(std::move(moved));
+                break;
+            case Repair::Invert: {
+                IR::Instruction &branch = moved[*node.terminator];
+                branch = retarget(branch,
+                                  IR::inverse(branch.opcode()),
+                                  position[block + 1]);
+                if (auto weights = moved.weights()) {
+                    moved.weights(IR::Block::Weights{weights->fallthrough,
+                                                     weights->taken});
+                }
+                result.push_back(std::move(moved));
+                break;
+            }
+            case Repair::Split: {
+                result.push_back(std::move(moved));
+                resume(result.emplace_back(), block);
+                break;
+            }
+            default: std::unreachable();
+            }
+        }
+
+        body = std::move(result);
+        return Preserved::none();
+    }
+};
+
+} // namespace fun::pass
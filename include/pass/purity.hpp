@@ -0,0 +1,208 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file purity.hpp
+ * @brief Defines [Effects](@ref Effects) and [Purity](@ref Purity)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "IR/module.hpp"
+#include "pass/cfg.hpp"
+#include "pass/ranges.hpp"
+
+namespace fun::pass {
+
+/**
+ * @brief what a lambda may do to memory which its caller can see, from
+ * least to most, so that the effects of two calls are the greater.
+ */
+enum class Memory : std::uint8_t { None, Read, Write };
+
+/**
+ * @struct Effects
+ * @brief What calling a lambda may do, besides returning its result.
+ */
+struct Effects {
+    Memory memory   = Memory::None;
+    bool unwinds    = false;
+    bool terminates = true;
+
+    constexpr bool operator==(Effects const &) const noexcept = default;
+};
+
+/**
+ * @class Purity
+ * @brief The effects of every lambda of a set, inferred from each other.
+ *
+ * A lambda touches only the cells of its own frame, which its caller
+ * cannot see, but for the elements of a slice, which may be those of a
+ * caller; nothing in it unwinds, so otherwise it is as pure as the lambdas
+ * it calls. It terminates if it calls only lambdas which terminate, has
+ * no bounds check, which traps rather than returns, and has no loop, that
+ * is, no branch to its own or an earlier block. A checked lambda traps as
+ * well on arithmetic which fails, unless its [Ranges](@ref Ranges) prove
+ * it cannot. Nothing is known of a lambda outside of the set, so a call
+ * to one may do anything.
+ *
+ * The effects are the least fixed point: every lambda starts out pure and
+ * not terminating, and is inferred again whenever a lambda it calls
+ * changes. So a recursive lambda stays pure, and is never proven to
+ * terminate.
+ */
+class Purity {
+    std::unordered_map<std::string_view, Effects> effects_;
+
+public:
+    /// the effects of a lambda of which nothing is known
+    static constexpr Effects unknown{Memory::Write, true, false};
+
+    /**
+     * @brief whether @p lambda may run a block more than once in a call,
+     * as it branches to its own or an earlier block.
+     */
+    static bool loops(IR::Lambda const &lambda) {
+        CFG cfg{lambda};
+        for (std::uint64_t block = 0; block < cfg.size(); ++block) {
+            if (cfg[block].taken && *cfg[block].taken <= block) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// whether @p operand is a cell of @p lambda which holds a slice
+    static bool is_slice(IR::Lambda const &lambda, IR::Operand operand) {
+        if (operand.is<IR::LocalHandle>()) {
+            IR::LocalHandle local = operand.as<IR::LocalHandle>();
+            return local.index < lambda.frame_size() &&
+                   lambda.type_of(local).is<IR::Type::Slice>();
+        }
+        return operand.is<IR::FieldHandle>() &&
+               lambda.has_field(operand.as<IR::FieldHandle>()) &&
+               lambda.type_of(operand.as<IR::FieldHandle>())
+                   .is<IR::Type::Slice>();
+    }
+
+    /**
+     * @brief the effects of @p lambda, given those of each lambda it calls
+     * by @p callee. A call of @p lambda by itself may do nothing else, but
+     * may never return.
+     */
+    template <class Callee>
+    static Effects infer(IR::Lambda const &lambda, Callee &&callee) {
+        Effects effects{Memory::None, false, !loops(lambda)};
+        if (effects.terminates && lambda.checked()) {
+            CFG const cfg{lambda};
+            effects.terminates = !Ranges{lambda, cfg}.may_fail(lambda, cfg);
+        }
+        for (IR::Block const &block : lambda.body()) {
+            for (IR::Instruction const &instruction : block) {
+                using Opcode = IR::Instruction::Opcode;
+                if (IR::is_element_access(instruction.opcode())) {
+                    if (IR::is_bounds_checked(instruction.opcode())) {
+                        effects.terminates = false;
+                    }
+                    bool const writes =
+                        instruction.opcode() == Opcode::Insert ||
+                        instruction.opcode() == Opcode::UncheckedInsert;
+                    if (is_slice(lambda,
+                                 writes ? instruction.A()
+                                        : instruction.B())) {
+                        effects.memory = std::max(
+                            effects.memory,
+                            writes ? Memory::Write : Memory::Read);
+                    }
+                    continue;
+                }
+                if (instruction.opcode() != Opcode::Call ||
+                    instruction.format() == IR::Instruction::Format::Unary ||
+                    !instruction.B().is<IR::Label>()) {
+                    continue;
+                }
+                IR::Label label = instruction.B().as<IR::Label>();
+                if (label == lambda.name()) {
+                    effects.terminates = false;
+                    continue;
+                }
+                Effects called     = callee(label);
+                effects.memory     = std::max(effects.memory, called.memory);
+                effects.unwinds    = effects.unwinds || called.unwinds;
+                effects.terminates = effects.terminates && called.terminates;
+            }
+        }
+        return effects;
+    }
+
+    /**
+     * @brief infers the effects of each of @p lambdas, which are those
+     * callees of theirs which are known.
+     */
+    explicit Purity(std::span<IR::Lambda const *const> lambdas) {
+        std::unordered_map<std::string_view, IR::Lambda const *> known;
+        std::unordered_map<std::string_view, std::vector<IR::Lambda const *>>
+            callers;
+        for (IR::Lambda const *lambda : lambdas) {
+            known.emplace(lambda->name().name, lambda);
+            effects_.emplace(lambda->name().name,
+                             Effects{Memory::None, false, false});
+        }
+        for (IR::Lambda const *lambda : lambdas) {
+            infer(*lambda, [&](IR::Label label) {
+                if (known.contains(label.name)) {
+                    callers[label.name].push_back(lambda);
+                }
+                return unknown;
+            });
+        }
+
+        std::vector<IR::Lambda const *> worklist{lambdas.rbegin(),
+                                                 lambdas.rend()};
+        while (!worklist.empty()) {
+            IR::Lambda const *lambda = worklist.back();
+            worklist.pop_back();
+            Effects effects = infer(*lambda, [&](IR::Label label) {
+                return find(label);
+            });
+            Effects &current = effects_[lambda->name().name];
+            if (effects == current) { continue; }
+            current = effects;
+            auto found = callers.find(lambda->name().name);
+            if (found == callers.end()) { continue; }
+            worklist.insert(
+                worklist.end(), found->second.begin(), found->second.end());
+        }
+    }
+
+    /// infers the effects of every lambda of @p module
+    explicit Purity(IR::Module const &module)
+        : Purity{[&module] {
+              std::vector<IR::Lambda const *> lambdas;
+              for (IR::Lambda const &lambda : module) {
+                  lambdas.push_back(&lambda);
+              }
+              return lambdas;
+          }()} {}
+
+    /// the effects of the lambda @p name, or unknown if it is not known
+    Effects find(IR::Label name) const noexcept {
+        auto found = effects_.find(name.name);
+        return found == effects_.end() ? unknown : found->second;
+    }
+};
+
+} // namespace fun::pass
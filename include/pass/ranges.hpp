@@ -0,0 +1,724 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file ranges.hpp
+ * @brief Defines [Range](@ref Range), [Ranges](@ref Ranges) and the
+ * [ValueRanges](@ref ValueRanges) analysis
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "IR/lambda.hpp"
+#include "pass/analysis.hpp"
+#include "pass/cfg.hpp"
+
+namespace fun::pass {
+
+/**
+ * @struct Range
+ * @brief The integers a cell may hold, from lo to hi.
+ *
+ * A bound at the limit of std::int64_t bounds nothing: past it the cell
+ * may hold whatever its type can, which for a u64 includes values that no
+ * std::int64_t can. A range whose lo is above its hi is empty.
+ */
+struct Range {
+    static constexpr std::int64_t below =
+        std::numeric_limits<std::int64_t>::min();
+    static constexpr std::int64_t above =
+        std::numeric_limits<std::int64_t>::max();
+
+    std::int64_t lo = below;
+    std::int64_t hi = above;
+
+    constexpr bool operator==(Range const &) const noexcept = default;
+
+    static constexpr Range exactly(std::int64_t value) noexcept {
+        return {value, value};
+    }
+
+    /**
+     * @brief every value of the type @p index of IR::Type, or everything
+     * if it is not an integer
+     */
+    static constexpr Range of_type(std::uint64_t index) noexcept {
+        switch (index) {
+        case 0:  return exactly(0);
+        case 1:  return {0, 1};
+        case 2:  return {0, std::numeric_limits<std::uint8_t>::max()};
+        case 3:  return {0, std::numeric_limits<std::uint16_t>::max()};
+        case 4:  return {0, std::numeric_limits<std::uint32_t>::max()};
+        case 5:  return {0, above};
+        case 6:
+            return {std::numeric_limits<std::int8_t>::min(),
+                    std::numeric_limits<std::int8_t>::max()};
+        case 7:
+            return {std::numeric_limits<std::int16_t>::min(),
+                    std::numeric_limits<std::int16_t>::max()};
+        case 8:
+            return {std::numeric_limits<std::int32_t>::min(),
+                    std::numeric_limits<std::int32_t>::max()};
+        default: return {};
+        }
+    }
+
+    /// the range of @p scalar, or everything if it is not an integer
+    static constexpr Range of(IR::Scalar const &scalar) noexcept {
+        switch (scalar.index()) {
+        case 0: return exactly(0);
+        case 1: return exactly(scalar.as<IR::Scalar::Bool>() ? 1 : 0);
+        case 2: return exactly(scalar.as<IR::Scalar::u8>());
+        case 3: return exactly(scalar.as<IR::Scalar::u16>());
+        case 4: return exactly(scalar.as<IR::Scalar::u32>());
+        case 5: {
+            IR::Scalar::u64 value = scalar.as<IR::Scalar::u64>();
+            if (value >= static_cast<IR::Scalar::u64>(above)) {
+                return {above, above};
+            }
+            return exactly(static_cast<std::int64_t>(value));
+        }
+        case 6:  return exactly(scalar.as<IR::Scalar::i8>());
+        case 7:  return exactly(scalar.as<IR::Scalar::i16>());
+        case 8:  return exactly(scalar.as<IR::Scalar::i32>());
+        case 9:  return exactly(scalar.as<IR::Scalar::i64>());
+        default: return {};
+        }
+    }
+
+    constexpr bool bounded() const noexcept {
+        return lo != below && hi != above;
+    }
+
+    constexpr bool empty() const noexcept { return lo > hi; }
+
+    /// whether every value of the range is at least @p low and at most
+    /// @p high
+    constexpr bool within(std::int64_t low, std::int64_t high) const noexcept {
+        return bounded() && low <= lo && hi <= high;
+    }
+
+    /// the smallest range which holds both this and @p other
+    constexpr Range hull(Range other) const noexcept {
+        return {std::min(lo, other.lo), std::max(hi, other.hi)};
+    }
+
+    /// the values both this and @p other hold
+    constexpr Range meet(Range other) const noexcept {
+        return {std::max(lo, other.lo), std::min(hi, other.hi)};
+    }
+
+    /**
+     * @brief this range, or else every value of @p type, if the
+     * arithmetic which gave it may have wrapped around
+     */
+    constexpr Range wrap(Range type) const noexcept {
+        if (!bounded() || lo < type.lo || hi > type.hi) { return type; }
+        return *this;
+    }
+
+    constexpr Range operator+(Range other) const noexcept {
+        Range sum;
+        if (!bounded() || !other.bounded() ||
+            __builtin_add_overflow(lo, other.lo, &sum.lo) ||
+            __builtin_add_overflow(hi, other.hi, &sum.hi)) {
+            return {};
+        }
+        return sum;
+    }
+
+    constexpr Range operator-(Range other) const noexcept {
+        Range difference;
+        if (!bounded() || !other.bounded() ||
+            __builtin_sub_overflow(lo, other.hi, &difference.lo) ||
+            __builtin_sub_overflow(hi, other.lo, &difference.hi)) {
+            return {};
+        }
+        return difference;
+    }
+
+    constexpr Range operator-() const noexcept {
+        if (!bounded()) { return {}; }
+        return {-hi, -lo};
+    }
+
+    constexpr Range operator*(Range other) const noexcept {
+        if (!bounded() || !other.bounded()) { return {}; }
+        std::int64_t const corners[][2] = {
+            {lo, other.lo}, {lo, other.hi}, {hi, other.lo}, {hi, other.hi}};
+        Range product{above, below};
+        for (auto [left, right] : corners) {
+            std::int64_t value = 0;
+            if (__builtin_mul_overflow(left, right, &value)) { return {}; }
+            product = product.hull(exactly(value));
+        }
+        return product;
+    }
+
+    /**
+     * @brief the quotients, rounded toward zero, of this by @p other.
+     *
+     * Division by zero is undefined, so only the divisors either side of
+     * it count, over each of which a quotient is monotone.
+     */
+    constexpr Range operator/(Range other) const noexcept {
+        if (!bounded() || !other.bounded()) { return {}; }
+        Range quotient{above, below};
+        auto divide = [&](Range divisor) {
+            if (divisor.empty()) { return; }
+            for (std::int64_t left : {lo, hi}) {
+                for (std::int64_t right : {divisor.lo, divisor.hi}) {
+                    quotient = quotient.hull(exactly(left / right));
+                }
+            }
+        };
+        divide(other.meet({below, -1}));
+        divide(other.meet({1, above}));
+        return quotient.empty() ? Range{} : quotient;
+    }
+
+    /**
+     * @brief the remainders of this by @p other, which take the sign of
+     * this and are smaller than @p other in magnitude.
+     *
+     * Unlike the other operations, this needs no bound of this, as the
+     * remainder has one anyway.
+     */
+    constexpr Range operator%(Range other) const noexcept {
+        if (!other.bounded()) { return {}; }
+        std::int64_t const largest =
+            std::max(other.lo < 0 ? -other.lo : other.lo,
+                     other.hi < 0 ? -other.hi : other.hi) -
+            1;
+        if (largest < 0) { return {}; }
+        // a dividend below every divisor is its own remainder.
+        if (lo >= 0 && other.lo > 0 && hi < other.lo) { return *this; }
+        return {lo < 0 ? std::max(lo, -largest) : 0,
+                hi > 0 ? std::min(hi, largest) : 0};
+    }
+};
+
+/**
+ * @class Ranges
+ * @brief The ranges of the integer locals of a lambda as each of its
+ * blocks begins, and what is known of the lengths of its slices.
+ *
+ * Each local starts out with the range of its initializer, and each
+ * argument with that of its type. An instruction which writes a local
+ * gives it a range: a copy takes the range of its source, arithmetic
+ * combines those of its operands, unless it may wrap around, and anything
+ * else gives every value of the type of the local. A conditional branch
+ * narrows the ranges of the locals it compares on each of its edges; one
+ * whose ranges are then empty is never taken.
+ *
+ * Besides ranges, a state knows which local holds the length of which
+ * slice, as length set it, and so which index is below that length, as a
+ * branch on the two found it; that is how a loop over a slice is proven
+ * in bounds, as its length is known to no range. Writing a local forgets
+ * whatever was known of it.
+ *
+ * The ranges at a block which a later block, or itself, branches back to
+ * are widened to those of their types once they still grow, so the
+ * analysis ends; as every loop has such an edge, a block within a loop
+ * keeps the ranges its branches narrowed.
+ */
+class Ranges {
+public:
+    struct State {
+        /// the range of each local, by LocalHandle
+        std::vector<Range> ranges;
+        /// the slice each local holds the length of, by LocalHandle
+        std::vector<std::optional<std::uint64_t>> lengths;
+        /// pairs of a local and a slice it is below the length of, sorted
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> below;
+
+        bool operator==(State const &) const = default;
+
+        /// whether the local @p index is below the length of @p slice
+        bool is_below(std::uint64_t index,
+                      std::uint64_t slice) const noexcept {
+            return std::ranges::binary_search(below,
+                                              std::pair{index, slice});
+        }
+
+        /// the range of the operand @p operand of @p lambda
+        Range range(IR::Lambda const &lambda, IR::Operand operand) const {
+            if (operand.is<IR::Scalar>()) {
+                return Range::of(operand.as<IR::Scalar>());
+            }
+            if (operand.is<IR::LocalHandle>() &&
+                operand.as<IR::LocalHandle>().index < ranges.size()) {
+                return ranges[operand.as<IR::LocalHandle>().index];
+            }
+            if (operand.is<IR::FieldHandle>() &&
+                lambda.has_field(operand.as<IR::FieldHandle>())) {
+                return Range::of_type(
+                    lambda.type_of(operand.as<IR::FieldHandle>()).index());
+            }
+            return {};
+        }
+    };
+
+private:
+    /// the state as each block begins, or none if it is never reached
+    std::vector<std::optional<State>> entries_;
+
+    /// how often a block is reached before its ranges are widened
+    static constexpr std::uint64_t widen_after = 2;
+
+    static Range type_range(IR::Lambda const &lambda, std::uint64_t local) {
+        return Range::of_type(lambda.type_of(IR::LocalHandle{local}).index());
+    }
+
+    /// the type of @p operand as the index of its IR::Type, if it has one
+    static std::optional<std::uint64_t> type_index(IR::Lambda const &lambda,
+                                                   IR::Operand operand) {
+        if (operand.is<IR::Scalar>()) {
+            return operand.as<IR::Scalar>().index();
+        }
+        if (operand.is<IR::LocalHandle>() &&
+            operand.as<IR::LocalHandle>().index < lambda.frame_size()) {
+            return lambda.type_of(operand.as<IR::LocalHandle>()).index();
+        }
+        if (operand.is<IR::FieldHandle>() &&
+            lambda.has_field(operand.as<IR::FieldHandle>())) {
+            return lambda.type_of(operand.as<IR::FieldHandle>()).index();
+        }
+        return std::nullopt;
+    }
+
+    /// forgets what is known of the local @p local
+    static void forget(State &state, std::uint64_t local) {
+        state.lengths[local] = std::nullopt;
+        for (std::optional<std::uint64_t> &length : state.lengths) {
+            if (length == local) { length = std::nullopt; }
+        }
+        std::erase_if(state.below, [local](auto const &fact) {
+            return fact.first == local || fact.second == local;
+        });
+    }
+
+    static void learn(State &state, std::uint64_t index, std::uint64_t slice) {
+        auto at = std::ranges::lower_bound(state.below,
+                                           std::pair{index, slice});
+        if (at == state.below.end() || *at != std::pair{index, slice}) {
+            state.below.insert(at, {index, slice});
+        }
+    }
+
+    /**
+     * @brief narrows @p state to where @p B compares to @p C as the
+     * comparison @p opcode does.
+     *
+     * @return false if they never do
+     */
+    static bool narrow(IR::Lambda const &lambda,
+                       State &state,
+                       IR::Instruction::Opcode opcode,
+                       IR::Operand B,
+                       IR::Operand C) {
+        using Opcode = IR::Instruction::Opcode;
+        switch (opcode) {
+        case Opcode::Gt: return narrow(lambda, state, Opcode::Lt, C, B);
+        case Opcode::Ge: return narrow(lambda, state, Opcode::Le, C, B);
+        default:         break;
+        }
+
+        Range b = state.range(lambda, B);
+        Range c = state.range(lambda, C);
+        switch (opcode) {
+        case Opcode::Lt:
+            // nothing is below the least std::int64_t, but a u64 may be
+            // above the greatest.
+            if (c.hi == Range::below) { return false; }
+            if (c.hi != Range::above) {
+                b = b.meet({Range::below, c.hi - 1});
+            }
+            if (b.lo != Range::below && b.lo != Range::above) {
+                c = c.meet({b.lo + 1, Range::above});
+            }
+            break;
+        case Opcode::Le:
+            if (c.hi != Range::above) { b = b.meet({Range::below, c.hi}); }
+            if (b.lo != Range::below) { c = c.meet({b.lo, Range::above}); }
+            break;
+        case Opcode::Eq:
+            b = c = b.meet(c);
+            break;
+        case Opcode::Ne: {
+            auto exclude = [](Range &range, Range other) {
+                if (!other.bounded() || other.lo != other.hi) { return; }
+                if (range.lo == other.lo && range.lo != Range::below) {
+                    ++range.lo;
+                } else if (range.hi == other.hi && range.hi != Range::above) {
+                    --range.hi;
+                }
+            };
+            exclude(b, c);
+            exclude(c, b);
+            break;
+        }
+        default: std::unreachable();
+        }
+        if (b.empty() || c.empty()) { return false; }
+
+        if (B.is<IR::LocalHandle>()) {
+            state.ranges[B.as<IR::LocalHandle>().index] = b;
+        }
+        if (C.is<IR::LocalHandle>()) {
+            state.ranges[C.as<IR::LocalHandle>().index] = c;
+        }
+        if (opcode == Opcode::Lt && B.is<IR::LocalHandle>() &&
+            C.is<IR::LocalHandle>()) {
+            if (std::optional<std::uint64_t> slice =
+                    state.lengths[C.as<IR::LocalHandle>().index]) {
+                learn(state, B.as<IR::LocalHandle>().index, *slice);
+            }
+        }
+        return true;
+    }
+
+    static State join(State const &left, State const &right) {
+        State joined;
+        joined.ranges.reserve(left.ranges.size());
+        for (std::size_t local = 0; local < left.ranges.size(); ++local) {
+            joined.ranges.push_back(
+                left.ranges[local].hull(right.ranges[local]));
+        }
+        joined.lengths = left.lengths;
+        for (std::size_t local = 0; local < left.lengths.size(); ++local) {
+            if (joined.lengths[local] != right.lengths[local]) {
+                joined.lengths[local] = std::nullopt;
+            }
+        }
+        std::ranges::set_intersection(
+            left.below, right.below, std::back_inserter(joined.below));
+        return joined;
+    }
+
+    /// @p next, with each bound which grew since @p last that of its type
+    static void widen(IR::Lambda const &lambda,
+                      State const &last,
+                      State &next) {
+        for (std::size_t local = 0; local < next.ranges.size(); ++local) {
+            Range const type = type_range(lambda, local);
+            Range &range     = next.ranges[local];
+            if (range.lo < last.ranges[local].lo) { range.lo = type.lo; }
+            if (range.hi > last.ranges[local].hi) { range.hi = type.hi; }
+        }
+    }
+
+public:
+    Ranges(IR::Lambda const &lambda, CFG const &cfg) {
+        entries_.resize(cfg.size());
+        if (cfg.size() == 0) { return; }
+
+        State entry;
+        entry.ranges.reserve(lambda.frame_size());
+        for (std::uint64_t local = 0; local < lambda.frame_size(); ++local) {
+            IR::LocalHandle handle{local};
+            std::uint64_t const type = lambda.type_of(handle).index();
+            Range range              = Range::of_type(type);
+            if (!lambda.is_argument(handle) && type < 10) {
+                IR::Scalar value =
+                    lambda.local(handle).value_.as<IR::Scalar>();
+                // a local without an initializer starts out as zero.
+                range = value.index() == type ? Range::of(value)
+                                              : Range::exactly(0);
+            }
+            entry.ranges.push_back(range);
+        }
+        entry.lengths.resize(lambda.frame_size());
+        entries_[0] = std::move(entry);
+
+        std::vector<std::uint64_t> visits(cfg.size(), 0);
+        std::deque<std::uint64_t> worklist{0};
+        std::vector<bool> queued(cfg.size(), false);
+        queued[0] = true;
+
+        auto reach = [&](std::uint64_t from,
+                         std::uint64_t block,
+                         State state) {
+            std::optional<State> &current = entries_[block];
+            if (current) {
+                State joined = join(*current, state);
+                if (from >= block && visits[block] >= widen_after) {
+                    widen(lambda, *current, joined);
+                }
+                if (joined == *current) { return; }
+                current = std::move(joined);
+            } else {
+                current = std::move(state);
+            }
+            if (!queued[block]) {
+                queued[block] = true;
+                worklist.push_back(block);
+            }
+        };
+
+        while (!worklist.empty()) {
+            std::uint64_t block = worklist.front();
+            worklist.pop_front();
+            queued[block] = false;
+            ++visits[block];
+
+            State state = *entries_[block];
+            IR::Block const &instructions = lambda.body()[block];
+            CFG::Node const &node         = cfg[block];
+            std::uint64_t const end =
+                node.terminator.value_or(instructions.size());
+            for (std::uint64_t index = 0; index < end; ++index) {
+                step(lambda, state, instructions[index]);
+            }
+
+            if (!node.terminator) {
+                if (auto next = cfg.fallthrough(block)) {
+                    reach(block, *next, std::move(state));
+                }
+                continue;
+            }
+            IR::Instruction const &branch = instructions[*node.terminator];
+            if (node.taken) {
+                State taken = state;
+                if (edge(lambda, taken, branch, true)) {
+                    reach(block, *node.taken, std::move(taken));
+                }
+            }
+            if (auto next = cfg.fallthrough(block)) {
+                if (edge(lambda, state, branch, false)) {
+                    reach(block, *next, std::move(state));
+                }
+            }
+        }
+    }
+
+    /// the state as @p block begins, or none if it is never reached
+    std::optional<State> const &entry(std::uint64_t block) const noexcept {
+        return entries_[block];
+    }
+
+    /**
+     * @brief narrows @p state to the edge of the conditional branch
+     * @p branch which is @p taken, or not.
+     *
+     * @return false if that edge is never followed
+     */
+    static bool edge(IR::Lambda const &lambda,
+                     State &state,
+                     IR::Instruction const &branch,
+                     bool taken) {
+        using Opcode = IR::Instruction::Opcode;
+        if (!IR::is_conditional(branch.opcode()) ||
+            branch.format() == IR::Instruction::Format::Unary) {
+            return true;
+        }
+        // only integers have an inverse, and only they have ranges.
+        std::optional<std::uint64_t> type = type_index(lambda, branch.B());
+        if (!type || *type >= 10) { return true; }
+
+        Opcode opcode = branch.opcode();
+        if (!taken) { opcode = IR::inverse(opcode); }
+        if (opcode == Opcode::Jz || opcode == Opcode::Jnz) {
+            return narrow(lambda,
+                          state,
+                          opcode == Opcode::Jz ? Opcode::Eq : Opcode::Ne,
+                          branch.B(),
+                          IR::Scalar{});
+        }
+        if (branch.format() != IR::Instruction::Format::Ternary ||
+            type_index(lambda, branch.C()) != type) {
+            return true;
+        }
+        return narrow(
+            lambda, state, IR::comparison(opcode), branch.B(), branch.C());
+    }
+
+    /**
+     * @brief the range of the arithmetic @p opcode of @p b and @p c, were
+     * it computed in unbounded integers, or everything if it may not fit
+     * an std::int64_t
+     */
+    static constexpr Range
+    apply(IR::Instruction::Opcode opcode, Range b, Range c) noexcept {
+        using Opcode = IR::Instruction::Opcode;
+        switch (opcode) {
+        case Opcode::Neg: return -b;
+        case Opcode::Add: return b + c;
+        case Opcode::Sub: return b - c;
+        case Opcode::Mul: return b * c;
+        case Opcode::Div: return b / c;
+        case Opcode::Rem: return b % c;
+        default:          return {};
+        }
+    }
+
+    /**
+     * @brief whether the arithmetic @p instruction of @p lambda may fail
+     * in @p state, as the evaluator reports: by dividing by zero, by
+     * dividing the least signed integer by -1, or, in a checked lambda, by
+     * wrapping around.
+     */
+    static bool may_fail(IR::Lambda const &lambda,
+                         State const &state,
+                         IR::Instruction const &instruction) {
+        using Opcode = IR::Instruction::Opcode;
+        Opcode const opcode = instruction.opcode();
+        if (opcode < Opcode::Neg || opcode > Opcode::Rem ||
+            instruction.format() == IR::Instruction::Format::Unary) {
+            return false;
+        }
+        std::optional<std::uint64_t> type = type_index(lambda, instruction.B());
+        if (!type || *type < 2 || *type > 9) { return false; }
+
+        Range const limits = Range::of_type(*type);
+        Range const b      = state.range(lambda, instruction.B());
+        Range const c      = opcode == Opcode::Neg
+                                 ? b
+                                 : state.range(lambda, instruction.C());
+        if (opcode == Opcode::Div || opcode == Opcode::Rem) {
+            auto holds = [](Range range, std::int64_t value) {
+                return range.lo <= value && value <= range.hi;
+            };
+            return holds(c, 0) ||
+                   (*type >= 6 && b.lo <= limits.lo && holds(c, -1));
+        }
+        return lambda.checked() &&
+               !apply(opcode, b, c).within(limits.lo, limits.hi);
+    }
+
+    /**
+     * @brief whether any arithmetic of @p lambda, whose control flow is
+     * @p cfg, may fail where it is reached
+     */
+    bool may_fail(IR::Lambda const &lambda, CFG const &cfg) const {
+        for (std::uint64_t block = 0; block < cfg.size(); ++block) {
+            if (!entries_[block]) { continue; }
+            State state                   = *entries_[block];
+            IR::Block const &instructions = lambda.body()[block];
+            std::uint64_t const end =
+                cfg[block].terminator.value_or(instructions.size());
+            for (std::uint64_t index = 0; index < end; ++index) {
+                if (may_fail(lambda, state, instructions[index])) {
+                    return true;
+                }
+                step(lambda, state, instructions[index]);
+            }
+        }
+        return false;
+    }
+
+    /// applies the instruction @p instruction of @p lambda to @p state
+    static void step(IR::Lambda const &lambda,
+                     State &state,
+                     IR::Instruction const &instruction) {
+        using Opcode = IR::Instruction::Opcode;
+        Opcode const opcode = instruction.opcode();
+        // an insert writes an element, of which nothing is known.
+        if (opcode == Opcode::Ret || IR::is_branch(opcode) ||
+            opcode == Opcode::Insert || opcode == Opcode::UncheckedInsert ||
+            !instruction.A().is<IR::LocalHandle>() ||
+            instruction.A().as<IR::LocalHandle>().index >=
+                state.ranges.size()) {
+            return;
+        }
+        std::uint64_t const local = instruction.A().as<IR::LocalHandle>().index;
+        Range const type          = type_range(lambda, local);
+        bool const binary =
+            instruction.format() != IR::Instruction::Format::Unary;
+        IR::Operand const B = instruction.B();
+
+        Range range = type;
+        std::optional<std::uint64_t> length;
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> copied;
+        switch (opcode) {
+        case Opcode::Load: {
+            if (!binary) { break; }
+            range = state.range(lambda, B).meet(type);
+            if (range.empty()) { range = type; }
+            if (!B.is<IR::LocalHandle>() ||
+                B.as<IR::LocalHandle>().index >= state.ranges.size()) {
+                break;
+            }
+            // a copy of an index, or of a slice, keeps what is known of it.
+            std::uint64_t const source = B.as<IR::LocalHandle>().index;
+            length                     = state.lengths[source];
+            for (auto [index, slice] : state.below) {
+                if (index == source) { copied.emplace_back(local, slice); }
+                if (slice == source) { copied.emplace_back(index, local); }
+            }
+            break;
+        }
+        case Opcode::Neg:
+            if (binary) { range = (-state.range(lambda, B)).wrap(type); }
+            break;
+        case Opcode::Add:
+        case Opcode::Sub:
+        case Opcode::Mul:
+        case Opcode::Div:
+        case Opcode::Rem: {
+            if (instruction.format() != IR::Instruction::Format::Ternary) {
+                break;
+            }
+            range = apply(opcode,
+                          state.range(lambda, B),
+                          state.range(lambda, instruction.C()))
+                        .wrap(type);
+            break;
+        }
+        case Opcode::Length: {
+            if (!binary) { break; }
+            std::optional<std::uint64_t> sequence = type_index(lambda, B);
+            if (sequence == 15) {
+                IR::Type const &array =
+                    B.is<IR::LocalHandle>()
+                        ? lambda.type_of(B.as<IR::LocalHandle>())
+                        : lambda.type_of(B.as<IR::FieldHandle>());
+                IR::Scalar::u64 const count =
+                    array.as<IR::Type::Array>().length;
+                range = Range::of(IR::Scalar{count}).meet(type);
+                if (range.empty()) { range = type; }
+            } else if (sequence == 16 && B.is<IR::LocalHandle>()) {
+                length = B.as<IR::LocalHandle>().index;
+            }
+            break;
+        }
+        default: break;
+        }
+
+        forget(state, local);
+        state.ranges[local]  = range;
+        state.lengths[local] = length;
+        for (auto [index, slice] : copied) {
+            if (index != slice) { learn(state, index, slice); }
+        }
+    }
+};
+
+/**
+ * @brief The analysis which finds the [Ranges](@ref Ranges) of the locals
+ * of a lambda.
+ */
+struct ValueRanges {
+    using Result = Ranges;
+
+    static Result run(IR::Lambda const &lambda, FunctionAnalyses &analyses) {
+        return Ranges{lambda, analyses.get<ControlFlow>()};
+    }
+};
+
+} // namespace fun::pass
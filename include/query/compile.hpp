@@ -0,0 +1,184 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file compile.hpp
+ * @brief Defines the queries which compile a source file, one lambda at a
+ * time, see [Database](@ref Database).
+ */
+
+#pragma once
+
+#include <compare>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Passes/OptimizationLevel.h>
+
+#include "IR/lambda.hpp"
+#include "env/context.hpp"
+#include "env/target.hpp"
+#include "query/database.hpp"
+
+namespace fs = std::filesystem;
+
+namespace fun::query {
+
+/**
+ * @struct Options
+ * @brief How every lambda is compiled.
+ */
+struct Options {
+    env::TargetKey target         = env::TargetKey::native();
+    llvm::OptimizationLevel level = llvm::OptimizationLevel::O0;
+    /// whether lambdas which are not annotated strict or fast are fast
+    bool fast_math = false;
+    /// whether every lambda is checked
+    bool checked_arithmetic = false;
+    /// the lambda _start calls, which must be set to link an executable
+    std::string entry = "main";
+};
+
+/// the input holding the [Options](@ref Options), which has a single key
+struct Configure {
+    using Key   = std::monostate;
+    using Value = Options;
+
+    static Fingerprint fingerprint(Options const &options);
+};
+
+/**
+ * @brief the input holding the text of each source file, or nullptr if
+ * it could not be read, see [load](@ref load).
+ */
+struct Source {
+    using Key   = fs::path;
+    using Value = std::shared_ptr<std::string const>;
+
+    static Fingerprint fingerprint(Value const &text);
+};
+
+/**
+ * @struct Parsed
+ * @brief A source file, parsed into the module of a Context of its own,
+ * which also holds the names the lambdas refer to.
+ *
+ * The lambdas have the fast math flags and the checked arithmetic of the
+ * options, the bounds checks they provably pass are
+ * [removed](@ref pass::EliminateBoundsChecks), and their blocks are
+ * [placed](@ref pass::PlaceBlocks). Passes which need more than one
+ * lambda, such as [EvaluateConstants](@ref pass::EvaluateConstants), are
+ * not run, so that each lambda depends on its own text alone.
+ */
+struct Parsed {
+    std::shared_ptr<std::string const> text;
+    std::unique_ptr<env::Context> ctx;
+    /// false if the text could not be read, or any error was diagnosed
+    bool ok = false;
+};
+
+/// parses a source file; diagnostics are printed once per edit
+struct Parse {
+    using Key   = fs::path;
+    using Value = std::shared_ptr<Parsed const>;
+
+    static Value compute(Database &database, Key const &path);
+    static Fingerprint fingerprint(Value const &parsed);
+};
+
+/**
+ * @brief the names of the lambdas of a source file, in source order,
+ * which only change when a lambda is added, removed or renamed.
+ */
+struct Lambdas {
+    using Key   = fs::path;
+    using Value = std::vector<std::string>;
+
+    static Value compute(Database &database, Key const &path);
+    static Fingerprint fingerprint(Value const &names);
+};
+
+/// names a lambda of a source file
+struct Name {
+    fs::path file;
+    std::string lambda;
+
+    auto operator<=>(Name const &) const = default;
+};
+
+/**
+ * @brief the IR of a lambda, or nullptr if the file has no such lambda.
+ *
+ * It is fingerprinted by its [structure](@ref IR::structural_hash), so an
+ * edit elsewhere in its file, or one which only renames its locals, does
+ * not change it.
+ */
+struct LambdaIR {
+    using Key   = Name;
+    using Value = std::shared_ptr<IR::Lambda const>;
+
+    static Value compute(Database &database, Key const &name);
+    static Fingerprint fingerprint(Value const &lambda);
+};
+
+/**
+ * @brief the type of a lambda: a lambda with its name, return type and
+ * arguments, but no body, which is enough to declare it. Only changes to
+ * the signature of a lambda change its type.
+ */
+struct LambdaType {
+    using Key   = Name;
+    using Value = std::shared_ptr<IR::Lambda const>;
+
+    static Value compute(Database &database, Key const &name);
+    static Fingerprint fingerprint(Value const &declaration);
+};
+
+/**
+ * @brief the object code of a lambda, lowered and optimized in a module
+ * of its own, or nullptr if it could not be compiled, in which case the
+ * reason has been printed to llvm::errs().
+ *
+ * It depends on the IR of the lambda, the types of the lambdas it calls,
+ * which it declares, and the options; editing the body of a callee does
+ * not recompile its callers. Optimization never crosses lambdas, and the
+ * effects of callees are unknown, as they are when compiling a stream.
+ * The object of the entry lambda of the options also defines _start.
+ */
+struct LambdaObject {
+    using Key   = Name;
+    using Value = std::shared_ptr<llvm::SmallVector<char, 0> const>;
+
+    static Value compute(Database &database, Key const &name);
+    static Fingerprint fingerprint(Value const &object);
+};
+
+/**
+ * @brief Reads @p path into the [Source](@ref Source) input of
+ * @p database. A file which cannot be read is set to nullptr.
+ *
+ * @return true if the text changed
+ */
+bool load(Database &database, fs::path const &path);
+
+/**
+ * @brief Links the objects of every lambda of @p path, as the options of
+ * @p database compile them, into the executable @p output. Only objects
+ * whose inputs changed since they were last linked are compiled again.
+ *
+ * @return false if the file did not parse, a lambda did not compile, or
+ * linking failed; the reason has been printed.
+ */
+bool build(Database &database, fs::path const &path, fs::path const &output);
+
+} // namespace fun::query
@@ -0,0 +1,238 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file database.hpp
+ * @brief Defines [Database](@ref Database)
+ */
+
+#pragma once
+
+#include <cassert>
+#include <concepts>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fun::query {
+
+/// counts the changes made to the inputs of a database
+using Revision = std::uint64_t;
+
+/// a hash of a value, which differs whenever the value does
+using Fingerprint = std::uint64_t;
+
+class Database;
+
+/**
+ * @brief A query maps a Key to a Value, and fingerprints its values so
+ * that a value which was recomputed can be told apart from the last one.
+ */
+template <class Q>
+concept Query = requires(typename Q::Value const &value) {
+    typename Q::Key;
+    typename Q::Value;
+    { Q::fingerprint(value) } -> std::convertible_to<Fingerprint>;
+};
+
+/**
+ * @brief A derived query computes its value from those of other queries,
+ * which it asks the database for.
+ */
+template <class Q>
+concept Derived =
+    Query<Q> && requires(Database &database, typename Q::Key const &key) {
+        { Q::compute(database, key) } -> std::convertible_to<typename Q::Value>;
+    };
+
+/**
+ * @brief An input query holds whatever it was last set to, or a default
+ * value if it never was.
+ */
+template <class Q>
+concept Input = Query<Q> && !Derived<Q> &&
+                std::default_initializable<typename Q::Value>;
+
+/**
+ * @class Database
+ * @brief Memoizes queries, and recomputes only those which depend on an
+ * input which changed.
+ *
+ * Every query a derived query asks for while it is computed is recorded
+ * as a dependency. Setting an input to a value of a new fingerprint
+ * starts a new revision. Asking for a derived query whose value is from
+ * an earlier revision first brings its dependencies up to date, in the
+ * order they were asked for, and only recomputes it if one of them
+ * changed since it was last verified. A value which is recomputed, but
+ * fingerprints the same, does not count as a change, so whatever depends
+ * on it is not recomputed either: editing the body of one lambda
+ * recompiles that lambda, not its callers.
+ *
+ * Queries may not depend on themselves, directly or not. A database
+ * belongs to one thread.
+ */
+class Database {
+    /**
+     * @brief a memoized value, which was last known to be current at the
+     * revision verified, and last changed at the revision changed.
+     */
+    struct Slot {
+        Revision verified       = 0;
+        Revision changed        = 0;
+        Fingerprint fingerprint = 0;
+        bool computing          = false;
+        std::vector<Slot *> dependencies;
+
+        virtual ~Slot() = default;
+
+        /**
+         * @brief brings the value up to date with the database
+         *
+         * @return the revision the value last changed at
+         */
+        virtual Revision refresh(Database &database) = 0;
+    };
+
+    template <Query Q> struct Memo final : Slot {
+        typename Q::Key key;
+        std::optional<typename Q::Value> value;
+
+        explicit Memo(typename Q::Key key) : key{std::move(key)} {}
+
+        Revision refresh(Database &database) override {
+            if constexpr (Derived<Q>) {
+                if (value && verified != database.revision_) {
+                    bool stale = false;
+                    for (Slot *dependency : dependencies) {
+                        if (dependency->refresh(database) > verified) {
+                            stale = true;
+                            break;
+                        }
+                    }
+                    if (!stale) { verified = database.revision_; }
+                }
+                if (!value || verified != database.revision_) {
+                    compute(database);
+                }
+            } else if (!value) {
+                value.emplace();
+                fingerprint = Q::fingerprint(*value);
+                changed = verified = database.revision_;
+            }
+            return changed;
+        }
+
+        void compute(Database &database) requires Derived<Q> {
+            assert(!computing && "a query depends on itself");
+            computing = true;
+            dependencies.clear();
+            database.active_.push_back(this);
+            typename Q::Value result = Q::compute(database, key);
+            database.active_.pop_back();
+            computing = false;
+
+            Fingerprint const next = Q::fingerprint(result);
+            if (!value || next != fingerprint) {
+                changed = database.revision_;
+            }
+            value       = std::move(result);
+            fingerprint = next;
+            verified    = database.revision_;
+            ++database.table<Q>().computed;
+        }
+    };
+
+    struct TableBase {
+        virtual ~TableBase() = default;
+    };
+
+    template <Query Q> struct Table final : TableBase {
+        std::map<typename Q::Key, std::unique_ptr<Memo<Q>>> memos;
+        std::uint64_t computed = 0;
+    };
+
+    std::unordered_map<std::type_index, std::unique_ptr<TableBase>> tables_;
+    /// the derived queries being computed, innermost last
+    std::vector<Slot *> active_;
+    Revision revision_ = 1;
+
+    template <Query Q> Table<Q> &table() {
+        std::unique_ptr<TableBase> &found = tables_[typeid(Q)];
+        if (!found) { found = std::make_unique<Table<Q>>(); }
+        return static_cast<Table<Q> &>(*found);
+    }
+
+    template <Query Q> Memo<Q> &memo(typename Q::Key const &key) {
+        auto &memos = table<Q>().memos;
+        auto found  = memos.find(key);
+        if (found == memos.end()) {
+            found =
+                memos.emplace(key, std::make_unique<Memo<Q>>(key)).first;
+        }
+        return *found->second;
+    }
+
+public:
+    Database() noexcept                   = default;
+    Database(Database const &)            = delete;
+    Database &operator=(Database const &) = delete;
+
+    /// the current revision, which every input change advances
+    Revision revision() const noexcept { return revision_; }
+
+    /**
+     * @brief Sets the input @p key of @p Q to @p value, starting a new
+     * revision unless the value fingerprints as it did before.
+     *
+     * @return true if the input changed
+     */
+    template <Input Q>
+    bool set(typename Q::Key const &key, typename Q::Value value) {
+        assert(active_.empty() && "inputs are set between queries");
+        Memo<Q> &slot          = memo<Q>(key);
+        Fingerprint const next = Q::fingerprint(value);
+        bool const changed     = !slot.value || next != slot.fingerprint;
+        if (changed) { slot.changed = ++revision_; }
+        slot.value       = std::move(value);
+        slot.fingerprint = next;
+        slot.verified    = revision_;
+        return changed;
+    }
+
+    /**
+     * @brief the value of @p key for the query @p Q, computed if it is not
+     * current. A query being computed depends on every query it gets.
+     *
+     * The reference is valid until the next input is set.
+     */
+    template <Query Q>
+    typename Q::Value const &get(typename Q::Key const &key) {
+        Memo<Q> &slot = memo<Q>(key);
+        slot.refresh(*this);
+        if (!active_.empty()) {
+            std::vector<Slot *> &dependencies = active_.back()->dependencies;
+            if (dependencies.empty() || dependencies.back() != &slot) {
+                dependencies.push_back(&slot);
+            }
+        }
+        return *slot.value;
+    }
+
+    /// the number of times any value of @p Q has been computed
+    template <Derived Q> std::uint64_t computed() {
+        return table<Q>().computed;
+    }
+};
+
+} // namespace fun::query
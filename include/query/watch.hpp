@@ -0,0 +1,64 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file watch.hpp
+ * @brief Declares [watch](@ref watch)
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+#include "query/database.hpp"
+
+namespace fs = std::filesystem;
+
+namespace fun::query {
+
+/**
+ * @struct Rebuilt
+ * @brief What a [rebuild](@ref rebuild) did.
+ */
+struct Rebuilt {
+    bool built = false;
+    /// how many lambdas were lowered and emitted again
+    std::uint64_t compiled = 0;
+};
+
+/**
+ * @brief Builds @p source into an executable of the same name without the
+ * extension, in @p outputs or beside it, as [watch](@ref watch) does each
+ * time @p source changes, and prints how many lambdas were compiled.
+ */
+Rebuilt rebuild(Database &database,
+                fs::path const &source,
+                fs::path const &outputs);
+
+/**
+ * @brief Builds each .fun file of @p directory into an executable of the
+ * same name without the extension, in @p outputs, or beside the file if
+ * @p outputs is empty. Then stays resident, and rebuilds each file which
+ * inotify reports written, moved in or created.
+ *
+ * Files are read into @p database again, so only lambdas whose structure
+ * or whose callees' types changed are lowered and emitted again before
+ * the executable is relinked; a rebuild reports how many that was.
+ * Events which arrive within a moment of each other are handled as one
+ * edit, as editors often write a file in several steps.
+ *
+ * @return 1 once @p directory can no longer be watched; otherwise this
+ * does not return until the process is interrupted.
+ */
+int watch(Database &database,
+          fs::path const &directory,
+          fs::path const &outputs);
+
+} // namespace fun::query
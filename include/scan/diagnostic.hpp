@@ -0,0 +1,87 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file diagnostic.hpp
+ * @brief Defines [Diagnostic](@ref Diagnostic)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace fun::scan {
+
+/**
+ * @struct Diagnostic
+ * @brief A message about the source text at a given offset.
+ *
+ * Offsets rather than line and column are recorded, so that diagnostics
+ * can be produced by any thread parsing any part of a file, and positions
+ * are resolved once, when the diagnostics are printed in order.
+ */
+struct Diagnostic {
+    enum class Kind {
+        Error,
+        Warning,
+    };
+
+    std::size_t offset;
+    Kind kind;
+    std::string message;
+};
+
+inline std::ostream &operator<<(std::ostream &out, Diagnostic::Kind kind) {
+    switch (kind) {
+    case Diagnostic::Kind::Error:   return out << "error";
+    case Diagnostic::Kind::Warning: return out << "warning";
+    default:                        std::unreachable();
+    }
+}
+
+/**
+ * @brief prints @p diagnostics, which must be sorted by offset, as
+ * file:line:column: kind: message followed by the offending line.
+ *
+ * @param first_line the line number of the start of @p source, for when
+ * @p source is only the part of a file which is still in memory.
+ */
+inline void print(std::ostream &out,
+                  std::string_view filename,
+                  std::string_view source,
+                  std::span<Diagnostic const> diagnostics,
+                  std::size_t first_line = 1) {
+    std::size_t line       = first_line;
+    std::size_t line_start = 0;
+    std::size_t scanned    = 0;
+    for (Diagnostic const &diagnostic : diagnostics) {
+        std::size_t offset = std::min(diagnostic.offset, source.size());
+        for (; scanned < offset; ++scanned) {
+            if (source[scanned] == '\n') {
+                ++line;
+                line_start = scanned + 1;
+            }
+        }
+
+        std::size_t line_end = source.find('\n', line_start);
+        if (line_end == std::string_view::npos) { line_end = source.size(); }
+        std::size_t column = offset - line_start;
+
+        out << filename << ":" << line << ":" << column + 1 << ": "
+            << diagnostic.kind << ": " << diagnostic.message << "\n"
+            << source.substr(line_start, line_end - line_start) << "\n"
+            << std::string(column, ' ') << "^\n";
+    }
+}
+
+} // namespace fun::scan
@@ -0,0 +1,315 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file literal.hpp
+ * @brief Defines [scan_integer](@ref scan_integer)
+ */
+
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <ostream>
+
+#include "IR/scalar.hpp"
+
+namespace fun::scan {
+
+enum class LiteralError {
+    None,
+    /// the input does not begin with an integer literal
+    NoMatch,
+    /// a base prefix which is not followed by any digits
+    MissingDigits,
+    /// a suffix which does not name an integer type
+    InvalidSuffix,
+    /// the value does not fit in the type of the literal
+    OutOfRange,
+};
+
+inline std::ostream &operator<<(std::ostream &out, LiteralError error) {
+    switch (error) {
+    case LiteralError::None:          return out << "none";
+    case LiteralError::NoMatch:       return out << "not an integer literal";
+    case LiteralError::MissingDigits: return out << "missing digits";
+    case LiteralError::InvalidSuffix: return out << "invalid integer suffix";
+    case LiteralError::OutOfRange:    return out << "literal out of range";
+    default:                          std::unreachable();
+    }
+}
+
+namespace detail {
+
+/**
+ * @brief loads eight bytes so that the first character is the least
+ * significant byte.
+ */
+inline std::uint64_t load_eight(char const *cursor) noexcept {
+    std::uint64_t chunk;
+    std::memcpy(&chunk, cursor, sizeof(chunk));
+    if constexpr (std::endian::native == std::endian::big) {
+        chunk = std::byteswap(chunk);
+    }
+    return chunk;
+}
+
+/**
+ * @brief true when every byte of @p chunk is an ascii decimal digit
+ *
+ * @note based on simdjson's is_made_of_eight_digits_fast
+ */
+constexpr bool is_eight_digits(std::uint64_t chunk) noexcept {
+    return ((chunk & 0xF0F0F0F0F0F0F0F0) |
+            (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) ==
+           0x3333333333333333;
+}
+
+/**
+ * @brief converts eight ascii decimal digits to their value, with three
+ * multiplies in place of eight.
+ *
+ * @note based on
+ * https://lemire.me/blog/2022/01/21/swar-explained-parsing-eight-digits/
+ */
+constexpr std::uint64_t parse_eight_digits(std::uint64_t chunk) noexcept {
+    chunk = (chunk & 0x0F0F0F0F0F0F0F0F) * 2561 >> 8;
+    chunk = (chunk & 0x00FF00FF00FF00FF) * 6553601 >> 16;
+    return (chunk & 0x0000FFFF0000FFFF) * 42949672960001 >> 32;
+}
+
+constexpr int digit_value(char c) noexcept {
+    if (c >= '0' && c <= '9') { return c - '0'; }
+    if (c >= 'a' && c <= 'f') { return c - 'a' + 10; }
+    if (c >= 'A' && c <= 'F') { return c - 'A' + 10; }
+    return 16;
+}
+
+/**
+ * @brief scans decimal digits into @p value, eight at a time where
+ * possible.
+ *
+ * @return false if the value does not fit in 64 bits. The cursor is
+ * advanced over every digit regardless.
+ */
+inline bool scan_decimal(char const *&cursor,
+                         char const *last,
+                         std::uint64_t &value) noexcept {
+    constexpr std::uint64_t max = std::numeric_limits<std::uint64_t>::max();
+    bool fits                   = true;
+
+    while (last - cursor >= 8) {
+        std::uint64_t chunk = load_eight(cursor);
+        if (!is_eight_digits(chunk)) { break; }
+        std::uint64_t digits = parse_eight_digits(chunk);
+        if (value > (max - digits) / 100000000) { fits = false; }
+        value = value * 100000000 + digits;
+        cursor += 8;
+    }
+
+    while (cursor != last && *cursor >= '0' && *cursor <= '9') {
+        auto digit = static_cast<std::uint64_t>(*cursor - '0');
+        if (value > (max - digit) / 10) { fits = false; }
+        value = value * 10 + digit;
+        ++cursor;
+    }
+
+    return fits;
+}
+
+/**
+ * @brief scans digits of base 2, 8 or 16 into @p value.
+ *
+ * These bases need only a shift per digit, so there is little to gain
+ * from processing them in parallel.
+ */
+inline bool scan_power_of_two(char const *&cursor,
+                              char const *last,
+                              unsigned bits,
+                              std::uint64_t &value) noexcept {
+    int const base = 1 << bits;
+    bool fits      = true;
+    while (cursor != last) {
+        int digit = digit_value(*cursor);
+        if (digit >= base) { break; }
+        if ((value >> (64 - bits)) != 0) { fits = false; }
+        value = (value << bits) | static_cast<std::uint64_t>(digit);
+        ++cursor;
+    }
+    return fits;
+}
+
+/**
+ * @brief the index into [Scalar](@ref IR::Scalar) of the type named by an
+ * integer suffix, or zero if the text at @p cursor is not a suffix.
+ */
+constexpr std::uint64_t
+scan_suffix(char const *&cursor, char const *last) noexcept {
+    if (cursor == last || (*cursor != 'u' && *cursor != 'i')) { return 0; }
+    std::uint64_t base = *cursor == 'u' ? 2 : 6;
+
+    auto remaining = last - cursor;
+    if (remaining >= 2 && cursor[1] == '8') {
+        cursor += 2;
+        return base;
+    }
+    if (remaining < 3) { return 0; }
+    std::uint64_t offset = 0;
+    if (cursor[1] == '1' && cursor[2] == '6') {
+        offset = 1;
+    } else if (cursor[1] == '3' && cursor[2] == '2') {
+        offset = 2;
+    } else if (cursor[1] == '6' && cursor[2] == '4') {
+        offset = 3;
+    } else {
+        return 0;
+    }
+    cursor += 3;
+    return base + offset;
+}
+
+/**
+ * @brief range checks a literal against T, and stores it into @p result
+ *
+ * @param overflow true when the digits did not fit in 64 bits
+ */
+template <class T>
+constexpr bool fits(std::uint64_t magnitude,
+                    bool negative,
+                    bool overflow,
+                    IR::Scalar &result) noexcept {
+    if (overflow) {
+        result = T{0};
+        return false;
+    }
+
+    if constexpr (std::is_unsigned_v<T>) {
+        if (negative || magnitude > std::numeric_limits<T>::max()) {
+            result = T{0};
+            return false;
+        }
+        result = static_cast<T>(magnitude);
+    } else {
+        auto limit = static_cast<std::uint64_t>(std::numeric_limits<T>::max());
+        if (magnitude > limit + (negative ? 1 : 0)) {
+            result = T{0};
+            return false;
+        }
+        // negate in unsigned arithmetic, so that the minimum value does not
+        // overflow on its way through the positive range of T.
+        result = static_cast<T>(negative ? 0 - magnitude : magnitude);
+    }
+    return true;
+}
+
+} // namespace detail
+
+/**
+ * @brief Scans an integer literal from [first, last).
+ *
+ * An integer literal is an optional sign, then either decimal digits or
+ * one of the prefixes 0b, 0o or 0x (in either case) and digits of that
+ * base, then an optional suffix naming the type: u8, u16, u32, u64, i8,
+ * i16, i32 or i64. Only decimal literals may carry a sign. Without a
+ * suffix the literal is an i64, or a u64 if it is too large for an i64.
+ *
+ * The prefix, digits and suffix are each read exactly once, and the
+ * result is range checked against the type named by the suffix.
+ *
+ * Decimal digits followed by '.', 'e' or 'E' are the start of a floating
+ * point literal, and are not matched.
+ *
+ * @param first advanced past the literal on success, or past the
+ * offending text on error. Unchanged on NoMatch.
+ * @param result the value of the literal. On OutOfRange, a zero of the
+ * type the literal was meant to have.
+ */
+inline LiteralError scan_integer(char const *&first,
+                                 char const *last,
+                                 IR::Scalar &result) noexcept {
+    char const *cursor = first;
+
+    bool negative = false;
+    if (cursor != last && (*cursor == '-' || *cursor == '+')) {
+        negative = *cursor == '-';
+        ++cursor;
+    }
+
+    unsigned bits = 0;
+    if (!negative && cursor == first && last - cursor >= 2 &&
+        cursor[0] == '0') {
+        switch (cursor[1]) {
+        case 'b':
+        case 'B': bits = 1; break;
+        case 'o':
+        case 'O': bits = 3; break;
+        case 'x':
+        case 'X': bits = 4; break;
+        default:  break;
+        }
+    }
+
+    std::uint64_t magnitude = 0;
+    bool fits               = true;
+    char const *digits      = cursor;
+    if (bits == 0) {
+        fits = detail::scan_decimal(cursor, last, magnitude);
+        if (cursor == digits) { return LiteralError::NoMatch; }
+        if (cursor != last &&
+            (*cursor == '.' || *cursor == 'e' || *cursor == 'E')) {
+            return LiteralError::NoMatch;
+        }
+    } else {
+        cursor += 2;
+        digits = cursor;
+        fits   = detail::scan_power_of_two(cursor, last, bits, magnitude);
+        if (cursor == digits) {
+            first = cursor;
+            return LiteralError::MissingDigits;
+        }
+    }
+
+    std::uint64_t type = detail::scan_suffix(cursor, last);
+    if (type == 0 && cursor != last && (*cursor == 'u' || *cursor == 'i')) {
+        first = cursor;
+        return LiteralError::InvalidSuffix;
+    }
+    first = cursor;
+
+    using IR::Scalar;
+    bool const overflow = !fits;
+    auto check          = [&]<class T>() {
+        return detail::fits<T>(magnitude, negative, overflow, result)
+                   ? LiteralError::None
+                   : LiteralError::OutOfRange;
+    };
+
+    switch (type) {
+    case 0: {
+        if (!negative && !overflow &&
+            magnitude > std::numeric_limits<Scalar::i64>::max()) {
+            return check.template operator()<Scalar::u64>();
+        }
+        return check.template operator()<Scalar::i64>();
+    }
+    case 2:  return check.template operator()<Scalar::u8>();
+    case 3:  return check.template operator()<Scalar::u16>();
+    case 4:  return check.template operator()<Scalar::u32>();
+    case 5:  return check.template operator()<Scalar::u64>();
+    case 6:  return check.template operator()<Scalar::i8>();
+    case 7:  return check.template operator()<Scalar::i16>();
+    case 8:  return check.template operator()<Scalar::i32>();
+    case 9:  return check.template operator()<Scalar::i64>();
+    default: std::unreachable();
+    }
+}
+
+} // namespace fun::scan
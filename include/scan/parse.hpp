@@ -17,13 +17,56 @@
 #include <filesystem>
 #include <string_view>
 
+#include <llvm/ADT/STLFunctionalExtras.h>
+
+#include "IR/lambda.hpp"
 #include "env/context.hpp"
 
 namespace fs = std::filesystem;
 
 namespace fun::scan {
 
+/**
+ * @brief Parses the top-level definitions of @p view into the module of
+ * @p ctx.
+ *
+ * Large sources are split at definition boundaries, and the chunks are
+ * parsed concurrently. Lambdas are added to the module, and diagnostics
+ * are printed, in source order regardless.
+ *
+ * @return false if any error was diagnosed
+ */
 bool parse(std::string_view view, env::Context &ctx);
 bool parse(fs::path path, env::Context &ctx);
 
+/// as above, naming @p view @p filename in diagnostics
+bool parse(std::string_view view,
+           std::string_view filename,
+           env::Context &ctx);
+
+/**
+ * @brief receives each lambda of a stream as soon as it has been parsed,
+ * and returns false if it could not be compiled.
+ */
+using LambdaSink = llvm::function_ref<bool(IR::Lambda &&)>;
+
+/**
+ * @brief Parses the top-level definitions read from @p fd, handing each
+ * one to @p sink instead of adding it to the module of @p ctx.
+ *
+ * The stream is read in fixed-size chunks, and a definition is parsed as
+ * soon as the start of the next one has been read. Only the text of the
+ * definition which is still being read is held; what @p sink keeps of
+ * each lambda is up to it. Lambdas reach @p sink in source order, so a
+ * lambda may call one which has not reached it yet, and diagnostics are
+ * printed as each definition is parsed.
+ *
+ * @param filename the name used by diagnostics
+ * @return false if any error was diagnosed, or the sink failed
+ */
+bool parse(int fd,
+           std::string_view filename,
+           env::Context &ctx,
+           LambdaSink sink);
+
 } // namespace fun::scan
\ No newline at end of file
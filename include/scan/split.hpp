@@ -0,0 +1,81 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file split.hpp
+ * @brief Defines [split_definitions](@ref split_definitions)
+ */
+
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+namespace fun::scan {
+
+/**
+ * @brief true if a top-level definition starts at @p offset
+ *
+ * A top-level definition starts with the keyword fn at the beginning of a
+ * line, followed by whitespace.
+ */
+constexpr bool is_definition_start(std::string_view source,
+                                   std::size_t offset) noexcept {
+    if (source.size() - offset < 3) { return false; }
+    if (source[offset] != 'f' || source[offset + 1] != 'n') { return false; }
+    char next = source[offset + 2];
+    return next == ' ' || next == '\t' || next == '\n' || next == '\r';
+}
+
+/**
+ * @brief the offset of the next top-level definition which starts after
+ * @p offset, or source.size() if there is none.
+ *
+ * Searching for "\nfn" is done by std::string_view::find, which the
+ * standard library implements with a vectorized memchr for the newline.
+ */
+constexpr std::size_t next_definition(std::string_view source,
+                                      std::size_t offset) noexcept {
+    while (true) {
+        std::size_t found = source.find("\nfn", offset);
+        if (found == std::string_view::npos) { return source.size(); }
+        if (is_definition_start(source, found + 1)) { return found + 1; }
+        offset = found + 1;
+    }
+}
+
+/**
+ * @brief Splits @p source into chunks which each hold whole top-level
+ * definitions.
+ *
+ * Consecutive definitions are merged until a chunk is at least @p grain
+ * bytes long, so that a file of many small definitions is not split into
+ * many tiny tasks. Text before the first definition belongs to the first
+ * chunk. The chunks cover @p source exactly, in order.
+ */
+inline std::vector<std::string_view> split_definitions(std::string_view source,
+                                                       std::size_t grain = 0) {
+    std::vector<std::string_view> chunks;
+    std::size_t first = 0;
+    while (first < source.size()) {
+        std::size_t last = next_definition(source, first);
+        if (first == 0 && !is_definition_start(source, 0) &&
+            last < source.size()) {
+            last = next_definition(source, last);
+        }
+        while (last < source.size() && last - first < grain) {
+            last = next_definition(source, last);
+        }
+        chunks.push_back(source.substr(first, last - first));
+        first = last;
+    }
+    return chunks;
+}
+
+} // namespace fun::scan
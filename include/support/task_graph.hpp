@@ -0,0 +1,285 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file task_graph.hpp
+ * @brief Defines [TaskGraph](@ref TaskGraph)
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "support/thread_pool.hpp"
+
+namespace fun::support {
+
+/**
+ * @class TaskGraph
+ * @brief Runs a directed acyclic graph of tasks on a work-stealing
+ * scheduler, within a memory budget.
+ *
+ * A task runs once every task it was added after has finished. A task
+ * which fails, by returning false, does not run the tasks which depend on
+ * it, nor theirs, but the rest of the graph still runs.
+ *
+ * Each worker keeps a deque of ready tasks. It runs the newest task of
+ * its own deque first, so a task which readies its successor is followed
+ * by it on the same thread, while its data is in cache; an idle worker
+ * steals the oldest task of another. A task may
+ * [reserve](@ref TaskGraph::reserve) memory, which it holds from when it
+ * starts until a later task finishes. A task whose reservation would
+ * exceed the budget waits until enough is released, unless nothing is
+ * reserved at all, so a task larger than the budget runs alone rather
+ * than never. The tasks between a reservation and its release should not
+ * reserve memory themselves.
+ */
+class TaskGraph {
+public:
+    using Id   = std::size_t;
+    using Work = std::move_only_function<bool()>;
+
+private:
+    struct Task {
+        Work work;
+        std::vector<Id> successors;
+        /// the reservations released when this task finishes
+        std::vector<Id> releases;
+        std::size_t dependencies = 0;
+        std::uint64_t reserve    = 0;
+        std::atomic<std::size_t> pending{0};
+        std::atomic<bool> skipped{false};
+        bool holding = false;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Id> ready;
+    };
+
+    std::deque<Task> tasks_;
+
+    // the state of a run
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    /// the tasks in a deque, or waiting for memory, guarded by mutex_
+    std::size_t queued_    = 0;
+    std::size_t remaining_ = 0;
+    std::uint64_t budget_  = 0;
+    std::uint64_t in_use_  = 0;
+    /// the tasks which wait for memory, in the order they became ready
+    std::deque<Id> waiting_;
+    std::atomic<bool> failed_{false};
+
+    void push(std::size_t worker, Id id) {
+        {
+            std::lock_guard lock{workers_[worker]->mutex};
+            workers_[worker]->ready.push_back(id);
+        }
+        {
+            std::lock_guard lock{mutex_};
+            ++queued_;
+        }
+        wake_.notify_one();
+    }
+
+    /// takes the newest task of @p worker, or the oldest of another
+    bool pop(std::size_t worker, Id &id) {
+        bool found = false;
+        {
+            std::lock_guard lock{workers_[worker]->mutex};
+            if (!workers_[worker]->ready.empty()) {
+                id = workers_[worker]->ready.back();
+                workers_[worker]->ready.pop_back();
+                found = true;
+            }
+        }
+        for (std::size_t offset = 1; !found && offset < workers_.size();
+             ++offset) {
+            Worker &victim = *workers_[(worker + offset) % workers_.size()];
+            std::lock_guard lock{victim.mutex};
+            if (!victim.ready.empty()) {
+                id = victim.ready.front();
+                victim.ready.pop_front();
+                found = true;
+            }
+        }
+        if (found) {
+            std::lock_guard lock{mutex_};
+            --queued_;
+        }
+        return found;
+    }
+
+    /// whether @p bytes more fit in the budget, when @p used are in use
+    bool fits(std::uint64_t bytes, std::uint64_t used) const noexcept {
+        // a task larger than the budget may be running alone.
+        return used <= budget_ && bytes <= budget_ - used;
+    }
+
+    /**
+     * @brief reserves the memory of @p id, or, if it does not fit, sets it
+     * aside until it does.
+     *
+     * @return true if @p id may run now
+     */
+    bool admit(Id id) {
+        Task &task = tasks_[id];
+        if (task.reserve == 0 || task.skipped) { return true; }
+        std::lock_guard lock{mutex_};
+        if (in_use_ != 0 && !fits(task.reserve, in_use_)) {
+            waiting_.push_back(id);
+            ++queued_;
+            return false;
+        }
+        in_use_ += task.reserve;
+        task.holding = true;
+        return true;
+    }
+
+    /// releases the memory held by @p id, and readies what now fits
+    void release(std::size_t worker, Id id) {
+        Task &task = tasks_[id];
+        std::vector<Id> admitted;
+        {
+            std::lock_guard lock{mutex_};
+            if (!task.holding) { return; }
+            task.holding = false;
+            in_use_ -= task.reserve;
+            std::uint64_t room = in_use_;
+            while (!waiting_.empty()) {
+                std::uint64_t const bytes = tasks_[waiting_.front()].reserve;
+                if (room != 0 && !fits(bytes, room)) { break; }
+                room += bytes;
+                admitted.push_back(waiting_.front());
+                waiting_.pop_front();
+                --queued_;
+            }
+        }
+        // they are admitted again as they are popped.
+        for (Id next : admitted) { push(worker, next); }
+    }
+
+    void finish(std::size_t worker, Id id, bool succeeded) {
+        Task &task = tasks_[id];
+        for (Id reservation : task.releases) { release(worker, reservation); }
+        for (Id successor : task.successors) {
+            if (!succeeded) { tasks_[successor].skipped = true; }
+            if (--tasks_[successor].pending == 0) { push(worker, successor); }
+        }
+        {
+            std::lock_guard lock{mutex_};
+            --remaining_;
+        }
+        wake_.notify_all();
+    }
+
+    void work(std::size_t worker) {
+        while (true) {
+            Id id = 0;
+            if (!pop(worker, id)) {
+                std::unique_lock lock{mutex_};
+                if (remaining_ == 0) { return; }
+                wake_.wait(lock, [this] {
+                    return remaining_ == 0 || queued_ > waiting_.size();
+                });
+                continue;
+            }
+            if (!admit(id)) { continue; }
+
+            Task &task     = tasks_[id];
+            bool succeeded = false;
+            if (!task.skipped) {
+                succeeded = task.work();
+                if (!succeeded) { failed_ = true; }
+            }
+            finish(worker, id, succeeded);
+        }
+    }
+
+public:
+    /**
+     * @brief Adds a task which runs @p work once each task of @p after has
+     * finished. Tasks may only follow tasks added before them.
+     */
+    Id add(Work work, std::initializer_list<Id> after = {}) {
+        Id const id = tasks_.size();
+        Task &task  = tasks_.emplace_back();
+        task.work   = std::move(work);
+        for (Id before : after) {
+            assert(before < id && "a task follows one added before it");
+            tasks_[before].successors.push_back(id);
+            ++task.dependencies;
+        }
+        return id;
+    }
+
+    /**
+     * @brief Makes @p task hold @p bytes of the budget from when it starts
+     * until @p until, which must run after it, finishes or is skipped.
+     */
+    void reserve(Id task, std::uint64_t bytes, Id until) {
+        assert(task < until && until < tasks_.size());
+        tasks_[task].reserve = bytes;
+        tasks_[until].releases.push_back(task);
+    }
+
+    std::size_t size() const noexcept { return tasks_.size(); }
+
+    /**
+     * @brief Runs every task on @p threads workers, zero selecting the
+     * hardware default, holding at most @p budget bytes at once.
+     *
+     * A graph runs once.
+     *
+     * @return false if any task failed
+     */
+    bool run(unsigned threads = 0,
+             std::uint64_t budget = std::numeric_limits<std::uint64_t>::max()) {
+        if (threads == 0) { threads = ThreadPool::default_size(); }
+        budget_    = budget;
+        remaining_ = tasks_.size();
+        for (unsigned index = 0; index < threads; ++index) {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+
+        std::size_t next = 0;
+        for (Id id = 0; id < tasks_.size(); ++id) {
+            tasks_[id].pending = tasks_[id].dependencies;
+            if (tasks_[id].dependencies == 0) {
+                workers_[next++ % threads]->ready.push_back(id);
+                ++queued_;
+            }
+        }
+
+        {
+            std::vector<std::jthread> pool;
+            pool.reserve(threads);
+            for (unsigned index = 0; index < threads; ++index) {
+                pool.emplace_back([this, index] { work(index); });
+            }
+        }
+        workers_.clear();
+        return !failed_;
+    }
+};
+
+} // namespace fun::support
@@ -0,0 +1,110 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file thread_pool.hpp
+ * @brief Defines [ThreadPool](@ref ThreadPool)
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace fun::support {
+
+/**
+ * @class ThreadPool
+ * @brief A fixed set of worker threads executing tasks in FIFO order.
+ *
+ * Tasks which are still queued when the pool is destroyed are run to
+ * completion before the destructor returns.
+ */
+class ThreadPool {
+    using Task = std::move_only_function<void()>;
+
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<Task> tasks_;
+    bool stopping_;
+    std::vector<std::jthread> workers_;
+
+    void work() {
+        while (true) {
+            Task task;
+            {
+                std::unique_lock lock{mutex_};
+                ready_.wait(lock,
+                            [this] { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty()) { return; }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    static unsigned default_size() noexcept {
+        unsigned threads = std::thread::hardware_concurrency();
+        return threads == 0 ? 1 : threads;
+    }
+
+    explicit ThreadPool(unsigned threads = default_size()) : stopping_{false} {
+        if (threads == 0) { threads = 1; }
+        workers_.reserve(threads);
+        for (unsigned index = 0; index < threads; ++index) {
+            workers_.emplace_back([this] { work(); });
+        }
+    }
+
+    ThreadPool(ThreadPool const &)            = delete;
+    ThreadPool &operator=(ThreadPool const &) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard lock{mutex_};
+            stopping_ = true;
+        }
+        ready_.notify_all();
+        workers_.clear();
+    }
+
+    unsigned size() const noexcept {
+        return static_cast<unsigned>(workers_.size());
+    }
+
+    /**
+     * @brief Queues @p function for execution on a worker thread.
+     *
+     * @return a future which holds the result, or the exception thrown by
+     * @p function.
+     */
+    template <class Function>
+    std::future<std::invoke_result_t<std::decay_t<Function>>>
+    submit(Function &&function) {
+        using Result = std::invoke_result_t<std::decay_t<Function>>;
+        std::packaged_task<Result()> task{std::forward<Function>(function)};
+        std::future<Result> future = task.get_future();
+        {
+            std::lock_guard lock{mutex_};
+            tasks_.emplace_back(std::move(task));
+        }
+        ready_.notify_one();
+        return future;
+    }
+};
+
+} // namespace fun::support
@@ -0,0 +1,213 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+#include <vector>
+
+#include <llvm/IR/Attributes.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/InlineAsm.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/TargetParser/Triple.h>
+
+#include "codegen/entry.hpp"
+#include "codegen/syscall.hpp"
+
+namespace fun::codegen {
+
+namespace {
+
+/// arch_prctl(ARCH_SET_FS, address) sets the thread pointer of x86-64
+constexpr std::uint64_t arch_set_fs = 0x1002;
+
+/// the alignment of the static thread local storage of an executable
+constexpr std::uint64_t tls_alignment = 64;
+
+/**
+ * @brief Points the thread pointer at a static block of thread local
+ * storage, if the module has any thread local variables.
+ *
+ * Without a C runtime nothing else sets up the thread pointer. Every
+ * thread local variable of an executable uses the local exec model, and
+ * is zero initialized, so a block of zeroes which is at least as large as
+ * the thread local segment, and placed as the ELF TLS ABI of the target
+ * places it relative to the thread pointer, is all that is needed.
+ */
+void set_up_thread_pointer(llvm::Triple const &triple, env::Context &ctx) {
+    llvm::Module &module         = ctx.llvm_module();
+    llvm::DataLayout const &data = module.getDataLayout();
+    std::uint64_t size           = 0;
+    for (llvm::GlobalVariable const &variable : module.globals()) {
+        if (!variable.isThreadLocal()) { continue; }
+        size = llvm::alignTo(size, variable.getAlign().valueOrOne()) +
+               data.getTypeAllocSize(variable.getValueType());
+    }
+    if (size == 0) { return; }
+    size = llvm::alignTo(size, tls_alignment);
+
+    // room for the block, and the thread control block which follows
+    // (x86-64) or precedes (AArch64) it.
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    llvm::Type *block_type     = llvm::ArrayType::get(
+        ctx.llvm_Int8Ty(), size + 2 * tls_alignment);
+    auto *block = new llvm::GlobalVariable(
+        module,
+        block_type,
+        false,
+        llvm::GlobalValue::InternalLinkage,
+        llvm::Constant::getNullValue(block_type),
+        "fun.tls");
+    block->setAlignment(llvm::Align{tls_alignment});
+
+    llvm::Type *i64 = ctx.llvm_Int64Ty();
+    if (triple.getArch() == llvm::Triple::x86_64) {
+        // variables lie below the thread pointer, which points at itself.
+        llvm::Value *pointer = builder.CreateConstInBoundsGEP2_64(
+            block_type, block, 0, size + tls_alignment);
+        llvm::Value *address = builder.CreatePtrToInt(pointer, i64);
+        builder.CreateStore(address, pointer);
+        emit_syscall(Syscall::ArchPrctl,
+                     {ctx.llvm_Int64(arch_set_fs), address},
+                     ctx);
+        return;
+    }
+
+    // variables lie above the thread pointer, after two reserved words.
+    auto *set = llvm::InlineAsm::get(
+        llvm::FunctionType::get(builder.getVoidTy(), {i64}, false),
+        "msr tpidr_el0, $0",
+        "r,~{memory}",
+        true);
+    builder.CreateCall(set, {builder.CreatePtrToInt(block, i64)});
+}
+
+/**
+ * @brief Calls each function of @p list, llvm.global_ctors or
+ * llvm.global_dtors, as there is no C runtime to call them at startup or
+ * at exit.
+ */
+void call_each(llvm::StringRef list, env::Context &ctx) {
+    llvm::GlobalVariable *functions = ctx.llvm_module().getNamedGlobal(list);
+    if (functions == nullptr || !functions->hasInitializer()) { return; }
+    auto *entries =
+        llvm::dyn_cast<llvm::ConstantArray>(functions->getInitializer());
+    if (entries == nullptr) { return; }
+    for (llvm::Value *entry : entries->operands()) {
+        auto *fields = llvm::cast<llvm::ConstantStruct>(entry);
+        if (auto *function =
+                llvm::dyn_cast<llvm::Function>(fields->getOperand(1))) {
+            ctx.llvm_builder().CreateCall(function);
+        }
+    }
+}
+
+} // namespace
+
+llvm::Function *emit_entry(IR::Label main, env::Context &ctx) {
+    llvm::Module &module = ctx.llvm_module();
+    llvm::Function *callee =
+        module.getFunction(llvm::StringRef{main.name.data(), main.name.size()});
+    if (callee == nullptr || callee->isDeclaration()) {
+        llvm::errs() << "error: the entry point " << main.name
+                     << " is not defined\n";
+        return nullptr;
+    }
+    if (callee->arg_size() != 0) {
+        llvm::errs() << "error: the entry point " << main.name
+                     << " must not take arguments\n";
+        return nullptr;
+    }
+
+    llvm::Triple triple{module.getTargetTriple()};
+    if (triple.getArch() != llvm::Triple::x86_64 &&
+        triple.getArch() != llvm::Triple::aarch64) {
+        llvm::errs() << "error: executables cannot be linked for "
+                     << triple.str() << "\n";
+        return nullptr;
+    }
+
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    llvm::Type *i64            = ctx.llvm_Int64Ty();
+    llvm::Function *start      = llvm::Function::Create(
+        llvm::FunctionType::get(builder.getVoidTy(), false),
+        llvm::Function::ExternalLinkage,
+        "_start",
+        module);
+    start->setDoesNotReturn();
+    start->setDoesNotThrow();
+    // the stack is not aligned for a call on entry to a process.
+    start->addFnAttr("stackrealign");
+
+    builder.SetInsertPoint(
+        llvm::BasicBlock::Create(ctx.llvm_context(), "entry", start));
+    set_up_thread_pointer(triple, ctx);
+    call_each("llvm.global_ctors", ctx);
+    llvm::Value *result = builder.CreateCall(callee);
+    llvm::Value *status = result->getType()->isIntegerTy()
+                            ? builder.CreateZExtOrTrunc(result, i64)
+                            : ctx.llvm_Int64(std::uint64_t{0});
+    call_each("llvm.global_dtors", ctx);
+
+    emit_syscall(Syscall::ExitGroup, {status}, ctx);
+    builder.CreateUnreachable();
+    return start;
+}
+
+llvm::Function *emit_adapter(llvm::Function *function,
+                             llvm::StringRef name,
+                             env::Context &ctx) {
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    llvm::Type *cell           = ctx.llvm_Int64Ty();
+    llvm::Type *pointer        = builder.getPtrTy();
+    llvm::Function *adapter    = llvm::Function::Create(
+        llvm::FunctionType::get(
+            builder.getVoidTy(), {pointer, pointer}, false),
+        llvm::Function::ExternalLinkage,
+        name,
+        ctx.llvm_module());
+    adapter->setDoesNotThrow();
+    // the engine passes two distinct arrays of cells, which it owns for the
+    // length of the call: the arguments, only read, and the result, only
+    // written. Knowing so, LLVM may load every argument up front.
+    std::uint64_t const cells = sizeof(std::uint64_t);
+    if (function->arg_size() != 0) {
+        llvm::AttrBuilder read{ctx.llvm_context()};
+        read.addAttribute(llvm::Attribute::NoAlias)
+            .addAttribute(llvm::Attribute::NonNull)
+            .addAttribute(llvm::Attribute::ReadOnly)
+            .addDereferenceableAttr(cells * function->arg_size())
+            .addAlignmentAttr(llvm::Align{cells});
+        adapter->addParamAttrs(0, read);
+    }
+    llvm::AttrBuilder written{ctx.llvm_context()};
+    written.addAttribute(llvm::Attribute::NoAlias)
+        .addAttribute(llvm::Attribute::NonNull)
+        .addAttribute(llvm::Attribute::WriteOnly)
+        .addDereferenceableAttr(cells)
+        .addAlignmentAttr(llvm::Align{cells});
+    adapter->addParamAttrs(1, written);
+
+    builder.SetInsertPoint(
+        llvm::BasicBlock::Create(ctx.llvm_context(), "entry", adapter));
+    std::vector<llvm::Value *> arguments;
+    arguments.reserve(function->arg_size());
+    for (llvm::Argument &argument : function->args()) {
+        llvm::Value *address = builder.CreateConstInBoundsGEP1_64(
+            cell, adapter->getArg(0), argument.getArgNo());
+        arguments.push_back(builder.CreateLoad(argument.getType(), address));
+    }
+
+    llvm::Value *result = builder.CreateCall(function, arguments);
+    if (!result->getType()->isVoidTy()) {
+        builder.CreateStore(result, adapter->getArg(1));
+    }
+    builder.CreateRetVoid();
+    return adapter;
+}
+
+} // namespace fun::codegen
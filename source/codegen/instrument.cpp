@@ -0,0 +1,252 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Intrinsics.h>
+#include <llvm/TargetParser/Triple.h>
+#include <llvm/Transforms/Utils/ModuleUtils.h>
+
+#include "codegen/instrument.hpp"
+#include "codegen/syscall.hpp"
+#include "codegen/to_llvm.hpp"
+
+namespace fun::codegen {
+
+namespace {
+
+/// the field of the counters of a function which counts its calls
+constexpr unsigned calls_field = 0;
+/// the field of the counters of a function which totals its ticks
+constexpr unsigned ticks_field = 1;
+
+/// room for two 64 bit integers in decimal and two tabs
+constexpr std::uint64_t line_buffer_size = 48;
+
+/// reads the cycle counter of the processor
+llvm::Value *ticks(env::Context &ctx) {
+    // the cycle counter of AArch64 cannot be read outside of the kernel,
+    // but its virtual counter can.
+    llvm::Triple triple{ctx.llvm_module().getTargetTriple()};
+    llvm::Intrinsic::ID id = triple.getArch() == llvm::Triple::aarch64
+                               ? llvm::Intrinsic::readsteadycounter
+                               : llvm::Intrinsic::readcyclecounter;
+    return ctx.llvm_builder().CreateIntrinsic(id, {}, {});
+}
+
+/// adds @p amount to the @p field of @p counters
+void bump(llvm::GlobalVariable *counters,
+          unsigned field,
+          llvm::Value *amount,
+          env::Context &ctx) {
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    llvm::Value *address =
+        builder.CreateStructGEP(counters->getValueType(), counters, field);
+    llvm::Value *value = builder.CreateLoad(ctx.llvm_Int64Ty(), address);
+    builder.CreateStore(builder.CreateAdd(value, amount), address);
+}
+
+void count(llvm::Function *function,
+           llvm::GlobalVariable *counters,
+           env::Context &ctx) {
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    builder.SetInsertPoint(
+        function->getEntryBlock().getFirstNonPHIOrDbgOrAlloca());
+    llvm::Value *start = ticks(ctx);
+    bump(counters, calls_field, ctx.llvm_Int64(std::uint64_t{1}), ctx);
+
+    for (llvm::BasicBlock &block : *function) {
+        auto *ret = llvm::dyn_cast<llvm::ReturnInst>(block.getTerminator());
+        if (ret == nullptr) { continue; }
+        builder.SetInsertPoint(ret);
+        bump(counters,
+             ticks_field,
+             builder.CreateSub(ticks(ctx), start),
+             ctx);
+    }
+}
+
+/**
+ * @brief Defines ptr fun.profile.format(ptr end, i64 value), which writes
+ * @p value in decimal to the bytes just before end, and returns the first
+ * byte written.
+ */
+llvm::Function *emit_format(env::Context &ctx) {
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    llvm::LLVMContext &context = ctx.llvm_context();
+    llvm::Type *i8             = ctx.llvm_Int8Ty();
+    llvm::Type *i64            = ctx.llvm_Int64Ty();
+    llvm::Type *pointer        = builder.getPtrTy();
+    llvm::Function *format     = llvm::Function::Create(
+        llvm::FunctionType::get(pointer, {pointer, i64}, false),
+        llvm::Function::InternalLinkage,
+        "fun.profile.format",
+        ctx.llvm_module());
+
+    auto *entry = llvm::BasicBlock::Create(context, "entry", format);
+    auto *loop  = llvm::BasicBlock::Create(context, "loop", format);
+    auto *done  = llvm::BasicBlock::Create(context, "done", format);
+
+    builder.SetInsertPoint(entry);
+    builder.CreateBr(loop);
+
+    builder.SetInsertPoint(loop);
+    llvm::PHINode *end   = builder.CreatePHI(pointer, 2);
+    llvm::PHINode *value = builder.CreatePHI(i64, 2);
+    llvm::Value *ten     = ctx.llvm_Int64(std::uint64_t{10});
+    llvm::Value *digit   = builder.CreateAdd(
+        builder.CreateTrunc(builder.CreateURem(value, ten), i8),
+        ctx.llvm_Int8(std::uint8_t{'0'}));
+    llvm::Value *first = builder.CreateInBoundsGEP(
+        i8, end, ctx.llvm_Int64(std::int64_t{-1}));
+    builder.CreateStore(digit, first);
+    llvm::Value *rest = builder.CreateUDiv(value, ten);
+    builder.CreateCondBr(
+        builder.CreateICmpNE(rest, ctx.llvm_Int64(std::uint64_t{0})),
+        loop,
+        done);
+    end->addIncoming(format->getArg(0), entry);
+    end->addIncoming(first, loop);
+    value->addIncoming(format->getArg(1), entry);
+    value->addIncoming(rest, loop);
+
+    builder.SetInsertPoint(done);
+    builder.CreateRet(first);
+    return format;
+}
+
+/**
+ * @brief Defines void fun.profile.line(ptr name, i64 size, i64 calls,
+ * i64 ticks), which writes one line of the profile to standard error.
+ */
+llvm::Function *emit_line(llvm::Function *format, env::Context &ctx) {
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    llvm::Type *i8             = ctx.llvm_Int8Ty();
+    llvm::Type *i64            = ctx.llvm_Int64Ty();
+    llvm::Type *pointer        = builder.getPtrTy();
+    llvm::Function *line       = llvm::Function::Create(
+        llvm::FunctionType::get(
+            builder.getVoidTy(), {pointer, i64, i64, i64}, false),
+        llvm::Function::InternalLinkage,
+        "fun.profile.line",
+        ctx.llvm_module());
+
+    builder.SetInsertPoint(
+        llvm::BasicBlock::Create(ctx.llvm_context(), "entry", line));
+    llvm::Value *buffer =
+        builder.CreateAlloca(llvm::ArrayType::get(i8, line_buffer_size));
+    llvm::Value *minus_one = ctx.llvm_Int64(std::int64_t{-1});
+    llvm::Value *tab       = ctx.llvm_Int8(std::uint8_t{'\t'});
+
+    // the line is written backwards from the end of the buffer.
+    llvm::Value *end = builder.CreateConstInBoundsGEP1_64(
+        i8, buffer, line_buffer_size - 1);
+    builder.CreateStore(tab, end);
+    llvm::Value *first = builder.CreateCall(format, {end, line->getArg(3)});
+    first              = builder.CreateInBoundsGEP(i8, first, minus_one);
+    builder.CreateStore(tab, first);
+    first = builder.CreateCall(format, {first, line->getArg(2)});
+
+    llvm::Value *size = builder.CreatePtrDiff(
+        i8,
+        builder.CreateConstInBoundsGEP1_64(i8, buffer, line_buffer_size),
+        first);
+    llvm::Value *stderr_fd = ctx.llvm_Int64(std::uint64_t{2});
+    if (emit_syscall(Syscall::Write,
+                     {stderr_fd, builder.CreatePtrToInt(first, i64), size},
+                     ctx) == nullptr) {
+        return nullptr;
+    }
+    emit_syscall(Syscall::Write,
+                 {stderr_fd,
+                  builder.CreatePtrToInt(line->getArg(0), i64),
+                  line->getArg(1)},
+                 ctx);
+    llvm::Value *newline = builder.CreateGlobalString("\n");
+    emit_syscall(
+        Syscall::Write,
+        {stderr_fd,
+         builder.CreatePtrToInt(newline, i64),
+         ctx.llvm_Int64(std::uint64_t{1})},
+        ctx);
+    builder.CreateRetVoid();
+    return line;
+}
+
+} // namespace
+
+bool instrument(env::Context &ctx) {
+    llvm::Module &module = ctx.llvm_module();
+    llvm::Type *i64      = ctx.llvm_Int64Ty();
+    llvm::StructType *counters_type =
+        llvm::StructType::get(ctx.llvm_context(), {i64, i64});
+
+    std::vector<std::pair<llvm::Function *, llvm::GlobalVariable *>>
+        instrumented;
+    for (llvm::Function &function : module) {
+        if (!is_lambda(function)) { continue; }
+        auto *counters = new llvm::GlobalVariable(
+            module,
+            counters_type,
+            false,
+            llvm::GlobalValue::InternalLinkage,
+            llvm::Constant::getNullValue(counters_type),
+            "fun.profile." + function.getName(),
+            nullptr,
+            llvm::GlobalValue::LocalExecTLSModel);
+        instrumented.emplace_back(&function, counters);
+    }
+    for (auto [function, counters] : instrumented) {
+        count(function, counters, ctx);
+    }
+    forget_memory(module);
+
+    llvm::Function *line = emit_line(emit_format(ctx), ctx);
+    if (line == nullptr) { return false; }
+
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    llvm::Function *dump       = llvm::Function::Create(
+        llvm::FunctionType::get(builder.getVoidTy(), false),
+        llvm::Function::InternalLinkage,
+        "fun.profile.dump",
+        module);
+    builder.SetInsertPoint(
+        llvm::BasicBlock::Create(ctx.llvm_context(), "entry", dump));
+
+    llvm::StringRef const header = "calls\tticks\tlambda\n";
+    emit_syscall(
+        Syscall::Write,
+        {ctx.llvm_Int64(std::uint64_t{2}),
+         builder.CreatePtrToInt(builder.CreateGlobalString(header), i64),
+         ctx.llvm_Int64(std::uint64_t{header.size()})},
+        ctx);
+    for (auto [function, counters] : instrumented) {
+        llvm::StringRef name = function->getName();
+        llvm::Value *calls   = builder.CreateLoad(
+            i64,
+            builder.CreateStructGEP(counters_type, counters, calls_field));
+        llvm::Value *total = builder.CreateLoad(
+            i64,
+            builder.CreateStructGEP(counters_type, counters, ticks_field));
+        builder.CreateCall(line,
+                           {builder.CreateGlobalString(name),
+                            ctx.llvm_Int64(std::uint64_t{name.size()}),
+                            calls,
+                            total});
+    }
+    builder.CreateRetVoid();
+
+    llvm::appendToGlobalDtors(module, dump, 0);
+    return true;
+}
+
+} // namespace fun::codegen
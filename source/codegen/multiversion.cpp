@@ -0,0 +1,330 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/InlineAsm.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/TargetParser/Triple.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/ModuleUtils.h>
+
+#include "codegen/multiversion.hpp"
+#include "codegen/to_llvm.hpp"
+
+namespace fun::codegen {
+
+namespace {
+
+constexpr std::uint32_t bit(unsigned index) noexcept {
+    return std::uint32_t{1} << index;
+}
+
+/**
+ * @struct Level
+ * @brief An x86-64 microarchitecture level, as the features cpuid must
+ * report, and the state the operating system must have enabled, for a
+ * machine to be at that level.
+ */
+struct Level {
+    llvm::StringRef cpu;
+    /// ecx of leaf 1
+    std::uint32_t basic;
+    /// ebx of leaf 7
+    std::uint32_t extended;
+    /// ecx of leaf 0x80000001
+    std::uint32_t amd;
+    /// xcr0, as xgetbv reads it
+    std::uint32_t state;
+};
+
+// sse3, ssse3, cmpxchg16b, sse4.1, sse4.2 and popcnt, and lahf/sahf
+constexpr std::uint32_t v2_basic =
+    bit(0) | bit(9) | bit(13) | bit(19) | bit(20) | bit(23);
+constexpr std::uint32_t v2_amd = bit(0);
+// and fma, movbe, osxsave, avx and f16c, bmi1, avx2 and bmi2, and lzcnt,
+// with the sse and avx state enabled
+constexpr std::uint32_t v3_basic =
+    v2_basic | bit(12) | bit(22) | bit(27) | bit(28) | bit(29);
+constexpr std::uint32_t v3_extended = bit(3) | bit(5) | bit(8);
+constexpr std::uint32_t v3_amd      = v2_amd | bit(5);
+constexpr std::uint32_t v3_state    = bit(1) | bit(2);
+// and avx512f, avx512dq, avx512cd, avx512bw and avx512vl, with the opmask
+// and zmm state enabled
+constexpr std::uint32_t v4_extended =
+    v3_extended | bit(16) | bit(17) | bit(28) | bit(30) | bit(31);
+constexpr std::uint32_t v4_state = v3_state | bit(5) | bit(6) | bit(7);
+
+/// the level of every x86-64 machine
+constexpr llvm::StringRef baseline = "x86-64";
+
+/// the levels, from the least to the most capable
+constexpr Level levels[] = {
+    {"x86-64-v2", v2_basic, 0, v2_amd, 0},
+    {"x86-64-v3", v3_basic, v3_extended, v3_amd, v3_state},
+    {"x86-64-v4", v3_basic, v4_extended, v3_amd, v4_state},
+};
+
+/// the registers cpuid and xgetbv read, as the resolver holds them
+struct Features {
+    llvm::Value *basic;
+    llvm::Value *extended;
+    llvm::Value *amd;
+    llvm::Value *state;
+};
+
+/// runs cpuid for @p leaf, giving {eax, ebx, ecx, edx}
+llvm::Value *cpuid(std::uint32_t leaf, env::Context &ctx) {
+    llvm::Type *i32 = ctx.llvm_Int32Ty();
+    auto *type =
+        llvm::StructType::get(ctx.llvm_context(), {i32, i32, i32, i32});
+    auto *instruction =
+        llvm::InlineAsm::get(llvm::FunctionType::get(type, {i32, i32}, false),
+                             "cpuid",
+                             "={ax},={bx},={cx},={dx},{ax},{cx}",
+                             false);
+    return ctx.llvm_builder().CreateCall(
+        instruction,
+        {ctx.llvm_Int32(leaf), ctx.llvm_Int32(std::uint32_t{0})});
+}
+
+/**
+ * @brief reads the features of the processor, within @p resolver.
+ *
+ * A leaf beyond the last the processor has gives garbage rather than a
+ * fault, so it is read and ignored, but xgetbv faults unless the
+ * operating system enabled it, as osxsave reports.
+ */
+Features read_features(llvm::Function *resolver, env::Context &ctx) {
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    llvm::Value *zero          = ctx.llvm_Int32(std::uint32_t{0});
+    // a register of the leaf, or zero if the processor does not have it
+    auto reads = [&](std::uint32_t leaf, llvm::Value *last, unsigned index) {
+        llvm::Value *value =
+            builder.CreateExtractValue(cpuid(leaf, ctx), index);
+        llvm::Value *present =
+            builder.CreateICmpUGE(last, ctx.llvm_Int32(leaf));
+        return builder.CreateSelect(present, value, zero);
+    };
+
+    llvm::Value *last_basic = builder.CreateExtractValue(cpuid(0, ctx), 0);
+    llvm::Value *last_amd =
+        builder.CreateExtractValue(cpuid(0x8000'0000, ctx), 0);
+    Features features{reads(1, last_basic, 2),
+                      reads(7, last_basic, 1),
+                      reads(0x8000'0001, last_amd, 2),
+                      nullptr};
+
+    llvm::BasicBlock *entry = builder.GetInsertBlock();
+    auto *enabled =
+        llvm::BasicBlock::Create(ctx.llvm_context(), "xgetbv", resolver);
+    auto *done = llvm::BasicBlock::Create(ctx.llvm_context(), "", resolver);
+    llvm::Value *osxsave = builder.CreateICmpNE(
+        builder.CreateAnd(features.basic, ctx.llvm_Int32(bit(27))), zero);
+    builder.CreateCondBr(osxsave, enabled, done);
+
+    builder.SetInsertPoint(enabled);
+    llvm::Type *i32 = ctx.llvm_Int32Ty();
+    auto *pair      = llvm::StructType::get(ctx.llvm_context(), {i32, i32});
+    auto *xgetbv    = llvm::InlineAsm::get(
+        llvm::FunctionType::get(pair, {i32}, false),
+        "xgetbv",
+        "={ax},={dx},{cx}",
+        false);
+    llvm::Value *state =
+        builder.CreateExtractValue(builder.CreateCall(xgetbv, {zero}), 0);
+    builder.CreateBr(done);
+
+    builder.SetInsertPoint(done);
+    llvm::PHINode *phi = builder.CreatePHI(i32, 2);
+    phi->addIncoming(zero, entry);
+    phi->addIncoming(state, enabled);
+    features.state = phi;
+    return features;
+}
+
+/// whether the processor of @p features is at @p level
+llvm::Value *
+supports(Features const &features, Level const &level, env::Context &ctx) {
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    auto has = [&](llvm::Value *value, std::uint32_t mask) {
+        llvm::Value *bits = ctx.llvm_Int32(mask);
+        return builder.CreateICmpEQ(builder.CreateAnd(value, bits), bits);
+    };
+    return builder.CreateAnd({has(features.basic, level.basic),
+                              has(features.extended, level.extended),
+                              has(features.amd, level.amd),
+                              has(features.state, level.state)});
+}
+
+/**
+ * @brief compiles @p function for any machine with @p cpu, with the
+ * features the cpu implies rather than those of the host
+ */
+void compile_for(llvm::Function &function, llvm::StringRef cpu) {
+    function.addFnAttr("target-cpu", cpu);
+    function.addFnAttr("target-features", "");
+}
+
+/// a lambda, as the resolver sees it once it is cloned
+struct Dispatched {
+    llvm::GlobalVariable *pointer;
+    llvm::Function *fallback;
+    /// a clone per level, in the order of the levels
+    std::vector<llvm::Function *> versions;
+};
+
+/**
+ * @brief clones @p function for each of @p chosen, and turns it into a
+ * dispatcher which calls whichever clone its function pointer holds.
+ */
+Dispatched dispatch(llvm::Function &function,
+                    std::vector<Level const *> const &chosen,
+                    env::Context &ctx) {
+    llvm::Module &module = ctx.llvm_module();
+    auto version = [&](llvm::StringRef suffix) {
+        llvm::ValueToValueMapTy map;
+        llvm::Function *clone = llvm::CloneFunction(&function, map);
+        clone->setName("fun.clone." + function.getName() + "." + suffix);
+        clone->setLinkage(llvm::Function::InternalLinkage);
+        return clone;
+    };
+
+    // the default runs on machines below every level, which may be older
+    // than the target of ctx.
+    Dispatched result{nullptr, version("default"), {}};
+    compile_for(*result.fallback, baseline);
+    for (Level const *level : chosen) {
+        llvm::Function *clone = version(level->cpu);
+        compile_for(*clone, level->cpu);
+        result.versions.push_back(clone);
+    }
+
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    llvm::Type *pointer_type   = builder.getPtrTy();
+    result.pointer             = new llvm::GlobalVariable(
+        module,
+        pointer_type,
+        false,
+        llvm::GlobalValue::InternalLinkage,
+        result.fallback,
+        "fun.dispatch." + function.getName());
+
+    llvm::GlobalValue::LinkageTypes linkage = function.getLinkage();
+    function.deleteBody();
+    function.setLinkage(linkage);
+    builder.SetInsertPoint(
+        llvm::BasicBlock::Create(ctx.llvm_context(), "entry", &function));
+    std::vector<llvm::Value *> arguments;
+    for (llvm::Argument &argument : function.args()) {
+        arguments.push_back(&argument);
+    }
+    llvm::CallInst *call = builder.CreateCall(
+        function.getFunctionType(),
+        builder.CreateLoad(pointer_type, result.pointer),
+        arguments);
+    call->setAttributes(function.getAttributes());
+    call->setTailCallKind(llvm::CallInst::TCK_MustTail);
+    builder.CreateRet(call);
+
+    // the dispatcher reads its function pointer, so a lambda which was
+    // memory(none) only reads memory now, as do the calls to it.
+    if (function.doesNotAccessMemory()) {
+        function.removeFnAttr(llvm::Attribute::Memory);
+        function.setOnlyReadsMemory();
+        for (llvm::User *user : function.users()) {
+            auto *caller = llvm::dyn_cast<llvm::CallBase>(user);
+            if (caller != nullptr && caller->getCalledFunction() == &function) {
+                caller->removeFnAttr(llvm::Attribute::Memory);
+            }
+        }
+    }
+    function.addFnAttr(llvm::Attribute::AlwaysInline);
+    return result;
+}
+
+} // namespace
+
+bool multiversion(llvm::ArrayRef<std::string> lambdas,
+                  llvm::ArrayRef<std::string> names,
+                  env::Context &ctx) {
+    llvm::Module &module = ctx.llvm_module();
+    llvm::Triple triple{module.getTargetTriple()};
+    if (triple.getArch() != llvm::Triple::x86_64) {
+        llvm::errs() << "error: lambdas can only be cloned for x86-64, not "
+                     << triple.str() << "\n";
+        return false;
+    }
+
+    for (std::string const &name : names) {
+        if (llvm::none_of(levels, [&](Level const &level) {
+                return level.cpu == name;
+            })) {
+            llvm::errs() << "error: " << name
+                         << " is not an x86-64 level to clone for\n";
+            return false;
+        }
+    }
+    std::vector<Level const *> chosen;
+    for (Level const &level : levels) {
+        if (names.empty() || llvm::is_contained(names, level.cpu)) {
+            chosen.push_back(&level);
+        }
+    }
+
+    std::vector<Dispatched> dispatched;
+    for (std::string const &name : lambdas) {
+        if (module.getNamedGlobal("fun.dispatch." + name) != nullptr) {
+            continue;
+        }
+        llvm::Function *function = module.getFunction(name);
+        if (function == nullptr || !is_lambda(*function)) {
+            llvm::errs() << "error: cannot clone " << name
+                         << ", which is not a defined lambda\n";
+            return false;
+        }
+        dispatched.push_back(dispatch(*function, chosen, ctx));
+    }
+    if (dispatched.empty()) { return true; }
+
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    llvm::Function *resolver   = llvm::Function::Create(
+        llvm::FunctionType::get(builder.getVoidTy(), false),
+        llvm::Function::InternalLinkage,
+        "fun.resolve",
+        module);
+    compile_for(*resolver, baseline);
+    builder.SetInsertPoint(
+        llvm::BasicBlock::Create(ctx.llvm_context(), "entry", resolver));
+    Features const features = read_features(resolver, ctx);
+    std::vector<llvm::Value *> supported;
+    for (Level const *level : chosen) {
+        supported.push_back(supports(features, *level, ctx));
+    }
+    // the most capable level which the machine supports wins.
+    for (Dispatched const &lambda : dispatched) {
+        llvm::Value *choice = lambda.fallback;
+        for (std::size_t index = 0; index < chosen.size(); ++index) {
+            choice = builder.CreateSelect(
+                supported[index], lambda.versions[index], choice);
+        }
+        builder.CreateStore(choice, lambda.pointer);
+    }
+    builder.CreateRetVoid();
+
+    llvm::appendToGlobalCtors(module, resolver, 0);
+    return true;
+}
+
+} // namespace fun::codegen
@@ -0,0 +1,306 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/IR/ProfileSummary.h>
+#include <llvm/IR/StructuralHash.h>
+#include <llvm/ProfileData/InstrProf.h>
+#include <llvm/ProfileData/ProfileCommon.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Utils/ModuleUtils.h>
+
+#include "codegen/pgo.hpp"
+#include "codegen/syscall.hpp"
+#include "codegen/to_llvm.hpp"
+
+namespace fun::codegen {
+
+namespace {
+
+// the arguments of openat which append to a file, creating it if need be:
+// AT_FDCWD, and O_WRONLY | O_CREAT | O_APPEND, which are the same on every
+// supported target.
+constexpr std::int64_t at_fdcwd     = -100;
+constexpr std::uint64_t open_flags  = 01 | 0100 | 02000;
+constexpr std::uint64_t create_mode = 0644;
+constexpr std::int64_t standard_error = 2;
+
+/// identifies the code of @p function, as it was lowered
+std::uint64_t hash(llvm::Function const &function) {
+    return llvm::StructuralHash(function, true);
+}
+
+/**
+ * @brief the conditional branches of @p function, in the order of their
+ * blocks, whose counts follow those of the blocks
+ */
+std::vector<llvm::BranchInst *> branches(llvm::Function &function) {
+    std::vector<llvm::BranchInst *> found;
+    for (llvm::BasicBlock &block : function) {
+        auto *branch =
+            llvm::dyn_cast_or_null<llvm::BranchInst>(block.getTerminator());
+        if (branch != nullptr && branch->isConditional()) {
+            found.push_back(branch);
+        }
+    }
+    return found;
+}
+
+/// appends the words of @p bytes, which are a whole number of words
+void append_words(std::vector<std::uint64_t> &words, llvm::StringRef bytes) {
+    std::size_t const first = words.size();
+    words.resize(first + bytes.size() / sizeof(std::uint64_t));
+    std::memcpy(words.data() + first, bytes.data(), bytes.size());
+}
+
+/**
+ * @brief adds one to the counter of each block of @p function, and the
+ * condition to that of each of its @p conditional branches, where the
+ * counters of @p function start at word @p first of @p run.
+ */
+void count(llvm::Function &function,
+           std::vector<llvm::BranchInst *> const &conditional,
+           llvm::GlobalVariable *run,
+           std::uint64_t first,
+           env::Context &ctx) {
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    llvm::Type *i64            = ctx.llvm_Int64Ty();
+    std::uint64_t index        = first;
+    auto add = [&](llvm::Value *amount) {
+        llvm::Value *address = builder.CreateConstInBoundsGEP2_64(
+            run->getValueType(), run, 0, index++);
+        llvm::Value *count = builder.CreateLoad(i64, address);
+        builder.CreateStore(builder.CreateAdd(count, amount), address);
+    };
+
+    for (llvm::BasicBlock &block : function) {
+        builder.SetInsertPoint(block.isEntryBlock()
+                                   ? block.getFirstNonPHIOrDbgOrAlloca()
+                                   : block.getFirstInsertionPt());
+        add(ctx.llvm_Int64(std::uint64_t{1}));
+    }
+    // how often a branch was not taken is what is left of its block.
+    for (llvm::BranchInst *branch : conditional) {
+        builder.SetInsertPoint(branch);
+        add(builder.CreateZExt(branch->getCondition(), i64));
+    }
+}
+
+/// @p count scaled down by @p shift, as a branch weight
+std::uint32_t weight(std::uint64_t count, int shift) noexcept {
+    return static_cast<std::uint32_t>(count >> shift);
+}
+
+} // namespace
+
+bool generate_profile(llvm::StringRef path, env::Context &ctx) {
+    llvm::Module &module = ctx.llvm_module();
+    llvm::Type *i64      = ctx.llvm_Int64Ty();
+
+    // the whole run is laid out in one array, with the counters in place
+    // between the headers, so that it is written with one system call,
+    // which appending runs cannot interleave.
+    struct Instrumented {
+        llvm::Function *function;
+        std::vector<llvm::BranchInst *> branches;
+        std::uint64_t first;
+    };
+    std::vector<Instrumented> instrumented;
+    for (llvm::Function &function : module) {
+        if (is_lambda(function)) {
+            instrumented.push_back({&function, branches(function), 0});
+        }
+    }
+    std::vector<std::uint64_t> words;
+    append_words(words, Profile::run_header(instrumented.size()));
+    for (Instrumented &lambda : instrumented) {
+        std::uint64_t const counters =
+            lambda.function->size() + lambda.branches.size();
+        append_words(words,
+                     Profile::record_header(lambda.function->getName(),
+                                            hash(*lambda.function),
+                                            counters));
+        lambda.first = words.size();
+        words.resize(words.size() + counters, 0);
+    }
+    llvm::Constant *initializer =
+        llvm::ConstantDataArray::get(ctx.llvm_context(), words);
+    auto *run = new llvm::GlobalVariable(module,
+                                         initializer->getType(),
+                                         false,
+                                         llvm::GlobalValue::InternalLinkage,
+                                         initializer,
+                                         "fun.pgo.run");
+    for (Instrumented const &lambda : instrumented) {
+        count(*lambda.function, lambda.branches, run, lambda.first, ctx);
+    }
+    forget_memory(module);
+
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    llvm::Function *dump       = llvm::Function::Create(
+        llvm::FunctionType::get(builder.getVoidTy(), false),
+        llvm::Function::InternalLinkage,
+        "fun.pgo.dump",
+        module);
+    auto *entry =
+        llvm::BasicBlock::Create(ctx.llvm_context(), "entry", dump);
+    auto *write =
+        llvm::BasicBlock::Create(ctx.llvm_context(), "write", dump);
+    auto *failed =
+        llvm::BasicBlock::Create(ctx.llvm_context(), "failed", dump);
+    auto *done = llvm::BasicBlock::Create(ctx.llvm_context(), "done", dump);
+
+    builder.SetInsertPoint(entry);
+    llvm::Value *fd = emit_syscall(
+        Syscall::Openat,
+        {ctx.llvm_Int64(at_fdcwd),
+         builder.CreatePtrToInt(builder.CreateGlobalString(path), i64),
+         ctx.llvm_Int64(open_flags),
+         ctx.llvm_Int64(create_mode)},
+        ctx);
+    if (fd == nullptr) { return false; }
+    builder.CreateCondBr(
+        builder.CreateICmpSGE(fd, ctx.llvm_Int64(std::int64_t{0})),
+        write,
+        failed);
+
+    // a short write leaves a truncated run, which is reported, and which
+    // read_profile rejects along with whatever follows it.
+    builder.SetInsertPoint(write);
+    std::uint64_t const size = words.size() * sizeof(std::uint64_t);
+    llvm::Value *written     = emit_syscall(
+        Syscall::Write,
+        {fd, builder.CreatePtrToInt(run, i64), ctx.llvm_Int64(size)},
+        ctx);
+    emit_syscall(Syscall::Close, {fd}, ctx);
+    builder.CreateCondBr(
+        builder.CreateICmpEQ(written, ctx.llvm_Int64(size)), done, failed);
+
+    builder.SetInsertPoint(failed);
+    std::string const message =
+        "error: cannot write the profile " + path.str() + "\n";
+    emit_syscall(Syscall::Write,
+                 {ctx.llvm_Int64(standard_error),
+                  builder.CreatePtrToInt(
+                      builder.CreateGlobalString(message), i64),
+                  ctx.llvm_Int64(message.size())},
+                 ctx);
+    builder.CreateBr(done);
+
+    builder.SetInsertPoint(done);
+    builder.CreateRetVoid();
+
+    llvm::appendToGlobalDtors(module, dump, 0);
+    return true;
+}
+
+std::optional<Profile> read_profile(std::filesystem::path const &path) {
+    auto buffer = llvm::MemoryBuffer::getFile(path.string());
+    if (!buffer) {
+        llvm::errs() << path.string() << ": " << buffer.getError().message()
+                     << "\n";
+        return std::nullopt;
+    }
+    Profile profile;
+    if (!profile.merge((*buffer)->getBuffer())) {
+        llvm::errs() << path.string() << ": not a fun profile\n";
+        return std::nullopt;
+    }
+    return profile;
+}
+
+void use_profile(Profile const &profile, env::Context &ctx) {
+    llvm::Module &module = ctx.llvm_module();
+    llvm::MDBuilder metadata{ctx.llvm_context()};
+    llvm::InstrProfSummaryBuilder summary{
+        llvm::ProfileSummaryBuilder::DefaultCutoffs.vec()};
+    std::vector<std::pair<std::uint64_t, llvm::Function *>> layout;
+
+    for (llvm::Function &function : module) {
+        if (!is_lambda(function)) { continue; }
+        Profile::Function const *counts = profile.find(function.getName());
+        if (counts == nullptr) {
+            layout.emplace_back(0, &function);
+            continue;
+        }
+        std::vector<llvm::BranchInst *> const conditional =
+            branches(function);
+        if (counts->hash != hash(function) ||
+            counts->blocks.size() != function.size() + conditional.size()) {
+            llvm::errs() << "warning: the profile of " << function.getName()
+                         << " is out of date\n";
+            layout.emplace_back(0, &function);
+            continue;
+        }
+
+        llvm::InstrProfRecord record;
+        record.Counts.assign(counts->blocks.begin(),
+                             counts->blocks.begin() +
+                                 static_cast<std::ptrdiff_t>(function.size()));
+        summary.addRecord(record);
+
+        llvm::DenseMap<llvm::BasicBlock const *, std::uint64_t> block_counts;
+        std::size_t index = 0;
+        for (llvm::BasicBlock &block : function) {
+            block_counts[&block] = counts->blocks[index++];
+        }
+        std::uint64_t entry = counts->blocks.front();
+        function.setEntryCount(
+            llvm::Function::ProfileCount{entry, llvm::Function::PCT_Real});
+        layout.emplace_back(entry, &function);
+
+        // the edges out of a branch are weighed by how often it was taken
+        // and how often its block ran otherwise, as the count of a join or
+        // a loop header is not that of any one edge into it.
+        for (llvm::BranchInst *branch : conditional) {
+            std::uint64_t const reached =
+                block_counts.lookup(branch->getParent());
+            std::uint64_t const taken = std::min(counts->blocks[index++],
+                                                 reached);
+            std::uint64_t const most  = std::max(taken, reached - taken);
+            if (most == 0) { continue; }
+            int shift = std::max(
+                0,
+                static_cast<int>(std::bit_width(most)) -
+                    std::numeric_limits<std::uint32_t>::digits);
+            branch->setMetadata(
+                llvm::LLVMContext::MD_prof,
+                metadata.createBranchWeights(
+                    weight(taken, shift), weight(reached - taken, shift)));
+        }
+    }
+
+    module.setProfileSummary(
+        summary.getSummary()->getMD(ctx.llvm_context()),
+        llvm::ProfileSummary::PSK_Instr);
+
+    // the hottest functions first, so that they share pages.
+    std::stable_sort(layout.begin(),
+                     layout.end(),
+                     [](auto const &left, auto const &right) {
+                         return left.first > right.first;
+                     });
+    for (auto [count, function] : layout) {
+        function->removeFromParent();
+        module.getFunctionList().push_back(function);
+    }
+}
+
+} // namespace fun::codegen
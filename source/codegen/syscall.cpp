@@ -0,0 +1,80 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+#include <string>
+#include <vector>
+
+#include <llvm/IR/InlineAsm.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/TargetParser/Triple.h>
+
+#include "codegen/syscall.hpp"
+
+namespace fun::codegen {
+
+namespace {
+
+/// marks a system call which the architecture does not have
+constexpr std::int64_t missing = -1;
+
+/// the numbers of each [Syscall](@ref Syscall), in the order declared
+constexpr std::int64_t x86_64_numbers[]  = {1, 231, 158, 257, 3};
+constexpr std::int64_t aarch64_numbers[] = {64, 94, missing, 56, 57};
+
+} // namespace
+
+llvm::Value *emit_syscall(Syscall call,
+                          llvm::ArrayRef<llvm::Value *> arguments,
+                          env::Context &ctx) {
+    // the system call number, the registers which hold it and the
+    // arguments, and the instruction which makes the call.
+    llvm::Triple triple{ctx.llvm_module().getTargetTriple()};
+    std::int64_t number  = missing;
+    char const *assembly = nullptr;
+    std::string registers;
+    std::vector<char const *> argument_registers;
+    switch (triple.getArch()) {
+    case llvm::Triple::x86_64:
+        number             = x86_64_numbers[static_cast<std::size_t>(call)];
+        assembly           = "syscall";
+        registers          = "={rax},{rax}";
+        argument_registers = {"{rdi}", "{rsi}", "{rdx}", "{r10}"};
+        break;
+    case llvm::Triple::aarch64:
+        number             = aarch64_numbers[static_cast<std::size_t>(call)];
+        assembly           = "svc #0";
+        registers          = "={x0},{x8}";
+        argument_registers = {"{x0}", "{x1}", "{x2}", "{x3}"};
+        break;
+    default: break;
+    }
+    if (number == missing) {
+        llvm::errs() << "error: the system call cannot be made on "
+                     << triple.str() << "\n";
+        return nullptr;
+    }
+
+    llvm::Type *i64 = ctx.llvm_Int64Ty();
+    std::vector<llvm::Value *> operands{ctx.llvm_Int64(number)};
+    for (std::size_t index = 0; index < arguments.size(); ++index) {
+        registers += ",";
+        registers += argument_registers[index];
+        operands.push_back(arguments[index]);
+    }
+    registers += triple.getArch() == llvm::Triple::x86_64
+                   ? ",~{rcx},~{r11},~{memory}"
+                   : ",~{memory}";
+
+    std::vector<llvm::Type *> types(operands.size(), i64);
+    auto *assembled = llvm::InlineAsm::get(
+        llvm::FunctionType::get(i64, types, false), assembly, registers, true);
+    return ctx.llvm_builder().CreateCall(assembled, operands);
+}
+
+} // namespace fun::codegen
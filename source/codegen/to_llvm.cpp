@@ -8,15 +8,38 @@
 // work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
 
 #include "codegen/to_llvm.hpp"
+#include "eval/fold.hpp"
+#include "IR/layout.hpp"
+#include "IR/structure.hpp"
+#include "pass/ranges.hpp"
 #include <llvm-20/llvm/IR/Constant.h>
 
+#include <array>
+#include <limits>
+#include <utility>
+
+#include <llvm/IR/Attributes.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Intrinsics.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/raw_ostream.h>
+
+using fun::IR::Instruction;
+using fun::IR::Operand;
 using fun::IR::Scalar;
 using fun::IR::Type;
+using fun::pass::Range;
 
 namespace fun::codegen {
 
 llvm::Type *to_llvm(Type::Ptr const &type, env::Context &ctx) {
-    switch (type->index()) {
+    return to_llvm(*type, ctx);
+}
+
+llvm::Type *to_llvm(Type const &type, env::Context &ctx) {
+    switch (type.index()) {
     case 0:  return ctx.llvm_Int1Ty();   // Type::Nil
     case 1:  return ctx.llvm_Int1Ty();   // Type::Bool
     case 2:  return ctx.llvm_Int8Ty();   // Type::u8
@@ -30,7 +53,7 @@ llvm::Type *to_llvm(Type::Ptr const &type, env::Context &ctx) {
     case 10: return ctx.llvm_FloatTy();  // Type::f32
     case 11: return ctx.llvm_DoubleTy(); // Type::f64
     case 12: {                           // Type::Function
-        Type::Function const &function = type->as<Type::Function>();
+        Type::Function const &function = type.as<Type::Function>();
         std::vector<llvm::Type *> arguments;
         for (Type::Function::Argument const &arg : function.arguments) {
             arguments.push_back(to_llvm(arg.type, ctx));
@@ -38,6 +61,31 @@ llvm::Type *to_llvm(Type::Ptr const &type, env::Context &ctx) {
         return llvm::FunctionType::get(
             to_llvm(function.return_type, ctx), arguments, false);
     }
+    case 14: { // Type::Struct
+        // the elements are in memory order, which LLVM pads as IR::layout
+        // does, as both align each type naturally.
+        Type::Struct const &record = type.as<Type::Struct>();
+        IR::Layout const layout    = IR::layout(record);
+        std::vector<llvm::Type *> elements;
+        for (std::size_t field : layout.order) {
+            elements.push_back(to_llvm(record.fields[field].type, ctx));
+        }
+        return llvm::StructType::get(ctx.llvm_context(),
+                                     elements,
+                                     record.order ==
+                                         Type::Struct::Order::Packed);
+    }
+    case 15: { // Type::Array
+        Type::Array const &array = type.as<Type::Array>();
+        return llvm::ArrayType::get(to_llvm(array.element, ctx),
+                                    array.length);
+    }
+    case 16: // Type::Slice
+        // a pointer to the first element, and the number of elements.
+        return llvm::StructType::get(
+            ctx.llvm_context(),
+            {llvm::PointerType::getUnqual(ctx.llvm_context()),
+             ctx.llvm_Int64Ty()});
     default: std::unreachable();
     }
 }
@@ -61,4 +109,1041 @@ llvm::Constant *to_llvm(Scalar const &scalar, env::Context &ctx) {
     }
 }
 
+namespace {
+
+/// attaches the attributes of @p effects to a function or a call
+template <class Callable>
+void annotate(Callable &callable, pass::Effects effects) {
+    switch (effects.memory) {
+    case pass::Memory::None:  callable.setDoesNotAccessMemory(); break;
+    case pass::Memory::Read:  callable.setOnlyReadsMemory(); break;
+    case pass::Memory::Write: break;
+    default:                  std::unreachable();
+    }
+    if (!effects.unwinds) { callable.setDoesNotThrow(); }
+    if (effects.terminates) {
+        callable.addFnAttr(llvm::Attribute::WillReturn);
+    }
+}
+
+/// the LLVM flags of @p flags
+llvm::FastMathFlags fast_math_flags(IR::FastMath flags) noexcept {
+    llvm::FastMathFlags result;
+    result.setAllowReassoc(IR::has(flags, IR::FastMath::Reassociate));
+    result.setAllowContract(IR::has(flags, IR::FastMath::Contract));
+    result.setNoNaNs(IR::has(flags, IR::FastMath::NoNaNs));
+    result.setNoInfs(IR::has(flags, IR::FastMath::NoInfs));
+    result.setAllowReciprocal(IR::has(flags, IR::FastMath::Reciprocal));
+    return result;
+}
+
+constexpr bool is_float(Type const &type) noexcept {
+    return type.is<Type::f32>() || type.is<Type::f64>();
+}
+
+constexpr bool is_signed(Type const &type) noexcept {
+    return type.is<Type::i8>() || type.is<Type::i16>() ||
+           type.is<Type::i32>() || type.is<Type::i64>();
+}
+
+/// the bits of the integer type with the index @p type, or zero
+constexpr unsigned width(std::uint64_t type) noexcept {
+    switch (type) {
+    case 2:
+    case 6:  return 8;
+    case 3:
+    case 7:  return 16;
+    case 4:
+    case 8:  return 32;
+    case 5:
+    case 9:  return 64;
+    default: return 0;
+    }
+}
+
+/// the values of a signed, or else an unsigned, integer of @p bits
+constexpr Range integers(unsigned bits, bool signed_) noexcept {
+    if (bits == 64) { return signed_ ? Range{} : Range{0, Range::above}; }
+    std::int64_t const half = std::int64_t{1} << (bits - 1);
+    return signed_ ? Range{-half, half - 1} : Range{0, 2 * half - 1};
+}
+
+/**
+ * @struct Wrapping
+ * @brief Whether integer arithmetic may wrap around, read as unsigned and
+ * as signed integers of its width.
+ */
+struct Wrapping {
+    bool unsigned_ = true;
+    bool signed_   = true;
+};
+
+/**
+ * @brief whether the arithmetic @p opcode on operands of the integer type
+ * with the index @p type, which lie in @p B and @p C, may wrap around.
+ *
+ * The ranges hold the operands as their type reads them. Read as the other
+ * signedness, an operand is the same only if it is not negative and below
+ * the greatest signed integer, and otherwise is unknown.
+ */
+Wrapping wrapping(Instruction::Opcode opcode,
+                  std::uint64_t type,
+                  Range B,
+                  Range C) noexcept {
+    unsigned const bits = width(type);
+    bool const signed_  = type >= 6;
+    Range const shared  = integers(bits, true).meet(integers(bits, false));
+    auto fits           = [&](bool as_signed) {
+        auto read = [&](Range range) {
+            if (as_signed == signed_ || range.within(shared.lo, shared.hi)) {
+                return range;
+            }
+            return Range{};
+        };
+        Range const limits = integers(bits, as_signed);
+        return pass::Ranges::apply(opcode, read(B), read(C))
+            .within(limits.lo, limits.hi);
+    };
+    return {!fits(false), !fits(true)};
+}
+
+/**
+ * @brief the predicate of the comparison @p opcode of operands whose type
+ * has the index @p type, which Scalar and Type number alike.
+ */
+llvm::CmpInst::Predicate predicate(Instruction::Opcode opcode,
+                                   std::uint64_t type) noexcept {
+    using llvm::CmpInst;
+    bool const fp      = type == 10 || type == 11;
+    bool const signed_ = type >= 6 && type <= 9;
+    // ordered, so that NaN compares false, except for ne, which is the
+    // negation of eq.
+    switch (opcode) {
+    case Instruction::Opcode::Eq:
+        return fp ? CmpInst::FCMP_OEQ : CmpInst::ICMP_EQ;
+    case Instruction::Opcode::Ne:
+        return fp ? CmpInst::FCMP_UNE : CmpInst::ICMP_NE;
+    case Instruction::Opcode::Lt:
+        return fp       ? CmpInst::FCMP_OLT
+               : signed_ ? CmpInst::ICMP_SLT
+                         : CmpInst::ICMP_ULT;
+    case Instruction::Opcode::Le:
+        return fp       ? CmpInst::FCMP_OLE
+               : signed_ ? CmpInst::ICMP_SLE
+                         : CmpInst::ICMP_ULE;
+    case Instruction::Opcode::Gt:
+        return fp       ? CmpInst::FCMP_OGT
+               : signed_ ? CmpInst::ICMP_SGT
+                         : CmpInst::ICMP_UGT;
+    case Instruction::Opcode::Ge:
+        return fp       ? CmpInst::FCMP_OGE
+               : signed_ ? CmpInst::ICMP_SGE
+                         : CmpInst::ICMP_UGE;
+    default: std::unreachable();
+    }
+}
+
+/**
+ * @brief the TBAA access tag of an element of @p type, or nullptr for
+ * types which have none.
+ *
+ * A slice may point into any array of its element type, which alias
+ * analysis cannot tell apart by their pointers alone; but elements of
+ * distinct types never overlap, so each scalar type is its own node under
+ * the root of fun. Unlike C, signed and unsigned integers do not alias
+ * either. A cell is its own alloca, which needs no tag.
+ */
+llvm::MDNode *tbaa(Type const &type, env::Context &ctx) {
+    static constexpr llvm::StringLiteral names[] = {"nil",
+                                                    "bool",
+                                                    "u8",
+                                                    "u16",
+                                                    "u32",
+                                                    "u64",
+                                                    "i8",
+                                                    "i16",
+                                                    "i32",
+                                                    "i64",
+                                                    "f32",
+                                                    "f64"};
+    if (type.index() >= std::size(names)) { return nullptr; }
+    llvm::MDBuilder metadata{ctx.llvm_context()};
+    llvm::MDNode *root = metadata.createTBAARoot("fun");
+    llvm::MDNode *scalar =
+        metadata.createTBAAScalarTypeNode(names[type.index()], root);
+    return metadata.createTBAAStructTagNode(scalar, scalar, 0);
+}
+
+llvm::StringRef llvm_name(IR::Label label) noexcept {
+    return llvm::StringRef{label.name.data(), label.name.size()};
+}
+
+/**
+ * @struct Frame
+ * @brief The state of lowering the body of one lambda.
+ */
+struct Frame {
+    IR::Lambda const &lambda;
+    env::Context &ctx;
+    /// the stack slot of each argument and local, by LocalHandle
+    std::vector<llvm::AllocaInst *> slots;
+    /// the LLVM block of each block of the body, by BlockHandle
+    std::vector<llvm::BasicBlock *> blocks;
+    /// the block which returns zero, once a branch needs it
+    llvm::BasicBlock *returns_zero = nullptr;
+    /// the block which traps, once a bounds or an overflow check needs it
+    llvm::BasicBlock *traps = nullptr;
+    /// the TBAA access tag of each scalar element type, once it is used
+    mutable std::array<llvm::MDNode *, 12> tags{};
+    /// what is known of the locals as the instruction being lowered runs,
+    /// or nothing in a block which is never reached
+    std::optional<pass::Ranges::State> facts;
+
+    /// tags @p access to an element of type @p type for alias analysis
+    template <class Access>
+    Access *tag(Access *access, Type const &type) const {
+        if (type.index() >= tags.size()) { return access; }
+        llvm::MDNode *&node = tags[type.index()];
+        if (node == nullptr) { node = tbaa(type, ctx); }
+        access->setMetadata(llvm::LLVMContext::MD_tbaa, node);
+        return access;
+    }
+
+    bool error(std::string_view message) const {
+        llvm::errs() << "error: in " << llvm_name(lambda.name()) << ": "
+                     << message << "\n";
+        return false;
+    }
+
+    /// whether @p operand is a local, or a field of one, which exists
+    bool is_cell(Operand operand) const {
+        if (operand.is<IR::LocalHandle>()) {
+            return operand.as<IR::LocalHandle>().index < slots.size();
+        }
+        return operand.is<IR::FieldHandle>() &&
+               lambda.has_field(operand.as<IR::FieldHandle>());
+    }
+
+    /// the address of the local, or the field of a local, @p operand
+    llvm::Value *address(Operand operand) const {
+        if (!operand.is<IR::LocalHandle>() &&
+            !operand.is<IR::FieldHandle>()) {
+            error("the destination of an instruction must be a local");
+            return nullptr;
+        }
+        if (!is_cell(operand)) {
+            error(operand.is<IR::LocalHandle>() ? "no such local"
+                                                : "no such field");
+            return nullptr;
+        }
+        if (operand.is<IR::LocalHandle>()) {
+            return slots[operand.as<IR::LocalHandle>().index];
+        }
+        // the field is declared in one place, and laid out in another.
+        IR::FieldHandle field = operand.as<IR::FieldHandle>();
+        Type const &type      = lambda.type_of(field.local);
+        IR::Layout const layout = IR::layout(type.as<Type::Struct>());
+        return ctx.llvm_builder().CreateStructGEP(
+            to_llvm(type, ctx),
+            slots[field.local.index],
+            static_cast<unsigned>(layout.position(field.field)));
+    }
+
+    /// the range of the source operand @p operand
+    Range range(Operand operand) const {
+        if (facts) { return facts->range(lambda, operand); }
+        if (operand.is<Scalar>()) { return Range::of(operand.as<Scalar>()); }
+        return {};
+    }
+
+    Type const *type_of(Operand operand) const {
+        if (operand.is<IR::FieldHandle>()) {
+            return &lambda.type_of(operand.as<IR::FieldHandle>());
+        }
+        std::uint64_t index = operand.as<IR::LocalHandle>().index;
+        return &lambda.type_of(IR::LocalHandle{index});
+    }
+
+    /// the type of a source operand, as the index of the Type
+    std::uint64_t type_index(Operand operand) const {
+        if (operand.is<Scalar>()) { return operand.as<Scalar>().index(); }
+        if (is_cell(operand)) { return type_of(operand)->index(); }
+        return 0;
+    }
+
+    /// the block control falls through to from the block @p index
+    llvm::BasicBlock *fallthrough(std::size_t index) {
+        if (index + 1 < blocks.size()) { return blocks[index + 1]; }
+        if (returns_zero == nullptr) {
+            llvm::Function *function = blocks[index]->getParent();
+            returns_zero =
+                llvm::BasicBlock::Create(ctx.llvm_context(), "", function);
+            llvm::IRBuilder<> builder{returns_zero};
+            builder.CreateRet(
+                llvm::Constant::getNullValue(function->getReturnType()));
+        }
+        return returns_zero;
+    }
+
+    llvm::Value *value(Operand operand) const {
+        if (operand.is<Scalar>()) {
+            return codegen::to_llvm(operand.as<Scalar>(), ctx);
+        }
+
+        if (operand.is<IR::Label>()) {
+            IR::Label label = operand.as<IR::Label>();
+            llvm::Function *callee =
+                ctx.llvm_module().getFunction(llvm_name(label));
+            if (callee == nullptr) {
+                error("use of undeclared lambda " + std::string{label.name});
+            }
+            return callee;
+        }
+
+        llvm::Value *source = address(operand);
+        if (source == nullptr) { return nullptr; }
+        return ctx.llvm_builder().CreateLoad(to_llvm(*type_of(operand), ctx),
+                                             source);
+    }
+
+    llvm::Value *compare(Instruction::Opcode opcode, Operand B, Operand C);
+
+    /// continues in a new block if @p holds, and traps otherwise
+    void trap_unless(llvm::Value *holds);
+
+    llvm::Value *integer(Instruction::Opcode opcode,
+                         Operand b,
+                         Operand c,
+                         llvm::Value *B,
+                         llvm::Value *C,
+                         Type const &type);
+
+    llvm::Value *divide(Instruction::Opcode opcode,
+                        Range left,
+                        Range right,
+                        llvm::Value *B,
+                        llvm::Value *C,
+                        bool signed_);
+
+    /**
+     * @brief the address of the element @p index of the array or slice
+     * @p sequence, and its type, checking the index if @p checked.
+     */
+    std::pair<llvm::Value *, Type const *>
+    element(Operand sequence, Operand index, bool checked);
+
+    bool access(Instruction const &instruction);
+
+    /// lowers the slice or length @p instruction, writing to @p destination
+    /// of type @p type
+    bool sequence(Instruction const &instruction,
+                  llvm::Value *destination,
+                  Type const &type);
+
+    bool branch(Instruction const &instruction, std::size_t index);
+
+    bool lower(Instruction const &instruction, std::size_t index);
+};
+
+llvm::Value *
+Frame::compare(Instruction::Opcode opcode, Operand B, Operand C) {
+    std::uint64_t const type = type_index(B);
+    if (type != type_index(C)) {
+        error("the operands of a comparison must have the same type");
+        return nullptr;
+    }
+    if (type >= 12) {
+        error("only scalars can be compared");
+        return nullptr;
+    }
+    llvm::Value *left  = value(B);
+    llvm::Value *right = value(C);
+    if (left == nullptr || right == nullptr) { return nullptr; }
+
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    llvm::CmpInst::Predicate const compared = predicate(opcode, type);
+    return llvm::CmpInst::isFPPredicate(compared)
+               ? builder.CreateFCmp(compared, left, right)
+               : builder.CreateICmp(compared, left, right);
+}
+
+void Frame::trap_unless(llvm::Value *holds) {
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    llvm::BasicBlock *current  = builder.GetInsertBlock();
+    llvm::Function *function   = current->getParent();
+    if (traps == nullptr) {
+        traps = llvm::BasicBlock::Create(ctx.llvm_context(), "", function);
+        llvm::IRBuilder<> trap{traps};
+        trap.CreateIntrinsic(llvm::Intrinsic::trap, {}, {});
+        trap.CreateUnreachable();
+    }
+    // the rest of the block follows it, before the next block.
+    llvm::BasicBlock *next = llvm::BasicBlock::Create(
+        ctx.llvm_context(), "", function, current->getNextNode());
+    builder.CreateCondBr(
+        holds,
+        next,
+        traps,
+        llvm::MDBuilder{ctx.llvm_context()}.createBranchWeights(
+            std::numeric_limits<std::uint32_t>::max() - 1, 1));
+    builder.SetInsertPoint(next);
+}
+
+std::pair<llvm::Value *, Type const *>
+Frame::element(Operand sequence, Operand index, bool checked) {
+    if (!is_cell(sequence) || (!type_of(sequence)->is<Type::Array>() &&
+                               !type_of(sequence)->is<Type::Slice>())) {
+        error("only an array or a slice has elements");
+        return {nullptr, nullptr};
+    }
+    std::uint64_t const index_type = type_index(index);
+    if (index_type < 2 || index_type > 9) {
+        error("the index of an element must be an integer");
+        return {nullptr, nullptr};
+    }
+    llvm::Value *position = value(index);
+    if (position == nullptr) { return {nullptr, nullptr}; }
+
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    // a negative index is widened to one far out of bounds.
+    position = builder.CreateIntCast(
+        position, ctx.llvm_Int64Ty(), index_type >= 6);
+    Type const &type = *type_of(sequence);
+    if (type.is<Type::Array>()) {
+        Type::Array const &array = type.as<Type::Array>();
+        llvm::Value *base        = address(sequence);
+        if (base == nullptr) { return {nullptr, nullptr}; }
+        if (checked) {
+            trap_unless(builder.CreateICmpULT(
+                position, ctx.llvm_Int64(array.length)));
+        }
+        llvm::Value *indices[] = {ctx.llvm_Int64(std::uint64_t{0}), position};
+        return {builder.CreateInBoundsGEP(to_llvm(type, ctx), base, indices),
+                array.element.get()};
+    }
+
+    Type::Slice const &slice = type.as<Type::Slice>();
+    llvm::Type *pair         = to_llvm(type, ctx);
+    llvm::Value *base        = address(sequence);
+    if (base == nullptr) { return {nullptr, nullptr}; }
+    if (checked) {
+        trap_unless(builder.CreateICmpULT(
+            position,
+            builder.CreateLoad(ctx.llvm_Int64Ty(),
+                               builder.CreateStructGEP(pair, base, 1))));
+    }
+    // a slice is only ever taken of an array, which lives in a frame, so
+    // its pointer is never null. Two slices may point into the same array,
+    // as may a slice and the array itself, so it is not noalias; the TBAA
+    // tags of the elements tell apart only those of distinct types.
+    llvm::LoadInst *first =
+        builder.CreateLoad(llvm::PointerType::getUnqual(ctx.llvm_context()),
+                           builder.CreateStructGEP(pair, base, 0));
+    first->setMetadata(llvm::LLVMContext::MD_nonnull,
+                       llvm::MDNode::get(ctx.llvm_context(), {}));
+    return {builder.CreateInBoundsGEP(
+                to_llvm(slice.element, ctx), first, position),
+            slice.element.get()};
+}
+
+bool Frame::access(Instruction const &instruction) {
+    using Opcode = Instruction::Opcode;
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    Opcode const opcode        = instruction.opcode();
+    if (instruction.format() != Instruction::Format::Ternary) {
+        return error("instruction is missing operands");
+    }
+
+    if (opcode == Opcode::Insert || opcode == Opcode::UncheckedInsert) {
+        auto [destination, type] = element(
+            instruction.A(), instruction.B(), opcode == Opcode::Insert);
+        if (destination == nullptr) { return false; }
+        if (type_index(instruction.C()) != type->index()) {
+            return error("an element must have the type of the elements");
+        }
+        llvm::Value *C = value(instruction.C());
+        if (C == nullptr) { return false; }
+        llvm::StoreInst *store = builder.CreateStore(C, destination);
+        if (type_of(instruction.A())->is<Type::Slice>()) { tag(store, *type); }
+        return true;
+    }
+
+    llvm::Value *destination = address(instruction.A());
+    if (destination == nullptr) { return false; }
+    auto [source, type] = element(
+        instruction.B(), instruction.C(), opcode == Opcode::Subscript);
+    if (source == nullptr) { return false; }
+    if (!IR::same_structure(*type_of(instruction.A()), *type)) {
+        return error("an element must have the type of the elements");
+    }
+    llvm::LoadInst *result = builder.CreateLoad(to_llvm(*type, ctx), source);
+    if (type_of(instruction.B())->is<Type::Slice>()) { tag(result, *type); }
+    builder.CreateStore(result, destination);
+    return true;
+}
+
+bool Frame::sequence(Instruction const &instruction,
+                     llvm::Value *destination,
+                     Type const &type) {
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    Operand const B            = instruction.B();
+    if (!is_cell(B) || (!type_of(B)->is<Type::Array>() &&
+                        !type_of(B)->is<Type::Slice>())) {
+        return error("only an array or a slice has elements");
+    }
+    Type const &source = *type_of(B);
+    bool const array   = source.is<Type::Array>();
+
+    if (instruction.opcode() == Instruction::Opcode::Length) {
+        if (!type.is<Type::u64>()) {
+            return error("the length of an array or a slice is a u64");
+        }
+        llvm::Value *length = nullptr;
+        if (array) {
+            length = ctx.llvm_Int64(source.as<Type::Array>().length);
+        } else {
+            llvm::Value *pair = value(B);
+            if (pair == nullptr) { return false; }
+            length = builder.CreateExtractValue(pair, 1);
+        }
+        builder.CreateStore(length, destination);
+        return true;
+    }
+
+    Type const &element = array ? *source.as<Type::Array>().element
+                                : *source.as<Type::Slice>().element;
+    if (!type.is<Type::Slice>() ||
+        !IR::same_structure(*type.as<Type::Slice>().element, element)) {
+        return error("a slice must have the element type of its source");
+    }
+    llvm::Value *result = nullptr;
+    if (array) {
+        // an array is laid out as its elements, so it begins with the
+        // first of them.
+        llvm::Value *first = address(B);
+        if (first == nullptr) { return false; }
+        result = builder.CreateInsertValue(
+            llvm::PoisonValue::get(to_llvm(type, ctx)), first, 0);
+        result = builder.CreateInsertValue(
+            result, ctx.llvm_Int64(source.as<Type::Array>().length), 1);
+    } else {
+        result = value(B);
+        if (result == nullptr) { return false; }
+    }
+    builder.CreateStore(result, destination);
+    return true;
+}
+
+/**
+ * @brief lowers the integer arithmetic @p opcode of @p B and @p C, the
+ * values of @p b and @p c, of the integer type @p type; neg ignores @p C.
+ *
+ * Whatever the ranges of the operands prove cannot wrap around is marked
+ * nuw or nsw, and is not checked even in a checked lambda.
+ */
+llvm::Value *Frame::integer(Instruction::Opcode opcode,
+                            Operand b,
+                            Operand c,
+                            llvm::Value *B,
+                            llvm::Value *C,
+                            Type const &type) {
+    using Opcode = Instruction::Opcode;
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    bool const signed_         = is_signed(type);
+    Range const left           = range(b);
+    Range const right          = range(c);
+    if (opcode == Opcode::Div || opcode == Opcode::Rem) {
+        return divide(opcode, left, right, B, C, signed_);
+    }
+    // neg is lowered as sub from zero.
+    if (opcode == Opcode::Neg) {
+        C = B;
+        B = llvm::Constant::getNullValue(B->getType());
+    }
+
+    Wrapping const wraps = wrapping(opcode, type.index(), left, right);
+    if (lambda.checked() && (signed_ ? wraps.signed_ : wraps.unsigned_)) {
+        using llvm::Intrinsic::ID;
+        ID const add = signed_ ? llvm::Intrinsic::sadd_with_overflow
+                               : llvm::Intrinsic::uadd_with_overflow;
+        ID const sub = signed_ ? llvm::Intrinsic::ssub_with_overflow
+                               : llvm::Intrinsic::usub_with_overflow;
+        ID const mul = signed_ ? llvm::Intrinsic::smul_with_overflow
+                               : llvm::Intrinsic::umul_with_overflow;
+        llvm::Value *pair = builder.CreateBinaryIntrinsic(
+            opcode == Opcode::Add   ? add
+            : opcode == Opcode::Mul ? mul
+                                    : sub,
+            B,
+            C);
+        llvm::Value *result = builder.CreateExtractValue(pair, 0);
+        trap_unless(builder.CreateNot(builder.CreateExtractValue(pair, 1)));
+        return result;
+    }
+
+    bool const nuw = !wraps.unsigned_;
+    bool const nsw = !wraps.signed_;
+    switch (opcode) {
+    case Opcode::Add: return builder.CreateAdd(B, C, "", nuw, nsw);
+    case Opcode::Mul: return builder.CreateMul(B, C, "", nuw, nsw);
+    default:          return builder.CreateSub(B, C, "", nuw, nsw);
+    }
+}
+
+/**
+ * @brief lowers the division or remainder @p opcode of @p B by @p C, which
+ * lie in @p left and @p right.
+ *
+ * Wide division is slow, so operands which fit a narrower integer are
+ * divided as one: as unsigned if neither is negative, and otherwise as
+ * signed, unless the least narrower integer may be divided by -1, which
+ * overflows it but not the wider integer.
+ *
+ * A checked lambda traps where the evaluator fails: on a divisor of zero,
+ * and on the least signed integer divided by -1, unless the ranges rule
+ * them out.
+ */
+llvm::Value *Frame::divide(Instruction::Opcode opcode,
+                           Range left,
+                           Range right,
+                           llvm::Value *B,
+                           llvm::Value *C,
+                           bool signed_) {
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    bool const quotient        = opcode == Instruction::Opcode::Div;
+    llvm::Type *type           = B->getType();
+    if (lambda.checked()) {
+        unsigned const bits = type->getIntegerBitWidth();
+        auto holds          = [](Range range, std::int64_t value) {
+            return range.lo <= value && value <= range.hi;
+        };
+        if (holds(right, 0)) {
+            trap_unless(
+                builder.CreateICmpNE(C, llvm::Constant::getNullValue(type)));
+        }
+        if (signed_ && left.lo <= integers(bits, true).lo &&
+            holds(right, -1)) {
+            llvm::Value *least = llvm::ConstantInt::get(
+                type, llvm::APInt::getSignedMinValue(bits));
+            trap_unless(builder.CreateOr(
+                builder.CreateICmpNE(B, least),
+                builder.CreateICmpNE(
+                    C, llvm::Constant::getAllOnesValue(type))));
+        }
+    }
+    for (unsigned bits : {8U, 16U, 32U}) {
+        if (bits >= type->getIntegerBitWidth()) { break; }
+        Range const as_unsigned = integers(bits, false);
+        Range const as_signed   = integers(bits, true);
+        bool const positive = left.within(0, as_unsigned.hi) &&
+                              right.within(0, as_unsigned.hi);
+        bool const small =
+            signed_ && left.within(as_signed.lo + 1, as_signed.hi) &&
+            right.within(as_signed.lo, as_signed.hi);
+        if (!positive && !small) { continue; }
+
+        llvm::Type *narrow = builder.getIntNTy(bits);
+        llvm::Value *b     = builder.CreateTrunc(B, narrow);
+        llvm::Value *c     = builder.CreateTrunc(C, narrow);
+        if (positive) {
+            return builder.CreateZExt(quotient ? builder.CreateUDiv(b, c)
+                                               : builder.CreateURem(b, c),
+                                      type);
+        }
+        return builder.CreateSExt(
+            quotient ? builder.CreateSDiv(b, c) : builder.CreateSRem(b, c),
+            type);
+    }
+    if (quotient) {
+        return signed_ ? builder.CreateSDiv(B, C) : builder.CreateUDiv(B, C);
+    }
+    return signed_ ? builder.CreateSRem(B, C) : builder.CreateURem(B, C);
+}
+
+bool Frame::branch(Instruction const &instruction, std::size_t index) {
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    if (!instruction.A().is<IR::BlockHandle>()) {
+        return error("the target of a branch must be a block");
+    }
+    std::uint64_t target = instruction.A().as<IR::BlockHandle>().index;
+    if (target >= lambda.body().size()) {
+        return error("branch to no such block");
+    }
+
+    if (instruction.opcode() == Instruction::Opcode::Jmp) {
+        builder.CreateBr(blocks[target]);
+        return true;
+    }
+
+    llvm::Value *condition = nullptr;
+    switch (instruction.opcode()) {
+    case Instruction::Opcode::Jz:
+    case Instruction::Opcode::Jnz: {
+        if (instruction.format() == Instruction::Format::Unary) {
+            return error("instruction is missing operands");
+        }
+        Scalar zero;
+        if (instruction.B().is<Scalar>()) {
+            zero = eval::zero_like(instruction.B().as<Scalar>());
+        } else if (is_cell(instruction.B()) &&
+                   type_index(instruction.B()) != 0) {
+            zero = eval::zero(*type_of(instruction.B()));
+        } else {
+            return error("the operand of a branch must be a value");
+        }
+        condition =
+            compare(instruction.opcode() == Instruction::Opcode::Jz
+                        ? Instruction::Opcode::Eq
+                        : Instruction::Opcode::Ne,
+                    instruction.B(),
+                    zero);
+        break;
+    }
+    default: {
+        if (instruction.format() != Instruction::Format::Ternary) {
+            return error("instruction is missing operands");
+        }
+        condition = compare(IR::comparison(instruction.opcode()),
+                            instruction.B(),
+                            instruction.C());
+        break;
+    }
+    }
+    if (condition == nullptr) { return false; }
+
+    llvm::BranchInst *br =
+        builder.CreateCondBr(condition, blocks[target], fallthrough(index));
+    if (auto const &weights = lambda.body()[index].weights()) {
+        br->setMetadata(
+            llvm::LLVMContext::MD_prof,
+            llvm::MDBuilder{ctx.llvm_context()}.createBranchWeights(
+                weights->taken, weights->fallthrough));
+    }
+    return true;
+}
+
+bool Frame::lower(Instruction const &instruction, std::size_t index) {
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+
+    if (IR::is_branch(instruction.opcode())) {
+        return branch(instruction, index);
+    }
+
+    if (instruction.opcode() == Instruction::Opcode::Ret) {
+        llvm::Value *result = value(instruction.A());
+        if (result == nullptr) { return false; }
+        builder.CreateRet(result);
+        return true;
+    }
+
+    if (IR::is_element_access(instruction.opcode())) {
+        return access(instruction);
+    }
+
+    llvm::Value *destination = address(instruction.A());
+    if (destination == nullptr) { return false; }
+    Type const &type = *type_of(instruction.A());
+
+    if (instruction.opcode() == Instruction::Opcode::Call) {
+        // call %result, @callee, %first; the arguments are held by
+        // consecutive locals, starting with %first.
+        if (!instruction.B().is<IR::Label>()) {
+            return error("the callee of a call must be a label");
+        }
+        auto *callee = llvm::cast_or_null<llvm::Function>(
+            value(instruction.B()));
+        if (callee == nullptr) { return false; }
+
+        std::vector<llvm::Value *> arguments;
+        if (instruction.format() == Instruction::Format::Ternary) {
+            if (!instruction.C().is<IR::LocalHandle>()) {
+                return error("the arguments of a call must be locals");
+            }
+            std::uint64_t first = instruction.C().as<IR::LocalHandle>().index;
+            for (std::uint64_t index = 0; index < callee->arg_size();
+                 ++index) {
+                llvm::Value *argument =
+                    value(IR::LocalHandle{first + index});
+                if (argument == nullptr) { return false; }
+                arguments.push_back(argument);
+            }
+        }
+        llvm::CallInst *call = builder.CreateCall(callee, arguments);
+        annotate(*call, effects(*callee));
+        builder.CreateStore(call, destination);
+        return true;
+    }
+
+    if (instruction.format() == Instruction::Format::Unary) {
+        return error("instruction is missing operands");
+    }
+
+    if (IR::is_comparison(instruction.opcode())) {
+        if (!type.is<Type::Bool>()) {
+            return error("the result of a comparison must be a bool");
+        }
+        if (instruction.format() != Instruction::Format::Ternary) {
+            return error("instruction is missing operands");
+        }
+        llvm::Value *result = compare(
+            instruction.opcode(), instruction.B(), instruction.C());
+        if (result == nullptr) { return false; }
+        builder.CreateStore(result, destination);
+        return true;
+    }
+
+    if (instruction.opcode() == Instruction::Opcode::Slice ||
+        instruction.opcode() == Instruction::Opcode::Length) {
+        return sequence(instruction, destination, type);
+    }
+
+    llvm::Value *B = value(instruction.B());
+    if (B == nullptr) { return false; }
+
+    llvm::Value *result = nullptr;
+    switch (instruction.opcode()) {
+    case Instruction::Opcode::Load: result = B; break;
+    case Instruction::Opcode::Neg:
+        if (type.index() >= 12) {
+            return error("only scalars can be negated");
+        }
+        if (is_float(type)) {
+            result = builder.CreateFNeg(B);
+        } else if (width(type.index()) != 0) {
+            result = integer(
+                Instruction::Opcode::Neg, instruction.B(), {}, B, B, type);
+        } else {
+            result = builder.CreateNeg(B);
+        }
+        break;
+    default: {
+        if (instruction.format() != Instruction::Format::Ternary) {
+            return error("instruction is missing operands");
+        }
+        llvm::Value *C = value(instruction.C());
+        if (C == nullptr) { return false; }
+
+        if (type.index() >= 12) {
+            return error("arithmetic is only defined on scalars");
+        }
+        bool const fp      = is_float(type);
+        bool const signed_ = is_signed(type);
+        if (!fp && width(type.index()) != 0) {
+            result = integer(instruction.opcode(),
+                             instruction.B(),
+                             instruction.C(),
+                             B,
+                             C,
+                             type);
+            break;
+        }
+        switch (instruction.opcode()) {
+        case Instruction::Opcode::Add:
+            result = fp ? builder.CreateFAdd(B, C) : builder.CreateAdd(B, C);
+            break;
+        case Instruction::Opcode::Sub:
+            result = fp ? builder.CreateFSub(B, C) : builder.CreateSub(B, C);
+            break;
+        case Instruction::Opcode::Mul:
+            result = fp ? builder.CreateFMul(B, C) : builder.CreateMul(B, C);
+            break;
+        case Instruction::Opcode::Div:
+            result = fp       ? builder.CreateFDiv(B, C)
+                     : signed_ ? builder.CreateSDiv(B, C)
+                               : builder.CreateUDiv(B, C);
+            break;
+        case Instruction::Opcode::Rem:
+            result = fp       ? builder.CreateFRem(B, C)
+                     : signed_ ? builder.CreateSRem(B, C)
+                               : builder.CreateURem(B, C);
+            break;
+        default: std::unreachable();
+        }
+    }
+    }
+
+    builder.CreateStore(result, destination);
+    return true;
+}
+
+llvm::FunctionType *signature(IR::Lambda const &lambda, env::Context &ctx) {
+    std::vector<llvm::Type *> arguments;
+    arguments.reserve(lambda.arguments().size());
+    for (IR::Lambda::Argument const &argument : lambda.arguments()) {
+        arguments.push_back(to_llvm(argument.type, ctx));
+    }
+    return llvm::FunctionType::get(
+        to_llvm(lambda.return_type(), ctx), arguments, false);
+}
+
+} // namespace
+
+void annotate(llvm::Function &function, pass::Effects effects) {
+    annotate<llvm::Function>(function, effects);
+}
+
+pass::Effects effects(llvm::Function const &function) {
+    pass::Memory memory = function.doesNotAccessMemory() ? pass::Memory::None
+                          : function.onlyReadsMemory()   ? pass::Memory::Read
+                                                         : pass::Memory::Write;
+    return {memory, !function.doesNotThrow(), function.willReturn()};
+}
+
+void forget_memory(llvm::Module &module) {
+    for (llvm::Function &function : module) {
+        if (!is_lambda(function)) { continue; }
+        function.removeFnAttr(llvm::Attribute::Memory);
+        for (llvm::Instruction &instruction : llvm::instructions(function)) {
+            if (auto *call = llvm::dyn_cast<llvm::CallBase>(&instruction)) {
+                call->removeFnAttr(llvm::Attribute::Memory);
+            }
+        }
+    }
+}
+
+llvm::Function *declare(IR::Lambda const &lambda, env::Context &ctx) {
+    llvm::FunctionType *type = signature(lambda, ctx);
+    llvm::Module &module     = ctx.llvm_module();
+    llvm::StringRef name     = llvm_name(lambda.name());
+
+    if (llvm::Function *function = module.getFunction(name)) {
+        if (function->getFunctionType() != type) {
+            llvm::errs() << "error: " << name
+                         << " redeclared with a different type\n";
+            return nullptr;
+        }
+        return function;
+    }
+
+    llvm::Function *function = llvm::Function::Create(
+        type, llvm::Function::ExternalLinkage, name, module);
+    for (std::size_t index = 0; index < lambda.arguments().size(); ++index) {
+        function->getArg(static_cast<unsigned>(index))
+            ->setName(llvm_name(lambda.arguments()[index].name));
+    }
+    return function;
+}
+
+llvm::Function *to_llvm(IR::Lambda const &lambda, env::Context &ctx) {
+    llvm::Function *function = declare(lambda, ctx);
+    if (function == nullptr) { return nullptr; }
+
+    Frame frame{lambda, ctx, {}, {}, nullptr, nullptr, {}, {}};
+    if (!function->empty()) {
+        frame.error("redefinition");
+        return nullptr;
+    }
+
+    llvm::IRBuilder<> &builder = ctx.llvm_builder();
+    llvm::BasicBlock *entry =
+        llvm::BasicBlock::Create(ctx.llvm_context(), "entry", function);
+    builder.SetInsertPoint(entry);
+    // every floating point instruction of the lambda gets its flags, until
+    // the guard restores those of the builder.
+    llvm::IRBuilderBase::FastMathFlagGuard guard{builder};
+    builder.setFastMathFlags(
+        fast_math_flags(lambda.fast_math().value_or(IR::FastMath::None)));
+
+    frame.slots.reserve(lambda.frame_size());
+    for (std::uint64_t index = 0; index < lambda.frame_size(); ++index) {
+        IR::LocalHandle handle{index};
+        Type const &type       = lambda.type_of(handle);
+        llvm::AllocaInst *slot = builder.CreateAlloca(to_llvm(type, ctx));
+        frame.slots.push_back(slot);
+
+        if (lambda.is_argument(handle)) {
+            builder.CreateStore(
+                function->getArg(static_cast<unsigned>(index)), slot);
+            continue;
+        }
+
+        IR::Local const &local = lambda.local(handle);
+        slot->setName(llvm_name(local.name_));
+        Scalar initializer = local.value_.as<Scalar>();
+        if (initializer.index() == type.index()) {
+            builder.CreateStore(to_llvm(initializer, ctx), slot);
+        }
+    }
+
+    std::vector<llvm::BasicBlock *> &blocks = frame.blocks;
+    blocks.reserve(lambda.body().size());
+    for (std::size_t index = 0; index < lambda.body().size(); ++index) {
+        blocks.push_back(
+            llvm::BasicBlock::Create(ctx.llvm_context(), "", function));
+    }
+    if (blocks.empty()) {
+        blocks.push_back(
+            llvm::BasicBlock::Create(ctx.llvm_context(), "", function));
+    }
+    builder.CreateBr(blocks.front());
+
+    // the ranges of the locals as each block begins, which each
+    // instruction of the block then narrows or widens as it is lowered.
+    pass::FunctionAnalyses analyses{lambda};
+    pass::Ranges const &ranges = analyses.get<pass::ValueRanges>();
+
+    for (std::size_t index = 0; index < blocks.size(); ++index) {
+        builder.SetInsertPoint(blocks[index]);
+        if (index < lambda.body().size()) {
+            frame.facts = ranges.entry(index);
+            for (Instruction const &instruction : lambda.body()[index]) {
+                if (!frame.lower(instruction, index)) {
+                    function->deleteBody();
+                    return nullptr;
+                }
+                if (frame.facts) {
+                    pass::Ranges::step(lambda, *frame.facts, instruction);
+                }
+                // anything after a return or a branch is unreachable; a
+                // bounds check continues in a block of its own.
+                if (builder.GetInsertBlock()->getTerminator() != nullptr) {
+                    break;
+                }
+            }
+        }
+
+        if (builder.GetInsertBlock()->getTerminator() != nullptr) {
+            continue;
+        }
+        // falling off the end of a block continues with the next, and
+        // falling off the end of the lambda returns zero.
+        if (index + 1 < blocks.size()) {
+            builder.CreateBr(blocks[index + 1]);
+        } else {
+            builder.CreateRet(
+                llvm::Constant::getNullValue(function->getReturnType()));
+        }
+    }
+
+    if (llvm::verifyFunction(*function, &llvm::errs())) {
+        frame.error("lowered to invalid LLVM IR");
+        function->deleteBody();
+        return nullptr;
+    }
+
+    annotate(*function, pass::Purity::infer(lambda, [&](IR::Label label) {
+        llvm::Function *callee =
+            ctx.llvm_module().getFunction(llvm_name(label));
+        return callee == nullptr ? pass::Purity::unknown : effects(*callee);
+    }));
+    return function;
+}
+
+bool to_llvm(IR::Module const &module, env::Context &ctx) {
+    bool success = true;
+    pass::Purity const purity{module};
+    for (IR::Lambda const &lambda : module) {
+        llvm::Function *function = declare(lambda, ctx);
+        if (function == nullptr) {
+            success = false;
+            continue;
+        }
+        annotate(*function, purity.find(lambda.name()));
+    }
+    for (IR::Lambda const &lambda : module) {
+        if (to_llvm(lambda, ctx) == nullptr) { success = false; }
+    }
+    return success;
+}
+
 } // namespace fun::codegen
@@ -0,0 +1,149 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <llvm/ExecutionEngine/JITEventListener.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/ExecutionEngine/SectionMemoryManager.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "codegen/entry.hpp"
+#include "codegen/to_llvm.hpp"
+#include "env/context.hpp"
+#include "exec/jit.hpp"
+#include "exec/perf.hpp"
+#include "pass/purity.hpp"
+
+namespace fun::exec {
+
+namespace {
+
+/**
+ * @brief @p root, and every lambda of @p module it may call, directly or
+ * not, with @p root first.
+ */
+std::vector<IR::Lambda const *> reachable(IR::Module const &module,
+                                          IR::Lambda const &root) {
+    std::vector<IR::Lambda const *> lambdas{&root};
+    std::unordered_set<std::string_view> seen{root.name().name};
+    for (std::size_t index = 0; index < lambdas.size(); ++index) {
+        for (IR::Block const &block : lambdas[index]->body()) {
+            for (IR::Instruction const &instruction : block) {
+                if (instruction.opcode() != IR::Instruction::Opcode::Call ||
+                    !instruction.B().is<IR::Label>()) {
+                    continue;
+                }
+                IR::Label callee = instruction.B().as<IR::Label>();
+                if (!seen.insert(callee.name).second) { continue; }
+                if (IR::Lambda const *lambda = module.find(callee)) {
+                    lambdas.push_back(lambda);
+                }
+            }
+        }
+    }
+    return lambdas;
+}
+
+} // namespace
+
+JitCompiler::JitCompiler(std::unique_ptr<PerfMapListener> perf_map,
+                         std::unique_ptr<llvm::orc::LLJIT> jit) noexcept
+    : perf_map_{std::move(perf_map)}, jit_{std::move(jit)} {}
+
+JitCompiler::~JitCompiler() = default;
+
+std::unique_ptr<JitCompiler> JitCompiler::create(bool perf) {
+    llvm::orc::LLJITBuilder builder;
+    std::unique_ptr<PerfMapListener> perf_map;
+    if (perf) {
+        perf_map = PerfMapListener::create();
+        if (perf_map == nullptr) { return nullptr; }
+
+        // JIT event listeners are only notified by the RuntimeDyld linker.
+        // the jitdump listener is null unless LLVM was built with perf.
+        llvm::JITEventListener *jitdump =
+            llvm::JITEventListener::createPerfJITEventListener();
+        if (jitdump == nullptr) {
+            llvm::errs() << "warning: LLVM was built without perf support, "
+                            "no jitdump file is written\n";
+        }
+        builder.setObjectLinkingLayerCreator(
+            [listener = perf_map.get(), jitdump](
+                llvm::orc::ExecutionSession &session, llvm::Triple const &) {
+                auto layer = std::make_unique<
+                    llvm::orc::RTDyldObjectLinkingLayer>(
+                    session, [](llvm::MemoryBuffer const &) {
+                        return std::make_unique<llvm::SectionMemoryManager>();
+                    });
+                layer->registerJITEventListener(*listener);
+                if (jitdump != nullptr) {
+                    layer->registerJITEventListener(*jitdump);
+                }
+                return std::unique_ptr<llvm::orc::ObjectLayer>{
+                    std::move(layer)};
+            });
+    }
+
+    auto jit = builder.create();
+    if (!jit) {
+        llvm::errs() << "error: " << llvm::toString(jit.takeError()) << "\n";
+        return nullptr;
+    }
+    return std::unique_ptr<JitCompiler>{
+        new JitCompiler{std::move(perf_map), std::move(*jit)}};
+}
+
+Native JitCompiler::compile(IR::Module const &module,
+                            IR::Lambda const &lambda) {
+    std::string name{native_prefix};
+    name += lambda.name().name;
+    env::Context ctx{name};
+    ctx.llvm_module().setDataLayout(jit_->getDataLayout());
+
+    std::vector<IR::Lambda const *> lambdas = reachable(module, lambda);
+    pass::Purity const purity{lambdas};
+    for (IR::Lambda const *callee : lambdas) {
+        llvm::Function *function = codegen::declare(*callee, ctx);
+        if (function == nullptr) { return nullptr; }
+        codegen::annotate(*function, purity.find(callee->name()));
+    }
+    llvm::Function *root = nullptr;
+    for (IR::Lambda const *callee : lambdas) {
+        llvm::Function *function = codegen::to_llvm(*callee, ctx);
+        if (function == nullptr) { return nullptr; }
+        function->setLinkage(llvm::Function::InternalLinkage);
+        if (root == nullptr) { root = function; }
+    }
+
+    codegen::emit_adapter(root, name, ctx);
+    ctx.optimize(llvm::OptimizationLevel::O2);
+
+    auto [context, ir] = ctx.release();
+    llvm::orc::ThreadSafeModule unit{std::move(ir), std::move(context)};
+    if (llvm::Error error = jit_->addIRModule(std::move(unit))) {
+        llvm::errs() << "error: " << llvm::toString(std::move(error)) << "\n";
+        return nullptr;
+    }
+
+    // looking the adapter up compiles the module, on this thread.
+    auto address = jit_->lookup(name);
+    if (!address) {
+        llvm::errs() << "error: " << llvm::toString(address.takeError())
+                     << "\n";
+        return nullptr;
+    }
+    return address->toPtr<Native>();
+}
+
+} // namespace fun::exec
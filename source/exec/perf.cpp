@@ -0,0 +1,83 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+#include <string>
+
+#include <unistd.h>
+
+#include <llvm/Object/SymbolSize.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Format.h>
+
+#include "exec/perf.hpp"
+
+namespace fun::exec {
+
+PerfMapListener::PerfMapListener(std::unique_ptr<llvm::raw_fd_ostream> out)
+    : out_{std::move(out)} {}
+
+std::unique_ptr<PerfMapListener> PerfMapListener::create() {
+    std::string const path = "/tmp/perf-" + std::to_string(::getpid()) + ".map";
+    std::error_code error;
+    auto out = std::make_unique<llvm::raw_fd_ostream>(
+        path, error, llvm::sys::fs::OF_Append | llvm::sys::fs::OF_Text);
+    if (error) {
+        llvm::errs() << path << ": " << error.message() << "\n";
+        return nullptr;
+    }
+    return std::unique_ptr<PerfMapListener>{
+        new PerfMapListener{std::move(out)}};
+}
+
+void PerfMapListener::notifyObjectLoaded(
+    ObjectKey,
+    llvm::object::ObjectFile const &object,
+    llvm::RuntimeDyld::LoadedObjectInfo const &loaded) {
+    // the debug object has the addresses the code was loaded at.
+    llvm::object::OwningBinary<llvm::object::ObjectFile> owner =
+        loaded.getObjectForDebug(object);
+    llvm::object::ObjectFile const *relocated = owner.getBinary();
+    if (relocated == nullptr) { return; }
+
+    std::lock_guard lock{mutex_};
+    for (auto const &[symbol, size] :
+         llvm::object::computeSymbolSizes(*relocated)) {
+        auto type = symbol.getType();
+        if (!type) {
+            llvm::consumeError(type.takeError());
+            continue;
+        }
+        if (*type != llvm::object::SymbolRef::ST_Function || size == 0) {
+            continue;
+        }
+        auto name    = symbol.getName();
+        auto address = symbol.getAddress();
+        if (!name || !address) {
+            llvm::consumeError(name.takeError());
+            llvm::consumeError(address.takeError());
+            continue;
+        }
+
+        // an object can be notified again, and an alias shares the
+        // address of what it names.
+        if (!mapped_.insert(*address).second) { continue; }
+
+        // each module has copies of the lambdas it calls, which are
+        // numbered so that no two entries name the same symbol.
+        std::string label = name->str();
+        unsigned const copy = ++copies_[label];
+        if (copy > 1) { label += "#" + std::to_string(copy); }
+        *out_ << llvm::format_hex_no_prefix(*address, 1) << " "
+              << llvm::format_hex_no_prefix(size, 1) << " " << label << "\n";
+    }
+    out_->flush();
+}
+
+} // namespace fun::exec
@@ -0,0 +1,156 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <lld/Common/Driver.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "link/link.hpp"
+
+LLD_HAS_DRIVER(elf)
+
+namespace fun::link {
+
+namespace {
+
+/**
+ * @class MemoryFile
+ * @brief An anonymous file which lives in memory, and which other code can
+ * open by name, through /proc/<pid>/fd, even from a child process.
+ */
+class MemoryFile {
+    int fd_ = -1;
+
+public:
+    MemoryFile() noexcept = default;
+    MemoryFile(MemoryFile const &) = delete;
+    MemoryFile &operator=(MemoryFile const &) = delete;
+    MemoryFile(MemoryFile &&other) noexcept : fd_{other.fd_} {
+        other.fd_ = -1;
+    }
+    MemoryFile &operator=(MemoryFile &&) = delete;
+
+    ~MemoryFile() {
+        if (fd_ >= 0) { ::close(fd_); }
+    }
+
+    bool write(llvm::StringRef contents) {
+        fd_ = ::memfd_create("fun.o", MFD_CLOEXEC);
+        if (fd_ < 0) { return false; }
+        char const *cursor = contents.data();
+        std::size_t left   = contents.size();
+        while (left != 0) {
+            ssize_t count = ::write(fd_, cursor, left);
+            if (count < 0) {
+                if (errno == EINTR) { continue; }
+                return false;
+            }
+            cursor += count;
+            left   -= static_cast<std::size_t>(count);
+        }
+        return true;
+    }
+
+    std::string path() const {
+        return "/proc/" + std::to_string(::getpid()) + "/fd/" +
+               std::to_string(fd_);
+    }
+};
+
+/// runs ld.lld, as found on the PATH, in a child process
+bool spawn_lld(std::vector<char const *> const &arguments) {
+    llvm::ErrorOr<std::string> program =
+        llvm::sys::findProgramByName("ld.lld");
+    if (!program) {
+        llvm::errs() << "error: lld cannot run again in this process, and "
+                        "ld.lld cannot be found: "
+                     << program.getError().message() << "\n";
+        return false;
+    }
+    std::vector<llvm::StringRef> const argv(arguments.begin(),
+                                            arguments.end());
+    std::string message;
+    int const code = llvm::sys::ExecuteAndWait(
+        *program, argv, std::nullopt, {}, 0, 0, &message);
+    if (code < 0) {
+        llvm::errs() << "error: " << *program << " failed: " << message << "\n";
+    }
+    return code == 0;
+}
+
+/**
+ * @brief runs lld with @p arguments, then each of @p objects, which are held
+ * in memory.
+ *
+ * lld's driver keeps its state in globals, so only one link may run in the
+ * process at a time, whichever thread asks for it. Once lld reports that
+ * it cannot run again, as after it recovered from a crash, every later
+ * link runs ld.lld in a child process instead.
+ */
+bool run_lld(std::span<llvm::StringRef const> objects,
+             std::vector<char const *> arguments) {
+    std::vector<MemoryFile> files(objects.size());
+    std::vector<std::string> paths;
+    paths.reserve(objects.size());
+    for (std::size_t index = 0; index < objects.size(); ++index) {
+        if (!files[index].write(objects[index])) {
+            llvm::errs() << "error: cannot hold an object file in memory: "
+                         << std::strerror(errno) << "\n";
+            return false;
+        }
+        paths.push_back(files[index].path());
+    }
+    for (std::string const &path : paths) {
+        arguments.push_back(path.c_str());
+    }
+
+    static std::mutex lld_mutex;
+    static bool in_process = true;
+    std::lock_guard const lock{lld_mutex};
+    if (!in_process) { return spawn_lld(arguments); }
+
+    lld::Result result = lld::lldMain(
+        arguments, llvm::outs(), llvm::errs(), {{lld::Gnu, &lld::elf::link}});
+    in_process = result.canRunAgain;
+    return result.retCode == 0;
+}
+
+} // namespace
+
+bool link_executable(std::span<llvm::StringRef const> objects,
+                     fs::path const &output,
+                     bool fold) {
+    std::string const destination = output.string();
+    std::vector<char const *> arguments{
+        "ld.lld", "-static", "-e", "_start", "-o", destination.c_str()};
+    if (fold) {
+        arguments.push_back("--icf=safe");
+        arguments.push_back("--gc-sections");
+    }
+    return run_lld(objects, std::move(arguments));
+}
+
+bool link_object(std::span<llvm::StringRef const> objects,
+                 fs::path const &output) {
+    std::string const destination = output.string();
+    return run_lld(objects, {"ld.lld", "-r", "-o", destination.c_str()});
+}
+
+} // namespace fun::link
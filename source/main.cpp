@@ -12,19 +12,821 @@
  * @brief defines the entry point for the program.
  */
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
 
-#include "IR/scalar.hpp"
+#include "codegen/entry.hpp"
+#include "codegen/instrument.hpp"
+#include "codegen/multiversion.hpp"
+#include "codegen/pgo.hpp"
+#include "codegen/to_llvm.hpp"
 #include "config/config.hpp"
+#include "env/context.hpp"
+#include "exec/engine.hpp"
+#include "exec/jit.hpp"
+#include "link/link.hpp"
+#include "pass/bounds_checks.hpp"
+#include "pass/evaluate_constants.hpp"
+#include "pass/merge_lambdas.hpp"
+#include "pass/monomorphize.hpp"
+#include "pass/pass_manager.hpp"
+#include "pass/place_blocks.hpp"
+#include "query/compile.hpp"
+#include "query/watch.hpp"
+#include "scan/parse.hpp"
+#include "support/task_graph.hpp"
+#include "support/thread_pool.hpp"
+
+namespace cl = llvm::cl;
+
+static cl::list<std::string> inputs{
+    cl::Positional,
+    cl::desc("<input files, or - for stdin>"),
+    cl::ZeroOrMore};
+
+static cl::opt<std::string> output{
+    "o",
+    cl::desc("write an executable to <file>, rather than LLVM IR to stdout. "
+             "Given several inputs, <file> is the directory each is built "
+             "into, by the name of its input without the extension"),
+    cl::value_desc("file")};
+
+static cl::opt<unsigned> jobs{
+    "j",
+    cl::desc("build several inputs on <n> threads, rather than on one for "
+             "each core"),
+    cl::value_desc("n"),
+    cl::Prefix,
+    cl::init(0)};
+
+static cl::opt<unsigned> codegen_parts{
+    "codegen-parts",
+    cl::desc("split each optimized module into up to <n> parts of lambdas "
+             "which call each other, and emit them on as many threads, "
+             "linking the objects afterwards. The threads count against "
+             "-j, as the clones of the module do against --memory-budget"),
+    cl::value_desc("n"),
+    cl::init(1)};
+
+static cl::opt<std::uint64_t> memory_budget{
+    "memory-budget",
+    cl::desc("start building another input only while the inputs being "
+             "built are estimated to use less than <MiB>, rather than half "
+             "the physical memory"),
+    cl::value_desc("MiB"),
+    cl::init(0)};
+
+static cl::opt<bool> object_only{
+    "c", cl::desc("write an object file to the -o file, rather than linking")};
+
+static cl::opt<std::string> optimization{
+    "O",
+    cl::desc("optimization level, from 0 to 3, or s or z to optimize for "
+             "size, which also folds identical lambdas"),
+    cl::value_desc("level"),
+    cl::Prefix,
+    cl::init("0")};
+
+static cl::opt<std::string> profile_generate{
+    "profile-generate",
+    cl::desc("count the blocks each run executes, and append them to "
+             "<file> as the program exits"),
+    cl::value_desc("file")};
+
+static cl::opt<std::string> profile_use{
+    "profile-use",
+    cl::desc("optimize for the counts of every run in <file>, written by "
+             "a program built with --profile-generate"),
+    cl::value_desc("file")};
+
+static cl::opt<bool> fast_math{
+    "fast-math",
+    cl::desc("let the floating point arithmetic of every lambda which is "
+             "not annotated strict or fast reassociate, contract, assume "
+             "no NaNs or infinities, and divide by multiplying by the "
+             "reciprocal")};
+
+static cl::opt<bool> checked_arithmetic{
+    "checked-arithmetic",
+    cl::desc("trap on integer arithmetic which overflows its type in every "
+             "lambda, as if each were annotated checked, unless the ranges "
+             "of its operands prove it cannot")};
+
+static cl::opt<bool> instrument{
+    "instrument",
+    cl::desc("count the calls to and the cycles spent in each lambda, and "
+             "write a flat profile to stderr when the program exits")};
+
+static cl::opt<std::string> cpu{
+    "cpu",
+    cl::desc("generate code for any machine with <cpu>, such as x86-64, "
+             "rather than for this one"),
+    cl::value_desc("cpu")};
+
+static cl::list<std::string> target_clones{
+    "target-clones",
+    cl::desc("also compile each of <lambdas> for the x86-64 levels of "
+             "--clone-for, and call the best the machine supports"),
+    cl::value_desc("lambdas"),
+    cl::CommaSeparated};
+
+static cl::list<std::string> clone_for{
+    "clone-for",
+    cl::desc("the levels --target-clones compiles for: x86-64-v2, "
+             "x86-64-v3 and x86-64-v4, which are all cloned for by default"),
+    cl::value_desc("levels"),
+    cl::CommaSeparated};
+
+static cl::opt<bool> run{
+    "run",
+    cl::desc("run the entry lambda, interpreting lambdas until they are hot "
+             "enough to compile")};
+
+static cl::opt<unsigned> jit_threshold{
+    "jit-threshold",
+    cl::desc("the calls after which --run compiles a lambda"),
+    cl::init(1000)};
+
+static cl::opt<bool> perf{
+    "perf",
+    cl::desc("with --run, describe compiled lambdas to perf, in "
+             "/tmp/perf-<pid>.map and a jitdump file")};
+
+static cl::opt<std::string> watch{
+    "watch",
+    cl::desc("build each .fun file of <dir> into an executable, then stay "
+             "resident and rebuild those which change, recompiling only "
+             "the lambdas which did. Executables are written to the -o "
+             "directory, or beside their sources"),
+    cl::value_desc("dir")};
+
+static cl::opt<std::string> entry{
+    "entry",
+    cl::desc("the lambda an executable, or --run, starts by calling"),
+    cl::value_desc("lambda"),
+    cl::init("main")};
+
+/**
+ * @brief the level of -O, where any number above 3 is 3
+ *
+ * @return std::nullopt if -O is neither a number, s nor z
+ */
+static std::optional<llvm::OptimizationLevel> optimization_level() {
+    std::string const &level = optimization.getValue();
+    if (level == "s") { return llvm::OptimizationLevel::Os; }
+    if (level == "z") { return llvm::OptimizationLevel::Oz; }
+    if (level.empty() || !std::ranges::all_of(level, [](char c) {
+            return c >= '0' && c <= '9';
+        })) {
+        return std::nullopt;
+    }
+    if (level.find_first_not_of('0') == std::string::npos) {
+        return llvm::OptimizationLevel::O0;
+    }
+    if (level == "1") { return llvm::OptimizationLevel::O1; }
+    if (level == "2") { return llvm::OptimizationLevel::O2; }
+    return llvm::OptimizationLevel::O3;
+}
+
+/// whether -Os or -Oz was given
+static bool optimize_for_size() {
+    std::optional<llvm::OptimizationLevel> level = optimization_level();
+    return level && level->getSizeLevel() > 0;
+}
+
+/**
+ * @brief gives @p lambda the fast math flags of --fast-math, unless it was
+ * annotated with its own mode, and makes it checked if
+ * --checked-arithmetic is given.
+ */
+static void default_fast_math(fun::IR::Lambda &lambda) {
+    if (fast_math && !lambda.fast_math()) {
+        lambda.fast_math(fun::IR::FastMath::All);
+    }
+    if (checked_arithmetic) { lambda.checked(true); }
+}
+
+/// the instances of generic lambdas, shared by every input of the build
+static fun::pass::SpecializationCache specializations;
+
+/// a Monomorphize which names instances with the strings of @p ctx
+static fun::pass::Monomorphize monomorphizer(fun::env::Context &ctx) {
+    return fun::pass::Monomorphize{
+        [&ctx](std::string_view name) { return ctx.intern_string(name); },
+        &specializations};
+}
+
+/**
+ * @brief gives the calls of generic lambdas in @p module their instances,
+ * as the first of the passes
+ *
+ * @return false, having printed why, if any could not be instantiated
+ */
+static bool monomorphize(fun::pass::Monomorphize &monomorphize,
+                         fun::IR::Module &module) {
+    fun::pass::AnalysisManager analyses;
+    monomorphize.run(module, analyses);
+    for (std::string const &error : monomorphize.errors()) {
+        std::cerr << "error: " << error << "\n";
+    }
+    return monomorphize.errors().empty();
+}
+
+/**
+ * @brief runs the passes over the module of @p ctx, as it was parsed
+ *
+ * @return false, having printed why, if the module cannot be compiled
+ */
+static bool run_passes(fun::env::Context &ctx) {
+    fun::pass::Monomorphize instances = monomorphizer(ctx);
+    if (!monomorphize(instances, ctx.ir())) { return false; }
+    for (fun::IR::Lambda &lambda : ctx.ir()) { default_fast_math(lambda); }
+
+    fun::pass::PassManager passes;
+    fun::pass::AnalysisManager analyses;
+    passes.add<fun::pass::EvaluateConstants>();
+    // folding lambdas needs the whole module, so a stream is not folded.
+    if (optimize_for_size()) { passes.add<fun::pass::MergeLambdas>(); }
+    passes.add<fun::pass::EliminateBoundsChecks>();
+    passes.add<fun::pass::PlaceBlocks>();
+    passes.run(ctx.ir(), analyses);
+    return true;
+}
+
+static bool compile_file(fs::path const &path, fun::env::Context &ctx) {
+    if (!fun::scan::parse(path, ctx) || !run_passes(ctx)) { return false; }
+    return fun::codegen::to_llvm(ctx.ir(), ctx);
+}
+
+/**
+ * @brief the profile of --profile-use, read once for every module it is
+ * applied to
+ *
+ * @return nullptr if it cannot be read, which is printed the first time
+ */
+static fun::codegen::Profile const *used_profile() {
+    static std::optional<fun::codegen::Profile> const profile =
+        fun::codegen::read_profile(profile_use.getValue());
+    return profile ? &*profile : nullptr;
+}
+
+/**
+ * @brief applies the profile, instrumentation, target clone and
+ * optimization options to the module of @p ctx, as it was lowered.
+ */
+static bool prepare(fun::env::Context &ctx) {
+    if (!profile_use.empty()) {
+        fun::codegen::Profile const *profile = used_profile();
+        if (profile == nullptr) { return false; }
+        fun::codegen::use_profile(*profile, ctx);
+    }
+    if (!profile_generate.empty() &&
+        !fun::codegen::generate_profile(profile_generate, ctx)) {
+        return false;
+    }
+    if (instrument && !fun::codegen::instrument(ctx)) { return false; }
+    if (!target_clones.empty() &&
+        !fun::codegen::multiversion(target_clones, clone_for, ctx)) {
+        return false;
+    }
+
+    llvm::OptimizationLevel const level = *optimization_level();
+    if (level != llvm::OptimizationLevel::O0) { ctx.optimize(level); }
+    return true;
+}
+
+/// the threads -j allows, or one for each core
+static unsigned threads() {
+    return jobs != 0 ? jobs.getValue()
+                     : fun::support::ThreadPool::default_size();
+}
+
+/// the --codegen-parts a module is emitted in, no more than -j allows
+static unsigned parts() {
+    return std::clamp(codegen_parts.getValue(), 1U, threads());
+}
+
+/// object files, held in memory
+using Objects = std::vector<llvm::SmallVector<char, 0>>;
+
+/**
+ * @brief emits the module of @p ctx into @p objects, one for each of the
+ * --codegen-parts it is split into, with the entry point an executable
+ * starts from, unless -c was given.
+ */
+static bool emit(fun::env::Context &ctx, Objects &objects) {
+    if (!object_only &&
+        fun::codegen::emit_entry(ctx.intern_string(entry), ctx) == nullptr) {
+        return false;
+    }
+    return ctx.emit_objects(parts(), objects);
+}
+
+/**
+ * @brief writes @p objects to @p destination, as one object file with -c,
+ * or else as a linked executable. Object files are only ever held in
+ * memory on their way to the linker.
+ */
+static bool write(Objects const &objects, std::string const &destination) {
+    std::vector<llvm::StringRef> files;
+    for (llvm::SmallVector<char, 0> const &object : objects) {
+        files.emplace_back(object.data(), object.size());
+    }
+
+    if (object_only && files.size() > 1) {
+        return fun::link::link_object(files, destination);
+    }
+    if (object_only) {
+        llvm::StringRef const object = files.front();
+        std::error_code error;
+        llvm::raw_fd_ostream out{destination, error, llvm::sys::fs::OF_None};
+        if (error) {
+            llvm::errs() << destination << ": " << error.message() << "\n";
+            return false;
+        }
+        out.write(object.data(), object.size());
+        return true;
+    }
+
+    return fun::link::link_executable(
+        files, destination, optimize_for_size());
+}
+
+/// the lambdas a stream lowers into one module before emitting it
+constexpr std::uint64_t stream_batch = 64;
+
+/// lambdas without bodies, by name, for the modules which call them
+using Declarations = std::unordered_map<std::string_view, fun::IR::Lambda>;
+
+/// @p lambda, without its body
+static fun::IR::Lambda declaration(fun::IR::Lambda const &lambda) {
+    fun::IR::Lambda::Arguments arguments;
+    for (fun::IR::Lambda::Argument const &argument : lambda.arguments()) {
+        arguments.emplace_back(argument.name, argument.type->clone());
+    }
+    return {lambda.name(), lambda.return_type()->clone(), std::move(arguments)};
+}
+
+/// the lambdas which @p definition calls by name, in the order of the calls
+static std::vector<fun::IR::Label>
+callees(fun::IR::Module const &definition) {
+    std::vector<fun::IR::Label> names;
+    for (fun::IR::Lambda const &lambda : definition) {
+        for (fun::IR::Block const &block : lambda.body()) {
+            for (fun::IR::Instruction const &instruction : block) {
+                if (instruction.opcode() ==
+                        fun::IR::Instruction::Opcode::Call &&
+                    instruction.B().is<fun::IR::Label>()) {
+                    names.push_back(instruction.B().as<fun::IR::Label>());
+                }
+            }
+        }
+    }
+    return names;
+}
+
+/// the first lambda which @p definition calls, but which is not declared
+static std::optional<fun::IR::Label>
+undeclared_callee(fun::IR::Module const &definition,
+                  Declarations const &declarations) {
+    for (fun::IR::Label callee : callees(definition)) {
+        if (!declarations.contains(callee.name)) { return callee; }
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief prepares @p batch, a module of the lambdas of a stream, and
+ * emits it into @p objects, or prints it if there is no -o.
+ *
+ * @param[out] entered set once the entry point of an executable has been
+ * emitted, which it is along with the entry lambda
+ */
+static bool
+emit_batch(fun::env::Context &batch, Objects &objects, bool &entered) {
+    llvm::Function const *defined =
+        batch.llvm_module().getFunction(entry.getValue());
+    if (!output.empty() && !object_only && defined != nullptr &&
+        !defined->isDeclaration()) {
+        if (fun::codegen::emit_entry(batch.intern_string(entry), batch) ==
+            nullptr) {
+            return false;
+        }
+        entered = true;
+    }
+    if (!prepare(batch)) { return false; }
+    if (output.empty()) {
+        batch.llvm_module().print(llvm::outs(), nullptr);
+        return true;
+    }
+    return batch.emit_object(objects.emplace_back());
+}
+
+/**
+ * @brief compiles a pipe, or anything else which cannot be mapped into
+ * memory in one piece, one definition at a time, into @p objects, or
+ * prints it if there is no -o.
+ *
+ * A generic lambda is kept until the end, and the instances which each
+ * definition calls are compiled along with it, so a generic lambda must be
+ * defined before it is called. Every other lambda is declared as soon as
+ * it is read, in @p ctx, and lowered once each lambda it calls has been
+ * declared, so only definitions which call ahead are held, as IR, until
+ * their callees arrive; a callee which never does is diagnosed once the
+ * stream ends.
+ *
+ * Lambdas are lowered into a module of their own, which is optimized and
+ * emitted as soon as it holds [stream_batch](@ref stream_batch) of them,
+ * and then released. Only the declarations, the definitions which wait,
+ * and the objects, on their way to the linker, grow with the stream. So
+ * lambdas are only inlined into others of their batch, and each
+ * definition only has the calls evaluated at compile time which stay
+ * within it and its instances, as the bodies of the others are gone.
+ */
+static bool compile_stream(int fd,
+                           std::string_view filename,
+                           fun::env::TargetKey const &key,
+                           fun::env::Context &ctx,
+                           Objects &objects) {
+    fun::pass::EvaluateConstants constants;
+    fun::pass::EliminateBoundsChecks bounds_checks;
+    fun::pass::PlaceBlocks place;
+    fun::pass::Monomorphize instances = monomorphizer(ctx);
+    Declarations declarations;
+    std::vector<fun::IR::Module> waiting;
+    std::unique_ptr<fun::env::Context> batch;
+    std::uint64_t batched = 0;
+    bool entered          = false;
+
+    auto flush = [&] {
+        std::unique_ptr<fun::env::Context> emitted = std::move(batch);
+        batched                                    = 0;
+        return emit_batch(*emitted, objects, entered);
+    };
+
+    auto lower = [&](fun::IR::Module const &definition) {
+        if (!batch) {
+            batch = std::make_unique<fun::env::Context>(filename, key);
+        }
+        for (fun::IR::Label callee : callees(definition)) {
+            if (fun::codegen::declare(declarations.at(callee.name),
+                                      *batch) == nullptr) {
+                return false;
+            }
+        }
+        if (!fun::codegen::to_llvm(definition, *batch)) { return false; }
+        batched += definition.size();
+        return batched < stream_batch || flush();
+    };
+
+    // lowers each waiting definition whose callees are all declared.
+    auto lower_ready = [&] {
+        bool success = true;
+        std::erase_if(waiting, [&](fun::IR::Module const &definition) {
+            if (undeclared_callee(definition, declarations)) { return false; }
+            if (!lower(definition)) { success = false; }
+            return true;
+        });
+        return success;
+    };
+
+    bool success =
+        fun::scan::parse(fd, filename, ctx, [&](fun::IR::Lambda &&lambda) {
+            if (lambda.generic()) {
+                instances.add_generic(std::move(lambda));
+                return true;
+            }
+            fun::IR::Module definition;
+            definition.append(std::move(lambda));
+            if (!monomorphize(instances, definition)) { return false; }
+            for (fun::IR::Lambda &lowered : definition) {
+                default_fast_math(lowered);
+            }
+            fun::pass::AnalysisManager evaluated;
+            constants.run(definition, evaluated);
+            for (fun::IR::Lambda &lowered : definition) {
+                fun::pass::FunctionAnalyses analyses{lowered};
+                analyses.invalidate(bounds_checks.run(lowered, analyses));
+                place.run(lowered, analyses);
+                declarations.emplace(lowered.name().name,
+                                     declaration(lowered));
+            }
+            waiting.push_back(std::move(definition));
+            return lower_ready();
+        });
+
+    for (fun::IR::Module const &definition : waiting) {
+        std::cerr << "error: " << definition.begin()->name().name
+                  << " calls "
+                  << undeclared_callee(definition, declarations)->name
+                  << ", which is never defined\n";
+        success = false;
+    }
+    if (!success) { return false; }
+
+    // even a stream without lambdas has a module to print or emit.
+    if (batch || objects.empty()) {
+        if (!batch) {
+            batch = std::make_unique<fun::env::Context>(filename, key);
+        }
+        if (!flush()) { return false; }
+    }
+    if (!output.empty() && !object_only && !entered) {
+        std::cerr << "error: the entry point " << entry.getValue()
+                  << " is not defined\n";
+        return false;
+    }
+    return true;
+}
+
+/// an input of compile_files, on its way from text to an output file
+struct Unit {
+    fs::path source;
+    fs::path destination;
+    std::unique_ptr<llvm::MemoryBuffer> text;
+    std::unique_ptr<fun::env::Context> ctx;
+    Objects objects;
+};
+
+/**
+ * @brief what a file of @p size bytes is estimated to need, parsed,
+ * lowered and emitted in [parts](@ref parts)
+ */
+static std::uint64_t estimate_memory(std::uint64_t size) {
+    // a module takes a few hundred times its text, and a context some more.
+    std::uint64_t const module = (std::uint64_t{16} << 20) + size * 256;
+    // each part is emitted from a clone of the module.
+    return parts() == 1 ? module : module * (parts() + 1);
+}
+
+/// the bytes of --memory-budget, or half the physical memory
+static std::uint64_t memory_limit() {
+    if (memory_budget != 0) { return memory_budget << 20; }
+    long const pages = ::sysconf(_SC_PHYS_PAGES);
+    long const size  = ::sysconf(_SC_PAGE_SIZE);
+    if (pages <= 0 || size <= 0) {
+        return std::numeric_limits<std::uint64_t>::max();
+    }
+    return static_cast<std::uint64_t>(pages) *
+           static_cast<std::uint64_t>(size) / 2;
+}
+
+/**
+ * @brief builds each of @p paths, as a translation unit of its own, into
+ * the -o directory, or beside it, by its name without the extension.
+ *
+ * Each file is read, parsed, lowered, optimized, emitted and written by a
+ * chain of tasks of a TaskGraph, so that the stages of different files
+ * overlap across -j threads. A file holds an estimate of the memory it
+ * needs from when it is parsed until its module is emitted and released,
+ * and no more files are started while that would exceed --memory-budget.
+ * A module emitted in several parts occupies a thread for each, so the
+ * graph runs on as many fewer workers.
+ *
+ * @return whether every file was built
+ */
+static bool compile_files(std::vector<fs::path> const &paths,
+                          fun::env::TargetKey const &key) {
+    fs::path directory{output.getValue()};
+    std::error_code error;
+    if (!directory.empty() && !fs::create_directories(directory, error) &&
+        error) {
+        std::cerr << directory.string() << ": " << error.message() << "\n";
+        return false;
+    }
+
+    std::vector<std::unique_ptr<Unit>> units;
+    fun::support::TaskGraph graph;
+    for (fs::path const &path : paths) {
+        Unit &unit       = *units.emplace_back(std::make_unique<Unit>());
+        unit.source      = path;
+        unit.destination = (directory.empty() ? path.parent_path()
+                                              : directory) /
+                           path.stem();
+        if (object_only) { unit.destination += ".o"; }
+
+        auto read = graph.add([&unit] {
+            auto buffer = llvm::MemoryBuffer::getFile(unit.source.string());
+            if (!buffer) {
+                std::cerr << unit.source.string() << ": "
+                          << buffer.getError().message() << "\n";
+                return false;
+            }
+            unit.text = std::move(*buffer);
+            return true;
+        });
+        auto parse = graph.add(
+            [&unit, &key] {
+                unit.ctx =
+                    std::make_unique<fun::env::Context>(unit.source, key);
+                bool const parsed = fun::scan::parse(
+                    unit.text->getBuffer(), unit.source.string(), *unit.ctx);
+                unit.text.reset();
+                return parsed;
+            },
+            {read});
+        auto passes =
+            graph.add([&unit] { return run_passes(*unit.ctx); }, {parse});
+        auto lower = graph.add(
+            [&unit] {
+                return fun::codegen::to_llvm(unit.ctx->ir(), *unit.ctx);
+            },
+            {passes});
+        auto optimize =
+            graph.add([&unit] { return prepare(*unit.ctx); }, {lower});
+        auto emitted = graph.add(
+            [&unit] {
+                bool const succeeded = emit(*unit.ctx, unit.objects);
+                unit.ctx.reset();
+                return succeeded;
+            },
+            {optimize});
+        graph.add(
+            [&unit] {
+                bool const written =
+                    write(unit.objects, unit.destination.string());
+                unit.objects.clear();
+                return written;
+            },
+            {emitted});
+
+        std::uint64_t const size = fs::file_size(path, error);
+        graph.reserve(parse, estimate_memory(error ? 0 : size), emitted);
+    }
+
+    return graph.run(std::max(1U, threads() / parts()), memory_limit());
+}
+
+/**
+ * @brief runs the entry lambda of @p path with the tiered engine
+ *
+ * @return the result of the entry lambda, as the exit status
+ */
+static int run_entry(fs::path const &path,
+                     bool from_stdin,
+                     fun::env::Context &ctx) {
+    bool parsed = false;
+    if (from_stdin) {
+        auto buffer = llvm::MemoryBuffer::getSTDIN();
+        if (!buffer) {
+            std::cerr << "<stdin>: " << buffer.getError().message() << "\n";
+            return 1;
+        }
+        parsed = fun::scan::parse((*buffer)->getBuffer(), ctx);
+    } else {
+        parsed = fun::scan::parse(path, ctx);
+    }
+    fun::pass::Monomorphize instances = monomorphizer(ctx);
+    if (!parsed || !monomorphize(instances, ctx.ir())) { return 1; }
+    for (fun::IR::Lambda &lambda : ctx.ir()) { default_fast_math(lambda); }
+
+    // the interpreter follows branches wherever blocks are; only the
+    // native code of hot lambdas cares how they are placed.
+    fun::pass::PassManager passes;
+    fun::pass::AnalysisManager analyses;
+    passes.add<fun::pass::EliminateBoundsChecks>();
+    passes.add<fun::pass::PlaceBlocks>();
+    passes.run(ctx.ir(), analyses);
+
+    fun::exec::Engine engine{ctx.ir(),
+                             fun::exec::JitCompiler::create(perf),
+                             {.threshold = jit_threshold}};
+    auto result = engine.call(ctx.intern_string(entry), {});
+    if (result.error != fun::eval::Error::None) {
+        std::cerr << "error: " << entry.getValue() << ": " << result.error
+                  << "\n";
+        return 1;
+    }
+
+    using fun::IR::Scalar;
+    switch (result.value.index()) {
+    case 1:  return result.value.as<Scalar::Bool>() ? 1 : 0;
+    case 2:  return result.value.as<Scalar::u8>();
+    case 3:  return result.value.as<Scalar::u16>();
+    case 4:  return static_cast<int>(result.value.as<Scalar::u32>());
+    case 5:  return static_cast<int>(result.value.as<Scalar::u64>());
+    case 6:  return result.value.as<Scalar::i8>();
+    case 7:  return result.value.as<Scalar::i16>();
+    case 8:  return result.value.as<Scalar::i32>();
+    case 9:  return static_cast<int>(result.value.as<Scalar::i64>());
+    default: return 0;
+    }
+}
 
 int main(int argc, char **argv) {
-  llvm::InitLLVM llvm{argc, argv};
+    llvm::InitLLVM llvm{argc, argv};
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    llvm::InitializeNativeTargetAsmParser();
+
+    cl::SetVersionPrinter([](llvm::raw_ostream &out) {
+        out << fun::config::version << "\n";
+    });
+    cl::ParseCommandLineOptions(argc, argv, "fun\n");
+
+    if (!optimization_level()) {
+        std::cerr << "error: -O" << optimization.getValue()
+                  << " is not a level, which is 0 to 3, s or z\n";
+        return 1;
+    }
+
+    fun::env::TargetKey key = cpu.empty() ? fun::env::TargetKey::native()
+                                          : fun::env::TargetKey::generic(cpu);
+    // a section per function lets the linker fold identical code.
+    key.sections = optimize_for_size();
+
+    if (!watch.empty()) {
+        if (run || object_only || instrument || !profile_generate.empty() ||
+            !profile_use.empty() || !target_clones.empty()) {
+            std::cerr << "error: --watch builds executables, which cannot "
+                         "be run, instrumented, profiled or cloned\n";
+            return 1;
+        }
+        fun::query::Database database;
+        database.set<fun::query::Configure>(
+            {},
+            {key, *optimization_level(), fast_math, checked_arithmetic, entry});
+        return fun::query::watch(database, watch.getValue(), output.getValue());
+    }
 
-  std::cout << fun::config::version << std::endl;
+    if (inputs.size() > 1) {
+        if (run || instrument || !profile_generate.empty() ||
+            !target_clones.empty() || std::ranges::count(inputs, "-") != 0) {
+            std::cerr << "error: several inputs are built into executables "
+                         "or objects, which cannot be run, instrumented, "
+                         "profiled, cloned or read from stdin\n";
+            return 1;
+        }
+        std::vector<fs::path> paths{inputs.begin(), inputs.end()};
+        return compile_files(paths, key) ? 0 : 1;
+    }
 
-  fun::IR::Scalar scalar{0.0};
+    std::string const input = inputs.empty() ? "-" : inputs.front();
+    bool const from_stdin   = input == "-";
+    fs::path path{from_stdin ? "<stdin>" : input};
+    fun::env::Context ctx{path, key};
+    if (run) {
+        if (instrument) {
+            std::cerr << "error: --instrument applies to compiled programs, "
+                         "not to --run\n";
+            return 1;
+        }
+        return run_entry(path, from_stdin, ctx);
+    }
 
-  return 0;
-}
\ No newline at end of file
+    Objects objects;
+    std::error_code error;
+    if (!from_stdin && fs::is_regular_file(path, error)) {
+        if (!compile_file(path, ctx) || !prepare(ctx)) { return 1; }
+        if (output.empty()) {
+            ctx.llvm_module().print(llvm::outs(), nullptr);
+            return 0;
+        }
+        if (!emit(ctx, objects)) { return 1; }
+    } else {
+        if (instrument || !profile_generate.empty() ||
+            !target_clones.empty()) {
+            std::cerr << "error: a stream is emitted a batch of lambdas at "
+                         "a time, so it cannot be instrumented, profiled or "
+                         "cloned\n";
+            return 1;
+        }
+        int fd = STDIN_FILENO;
+        if (!from_stdin) {
+            fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                std::cerr << path.string() << ": " << std::strerror(errno)
+                          << "\n";
+                return 1;
+            }
+        }
+        bool const compiled =
+            compile_stream(fd, path.string(), key, ctx, objects);
+        if (!from_stdin) { ::close(fd); }
+        if (!compiled) { return 1; }
+        if (output.empty()) { return 0; }
+    }
+    return write(objects, output.getValue()) ? 0 : 1;
+}
@@ -0,0 +1,254 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+#include <algorithm>
+#include <set>
+#include <string_view>
+#include <utility>
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+
+#include "IR/structure.hpp"
+#include "codegen/entry.hpp"
+#include "codegen/to_llvm.hpp"
+#include "link/link.hpp"
+#include "pass/bounds_checks.hpp"
+#include "pass/monomorphize.hpp"
+#include "pass/place_blocks.hpp"
+#include "query/compile.hpp"
+#include "scan/parse.hpp"
+
+namespace fun::query {
+
+namespace {
+
+void mix(Fingerprint &seed, Fingerprint value) noexcept {
+    seed ^= value + 0x9e37'79b9'7f4a'7c15 + (seed << 6) + (seed >> 2);
+}
+
+Fingerprint hash(std::string_view text) noexcept {
+    return llvm::xxh3_64bits(llvm::StringRef{text.data(), text.size()});
+}
+
+/// a lambda without a body, which keeps the names it refers to alive
+struct Declaration {
+    std::shared_ptr<IR::Lambda const> definition;
+    IR::Lambda lambda;
+};
+
+/// the names of the lambdas @p lambda calls, other than itself
+std::set<std::string_view> callees(IR::Lambda const &lambda) {
+    std::set<std::string_view> names;
+    for (IR::Block const &block : lambda.body()) {
+        for (IR::Instruction const &instruction : block) {
+            if (instruction.opcode() != IR::Instruction::Opcode::Call ||
+                !instruction.B().is<IR::Label>()) {
+                continue;
+            }
+            IR::Label callee = instruction.B().as<IR::Label>();
+            if (callee != lambda.name()) { names.insert(callee.name); }
+        }
+    }
+    return names;
+}
+
+} // namespace
+
+Fingerprint Configure::fingerprint(Options const &options) {
+    Fingerprint seed = hash(options.target.triple);
+    mix(seed, hash(options.target.cpu));
+    mix(seed, hash(options.target.features));
+    mix(seed, static_cast<Fingerprint>(options.target.opt_level));
+    mix(seed, options.target.sections);
+    mix(seed, options.level.getSpeedupLevel());
+    mix(seed, options.level.getSizeLevel());
+    mix(seed, options.fast_math);
+    mix(seed, options.checked_arithmetic);
+    mix(seed, hash(options.entry));
+    return seed;
+}
+
+Fingerprint Source::fingerprint(Value const &text) {
+    return text ? hash(*text) + 1 : 0;
+}
+
+Parse::Value Parse::compute(Database &database, Key const &path) {
+    Options const &options = database.get<Configure>({});
+    auto parsed            = std::make_shared<Parsed>();
+    parsed->text           = database.get<Source>(path);
+    parsed->ctx = std::make_unique<env::Context>(path, options.target);
+    if (!parsed->text) {
+        llvm::errs() << "error: " << path.string() << " cannot be read\n";
+        return parsed;
+    }
+
+    parsed->ok = scan::parse(
+        std::string_view{*parsed->text}, path.string(), *parsed->ctx);
+
+    env::Context &ctx = *parsed->ctx;
+    pass::Monomorphize monomorphize{
+        [&ctx](std::string_view name) { return ctx.intern_string(name); }};
+    pass::AnalysisManager manager;
+    monomorphize.run(ctx.ir(), manager);
+    for (std::string const &error : monomorphize.errors()) {
+        llvm::errs() << "error: " << error << "\n";
+        parsed->ok = false;
+    }
+
+    pass::EliminateBoundsChecks bounds_checks;
+    pass::PlaceBlocks place;
+    for (IR::Lambda &lambda : parsed->ctx->ir()) {
+        if (options.fast_math && !lambda.fast_math()) {
+            lambda.fast_math(IR::FastMath::All);
+        }
+        if (options.checked_arithmetic) { lambda.checked(true); }
+        pass::FunctionAnalyses analyses{lambda};
+        analyses.invalidate(bounds_checks.run(lambda, analyses));
+        place.run(lambda, analyses);
+    }
+    return parsed;
+}
+
+Fingerprint Parse::fingerprint(Value const &parsed) {
+    // the text alone would miss a change of options.
+    Fingerprint seed = parsed->ok;
+    for (IR::Lambda const &lambda : parsed->ctx->ir()) {
+        mix(seed, hash(lambda.name().name));
+        mix(seed, IR::structural_hash(lambda));
+    }
+    return seed;
+}
+
+Lambdas::Value Lambdas::compute(Database &database, Key const &path) {
+    Parse::Value const &parsed = database.get<Parse>(path);
+    Value names;
+    for (IR::Lambda const &lambda : parsed->ctx->ir()) {
+        names.emplace_back(lambda.name().name);
+    }
+    return names;
+}
+
+Fingerprint Lambdas::fingerprint(Value const &names) {
+    Fingerprint seed = names.size();
+    for (std::string const &name : names) { mix(seed, hash(name)); }
+    return seed;
+}
+
+LambdaIR::Value LambdaIR::compute(Database &database, Key const &name) {
+    Parse::Value parsed = database.get<Parse>(name.file);
+    IR::Lambda const *lambda =
+        parsed->ctx->ir().find(parsed->ctx->intern_string(name.lambda));
+    if (lambda == nullptr) { return nullptr; }
+    return {std::move(parsed), lambda};
+}
+
+Fingerprint LambdaIR::fingerprint(Value const &lambda) {
+    return lambda ? IR::structural_hash(*lambda) : 0;
+}
+
+LambdaType::Value LambdaType::compute(Database &database, Key const &name) {
+    LambdaIR::Value lambda = database.get<LambdaIR>(name);
+    if (!lambda) { return nullptr; }
+
+    IR::Lambda::Arguments arguments;
+    for (IR::Lambda::Argument const &argument : lambda->arguments()) {
+        arguments.emplace_back(argument.name, argument.type->clone());
+    }
+    IR::Lambda declared{
+        lambda->name(), lambda->return_type()->clone(), std::move(arguments)};
+    auto declaration =
+        std::make_shared<Declaration>(std::move(lambda), std::move(declared));
+    return {declaration, &declaration->lambda};
+}
+
+Fingerprint LambdaType::fingerprint(Value const &declaration) {
+    return declaration ? IR::structural_hash(*declaration) : 0;
+}
+
+LambdaObject::Value LambdaObject::compute(Database &database,
+                                          Key const &name) {
+    Options const &options = database.get<Configure>({});
+    LambdaIR::Value lambda = database.get<LambdaIR>(name);
+    if (!lambda) {
+        llvm::errs() << "error: " << name.file.string() << " has no lambda "
+                     << name.lambda << "\n";
+        return nullptr;
+    }
+
+    env::Context ctx{name.lambda, options.target};
+    for (std::string_view callee : callees(*lambda)) {
+        LambdaType::Value const &declaration =
+            database.get<LambdaType>({name.file, std::string{callee}});
+        // an undeclared callee is diagnosed as the call is lowered.
+        if (declaration && codegen::declare(*declaration, ctx) == nullptr) {
+            return nullptr;
+        }
+    }
+    if (codegen::to_llvm(*lambda, ctx) == nullptr) { return nullptr; }
+    if (name.lambda == options.entry &&
+        codegen::emit_entry(lambda->name(), ctx) == nullptr) {
+        return nullptr;
+    }
+    if (options.level != llvm::OptimizationLevel::O0) {
+        ctx.optimize(options.level);
+    }
+
+    auto object = std::make_shared<llvm::SmallVector<char, 0>>();
+    if (!ctx.emit_object(*object)) { return nullptr; }
+    return object;
+}
+
+Fingerprint LambdaObject::fingerprint(Value const &object) {
+    return object ? hash({object->data(), object->size()}) + 1 : 0;
+}
+
+bool load(Database &database, fs::path const &path) {
+    Source::Value text;
+    auto buffer = llvm::MemoryBuffer::getFile(path.string());
+    if (buffer) {
+        text = std::make_shared<std::string const>((*buffer)->getBuffer());
+    }
+    return database.set<Source>(path, std::move(text));
+}
+
+bool build(Database &database, fs::path const &path, fs::path const &output) {
+    if (!database.get<Parse>(path)->ok) { return false; }
+
+    Options const &options        = database.get<Configure>({});
+    Lambdas::Value const &lambdas = database.get<Lambdas>(path);
+    if (std::ranges::find(lambdas, options.entry) == lambdas.end()) {
+        llvm::errs() << "error: the entry point " << options.entry
+                     << " is not defined\n";
+        return false;
+    }
+
+    std::vector<LambdaObject::Value> objects;
+    bool compiled = true;
+    for (std::string const &lambda : lambdas) {
+        LambdaObject::Value object =
+            database.get<LambdaObject>({path, lambda});
+        if (object) {
+            objects.push_back(std::move(object));
+        } else {
+            compiled = false;
+        }
+    }
+    if (!compiled) { return false; }
+
+    std::vector<llvm::StringRef> files;
+    for (LambdaObject::Value const &object : objects) {
+        files.emplace_back(object->data(), object->size());
+    }
+    return link::link_executable(files, output, options.target.sections);
+}
+
+} // namespace fun::query
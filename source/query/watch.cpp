@@ -0,0 +1,158 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <system_error>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <llvm/Support/raw_ostream.h>
+
+#include "query/compile.hpp"
+#include "query/watch.hpp"
+
+namespace fun::query {
+
+namespace {
+
+/// how long to wait for the rest of an edit, in milliseconds
+constexpr int settle = 50;
+
+constexpr std::uint32_t events =
+    IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+
+bool is_source(fs::path const &path) { return path.extension() == ".fun"; }
+
+/// the .fun files of @p directory
+std::set<fs::path> sources(fs::path const &directory) {
+    std::set<fs::path> found;
+    std::error_code error;
+    for (auto const &entry : fs::directory_iterator{directory, error}) {
+        if (entry.is_regular_file(error) && is_source(entry.path())) {
+            found.insert(entry.path());
+        }
+    }
+    return found;
+}
+
+/// owns the inotify instance
+class Notifier {
+    int fd_;
+
+public:
+    Notifier() noexcept : fd_{::inotify_init1(IN_CLOEXEC)} {}
+    Notifier(Notifier const &)            = delete;
+    Notifier &operator=(Notifier const &) = delete;
+    ~Notifier() {
+        if (fd_ >= 0) { ::close(fd_); }
+    }
+
+    int fd() const noexcept { return fd_; }
+
+    /**
+     * @brief waits up to @p timeout milliseconds, or forever if it is
+     * negative, for events, and adds the files they name to @p changed.
+     * A queue which overflowed adds every source of @p directory.
+     *
+     * @return 1 if there were events, 0 if there were none, and -1 if the
+     * directory is no longer watched or reading failed
+     */
+    int read(fs::path const &directory,
+             int timeout,
+             std::set<fs::path> &changed) {
+        pollfd ready{fd_, POLLIN, 0};
+        int const count = ::poll(&ready, 1, timeout);
+        if (count < 0) { return errno == EINTR ? 0 : -1; }
+        if (count == 0) { return 0; }
+
+        alignas(inotify_event) char buffer[4096];
+        ssize_t const size = ::read(fd_, buffer, sizeof(buffer));
+        if (size < 0) { return errno == EINTR || errno == EAGAIN ? 0 : -1; }
+
+        for (char const *cursor = buffer; cursor < buffer + size;) {
+            auto const *event =
+                reinterpret_cast<inotify_event const *>(cursor);
+            cursor += sizeof(inotify_event) + event->len;
+            if ((event->mask & IN_IGNORED) != 0) { return -1; }
+            if ((event->mask & IN_Q_OVERFLOW) != 0) {
+                changed.merge(sources(directory));
+                continue;
+            }
+            if (event->len == 0) { continue; }
+            fs::path const path = directory / event->name;
+            if (is_source(path)) { changed.insert(path); }
+        }
+        return 1;
+    }
+};
+
+} // namespace
+
+Rebuilt rebuild(Database &database,
+                fs::path const &source,
+                fs::path const &outputs) {
+    fs::path const executable =
+        (outputs.empty() ? source.parent_path() : outputs) / source.stem();
+    std::uint64_t const before = database.computed<LambdaObject>();
+    bool const built           = build(database, source, executable);
+    std::uint64_t const compiled =
+        database.computed<LambdaObject>() - before;
+
+    llvm::errs() << (built ? "built " : "failed to build ")
+                 << executable.string() << ", compiling " << compiled
+                 << " of " << database.get<Lambdas>(source).size()
+                 << " lambdas\n";
+    return {built, compiled};
+}
+
+int watch(Database &database,
+          fs::path const &directory,
+          fs::path const &outputs) {
+    Notifier notifier;
+    if (notifier.fd() < 0 ||
+        ::inotify_add_watch(notifier.fd(), directory.c_str(), events) < 0) {
+        llvm::errs() << "error: cannot watch " << directory.string() << ": "
+                     << std::strerror(errno) << "\n";
+        return 1;
+    }
+
+    // watch before the first build, so that no edit is missed.
+    std::set<fs::path> changed = sources(directory);
+    for (fs::path const &source : changed) {
+        load(database, source);
+        rebuild(database, source, outputs);
+    }
+    llvm::errs() << "watching " << directory.string() << "\n";
+
+    for (;;) {
+        changed.clear();
+        int read = notifier.read(directory, -1, changed);
+        // an editor may write, rename and delete in quick succession.
+        while (read > 0) { read = notifier.read(directory, settle, changed); }
+        if (read < 0) { break; }
+
+        for (fs::path const &source : changed) {
+            // a file which is gone is not built, but its text is dropped.
+            bool const exists = fs::is_regular_file(source);
+            if (!load(database, source) || !exists) { continue; }
+            rebuild(database, source, outputs);
+        }
+    }
+
+    llvm::errs() << "error: " << directory.string()
+                 << " can no longer be watched\n";
+    return 1;
+}
+
+} // namespace fun::query
@@ -12,20 +12,42 @@
  * @brief Defines [parse](@ref parse)
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+#include <unistd.h>
 
 #include <boost/parser/parser.hpp>
 
 namespace bp = boost::parser;
 
+#include <llvm/Support/MemoryBuffer.h>
+
+#include "IR/field_handle.hpp"
 #include "IR/instruction.hpp"
 #include "IR/operand.hpp"
 #include "IR/scalar.hpp"
 #include "IR/type.hpp"
 #include "IR/value.hpp"
 
+#include "scan/diagnostic.hpp"
+#include "scan/literal.hpp"
 #include "scan/parse.hpp"
+#include "scan/split.hpp"
+#include "support/thread_pool.hpp"
 
+using fun::IR::Operand;
 using fun::IR::Scalar;
 
 namespace fun::scan {
@@ -38,104 +60,94 @@ bp::rule<struct bool_, Scalar> bool_rule = "bool";
 auto const bool_rule_def                 = bp::bool_;
 BOOST_PARSER_DEFINE_RULES(bool_rule);
 
-bp::rule<struct bin, Scalar> bin_rule = "bin";
-auto const bin_rule_def = bp::lit("0b") > bp::bin | bp::lit("0B") > bp::bin;
-BOOST_PARSER_DEFINE_RULES(bin_rule);
-
-bp::rule<struct hex, Scalar> hex_rule = "hex";
-auto const hex_rule_def = bp::lit("0x") > bp::hex | bp::lit("0X") > bp::hex;
-BOOST_PARSER_DEFINE_RULES(hex_rule);
-
-bp::rule<struct oct, Scalar> oct_rule = "oct";
-auto const oct_rule_def = bp::lit("0o") > bp::oct | bp::lit("0O") > bp::oct;
-BOOST_PARSER_DEFINE_RULES(oct_rule);
-
-bp::rule<struct u8_, Scalar> u8_rule = "u8";
-auto const u8_rule_def =
-    (bin_rule > bp::lit("u8") | hex_rule > bp::lit("u8") |
-     oct_rule > bp::lit("u8") | bp::ushort_ > bp::lit("u8"))[([](auto &ctx) {
-        unsigned short value = _attr(ctx);
-        if (value > std::numeric_limits<std::uint8_t>::max()) {
-            _report_error(ctx, "u8 literal out of range", _where(ctx));
-        }
-        return Scalar{static_cast<std::uint8_t>(value)};
-    })];
-BOOST_PARSER_DEFINE_RULES(u8_rule);
-
-bp::rule<struct u16_, Scalar> u16_rule = "u16";
-auto const u16_rule_def =
-    (bin_rule > bp::lit("u16") | hex_rule > bp::lit("u16") |
-     oct_rule > bp::lit("u16") | bp::ushort_ > bp::lit("u16"))[([](auto &ctx) {
-        unsigned int value = _attr(ctx);
-        if (value > std::numeric_limits<std::uint16_t>::max()) {
-            _report_error(ctx, "u16 literal out of range", _where(ctx));
-        }
-        return Scalar{static_cast<std::uint16_t>(value)};
-    })];
-BOOST_PARSER_DEFINE_RULES(u16_rule);
-
-bp::rule<struct u32_, Scalar> u32_rule = "u32";
-auto const u32_rule_def =
-    (bin_rule > bp::lit("u32") | hex_rule > bp::lit("u32") |
-     oct_rule > bp::lit("u32") | bp::uint_ > bp::lit("u32"))[([](auto &ctx) {
-        unsigned long value = _attr(ctx);
-        if (value > std::numeric_limits<std::uint32_t>::max()) {
-            _report_error(ctx, "u32 literal out of range", _where(ctx));
-        }
-        return Scalar{static_cast<std::uint32_t>(value)};
-    })];
-BOOST_PARSER_DEFINE_RULES(u32_rule);
-
-bp::rule<struct u64_, Scalar> u64_rule = "u64";
-auto const u64_rule_def =
-    (bin_rule > bp::lit("u64") | hex_rule > bp::lit("u64") |
-     oct_rule > bp::lit("u64") | bp::ulong_ > bp::lit("u64") | bp::ulong_);
-BOOST_PARSER_DEFINE_RULES(u64_rule);
-
-bp::rule<struct i8_, Scalar> i8_rule = "i8";
-auto const i8_rule_def =
-    (bin_rule > bp::lit("i8") | hex_rule > bp::lit("i8") |
-     oct_rule > bp::lit("i8") | bp::short_ > bp::lit("i8"))[([](auto &ctx) {
-        short value = _attr(ctx);
-        if (value > std::numeric_limits<std::int8_t>::max() ||
-            value < std::numeric_limits<std::int8_t>::min()) {
-            _report_error(ctx, "i8 literal out of range", _where(ctx));
+/**
+ * @brief Parses any integer literal with [scan_integer](@ref scan_integer)
+ *
+ * The prefix, digits and suffix of a literal are each read once, and the
+ * type is chosen from the suffix afterwards, rather than trying a rule per
+ * integer type and re-reading the digits each time a suffix fails to match.
+ */
+struct integer_parser {
+    template <typename Iter,
+              typename Sentinel,
+              typename Context,
+              typename SkipParser>
+    Scalar call(Iter &first,
+                Sentinel last,
+                Context const &context,
+                SkipParser const &skip,
+                bp::detail::flags flags,
+                bool &success) const {
+        Scalar result;
+        call(first, last, context, skip, flags, success, result);
+        return result;
+    }
+
+    template <typename Iter,
+              typename Sentinel,
+              typename Context,
+              typename SkipParser,
+              typename Attribute>
+    void call(Iter &first,
+              Sentinel last,
+              Context const &context,
+              SkipParser const &skip,
+              bp::detail::flags flags,
+              bool &success,
+              Attribute &retval) const {
+        static_assert(std::contiguous_iterator<Iter>,
+                      "integer literals are scanned from contiguous memory");
+        bp::detail::skip(first, last, skip, flags);
+
+        char const *begin  = std::to_address(first);
+        char const *cursor = begin;
+        char const *end    = begin + (last - first);
+        Scalar scalar;
+        LiteralError error = scan_integer(cursor, end, scalar);
+        if (error == LiteralError::NoMatch) {
+            success = false;
+            return;
         }
-        return Scalar{static_cast<std::int8_t>(value)};
-    })];
-BOOST_PARSER_DEFINE_RULES(i8_rule);
-
-bp::rule<struct i16_, Scalar> i16_rule = "i16";
-auto const i16_rule_def =
-    (bin_rule > bp::lit("i16") | hex_rule > bp::lit("i16") |
-     oct_rule > bp::lit("i16") | bp::short_ > bp::lit("i16"))[([](auto &ctx) {
-        int value = _attr(ctx);
-        if (value > std::numeric_limits<std::int16_t>::max() ||
-            value < std::numeric_limits<std::int16_t>::min()) {
-            _report_error(ctx, "i16 literal out of range", _where(ctx));
+
+        auto where = first;
+        first += cursor - begin;
+        switch (error) {
+        case LiteralError::None: break;
+        case LiteralError::MissingDigits:
+            _report_error(context, "expected digits after prefix", where);
+            break;
+        case LiteralError::InvalidSuffix:
+            _report_error(context, "invalid integer literal suffix", where);
+            break;
+        case LiteralError::OutOfRange:
+            _report_error(context, out_of_range(scalar), where);
+            break;
+        default: std::unreachable();
         }
-        return Scalar{static_cast<std::int16_t>(value)};
-    })];
-BOOST_PARSER_DEFINE_RULES(i16_rule);
-
-bp::rule<struct i32_, Scalar> i32_rule = "i32";
-auto const i32_rule_def =
-    (bin_rule > bp::lit("i32") | hex_rule > bp::lit("i32") |
-     oct_rule > bp::lit("i32") | bp::int_ > bp::lit("i32"))[([](auto &ctx) {
-        long value = _attr(ctx);
-        if (value > std::numeric_limits<std::int32_t>::max() ||
-            value < std::numeric_limits<std::int32_t>::min()) {
-            _report_error(ctx, "i32 literal out of range", _where(ctx));
+
+        if (bp::detail::gen_attrs(flags)) { retval = scalar; }
+    }
+
+    static std::string_view out_of_range(Scalar const &scalar) noexcept {
+        switch (scalar.index()) {
+        case 2:  return "u8 literal out of range";
+        case 3:  return "u16 literal out of range";
+        case 4:  return "u32 literal out of range";
+        case 5:  return "u64 literal out of range";
+        case 6:  return "i8 literal out of range";
+        case 7:  return "i16 literal out of range";
+        case 8:  return "i32 literal out of range";
+        case 9:  return "i64 literal out of range";
+        default: std::unreachable();
         }
-        return Scalar{static_cast<std::int32_t>(value)};
-    })];
-BOOST_PARSER_DEFINE_RULES(i32_rule);
+    }
+};
 
-bp::rule<struct i64_, Scalar> i64_rule = "i64";
-auto const i64_rule_def =
-    (bin_rule > bp::lit("i64") | hex_rule > bp::lit("i64") |
-     oct_rule > bp::lit("i64") | bp::long_ > bp::lit("i64") | bp::long_);
-BOOST_PARSER_DEFINE_RULES(i64_rule);
+constexpr bp::parser_interface<integer_parser> integer;
+
+bp::rule<struct integer_, Scalar> integer_rule = "integer";
+auto const integer_rule_def                    = integer;
+BOOST_PARSER_DEFINE_RULES(integer_rule);
 
 bp::rule<struct f32_, Scalar> f32_rule = "f32";
 auto const f32_rule_def                = bp::float_;
@@ -146,13 +158,815 @@ auto const f64_rule_def                = bp::double_;
 BOOST_PARSER_DEFINE_RULES(f64_rule);
 
 bp::rule<struct number, Scalar> number_rule = "number";
-auto const number_rule_def                  = ;
+auto const number_rule_def                  = integer_rule | f64_rule;
+BOOST_PARSER_DEFINE_RULES(number_rule);
+
+bp::rule<struct scalar, Scalar> scalar_rule = "scalar";
+auto const scalar_rule_def = nil_rule | bool_rule | number_rule;
+BOOST_PARSER_DEFINE_RULES(scalar_rule);
 
 bp::rule<struct atom, Operand> atom_rule = "atom";
-auto const atom_rule_def =
-    nil_rule | bool_rule | i64_rule | u64_rule | f64_rule;
+auto const atom_rule_def                 = scalar_rule;
 BOOST_PARSER_DEFINE_RULES(atom_rule);
 
-bool parse(std::string_view view, env::Context &ctx) { return false; }
+/**
+ * @struct Chunk
+ * @brief The state of parsing one chunk of a source file.
+ *
+ * Every chunk is parsed into its own lambdas and diagnostics, which may
+ * happen on any thread. Only the string interner of the env::Context is
+ * shared between chunks.
+ */
+struct Chunk {
+    env::Context &context;
+    /// the start of the whole source, diagnostics are relative to it
+    char const *base;
+    std::vector<IR::Lambda> lambdas;
+    /// the offset of the definition of each lambda
+    std::vector<std::size_t> offsets;
+    std::vector<Diagnostic> diagnostics;
+
+    /// the header of the lambda being parsed, until its return type
+    std::size_t offset;
+    IR::Label name;
+    /// the type parameters of the lambda being parsed, until its end
+    std::vector<IR::Label> type_parameters;
+    IR::Lambda::Arguments arguments;
+    /// the structs and tuples being parsed, innermost last
+    std::vector<IR::Type::Struct> records;
+    /// the structs, tuples, arrays and slices parsed in the lambda, by
+    /// type index
+    std::vector<IR::Type::Ptr> aggregates;
+
+    template <typename Iter> std::size_t offset_of(Iter it) const noexcept {
+        return static_cast<std::size_t>(std::to_address(it) - base);
+    }
+};
+
+/**
+ * @brief Records parse errors as [Diagnostics](@ref Diagnostic) of the
+ * chunk, rather than printing them, so they can be printed in source order
+ * once every chunk has been parsed.
+ */
+struct ChunkErrorHandler {
+    Chunk &chunk;
+
+    template <typename Iter>
+    void record(Diagnostic::Kind kind, std::string message, Iter it) const {
+        chunk.diagnostics.emplace_back(
+            chunk.offset_of(it), kind, std::move(message));
+    }
+
+    template <typename Iter, typename Sentinel>
+    bp::error_handler_result operator()(Iter,
+                                        Sentinel,
+                                        bp::parse_error<Iter> const &e) const {
+        record(Diagnostic::Kind::Error,
+               std::string{"expected "} + e.what(),
+               e.iter);
+        return bp::error_handler_result::fail;
+    }
+
+    template <typename Context, typename Iter>
+    void diagnose(bp::diagnostic_kind kind,
+                  std::string_view message,
+                  Context const &,
+                  Iter it) const {
+        record(kind == bp::diagnostic_kind::error ? Diagnostic::Kind::Error
+                                                  : Diagnostic::Kind::Warning,
+               std::string{message},
+               it);
+    }
+
+    template <typename Context>
+    void diagnose(bp::diagnostic_kind kind,
+                  std::string_view message,
+                  Context const &context) const {
+        diagnose(kind, message, context, bp::_where(context).begin());
+    }
+};
+
+/// types from this index on are the type parameters of a lambda, in order
+constexpr std::uint64_t first_parameter = 13;
+/// types from this index on are the structs, tuples, arrays and slices of
+/// a lambda
+constexpr std::uint64_t first_aggregate = std::uint64_t{1} << 32U;
+
+IR::Type::Ptr make_type(std::uint64_t index, Chunk const &chunk) {
+    switch (index) {
+    case 0:  return std::make_unique<IR::Type>(IR::Type::Nil{});
+    case 1:  return std::make_unique<IR::Type>(IR::Type::Bool{});
+    case 2:  return std::make_unique<IR::Type>(IR::Type::u8{});
+    case 3:  return std::make_unique<IR::Type>(IR::Type::u16{});
+    case 4:  return std::make_unique<IR::Type>(IR::Type::u32{});
+    case 5:  return std::make_unique<IR::Type>(IR::Type::u64{});
+    case 6:  return std::make_unique<IR::Type>(IR::Type::i8{});
+    case 7:  return std::make_unique<IR::Type>(IR::Type::i16{});
+    case 8:  return std::make_unique<IR::Type>(IR::Type::i32{});
+    case 9:  return std::make_unique<IR::Type>(IR::Type::i64{});
+    case 10: return std::make_unique<IR::Type>(IR::Type::f32{});
+    case 11: return std::make_unique<IR::Type>(IR::Type::f64{});
+    default:
+        if (index >= first_aggregate) {
+            assert(index - first_aggregate < chunk.aggregates.size());
+            return chunk.aggregates[index - first_aggregate]->clone();
+        }
+        std::span<IR::Label const> parameters = chunk.type_parameters;
+        assert(index - first_parameter < parameters.size());
+        return std::make_unique<IR::Type>(
+            IR::Type::Parameter{parameters[index - first_parameter]});
+    }
+}
+
+// the symbols map to the index of the type in IR::Type and IR::Scalar
+bp::symbols<std::uint64_t> const type_symbols = {
+    {"nil", 0},
+    {"bool", 1},
+    {"u8", 2},
+    {"u16", 3},
+    {"u32", 4},
+    {"u64", 5},
+    {"i8", 6},
+    {"i16", 7},
+    {"i32", 8},
+    {"i64", 9},
+    {"f32", 10},
+    {"f64", 11},
+};
+
+bp::symbols<IR::Instruction::Opcode> const opcode_symbols = {
+    {"ret", IR::Instruction::Opcode::Ret},
+    {"call", IR::Instruction::Opcode::Call},
+    {"jmp", IR::Instruction::Opcode::Jmp},
+    {"jeq", IR::Instruction::Opcode::Jeq},
+    {"jne", IR::Instruction::Opcode::Jne},
+    {"jlt", IR::Instruction::Opcode::Jlt},
+    {"jle", IR::Instruction::Opcode::Jle},
+    {"jgt", IR::Instruction::Opcode::Jgt},
+    {"jge", IR::Instruction::Opcode::Jge},
+    {"jz", IR::Instruction::Opcode::Jz},
+    {"jnz", IR::Instruction::Opcode::Jnz},
+    {"load", IR::Instruction::Opcode::Load},
+    {"subscript", IR::Instruction::Opcode::Subscript},
+    {"insert", IR::Instruction::Opcode::Insert},
+    {"unchecked_subscript", IR::Instruction::Opcode::UncheckedSubscript},
+    {"unchecked_insert", IR::Instruction::Opcode::UncheckedInsert},
+    {"slice", IR::Instruction::Opcode::Slice},
+    {"length", IR::Instruction::Opcode::Length},
+    {"neg", IR::Instruction::Opcode::Neg},
+    {"add", IR::Instruction::Opcode::Add},
+    {"sub", IR::Instruction::Opcode::Sub},
+    {"mul", IR::Instruction::Opcode::Mul},
+    {"div", IR::Instruction::Opcode::Div},
+    {"rem", IR::Instruction::Opcode::Rem},
+    {"eq", IR::Instruction::Opcode::Eq},
+    {"ne", IR::Instruction::Opcode::Ne},
+    {"lt", IR::Instruction::Opcode::Lt},
+    {"le", IR::Instruction::Opcode::Le},
+    {"gt", IR::Instruction::Opcode::Gt},
+    {"ge", IR::Instruction::Opcode::Ge},
+};
+
+bp::symbols<IR::Type::Struct::Order> const struct_order_symbols = {
+    {"ordered", IR::Type::Struct::Order::Ordered},
+    {"packed", IR::Type::Struct::Order::Packed},
+};
+
+bp::symbols<IR::FastMath> const fast_math_symbols = {
+    {"reassoc", IR::FastMath::Reassociate},
+    {"contract", IR::FastMath::Contract},
+    {"nnan", IR::FastMath::NoNaNs},
+    {"ninf", IR::FastMath::NoInfs},
+    {"arcp", IR::FastMath::Reciprocal},
+};
+
+auto const intern = [](auto &ctx) {
+    _val(ctx) = _globals(ctx).context.intern_string(_attr(ctx));
+};
+
+auto const assign_operand = [](auto &ctx) { _val(ctx) = Operand{_attr(ctx)}; };
+
+auto const assign_type = [](auto &ctx) { _val(ctx) = _attr(ctx); };
+
+auto const begin_lambda = [](auto &ctx) {
+    Chunk &chunk = _globals(ctx);
+    chunk.offset = chunk.offset_of(_where(ctx).begin());
+    chunk.name   = _attr(ctx);
+    chunk.type_parameters.clear();
+    chunk.arguments.clear();
+    chunk.records.clear();
+    chunk.aggregates.clear();
+};
+
+auto const add_type_parameter = [](auto &ctx) {
+    Chunk &chunk = _globals(ctx);
+    IR::Label parameter{chunk.context.intern_string(_attr(ctx))};
+    if (std::ranges::find(chunk.type_parameters, parameter) !=
+        chunk.type_parameters.end()) {
+        _report_error(
+            ctx, "type parameter declared twice", _where(ctx).begin());
+        return;
+    }
+    chunk.type_parameters.push_back(parameter);
+};
+
+// a name which is not a type parameter of the lambda is not a type.
+auto const resolve_parameter = [](auto &ctx) {
+    std::vector<IR::Label> const &parameters =
+        _globals(ctx).type_parameters;
+    auto found = std::ranges::find(parameters, IR::Label{_attr(ctx)});
+    if (found == parameters.end()) {
+        _pass(ctx) = false;
+        return;
+    }
+    _val(ctx) = first_parameter +
+                static_cast<std::uint64_t>(found - parameters.begin());
+};
+
+auto const add_argument = [](auto &ctx) {
+    using namespace bp::literals;
+    Chunk &chunk = _globals(ctx);
+    auto &attr   = _attr(ctx);
+    chunk.arguments.emplace_back(
+        chunk.context.intern_string(bp::get(attr, 0_c)),
+        make_type(bp::get(attr, 1_c), chunk));
+};
+
+auto const begin_record = [](auto &ctx) {
+    _globals(ctx).records.emplace_back(IR::Type::Struct::Fields{},
+                                       IR::Type::Struct::Order::Reordered);
+};
+
+auto const set_order = [](auto &ctx) {
+    _globals(ctx).records.back().order = _attr(ctx);
+};
+
+auto const add_field = [](auto &ctx) {
+    using namespace bp::literals;
+    Chunk &chunk = _globals(ctx);
+    auto &attr   = _attr(ctx);
+    IR::Label name{chunk.context.intern_string(bp::get(attr, 0_c))};
+    IR::Type::Struct::Fields &fields = chunk.records.back().fields;
+    if (std::ranges::find(fields, name, &IR::Type::Struct::Field::name) !=
+        fields.end()) {
+        _report_error(ctx, "field declared twice", _where(ctx).begin());
+        return;
+    }
+    fields.emplace_back(name, make_type(bp::get(attr, 1_c), chunk));
+};
+
+// the elements of a tuple are fields named by their positions.
+auto const add_element = [](auto &ctx) {
+    Chunk &chunk                     = _globals(ctx);
+    IR::Type::Struct::Fields &fields = chunk.records.back().fields;
+    IR::Label name{
+        chunk.context.intern_string(std::to_string(fields.size()))};
+    fields.emplace_back(name, make_type(_attr(ctx), chunk));
+};
+
+auto const end_record = [](auto &ctx) {
+    Chunk &chunk = _globals(ctx);
+    IR::Type::Struct record = std::move(chunk.records.back());
+    chunk.records.pop_back();
+    _val(ctx) = first_aggregate + chunk.aggregates.size();
+    chunk.aggregates.push_back(std::make_unique<IR::Type>(
+        std::move(record.fields), record.order));
+};
+
+// [type; length] is an array, and [type] a slice.
+auto const make_sequence = [](auto &ctx) {
+    using namespace bp::literals;
+    Chunk &chunk          = _globals(ctx);
+    auto &attr            = _attr(ctx);
+    IR::Type::Ptr element = make_type(bp::get(attr, 0_c), chunk);
+    auto const &length    = bp::get(attr, 1_c);
+    _val(ctx)             = first_aggregate + chunk.aggregates.size();
+    chunk.aggregates.push_back(
+        length ? std::make_unique<IR::Type>(
+                     IR::Type::Array{std::move(element), *length})
+               : std::make_unique<IR::Type>(
+                     IR::Type::Slice{std::move(element)}));
+};
+
+auto const end_header = [](auto &ctx) {
+    Chunk &chunk = _globals(ctx);
+    IR::Lambda &lambda =
+        chunk.lambdas.emplace_back(chunk.name,
+                                   make_type(_attr(ctx), chunk),
+                                   std::move(chunk.arguments));
+    // the locals which follow may still name the parameters.
+    lambda.type_parameters(chunk.type_parameters);
+    lambda.body().emplace_back();
+    chunk.offsets.push_back(chunk.offset);
+};
+
+// fast alone assumes every flag, fast(flag, ...) only those listed.
+auto const set_fast_math = [](auto &ctx) {
+    IR::FastMath flags = IR::FastMath::All;
+    if (auto const &listed = _attr(ctx)) {
+        flags = IR::FastMath::None;
+        for (IR::FastMath flag : *listed) { flags = flags | flag; }
+    }
+    _globals(ctx).lambdas.back().fast_math(flags);
+};
+
+auto const set_strict = [](auto &ctx) {
+    _globals(ctx).lambdas.back().fast_math(IR::FastMath::None);
+};
+
+auto const set_checked = [](auto &ctx) {
+    _globals(ctx).lambdas.back().checked(true);
+};
+
+auto const declare_local = [](auto &ctx) {
+    using namespace bp::literals;
+    Chunk &chunk       = _globals(ctx);
+    auto &attr         = _attr(ctx);
+    IR::Label name     = chunk.context.intern_string(bp::get(attr, 0_c));
+    std::uint64_t type = bp::get(attr, 1_c);
+
+    IR::Value value;
+    if (auto const &initializer = bp::get(attr, 2_c)) {
+        if (type >= first_aggregate) {
+            _report_error(ctx,
+                          "a local of an aggregate cannot be initialized",
+                          _where(ctx).begin());
+        } else if (type >= first_parameter) {
+            _report_error(ctx,
+                          "a local of a type parameter cannot be initialized",
+                          _where(ctx).begin());
+        } else if (initializer->index() != type) {
+            _report_error(ctx,
+                          "initializer does not have the type of the local",
+                          _where(ctx).begin());
+        } else {
+            value = *initializer;
+        }
+    }
+    chunk.lambdas.back().declare(
+        IR::Local{name, make_type(type, chunk), value});
+};
+
+auto const begin_block = [](auto &ctx) {
+    IR::Lambda::Body &body = _globals(ctx).lambdas.back().body();
+    std::uint64_t index    = _attr(ctx);
+    // the first block is begun by the header, and may be labelled #0
+    // before any instruction.
+    if (index == 0 && body.size() == 1 && body.front().empty()) { return; }
+    if (index != body.size()) {
+        _report_error(ctx,
+                      "blocks must be numbered in order, from #0",
+                      _where(ctx).begin());
+    }
+    body.emplace_back();
+};
+
+auto const append_instruction = [](auto &ctx) {
+    using namespace bp::literals;
+    Chunk &chunk                         = _globals(ctx);
+    auto &attr                           = _attr(ctx);
+    IR::Instruction::Opcode opcode       = bp::get(attr, 0_c);
+    std::vector<Operand> const &operands = bp::get(attr, 1_c);
+
+    IR::Block &block = chunk.lambdas.back().body().back();
+    switch (operands.size()) {
+    case 1: block.append(opcode, operands[0]); break;
+    case 2: block.append(opcode, operands[0], operands[1]); break;
+    case 3: block.append(opcode, operands[0], operands[1], operands[2]); break;
+    default:
+        _report_error(ctx,
+                      "instructions take one to three operands",
+                      _where(ctx).begin());
+    }
+};
+
+/// weighs the conditional branch which was just appended, and so its block
+auto const set_weights = [](auto &ctx) {
+    using namespace bp::literals;
+    auto &attr       = _attr(ctx);
+    IR::Block &block = _globals(ctx).lambdas.back().body().back();
+    if (block.empty() ||
+        !IR::is_conditional(block[block.size() - 1].opcode())) {
+        _report_error(ctx,
+                      "only a conditional branch has weights",
+                      _where(ctx).begin());
+        return;
+    }
+    block.weights(
+        IR::Block::Weights{bp::get(attr, 0_c), bp::get(attr, 1_c)});
+};
+
+bp::rule<struct identifier, std::string> identifier_rule = "identifier";
+auto const identifier_rule_def =
+    bp::lexeme[(bp::char_('a', 'z') | bp::char_('A', 'Z') | bp::char_('_')) >>
+               *(bp::char_('a', 'z') | bp::char_('A', 'Z') |
+                 bp::char_('0', '9') | bp::char_('_'))];
+BOOST_PARSER_DEFINE_RULES(identifier_rule);
+
+// types nest, so their rules are declared before they are defined.
+bp::rule<struct type, std::uint64_t> type_rule         = "type";
+bp::rule<struct field_, std::uint64_t> field_rule      = "field";
+bp::rule<struct record, std::uint64_t> struct_rule     = "struct";
+bp::rule<struct tuple_, std::uint64_t> tuple_rule      = "tuple";
+bp::rule<struct sequence, std::uint64_t> sequence_rule = "array or slice";
+
+// struct is a keyword only as a whole word.
+auto const struct_keyword =
+    bp::lexeme[bp::lit("struct") >>
+               !(bp::char_('a', 'z') | bp::char_('A', 'Z') |
+                 bp::char_('0', '9') | bp::char_('_'))];
+
+auto const type_rule_def = type_symbols[assign_type] |
+                           struct_rule[assign_type] |
+                           tuple_rule[assign_type] |
+                           sequence_rule[assign_type] |
+                           identifier_rule[resolve_parameter];
+
+auto const field_rule_def = (identifier_rule > ':' > type_rule)[add_field];
+
+/**
+ * struct packed { name: type, ... } lays its fields out as IR::layout
+ * does; the order, ordered or packed, is optional.
+ */
+auto const struct_rule_def =
+    struct_keyword[begin_record] > -struct_order_symbols[set_order] > '{' >
+    -(field_rule % ',') > bp::lit('}')[end_record];
+
+/// (type, ...) is a struct whose fields are named 0, 1, ...
+auto const tuple_rule_def = bp::lit('(')[begin_record] >
+                            -(type_rule[add_element] % ',') >
+                            bp::lit(')')[end_record];
+
+/// [type; length] is an array of length elements, [type] a slice of them
+auto const sequence_rule_def =
+    ('[' > type_rule > -(';' > bp::ulong_) > ']')[make_sequence];
+
+BOOST_PARSER_DEFINE_RULES(
+    type_rule, field_rule, struct_rule, tuple_rule, sequence_rule);
+
+bp::rule<struct label, IR::Label> label_rule = "label";
+auto const label_rule_def                    = identifier_rule[intern];
+BOOST_PARSER_DEFINE_RULES(label_rule);
+
+bp::rule<struct local, IR::LocalHandle> local_rule = "local";
+auto const local_rule_def = bp::lexeme['%' >> bp::ulong_][([](auto &ctx) {
+    _val(ctx) = IR::LocalHandle{_attr(ctx)};
+})];
+BOOST_PARSER_DEFINE_RULES(local_rule);
+
+// a field is selected by its name, or its position as it is declared.
+auto const select_field = [](auto &ctx) {
+    using namespace bp::literals;
+    Chunk &chunk             = _globals(ctx);
+    auto &attr               = _attr(ctx);
+    IR::LocalHandle local{bp::get(attr, 0_c)};
+    IR::Lambda const &lambda = chunk.lambdas.back();
+    if (local.index >= lambda.frame_size() ||
+        !lambda.type_of(local).is<IR::Type::Struct>()) {
+        _report_error(ctx,
+                      "only a local of a struct or tuple has fields",
+                      _where(ctx).begin());
+        return;
+    }
+    IR::Type::Struct::Fields const &fields =
+        lambda.type_of(local).as<IR::Type::Struct>().fields;
+    std::uint64_t field = fields.size();
+    if (auto const *position = std::get_if<0>(&bp::get(attr, 1_c))) {
+        field = std::min<std::uint64_t>(*position, fields.size());
+    } else {
+        IR::Label name{std::get<1>(bp::get(attr, 1_c))};
+        field = static_cast<std::uint64_t>(
+            std::ranges::find(fields, name, &IR::Type::Struct::Field::name) -
+            fields.begin());
+    }
+    if (field == fields.size()) {
+        _report_error(ctx, "no such field", _where(ctx).begin());
+        return;
+    }
+    _val(ctx) = IR::FieldHandle{local, field};
+};
+
+bp::rule<struct field_operand, IR::FieldHandle> field_operand_rule =
+    "field operand";
+auto const field_operand_rule_def = bp::lexeme[
+    '%' >> bp::ulong_ >> '.' >> (bp::ulong_ | identifier_rule)][select_field];
+BOOST_PARSER_DEFINE_RULES(field_operand_rule);
+
+bp::rule<struct block, IR::BlockHandle> block_rule = "block";
+auto const block_rule_def = bp::lexeme['#' >> bp::ulong_][([](auto &ctx) {
+    _val(ctx) = IR::BlockHandle{_attr(ctx)};
+})];
+BOOST_PARSER_DEFINE_RULES(block_rule);
+
+bp::rule<struct operand, Operand> operand_rule = "operand";
+auto const operand_rule_def = field_operand_rule[assign_operand] |
+                              local_rule[assign_operand] |
+                              block_rule[assign_operand] |
+                              ('@' > label_rule)[assign_operand] |
+                              atom_rule[assign_operand];
+BOOST_PARSER_DEFINE_RULES(operand_rule);
+
+bp::rule<struct weights> weights_rule = "branch weights";
+auto const weights_rule_def =
+    (bp::lit("weights") > '(' > bp::uint_ > ',' > bp::uint_ > ')')[set_weights];
+BOOST_PARSER_DEFINE_RULES(weights_rule);
+
+bp::rule<struct instruction> instruction_rule = "instruction";
+auto const instruction_rule_def =
+    (opcode_symbols > (operand_rule % ','))[append_instruction] >>
+    -weights_rule;
+BOOST_PARSER_DEFINE_RULES(instruction_rule);
+
+bp::rule<struct block_label> block_label_rule = "block label";
+auto const block_label_rule_def =
+    (bp::lexeme['#' >> bp::ulong_] >> ':')[begin_block];
+BOOST_PARSER_DEFINE_RULES(block_label_rule);
+
+bp::rule<struct local_declaration> local_declaration_rule = "let";
+auto const local_declaration_rule_def =
+    (bp::lit("let") > identifier_rule > ':' > type_rule >
+     -('=' > scalar_rule))[declare_local];
+BOOST_PARSER_DEFINE_RULES(local_declaration_rule);
+
+bp::rule<struct float_mode> float_mode_rule = "floating point mode";
+auto const float_mode_rule_def =
+    (bp::lit("fast") >>
+     -('(' > (fast_math_symbols % ',') > ')'))[set_fast_math] |
+    bp::lit("strict")[set_strict];
+BOOST_PARSER_DEFINE_RULES(float_mode_rule);
+
+bp::rule<struct argument> argument_rule = "argument";
+auto const argument_rule_def =
+    (identifier_rule > ':' > type_rule)[add_argument];
+BOOST_PARSER_DEFINE_RULES(argument_rule);
+
+/**
+ * fn name<T, ...>(argument: type, ...) -> type checked mode {
+ *     let local: type = scalar
+ *     opcode operand, operand, operand
+ * #1:
+ *     jlt #1, operand, operand weights(taken, fallthrough)
+ * }
+ *
+ * Each label #n: begins the next block, whose operand is #n. A
+ * conditional branch may be weighed by how often it is taken relative to
+ * how often it falls through, which places its block and is lowered to
+ * !prof metadata. A checked
+ * lambda traps on integer overflow; checked is optional, as is the mode of
+ * floating point arithmetic: strict, fast, or fast(flag, ...) with the
+ * flags of IR::FastMath, which are reassoc, contract, nnan, ninf and arcp.
+ * The type parameters are optional; a lambda which has them is generic,
+ * and its arguments, locals and return type may be of them. The fields of
+ * a local of a struct or tuple are operands of their own, %n.name or %n.0
+ * by position.
+ */
+bp::rule<struct lambda> lambda_rule = "lambda";
+auto const lambda_rule_def =
+    bp::lit("fn") > label_rule[begin_lambda] >
+    -('<' > (identifier_rule[add_type_parameter] % ',') > '>') > '(' >
+    -(argument_rule % ',') > ')' > bp::lit("->") > type_rule[end_header] >
+    -bp::lit("checked")[set_checked] > -float_mode_rule > '{' >
+    *local_declaration_rule > *(block_label_rule | instruction_rule) > '}';
+BOOST_PARSER_DEFINE_RULES(lambda_rule);
+
+bp::rule<struct definitions> definitions_rule = "definitions";
+auto const definitions_rule_def               = *lambda_rule > bp::eoi;
+BOOST_PARSER_DEFINE_RULES(definitions_rule);
+
+void parse_chunk(std::string_view text, Chunk &chunk) {
+    ChunkErrorHandler handler{chunk};
+    auto const parser = bp::with_error_handler(
+        bp::with_globals(definitions_rule, chunk), handler);
+
+    bool success = bp::parse(text, parser, bp::ws);
+    if (!success && chunk.diagnostics.empty()) {
+        handler.record(Diagnostic::Kind::Error,
+                       "failed to parse definitions",
+                       text.begin());
+    }
+}
+
+/**
+ * @brief sorts @p diagnostics by offset and prints them
+ *
+ * @return false if any of them is an error
+ */
+bool report(std::span<Diagnostic> diagnostics,
+            std::string_view filename,
+            std::string_view source,
+            std::size_t first_line = 1) {
+    std::ranges::stable_sort(diagnostics, {}, &Diagnostic::offset);
+    print(std::cerr, filename, source, diagnostics, first_line);
+    return std::ranges::none_of(diagnostics, [](Diagnostic const &diagnostic) {
+        return diagnostic.kind == Diagnostic::Kind::Error;
+    });
+}
+
+/**
+ * @brief appends the lambdas of each chunk to the module of @p ctx and
+ * prints the diagnostics of each chunk, in chunk order.
+ *
+ * The result does not depend on which thread parsed which chunk, or in
+ * which order they finished.
+ */
+bool merge(std::span<Chunk> chunks,
+           std::string_view filename,
+           std::string_view source,
+           env::Context &ctx) {
+    // the names already defined, as the module only finds a lambda by
+    // looking through each of them.
+    std::unordered_set<std::string_view> defined;
+    defined.reserve(ctx.ir().size());
+    for (IR::Lambda const &lambda : ctx.ir()) {
+        defined.insert(lambda.name().name);
+    }
+
+    std::vector<Diagnostic> diagnostics;
+    for (Chunk &chunk : chunks) {
+        for (Diagnostic &diagnostic : chunk.diagnostics) {
+            diagnostics.push_back(std::move(diagnostic));
+        }
+
+        for (std::size_t index = 0; index < chunk.lambdas.size(); ++index) {
+            IR::Lambda &lambda = chunk.lambdas[index];
+            if (!defined.insert(lambda.name().name).second) {
+                diagnostics.emplace_back(
+                    chunk.offsets[index],
+                    Diagnostic::Kind::Error,
+                    "redefinition of " + std::string{lambda.name().name});
+                continue;
+            }
+            ctx.ir().append(std::move(lambda));
+        }
+    }
+
+    // chunks are in source order, so sorting by offset only interleaves the
+    // redefinitions found here with the diagnostics of each chunk.
+    return report(diagnostics, filename, source);
+}
+
+/// chunks smaller than this are not worth a task of their own
+constexpr std::size_t parallel_grain = 64 * 1024;
+
+bool parse(std::string_view view,
+           std::string_view filename,
+           env::Context &ctx) {
+    std::vector<std::string_view> texts =
+        split_definitions(view, parallel_grain);
+
+    std::vector<Chunk> chunks;
+    chunks.reserve(texts.size());
+    for (std::size_t index = 0; index < texts.size(); ++index) {
+        chunks.push_back(Chunk{ctx, view.data(), {}, {}, {}, 0, {}, {}});
+    }
+
+    if (texts.size() < 2) {
+        for (std::size_t index = 0; index < texts.size(); ++index) {
+            parse_chunk(texts[index], chunks[index]);
+        }
+        return merge(chunks, filename, view, ctx);
+    }
+
+    support::ThreadPool pool{std::min<unsigned>(
+        support::ThreadPool::default_size(),
+        static_cast<unsigned>(texts.size()))};
+    std::vector<std::future<void>> pending;
+    pending.reserve(texts.size());
+    for (std::size_t index = 0; index < texts.size(); ++index) {
+        pending.push_back(pool.submit(
+            [&, index] { parse_chunk(texts[index], chunks[index]); }));
+    }
+    for (auto &task : pending) {
+        task.get();
+    }
+
+    return merge(chunks, filename, view, ctx);
+}
+
+bool parse(std::string_view view, env::Context &ctx) {
+    return parse(view, "<input>", ctx);
+}
+
+bool parse(fs::path path, env::Context &ctx) {
+    auto buffer = llvm::MemoryBuffer::getFile(path.string());
+    if (!buffer) {
+        std::cerr << path.string() << ": " << buffer.getError().message()
+                  << "\n";
+        return false;
+    }
+    return parse((*buffer)->getBuffer(), path.string(), ctx);
+}
+
+/// the size of each read from a stream
+constexpr std::size_t stream_chunk = 64 * 1024;
+
+/**
+ * @brief reads up to stream_chunk bytes from @p fd onto the end of
+ * @p buffer, without first zeroing the space they are read into.
+ *
+ * @return the number of bytes read, zero at the end of the stream, or a
+ * negative number on error, with errno set.
+ */
+ssize_t read_some(int fd, std::string &buffer) {
+    ssize_t count      = 0;
+    std::size_t filled = buffer.size();
+    auto fill          = [&](char *data, std::size_t) {
+        do {
+            count = ::read(fd, data + filled, stream_chunk);
+        } while (count < 0 && errno == EINTR);
+        return filled + static_cast<std::size_t>(std::max<ssize_t>(count, 0));
+    };
+    buffer.resize_and_overwrite(filled + stream_chunk, fill);
+    return count;
+}
+
+/**
+ * @brief parses one definition of a stream and hands its lambda to
+ * @p sink, unless an error was diagnosed.
+ *
+ * @param line the line number of the start of @p text
+ * @param defined the names of the lambdas seen so far
+ */
+bool parse_streamed(std::string_view text,
+                    std::string_view filename,
+                    std::size_t line,
+                    env::Context &ctx,
+                    std::unordered_set<std::string_view> &defined,
+                    LambdaSink sink) {
+    Chunk chunk{ctx, text.data(), {}, {}, {}, 0, {}, {}};
+    parse_chunk(text, chunk);
+
+    for (std::size_t index = 0; index < chunk.lambdas.size(); ++index) {
+        if (!defined.insert(chunk.lambdas[index].name().name).second) {
+            chunk.diagnostics.emplace_back(
+                chunk.offsets[index],
+                Diagnostic::Kind::Error,
+                "redefinition of " +
+                    std::string{chunk.lambdas[index].name().name});
+        }
+    }
+
+    if (!report(chunk.diagnostics, filename, text, line)) { return false; }
+
+    bool success = true;
+    for (IR::Lambda &lambda : chunk.lambdas) {
+        if (!sink(std::move(lambda))) { success = false; }
+    }
+    return success;
+}
+
+bool parse(int fd,
+           std::string_view filename,
+           env::Context &ctx,
+           LambdaSink sink) {
+    std::string buffer;
+    buffer.reserve(2 * stream_chunk);
+    std::unordered_set<std::string_view> defined;
+
+    bool success = true;
+    bool end     = false;
+    // the line number of the start of buffer
+    std::size_t line = 1;
+    // where to resume looking for the start of the next definition, so
+    // that a long definition is not searched again after every read.
+    std::size_t searched = 0;
+
+    while (!end) {
+        ssize_t count = read_some(fd, buffer);
+        if (count < 0) {
+            std::cerr << filename << ": " << std::strerror(errno) << "\n";
+            return false;
+        }
+        end = count == 0;
+
+        // a definition is complete once the next one has started, or the
+        // stream has ended.
+        std::string_view view = buffer;
+        std::size_t first     = 0;
+        while (first < view.size()) {
+            std::size_t last =
+                next_definition(view, std::max(searched, first + 1));
+            if (last == view.size() && !end) {
+                // the last few bytes may be the start of "\nfn ".
+                searched = std::max(first + 1,
+                                    view.size() - std::min<std::size_t>(
+                                                      view.size(), 3));
+                break;
+            }
+
+            std::string_view text = view.substr(first, last - first);
+            if (!parse_streamed(text, filename, line, ctx, defined, sink)) {
+                success = false;
+            }
+            line += static_cast<std::size_t>(std::ranges::count(text, '\n'));
+            first = last;
+        }
+
+        buffer.erase(0, first);
+        searched = searched > first ? searched - first : 0;
+    }
+
+    return success;
+}
 
 } // namespace fun::scan
@@ -0,0 +1,47 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file fast_math_tests.hpp
+ * @brief Defines tests for [FastMath](@ref FastMath)
+ */
+
+#pragma once
+
+#include <sstream>
+
+#include <boost/test/unit_test.hpp>
+
+#include "IR/fast_math.hpp"
+
+BOOST_AUTO_TEST_SUITE(fast_math_tests)
+
+BOOST_AUTO_TEST_CASE(fast_math_flags) {
+    using fun::IR::FastMath;
+    FastMath flags = FastMath::Reassociate | FastMath::Contract;
+    BOOST_TEST(fun::IR::has(flags, FastMath::Contract));
+    BOOST_TEST(!fun::IR::has(flags, FastMath::NoNaNs));
+    BOOST_TEST(!fun::IR::has(FastMath::None, FastMath::Reciprocal));
+    BOOST_TEST(fun::IR::has(FastMath::All, FastMath::Reciprocal));
+}
+
+BOOST_AUTO_TEST_CASE(fast_math_prints) {
+    using fun::IR::FastMath;
+    auto print = [](FastMath flags) {
+        std::ostringstream out;
+        out << flags;
+        return out.str();
+    };
+    BOOST_TEST(print(FastMath::None) == "strict");
+    BOOST_TEST(print(FastMath::All) == "fast");
+    BOOST_TEST(print(FastMath::NoNaNs | FastMath::Reassociate) ==
+               "fast(reassoc, nnan)");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -14,6 +14,8 @@
 
 #pragma once
 
+#include <sstream>
+
 #include <boost/test/unit_test.hpp>
 
 #include "IR/instruction.hpp"
@@ -59,6 +61,18 @@ BOOST_AUTO_TEST_CASE(instruction_load) {
     BOOST_TEST(I.C().is<fun::IR::Scalar::Nil>());
 }
 
+BOOST_AUTO_TEST_CASE(instruction_prints_padded_mnemonics) {
+    std::ostringstream out;
+    out << fun::IR::Instruction{fun::IR::Instruction::Opcode::Load,
+                                fun::IR::LocalHandle{0},
+                                fun::IR::LocalHandle{1}}
+        << "\n"
+        << fun::IR::Instruction{fun::IR::Instruction::Opcode::Neg,
+                                fun::IR::LocalHandle{0},
+                                fun::IR::LocalHandle{1}};
+    BOOST_TEST(out.str() == "load %0, %1\nneg  %0, %1");
+}
+
 BOOST_AUTO_TEST_CASE(instruction_neg) {
     fun::IR::Instruction I{fun::IR::Instruction::Opcode::Neg,
                            fun::IR::LocalHandle{0},
@@ -0,0 +1,94 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file layout_tests.hpp
+ * @brief Tests for [layout](@ref layout)
+ */
+
+#pragma once
+
+#include <sstream>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "IR/layout.hpp"
+#include "IR/structure.hpp"
+
+namespace layout_tests {
+
+using fun::IR::Label;
+using fun::IR::Type;
+
+/// struct { a: i8, b: i64, c: i16, d: i32 }, laid out by @p order
+inline Type mixed(Type::Struct::Order order) {
+    Type::Struct::Fields fields;
+    fields.emplace_back(Label{"a"}, std::make_unique<Type>(Type::i8{}));
+    fields.emplace_back(Label{"b"}, std::make_unique<Type>(Type::i64{}));
+    fields.emplace_back(Label{"c"}, std::make_unique<Type>(Type::i16{}));
+    fields.emplace_back(Label{"d"}, std::make_unique<Type>(Type::i32{}));
+    return Type{std::move(fields), order};
+}
+
+} // namespace layout_tests
+
+BOOST_AUTO_TEST_SUITE(layout_tests)
+
+BOOST_AUTO_TEST_CASE(reordered_fields_leave_no_padding) {
+    using namespace ::layout_tests;
+    Type record = mixed(Type::Struct::Order::Reordered);
+    fun::IR::Layout layout = fun::IR::layout(record.as<Type::Struct>());
+
+    BOOST_TEST(layout.size == 16U);
+    BOOST_TEST(layout.align == 8U);
+    BOOST_TEST((layout.order == std::vector<std::size_t>{1, 3, 2, 0}));
+    BOOST_TEST(
+        (layout.offsets == std::vector<std::uint64_t>{14, 0, 12, 8}));
+    BOOST_TEST(layout.position(0) == 3U);
+    BOOST_TEST(fun::IR::size_of(record) == 16U);
+}
+
+BOOST_AUTO_TEST_CASE(ordered_and_packed_keep_declared_order) {
+    using namespace ::layout_tests;
+    Type ordered = mixed(Type::Struct::Order::Ordered);
+    fun::IR::Layout layout = fun::IR::layout(ordered.as<Type::Struct>());
+    BOOST_TEST(layout.size == 24U);
+    BOOST_TEST(layout.align == 8U);
+    BOOST_TEST((layout.offsets == std::vector<std::uint64_t>{0, 8, 16, 20}));
+
+    Type packed = mixed(Type::Struct::Order::Packed);
+    layout      = fun::IR::layout(packed.as<Type::Struct>());
+    BOOST_TEST(layout.size == 15U);
+    BOOST_TEST(layout.align == 1U);
+    BOOST_TEST((layout.offsets == std::vector<std::uint64_t>{0, 1, 9, 11}));
+    BOOST_TEST(!fun::IR::same_structure(ordered, packed));
+}
+
+BOOST_AUTO_TEST_CASE(nested_structs_align_to_their_fields) {
+    using namespace ::layout_tests;
+    // (i8, struct { a: i8, b: i64, c: i16, d: i32 }), a tuple.
+    Type::Struct::Fields fields;
+    fields.emplace_back(Label{"0"}, std::make_unique<Type>(Type::i8{}));
+    fields.emplace_back(
+        Label{"1"},
+        std::make_unique<Type>(mixed(Type::Struct::Order::Reordered)));
+    Type tuple{std::move(fields), Type::Struct::Order::Reordered};
+
+    BOOST_TEST(fun::IR::size_of(tuple) == 24U);
+    BOOST_TEST(fun::IR::align_of(tuple) == 8U);
+    BOOST_TEST(fun::IR::layout(tuple.as<Type::Struct>()).offsets[0] == 16U);
+
+    std::ostringstream out;
+    out << tuple;
+    BOOST_TEST(out.str() == "(i8, struct {a: i8, b: i64, c: i16, d: i32})");
+    BOOST_TEST(fun::IR::same_structure(*tuple.clone(), tuple));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
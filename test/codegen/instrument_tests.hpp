@@ -0,0 +1,150 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file instrument_tests.hpp
+ * @brief Defines tests for [instrument](@ref fun::codegen::instrument)
+ */
+
+#pragma once
+
+#include <memory>
+#include <string_view>
+
+#include <boost/test/unit_test.hpp>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/Operator.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "codegen/instrument.hpp"
+#include "codegen/to_llvm.hpp"
+#include "env/context.hpp"
+#include "scan/parse.hpp"
+
+namespace instrument_tests {
+
+constexpr std::string_view square = "fn square(x: i64) -> i64 {\n"
+                                    "    mul %0, %0, %0\n"
+                                    "    ret %0\n"
+                                    "}\n";
+
+/// a context for any x86-64, whatever the host, holding square, lowered
+inline std::unique_ptr<fun::env::Context> lowered() {
+    llvm::InitializeAllTargetInfos();
+    llvm::InitializeAllTargets();
+    llvm::InitializeAllTargetMCs();
+
+    auto ctx = std::make_unique<fun::env::Context>(
+        "square.fun",
+        fun::env::TargetKey{"x86_64-unknown-linux-gnu", "x86-64", ""});
+    BOOST_REQUIRE(fun::scan::parse(square, *ctx));
+    BOOST_REQUIRE(fun::codegen::to_llvm(ctx->ir(), *ctx));
+    return ctx;
+}
+
+/// the field of @p counters which @p store writes, or -1 if it writes
+/// something else
+inline int field(llvm::StoreInst const &store,
+                 llvm::GlobalVariable const *counters) {
+    llvm::Value const *pointer = store.getPointerOperand();
+    if (pointer == counters) { return 0; }
+    auto const *element = llvm::dyn_cast<llvm::GEPOperator>(pointer);
+    if (element == nullptr || element->getPointerOperand() != counters) {
+        return -1;
+    }
+    auto const *last = llvm::cast<llvm::ConstantInt>(
+        element->getOperand(element->getNumOperands() - 1));
+    return static_cast<int>(last->getZExtValue());
+}
+
+/// whether @p block reads the cycle counter, then writes @p field of
+/// @p counters
+inline bool bumps(llvm::BasicBlock const &block,
+                  llvm::GlobalVariable const *counters,
+                  int field) {
+    bool ticked = false;
+    for (llvm::Instruction const &instruction : block) {
+        auto const *call = llvm::dyn_cast<llvm::IntrinsicInst>(&instruction);
+        if (call != nullptr &&
+            call->getIntrinsicID() == llvm::Intrinsic::readcyclecounter) {
+            ticked = true;
+        }
+        auto const *store = llvm::dyn_cast<llvm::StoreInst>(&instruction);
+        if (store != nullptr &&
+            instrument_tests::field(*store, counters) == field) {
+            return ticked;
+        }
+    }
+    return false;
+}
+
+} // namespace instrument_tests
+
+BOOST_AUTO_TEST_SUITE(instrument_tests)
+
+BOOST_AUTO_TEST_CASE(every_lambda_gets_thread_local_counters) {
+    auto ctx             = instrument_tests::lowered();
+    llvm::Module &module = ctx->llvm_module();
+    BOOST_REQUIRE(fun::codegen::instrument(*ctx));
+    BOOST_TEST(!llvm::verifyModule(module, &llvm::errs()));
+
+    llvm::GlobalVariable const *counters =
+        module.getNamedGlobal("fun.profile.square");
+    BOOST_REQUIRE(counters != nullptr);
+    BOOST_TEST(counters->getThreadLocalMode() ==
+               llvm::GlobalValue::LocalExecTLSModel);
+    auto const *type =
+        llvm::dyn_cast<llvm::StructType>(counters->getValueType());
+    BOOST_REQUIRE(type != nullptr);
+    BOOST_TEST(type->getNumElements() == 2U);
+}
+
+BOOST_AUTO_TEST_CASE(calls_are_counted_on_entry_and_timed_to_each_return) {
+    auto ctx             = instrument_tests::lowered();
+    llvm::Module &module = ctx->llvm_module();
+    BOOST_REQUIRE(fun::codegen::instrument(*ctx));
+    llvm::Function *function = module.getFunction("square");
+    BOOST_REQUIRE(function != nullptr);
+    llvm::GlobalVariable const *counters =
+        module.getNamedGlobal("fun.profile.square");
+    BOOST_REQUIRE(counters != nullptr);
+
+    // the calls are field 0, and the ticks field 1.
+    BOOST_TEST(
+        instrument_tests::bumps(function->getEntryBlock(), counters, 0));
+    unsigned returns = 0;
+    for (llvm::BasicBlock const &block : *function) {
+        if (llvm::isa<llvm::ReturnInst>(block.getTerminator())) {
+            BOOST_TEST(instrument_tests::bumps(block, counters, 1));
+            ++returns;
+        }
+    }
+    BOOST_TEST(returns != 0U);
+}
+
+BOOST_AUTO_TEST_CASE(the_profile_is_dumped_by_a_destructor) {
+    auto ctx             = instrument_tests::lowered();
+    llvm::Module &module = ctx->llvm_module();
+    BOOST_REQUIRE(fun::codegen::instrument(*ctx));
+
+    llvm::Function const *dump = module.getFunction("fun.profile.dump");
+    BOOST_REQUIRE(dump != nullptr);
+    auto const *destructors = llvm::cast<llvm::ConstantArray>(
+        module.getNamedGlobal("llvm.global_dtors")->getInitializer());
+    BOOST_REQUIRE(destructors->getNumOperands() == 1U);
+    auto const *destructor =
+        llvm::cast<llvm::ConstantStruct>(destructors->getOperand(0));
+    BOOST_TEST(destructor->getOperand(1) == dump);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
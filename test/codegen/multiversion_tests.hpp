@@ -0,0 +1,163 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file multiversion_tests.hpp
+ * @brief Defines tests for [multiversion](@ref fun::codegen::multiversion)
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "codegen/multiversion.hpp"
+#include "codegen/to_llvm.hpp"
+#include "env/context.hpp"
+#include "scan/parse.hpp"
+
+namespace multiversion_tests {
+
+constexpr std::string_view square = "fn square(x: i64) -> i64 {\n"
+                                    "    mul %0, %0, %0\n"
+                                    "    ret %0\n"
+                                    "}\n";
+
+/// a context for any x86-64, whatever the host, holding square, lowered
+inline std::unique_ptr<fun::env::Context> lowered() {
+    llvm::InitializeAllTargetInfos();
+    llvm::InitializeAllTargets();
+    llvm::InitializeAllTargetMCs();
+
+    auto ctx = std::make_unique<fun::env::Context>(
+        "square.fun",
+        fun::env::TargetKey{"x86_64-unknown-linux-gnu", "x86-64-v3", ""});
+    BOOST_REQUIRE(fun::scan::parse(square, *ctx));
+    BOOST_REQUIRE(fun::codegen::to_llvm(ctx->ir(), *ctx));
+    return ctx;
+}
+
+/// the cpu @p function is compiled for, or "" if it is the target's
+inline std::string cpu(llvm::Function const *function) {
+    return function->getFnAttribute("target-cpu").getValueAsString().str();
+}
+
+/// the value the resolver stores into @p pointer
+inline llvm::Value const *resolved(llvm::Function const &resolver,
+                             llvm::GlobalVariable const *pointer) {
+    for (llvm::BasicBlock const &block : resolver) {
+        for (llvm::Instruction const &instruction : block) {
+            auto const *store = llvm::dyn_cast<llvm::StoreInst>(&instruction);
+            if (store != nullptr && store->getPointerOperand() == pointer) {
+                return store->getValueOperand();
+            }
+        }
+    }
+    return nullptr;
+}
+
+} // namespace multiversion_tests
+
+BOOST_AUTO_TEST_SUITE(multiversion_tests)
+
+BOOST_AUTO_TEST_CASE(multiversion_clones_for_every_level) {
+    auto ctx             = multiversion_tests::lowered();
+    llvm::Module &module = ctx->llvm_module();
+    BOOST_REQUIRE(fun::codegen::multiversion({"square"}, {}, *ctx));
+    BOOST_TEST(!llvm::verifyModule(module, &llvm::errs()));
+
+    for (std::string level : {"x86-64-v2", "x86-64-v3", "x86-64-v4"}) {
+        llvm::Function const *clone =
+            module.getFunction("fun.clone.square." + level);
+        BOOST_REQUIRE(clone != nullptr);
+        BOOST_TEST(multiversion_tests::cpu(clone) == level);
+        BOOST_TEST(clone->getFnAttribute("target-features")
+                       .getValueAsString()
+                       .empty());
+    }
+
+    // the default runs on every x86-64, though the target is x86-64-v3.
+    llvm::Function const *fallback =
+        module.getFunction("fun.clone.square.default");
+    BOOST_REQUIRE(fallback != nullptr);
+    BOOST_TEST(multiversion_tests::cpu(fallback) == "x86-64");
+
+    llvm::GlobalVariable const *pointer =
+        module.getNamedGlobal("fun.dispatch.square");
+    BOOST_REQUIRE(pointer != nullptr);
+    BOOST_TEST(pointer->getInitializer() == fallback);
+
+    llvm::Function const *square = module.getFunction("square");
+    BOOST_REQUIRE(square != nullptr);
+    BOOST_TEST(square->hasFnAttribute(llvm::Attribute::AlwaysInline));
+}
+
+BOOST_AUTO_TEST_CASE(multiversion_clones_for_chosen_levels) {
+    auto ctx             = multiversion_tests::lowered();
+    llvm::Module &module = ctx->llvm_module();
+    BOOST_REQUIRE(
+        fun::codegen::multiversion({"square"}, {"x86-64-v3"}, *ctx));
+
+    BOOST_TEST(module.getFunction("fun.clone.square.default") != nullptr);
+    BOOST_TEST(module.getFunction("fun.clone.square.x86-64-v3") != nullptr);
+    BOOST_TEST(module.getFunction("fun.clone.square.x86-64-v2") == nullptr);
+    BOOST_TEST(module.getFunction("fun.clone.square.x86-64-v4") == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(resolver_prefers_the_most_capable_level) {
+    auto ctx             = multiversion_tests::lowered();
+    llvm::Module &module = ctx->llvm_module();
+    BOOST_REQUIRE(fun::codegen::multiversion({"square"}, {}, *ctx));
+
+    llvm::Function const *resolver = module.getFunction("fun.resolve");
+    BOOST_REQUIRE(resolver != nullptr);
+    BOOST_TEST(multiversion_tests::cpu(resolver) == "x86-64");
+
+    // it runs before the entry lambda, as a constructor.
+    auto const *constructors = llvm::cast<llvm::ConstantArray>(
+        module.getNamedGlobal("llvm.global_ctors")->getInitializer());
+    BOOST_REQUIRE(constructors->getNumOperands() == 1U);
+    auto const *constructor =
+        llvm::cast<llvm::ConstantStruct>(constructors->getOperand(0));
+    BOOST_TEST(constructor->getOperand(1) == resolver);
+
+    // each level, the most capable first, then the default.
+    llvm::Value const *choice = multiversion_tests::resolved(
+        *resolver, module.getNamedGlobal("fun.dispatch.square"));
+    std::vector<std::string> order;
+    while (auto const *select =
+               llvm::dyn_cast_or_null<llvm::SelectInst>(choice)) {
+        order.push_back(select->getTrueValue()->getName().str());
+        choice = select->getFalseValue();
+    }
+    BOOST_REQUIRE(choice != nullptr);
+    order.push_back(choice->getName().str());
+    BOOST_TEST((order == std::vector<std::string>{
+                             "fun.clone.square.x86-64-v4",
+                             "fun.clone.square.x86-64-v3",
+                             "fun.clone.square.x86-64-v2",
+                             "fun.clone.square.default"}));
+}
+
+BOOST_AUTO_TEST_CASE(multiversion_rejects_what_it_cannot_clone) {
+    auto ctx = multiversion_tests::lowered();
+    BOOST_TEST(!fun::codegen::multiversion({"square"}, {"x86-64-v5"}, *ctx));
+    BOOST_TEST(!fun::codegen::multiversion({"cube"}, {}, *ctx));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
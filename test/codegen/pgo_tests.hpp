@@ -0,0 +1,116 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file pgo_tests.hpp
+ * @brief Defines tests for [generate_profile](@ref
+ * fun::codegen::generate_profile) and [use_profile](@ref
+ * fun::codegen::use_profile)
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/ProfDataUtils.h>
+#include <llvm/IR/StructuralHash.h>
+#include <llvm/Support/TargetSelect.h>
+
+#include "codegen/pgo.hpp"
+#include "codegen/profile.hpp"
+#include "codegen/to_llvm.hpp"
+#include "env/context.hpp"
+#include "scan/parse.hpp"
+
+namespace pgo_tests {
+
+/// a loop, whose header joins the entry and the back edge
+constexpr std::string_view loop = "fn count(n: i64) -> i64 {\n"
+                                  "    let i: i64\n"
+                                  "    load %1, 0\n"
+                                  "#1:\n"
+                                  "    jge #2, %1, %0\n"
+                                  "    add %1, %1, 1\n"
+                                  "    jmp #1\n"
+                                  "#2:\n"
+                                  "    ret %1\n"
+                                  "}\n";
+
+inline std::unique_ptr<fun::env::Context> lowered() {
+    llvm::InitializeNativeTarget();
+    auto ctx = std::make_unique<fun::env::Context>("loop.fun");
+    BOOST_REQUIRE(fun::scan::parse(loop, *ctx));
+    BOOST_REQUIRE(fun::codegen::to_llvm(ctx->ir(), *ctx));
+    return ctx;
+}
+
+/// the one conditional branch of @p function
+inline llvm::BranchInst *branch(llvm::Function &function) {
+    for (llvm::BasicBlock &block : function) {
+        auto *found =
+            llvm::dyn_cast_or_null<llvm::BranchInst>(block.getTerminator());
+        if (found != nullptr && found->isConditional()) { return found; }
+    }
+    return nullptr;
+}
+
+} // namespace pgo_tests
+
+BOOST_AUTO_TEST_SUITE(pgo_tests)
+
+BOOST_AUTO_TEST_CASE(generated_runs_are_laid_out_whole) {
+    auto ctx                 = pgo_tests::lowered();
+    llvm::Function *function = ctx->llvm_module().getFunction("count");
+    BOOST_REQUIRE(function != nullptr);
+    std::uint64_t const blocks = function->size();
+    BOOST_REQUIRE(fun::codegen::generate_profile("count.profile", *ctx));
+
+    // the run header, then the name size, the name in a word, the hash,
+    // the number of counts, a count per block, and one for the branch.
+    auto const *run = ctx->llvm_module().getNamedGlobal("fun.pgo.run");
+    BOOST_REQUIRE(run != nullptr);
+    auto const *type = llvm::cast<llvm::ArrayType>(run->getValueType());
+    BOOST_TEST(type->getNumElements() == 2 + 4 + blocks + 1);
+}
+
+BOOST_AUTO_TEST_CASE(branch_weights_follow_taken_edges) {
+    auto ctx                 = pgo_tests::lowered();
+    llvm::Function *function = ctx->llvm_module().getFunction("count");
+    BOOST_REQUIRE(function != nullptr);
+
+    // every block runs 11 times, but the loop is left only once; the
+    // counts of the blocks alone would weigh both edges the same.
+    std::vector<std::uint64_t> counts(function->size(), 11);
+    counts.push_back(1);
+    std::string bytes = fun::codegen::Profile::run_header(1) +
+                        fun::codegen::Profile::record_header(
+                            "count",
+                            llvm::StructuralHash(*function, true),
+                            counts.size());
+    for (std::uint64_t count : counts) {
+        bytes.append(reinterpret_cast<char const *>(&count), sizeof(count));
+    }
+    fun::codegen::Profile profile;
+    BOOST_REQUIRE(profile.merge(bytes));
+    fun::codegen::use_profile(profile, *ctx);
+
+    llvm::BranchInst *leave = pgo_tests::branch(*function);
+    BOOST_REQUIRE(leave != nullptr);
+    llvm::SmallVector<std::uint32_t, 2> weights;
+    BOOST_REQUIRE(llvm::extractBranchWeights(*leave, weights));
+    BOOST_TEST((weights == llvm::SmallVector<std::uint32_t, 2>{1, 10}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,90 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file profile_tests.hpp
+ * @brief Defines tests for [Profile](@ref Profile)
+ */
+
+#pragma once
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "codegen/profile.hpp"
+
+namespace profile_tests {
+
+/// a run, as a program built with --profile-generate appends it
+inline std::string
+run(std::vector<std::pair<std::string_view, std::vector<std::uint64_t>>>
+        functions,
+    std::uint64_t hash = 7) {
+    using fun::codegen::Profile;
+    std::string bytes = Profile::run_header(functions.size());
+    for (auto const &[name, blocks] : functions) {
+        bytes += Profile::record_header(name, hash, blocks.size());
+        std::string counts(blocks.size() * sizeof(std::uint64_t), '\0');
+        std::memcpy(counts.data(), blocks.data(), counts.size());
+        bytes += counts;
+    }
+    return bytes;
+}
+
+} // namespace profile_tests
+
+BOOST_AUTO_TEST_SUITE(profile_tests)
+
+BOOST_AUTO_TEST_CASE(profile_merges_runs) {
+    fun::codegen::Profile profile;
+    std::string bytes = run({{"main", {1, 0, 1}}, {"fib", {10, 4, 6}}}) +
+                        run({{"main", {1, 1, 0}}, {"fib", {20, 8, 12}}});
+    BOOST_REQUIRE(profile.merge(bytes));
+    BOOST_TEST(profile.size() == 2U);
+
+    auto const *main = profile.find("main");
+    BOOST_REQUIRE(main != nullptr);
+    BOOST_TEST(main->hash == 7U);
+    BOOST_TEST((main->blocks == std::vector<std::uint64_t>{2, 1, 1}));
+
+    auto const *fib = profile.find("fib");
+    BOOST_REQUIRE(fib != nullptr);
+    BOOST_TEST((fib->blocks == std::vector<std::uint64_t>{30, 12, 18}));
+    BOOST_TEST(profile.find("square") == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(profile_replaces_changed_functions) {
+    fun::codegen::Profile profile;
+    std::string bytes =
+        run({{"fib", {10, 4, 6}}}) + run({{"fib", {3, 3}}}, 8);
+    BOOST_REQUIRE(profile.merge(bytes));
+
+    auto const *fib = profile.find("fib");
+    BOOST_REQUIRE(fib != nullptr);
+    BOOST_TEST(fib->hash == 8U);
+    BOOST_TEST((fib->blocks == std::vector<std::uint64_t>{3, 3}));
+}
+
+BOOST_AUTO_TEST_CASE(profile_rejects_truncated_runs) {
+    fun::codegen::Profile profile;
+    std::string bytes     = run({{"main", {1}}});
+    std::string truncated = run({{"main", {5, 5}}});
+    truncated.resize(truncated.size() - 1);
+    BOOST_TEST(!profile.merge(bytes + truncated));
+
+    auto const *main = profile.find("main");
+    BOOST_REQUIRE(main != nullptr);
+    BOOST_TEST((main->blocks == std::vector<std::uint64_t>{1}));
+    BOOST_TEST(!profile.merge("not a profile"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
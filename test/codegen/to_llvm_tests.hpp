@@ -0,0 +1,151 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file to_llvm_tests.hpp
+ * @brief Defines tests for [to_llvm](@ref fun::codegen::to_llvm)
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/ProfDataUtils.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "codegen/to_llvm.hpp"
+#include "env/context.hpp"
+#include "scan/parse.hpp"
+
+namespace to_llvm_tests {
+
+/// reads and writes elements through slices of two types, and an array
+constexpr std::string_view scale = "fn scale(s: [i64], t: [f64]) -> i64 {\n"
+                                   "    let i: u64\n"
+                                   "    let x: i64\n"
+                                   "    let y: f64\n"
+                                   "    let a: [i64; 4]\n"
+                                   "    subscript %3, %0, %2\n"
+                                   "    subscript %4, %1, %2\n"
+                                   "    insert %0, %2, %3\n"
+                                   "    insert %5, %2, %3\n"
+                                   "    ret %3\n"
+                                   "}\n";
+
+/// a loop, whose branch out of it the source weighs
+constexpr std::string_view count = "fn count(n: i64) -> i64 {\n"
+                                   "    let i: i64\n"
+                                   "    load %1, 0\n"
+                                   "#1:\n"
+                                   "    jge #2, %1, %0 weights(1, 10)\n"
+                                   "    add %1, %1, 1\n"
+                                   "    jmp #1\n"
+                                   "#2:\n"
+                                   "    ret %1\n"
+                                   "}\n";
+
+inline std::unique_ptr<fun::env::Context>
+lowered(std::string_view source = scale) {
+    llvm::InitializeNativeTarget();
+    auto ctx = std::make_unique<fun::env::Context>("lowered.fun");
+    BOOST_REQUIRE(fun::scan::parse(source, *ctx));
+    BOOST_REQUIRE(fun::codegen::to_llvm(ctx->ir(), *ctx));
+    return ctx;
+}
+
+/// the TBAA access tag of each load and store of @p function which has one
+inline std::vector<llvm::MDNode *> tags(llvm::Function &function) {
+    std::vector<llvm::MDNode *> found;
+    for (llvm::Instruction &instruction : llvm::instructions(function)) {
+        if (llvm::isa<llvm::LoadInst, llvm::StoreInst>(instruction)) {
+            if (llvm::MDNode *tag =
+                    instruction.getMetadata(llvm::LLVMContext::MD_tbaa)) {
+                found.push_back(tag);
+            }
+        }
+    }
+    return found;
+}
+
+} // namespace to_llvm_tests
+
+BOOST_AUTO_TEST_SUITE(to_llvm_tests)
+
+BOOST_AUTO_TEST_CASE(elements_through_slices_are_tagged_by_type) {
+    auto ctx                 = to_llvm_tests::lowered();
+    llvm::Function *function = ctx->llvm_module().getFunction("scale");
+    BOOST_REQUIRE(function != nullptr);
+    BOOST_TEST(!llvm::verifyModule(ctx->llvm_module(), &llvm::errs()));
+
+    // the load of an i64 and of an f64, then the store of an i64; the
+    // store into the array, and those of the cells, need no tag.
+    std::vector<llvm::MDNode *> const found = to_llvm_tests::tags(*function);
+    BOOST_REQUIRE(found.size() == 3U);
+    BOOST_TEST(found[0] != found[1]);
+    BOOST_TEST(found[0] == found[2]);
+}
+
+BOOST_AUTO_TEST_CASE(pointers_of_slices_are_nonnull) {
+    auto ctx                 = to_llvm_tests::lowered();
+    llvm::Function *function = ctx->llvm_module().getFunction("scale");
+    BOOST_REQUIRE(function != nullptr);
+
+    // one pointer is loaded for each access through a slice.
+    unsigned nonnull = 0;
+    for (llvm::Instruction &instruction : llvm::instructions(*function)) {
+        auto *load = llvm::dyn_cast<llvm::LoadInst>(&instruction);
+        if (load != nullptr && load->getType()->isPointerTy()) {
+            BOOST_TEST(load->hasMetadata(llvm::LLVMContext::MD_nonnull));
+            ++nonnull;
+        }
+    }
+    BOOST_TEST(nonnull == 3U);
+}
+
+BOOST_AUTO_TEST_CASE(weighed_branches_carry_their_weights) {
+    auto ctx = to_llvm_tests::lowered(to_llvm_tests::count);
+    auto const &weights = ctx->ir().begin()->body()[1].weights();
+    BOOST_REQUIRE(weights.has_value());
+    BOOST_TEST(weights->taken == 1U);
+    BOOST_TEST(weights->fallthrough == 10U);
+
+    llvm::Function *function = ctx->llvm_module().getFunction("count");
+    BOOST_REQUIRE(function != nullptr);
+    unsigned weighed = 0;
+    for (llvm::Instruction &instruction : llvm::instructions(*function)) {
+        auto *branch = llvm::dyn_cast<llvm::BranchInst>(&instruction);
+        llvm::SmallVector<std::uint32_t, 2> found;
+        if (branch != nullptr && branch->isConditional() &&
+            llvm::extractBranchWeights(*branch, found)) {
+            BOOST_TEST((found == llvm::SmallVector<std::uint32_t, 2>{1, 10}));
+            ++weighed;
+        }
+    }
+    BOOST_TEST(weighed == 1U);
+}
+
+BOOST_AUTO_TEST_CASE(only_conditional_branches_are_weighed) {
+    llvm::InitializeNativeTarget();
+    fun::env::Context ctx{"jump.fun"};
+    BOOST_TEST(!fun::scan::parse("fn jump() -> nil {\n"
+                                 "#0:\n"
+                                 "    jmp #0 weights(1, 10)\n"
+                                 "}\n",
+                                 ctx));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
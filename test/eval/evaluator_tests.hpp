@@ -0,0 +1,474 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file evaluator_tests.hpp
+ * @brief Defines tests for [Evaluator](@ref Evaluator) and
+ * [EvaluateConstants](@ref EvaluateConstants)
+ */
+
+#pragma once
+
+#include <limits>
+
+#include <boost/test/unit_test.hpp>
+
+#include "eval/evaluator.hpp"
+#include "pass/evaluate_constants.hpp"
+
+namespace evaluator_tests {
+
+using fun::IR::Instruction;
+using fun::IR::LocalHandle;
+using fun::IR::Scalar;
+using fun::IR::Type;
+
+inline Type::Ptr i64() { return std::make_unique<Type>(Type::i64{}); }
+
+/// square(x: i64) -> i64 { let r: i64; mul %1, %0, %0; ret %1 }
+inline fun::IR::Lambda square() {
+    fun::IR::Lambda::Arguments arguments;
+    arguments.emplace_back(fun::IR::Label{"x"}, i64());
+    fun::IR::Lambda lambda{
+        fun::IR::Label{"square"}, i64(), std::move(arguments)};
+    lambda.declare(fun::IR::Local{fun::IR::Label{"r"}, i64(), {}});
+    fun::IR::Block &block = lambda.body().emplace_back();
+    block.append(Instruction::Opcode::Mul,
+                 LocalHandle{1},
+                 LocalHandle{0},
+                 LocalHandle{0});
+    block.append(Instruction::Opcode::Ret, LocalHandle{1});
+    return lambda;
+}
+
+/// loop() -> i64 { let r: i64; call %0, @loop; ret %0 }
+inline fun::IR::Lambda loop() {
+    fun::IR::Lambda lambda{fun::IR::Label{"loop"}, i64(), {}};
+    lambda.declare(fun::IR::Local{fun::IR::Label{"r"}, i64(), {}});
+    fun::IR::Block &block = lambda.body().emplace_back();
+    block.append(
+        Instruction::Opcode::Call, LocalHandle{0}, fun::IR::Label{"loop"});
+    block.append(Instruction::Opcode::Ret, LocalHandle{0});
+    return lambda;
+}
+
+/**
+ * main() -> i64 {
+ *     let x: i64 = 7
+ *     let y: i64
+ *     call %1, @square, %0
+ *     ret %1
+ * }
+ */
+inline fun::IR::Lambda main() {
+    fun::IR::Lambda lambda{fun::IR::Label{"main"}, i64(), {}};
+    lambda.declare(
+        fun::IR::Local{fun::IR::Label{"x"}, i64(), Scalar{Scalar::i64{7}}});
+    lambda.declare(fun::IR::Local{fun::IR::Label{"y"}, i64(), {}});
+    fun::IR::Block &block = lambda.body().emplace_back();
+    block.append(Instruction::Opcode::Call,
+                 LocalHandle{1},
+                 fun::IR::Label{"square"},
+                 LocalHandle{0});
+    block.append(Instruction::Opcode::Ret, LocalHandle{1});
+    return lambda;
+}
+
+/**
+ * sum(n: i64) -> i64 {
+ *     let i: i64
+ *     let s: i64
+ *     let c: bool
+ *     jle #2, %0, 0
+ * #1:
+ *     add %2, %2, %1
+ *     add %1, %1, 1
+ *     lt  %3, %1, %0
+ *     jnz #1, %3
+ * #2:
+ *     ret %2
+ * }
+ */
+inline fun::IR::Lambda sum() {
+    using fun::IR::BlockHandle;
+    fun::IR::Lambda::Arguments arguments;
+    arguments.emplace_back(fun::IR::Label{"n"}, i64());
+    fun::IR::Lambda lambda{fun::IR::Label{"sum"}, i64(), std::move(arguments)};
+    lambda.declare(fun::IR::Local{fun::IR::Label{"i"}, i64(), {}});
+    lambda.declare(fun::IR::Local{fun::IR::Label{"s"}, i64(), {}});
+    lambda.declare(fun::IR::Local{fun::IR::Label{"c"},
+                                  std::make_unique<Type>(Type::Bool{}),
+                                  {}});
+    fun::IR::Lambda::Body &body = lambda.body();
+    body.emplace_back().append(Instruction::Opcode::Jle,
+                               BlockHandle{2},
+                               LocalHandle{0},
+                               Scalar::i64{0});
+    fun::IR::Block &loop = body.emplace_back();
+    loop.append(Instruction::Opcode::Add,
+                LocalHandle{2},
+                LocalHandle{2},
+                LocalHandle{1});
+    loop.append(Instruction::Opcode::Add,
+                LocalHandle{1},
+                LocalHandle{1},
+                Scalar::i64{1});
+    loop.append(Instruction::Opcode::Lt,
+                LocalHandle{3},
+                LocalHandle{1},
+                LocalHandle{0});
+    loop.append(Instruction::Opcode::Jnz, BlockHandle{1}, LocalHandle{3});
+    body.emplace_back().append(Instruction::Opcode::Ret, LocalHandle{2});
+    return lambda;
+}
+
+/**
+ * g(x: i64, y: i64) -> i64 { add %0, %0, %1; ret %0 }
+ * h() -> i64 { let r: i64 = 5; ret %0 }
+ * main() -> i64 {
+ *     let r: i64
+ *     let a: i64 = 1
+ *     let b: i64
+ *     call %0, @g, %1
+ *     call %2, @h
+ *     ret %0
+ * }
+ *
+ * where g reads b before h writes it.
+ */
+inline fun::IR::Module read_before_written() {
+    using fun::IR::Label;
+    fun::IR::Lambda::Arguments arguments;
+    arguments.emplace_back(Label{"x"}, i64());
+    arguments.emplace_back(Label{"y"}, i64());
+    fun::IR::Lambda g{Label{"g"}, i64(), std::move(arguments)};
+    fun::IR::Block &add = g.body().emplace_back();
+    add.append(Instruction::Opcode::Add,
+               LocalHandle{0},
+               LocalHandle{0},
+               LocalHandle{1});
+    add.append(Instruction::Opcode::Ret, LocalHandle{0});
+
+    fun::IR::Lambda h{Label{"h"}, i64(), {}};
+    h.declare(fun::IR::Local{Label{"r"}, i64(), Scalar{Scalar::i64{5}}});
+    h.body().emplace_back().append(Instruction::Opcode::Ret, LocalHandle{0});
+
+    fun::IR::Lambda lambda{Label{"main"}, i64(), {}};
+    lambda.declare(fun::IR::Local{Label{"r"}, i64(), {}});
+    lambda.declare(
+        fun::IR::Local{Label{"a"}, i64(), Scalar{Scalar::i64{1}}});
+    lambda.declare(fun::IR::Local{Label{"b"}, i64(), {}});
+    fun::IR::Block &block = lambda.body().emplace_back();
+    block.append(
+        Instruction::Opcode::Call, LocalHandle{0}, Label{"g"}, LocalHandle{1});
+    block.append(Instruction::Opcode::Call, LocalHandle{2}, Label{"h"});
+    block.append(Instruction::Opcode::Ret, LocalHandle{0});
+
+    fun::IR::Module module;
+    module.append(std::move(g));
+    module.append(std::move(h));
+    module.append(std::move(lambda));
+    return module;
+}
+
+} // namespace evaluator_tests
+
+BOOST_AUTO_TEST_SUITE(evaluator_tests)
+
+BOOST_AUTO_TEST_CASE(fold_wraps_and_traps) {
+    using fun::eval::Error;
+    using fun::eval::fold;
+    using fun::IR::Instruction;
+    using fun::IR::Scalar;
+
+    Scalar result;
+    BOOST_TEST(fold(Instruction::Opcode::Add,
+                    Scalar{Scalar::i8{127}},
+                    Scalar{Scalar::i8{1}},
+                    result) == Error::None);
+    BOOST_TEST(result.as<Scalar::i8>() == -128);
+
+    BOOST_TEST(fold(Instruction::Opcode::Mul,
+                    Scalar{Scalar::u16{65535}},
+                    Scalar{Scalar::u16{65535}},
+                    result) == Error::None);
+    BOOST_TEST(result.as<Scalar::u16>() == 1);
+
+    BOOST_TEST(fold(Instruction::Opcode::Div,
+                    Scalar{Scalar::i32{1}},
+                    Scalar{Scalar::i32{0}},
+                    result) == Error::DivideByZero);
+    BOOST_TEST(fold(Instruction::Opcode::Rem,
+                    Scalar{Scalar::i64{INT64_MIN}},
+                    Scalar{Scalar::i64{-1}},
+                    result) == Error::Overflow);
+    BOOST_TEST(fold(Instruction::Opcode::Add,
+                    Scalar{Scalar::i64{1}},
+                    Scalar{Scalar::i32{1}},
+                    result) == Error::TypeMismatch);
+}
+
+BOOST_AUTO_TEST_CASE(checked_fold_traps_on_overflow) {
+    using fun::eval::Error;
+    using fun::eval::fold;
+    using fun::IR::FastMath;
+    using fun::IR::Instruction;
+    using fun::IR::Scalar;
+
+    Scalar result;
+    BOOST_TEST(fold(Instruction::Opcode::Add,
+                    Scalar{Scalar::i8{127}},
+                    Scalar{Scalar::i8{1}},
+                    result,
+                    FastMath::None,
+                    true) == Error::Overflow);
+    BOOST_TEST(fold(Instruction::Opcode::Sub,
+                    Scalar{Scalar::u32{0}},
+                    Scalar{Scalar::u32{1}},
+                    result,
+                    FastMath::None,
+                    true) == Error::Overflow);
+    BOOST_TEST(fold(Instruction::Opcode::Mul,
+                    Scalar{Scalar::i16{100}},
+                    Scalar{Scalar::i16{-300}},
+                    result,
+                    FastMath::None,
+                    true) == Error::None);
+    BOOST_TEST(result.as<Scalar::i16>() == -30000);
+}
+
+BOOST_AUTO_TEST_CASE(fold_compares) {
+    using fun::eval::Error;
+    using fun::eval::fold;
+    using fun::eval::taken;
+    using fun::IR::Instruction;
+    using fun::IR::Scalar;
+
+    Scalar result;
+    BOOST_TEST(fold(Instruction::Opcode::Lt,
+                    Scalar{Scalar::u8{255}},
+                    Scalar{Scalar::u8{1}},
+                    result) == Error::None);
+    BOOST_TEST(!result.as<Scalar::Bool>());
+    BOOST_TEST(fold(Instruction::Opcode::Lt,
+                    Scalar{Scalar::i8{-1}},
+                    Scalar{Scalar::i8{1}},
+                    result) == Error::None);
+    BOOST_TEST(result.as<Scalar::Bool>());
+
+    // every comparison with NaN is false, but ne.
+    Scalar const nan{Scalar::f64{std::numeric_limits<double>::quiet_NaN()}};
+    BOOST_TEST(fold(Instruction::Opcode::Ge, nan, nan, result) == Error::None);
+    BOOST_TEST(!result.as<Scalar::Bool>());
+    BOOST_TEST(fold(Instruction::Opcode::Ne, nan, nan, result) == Error::None);
+    BOOST_TEST(result.as<Scalar::Bool>());
+
+    BOOST_TEST(fold(Instruction::Opcode::Eq,
+                    Scalar{Scalar::Bool{true}},
+                    Scalar{Scalar::Bool{true}},
+                    result) == Error::None);
+    BOOST_TEST(result.as<Scalar::Bool>());
+    BOOST_TEST(fold(Instruction::Opcode::Add,
+                    Scalar{Scalar::Bool{true}},
+                    Scalar{Scalar::Bool{true}},
+                    result) == Error::TypeMismatch);
+
+    bool jump = false;
+    BOOST_TEST(taken(Instruction::Opcode::Jz,
+                     Scalar{Scalar::f32{0.0F}},
+                     Scalar{},
+                     jump) == Error::None);
+    BOOST_TEST(jump);
+    BOOST_TEST(taken(Instruction::Opcode::Jnz,
+                     Scalar{Scalar::Bool{false}},
+                     Scalar{},
+                     jump) == Error::None);
+    BOOST_TEST(!jump);
+}
+
+BOOST_AUTO_TEST_CASE(fold_fast_math) {
+    using fun::eval::Error;
+    using fun::eval::fold;
+    using fun::eval::taken;
+    using fun::IR::FastMath;
+    using fun::IR::Instruction;
+    using fun::IR::Scalar;
+
+    Scalar const one{Scalar::f64{1.0}};
+    Scalar const zero{Scalar::f64{0.0}};
+    Scalar const inf{Scalar::f64{std::numeric_limits<double>::infinity()}};
+    Scalar const nan{Scalar::f64{std::numeric_limits<double>::quiet_NaN()}};
+
+    Scalar result;
+    BOOST_TEST(fold(Instruction::Opcode::Div, one, zero, result) ==
+               Error::None);
+    BOOST_TEST(fold(Instruction::Opcode::Div,
+                    one,
+                    zero,
+                    result,
+                    FastMath::NoInfs) == Error::Poison);
+    BOOST_TEST(fold(Instruction::Opcode::Sub,
+                    inf,
+                    inf,
+                    result,
+                    FastMath::NoNaNs) == Error::Poison);
+    BOOST_TEST(fold(Instruction::Opcode::Add,
+                    nan,
+                    one,
+                    result,
+                    FastMath::NoInfs) == Error::None);
+    BOOST_TEST(fold(Instruction::Opcode::Mul,
+                    one,
+                    one,
+                    result,
+                    FastMath::All) == Error::None);
+    BOOST_TEST(result.as<Scalar::f64>() == 1.0);
+
+    bool jump = false;
+    BOOST_TEST(taken(Instruction::Opcode::Jlt,
+                     nan,
+                     one,
+                     jump,
+                     FastMath::Reassociate | FastMath::NoNaNs) ==
+               Error::Poison);
+    BOOST_TEST(fold(Instruction::Opcode::Add,
+                    Scalar{Scalar::i64{1}},
+                    Scalar{Scalar::i64{1}},
+                    result,
+                    FastMath::All) == Error::None);
+}
+
+BOOST_AUTO_TEST_CASE(evaluator_fast_math) {
+    using namespace ::evaluator_tests;
+    auto f64 = [] { return std::make_unique<Type>(Type::f64{}); };
+    fun::IR::Lambda::Arguments arguments;
+    arguments.emplace_back(fun::IR::Label{"x"}, f64());
+    fun::IR::Lambda lambda{
+        fun::IR::Label{"inverse"}, f64(), std::move(arguments)};
+    lambda.declare(fun::IR::Local{fun::IR::Label{"r"}, f64(), {}});
+    fun::IR::Block &block = lambda.body().emplace_back();
+    block.append(Instruction::Opcode::Div,
+                 LocalHandle{1},
+                 Scalar::f64{1.0},
+                 LocalHandle{0});
+    block.append(Instruction::Opcode::Ret, LocalHandle{1});
+    lambda.fast_math(fun::IR::FastMath::All);
+
+    fun::IR::Module module;
+    module.append(std::move(lambda));
+    fun::eval::Evaluator evaluator{module};
+    Scalar const two[] = {Scalar{Scalar::f64{2.0}}};
+    auto result = evaluator.call(fun::IR::Label{"inverse"}, two);
+    BOOST_TEST(result.error == fun::eval::Error::None);
+    BOOST_TEST(result.value.as<Scalar::f64>() == 0.5);
+
+    Scalar const zero[] = {Scalar{Scalar::f64{0.0}}};
+    result = evaluator.call(fun::IR::Label{"inverse"}, zero);
+    BOOST_TEST(result.error == fun::eval::Error::Poison);
+}
+
+BOOST_AUTO_TEST_CASE(evaluator_branches) {
+    using namespace ::evaluator_tests;
+    fun::IR::Module module;
+    module.append(sum());
+    fun::eval::Evaluator evaluator{module};
+
+    for (std::int64_t n : {-3, 0, 1, 5}) {
+        Scalar const arguments[] = {Scalar{Scalar::i64{n}}};
+        auto result = evaluator.call(fun::IR::Label{"sum"}, arguments);
+        BOOST_TEST(result.error == fun::eval::Error::None);
+        BOOST_TEST(result.value.as<Scalar::i64>() ==
+                   (n > 0 ? n * (n - 1) / 2 : 0));
+    }
+
+    fun::IR::Lambda lambda{fun::IR::Label{"lost"}, i64(), {}};
+    lambda.body().emplace_back().append(Instruction::Opcode::Jmp,
+                                        fun::IR::BlockHandle{1});
+    module.append(std::move(lambda));
+    fun::eval::Evaluator lost{module};
+    auto result = lost.call(fun::IR::Label{"lost"}, {});
+    BOOST_TEST(result.error == fun::eval::Error::NoSuchBlock);
+}
+
+BOOST_AUTO_TEST_CASE(evaluator_memoizes) {
+    using namespace ::evaluator_tests;
+    fun::IR::Module module;
+    module.append(square());
+    fun::eval::Evaluator evaluator{module};
+
+    Scalar const arguments[] = {Scalar{Scalar::i64{12}}};
+    auto A = evaluator.call(fun::IR::Label{"square"}, arguments);
+    BOOST_TEST(A.error == fun::eval::Error::None);
+    BOOST_TEST(A.value.as<Scalar::i64>() == 144);
+    BOOST_TEST(evaluator.steps() == 2);
+
+    auto B = evaluator.call(fun::IR::Label{"square"}, arguments);
+    BOOST_TEST(B.value.as<Scalar::i64>() == 144);
+    BOOST_TEST(evaluator.steps() == 0);
+    BOOST_TEST(evaluator.memoized() == 1);
+
+    Scalar const wrong[] = {Scalar{Scalar::i32{12}}};
+    auto C = evaluator.call(fun::IR::Label{"square"}, wrong);
+    BOOST_TEST(C.error == fun::eval::Error::TypeMismatch);
+}
+
+BOOST_AUTO_TEST_CASE(evaluator_budget) {
+    using namespace ::evaluator_tests;
+    fun::IR::Module module;
+    module.append(square());
+    module.append(loop());
+
+    fun::eval::Evaluator small{module, {.steps = 1}};
+    Scalar const arguments[] = {Scalar{Scalar::i64{3}}};
+    auto A = small.call(fun::IR::Label{"square"}, arguments);
+    BOOST_TEST(A.error == fun::eval::Error::StepLimit);
+    BOOST_TEST(small.memoized() == 0);
+
+    fun::eval::Evaluator evaluator{module};
+    auto B = evaluator.call(fun::IR::Label{"loop"}, {});
+    BOOST_TEST(B.error == fun::eval::Error::DepthLimit);
+
+    fun::eval::Evaluator tight{module, {.memory = 64}};
+    auto C = tight.call(fun::IR::Label{"loop"}, {});
+    BOOST_TEST(C.error == fun::eval::Error::MemoryLimit);
+}
+
+BOOST_AUTO_TEST_CASE(evaluate_constants_pass) {
+    using namespace ::evaluator_tests;
+    fun::IR::Module module;
+    module.append(square());
+    module.append(main());
+    fun::pass::AnalysisManager analyses;
+    fun::pass::EvaluateConstants pass;
+
+    pass.run(module, analyses);
+    BOOST_TEST(pass.evaluated() == 1);
+
+    fun::IR::Lambda const &lambda = *module.find(fun::IR::Label{"main"});
+    BOOST_TEST(lambda.body()[0].size() == 1);
+    BOOST_TEST(lambda.local(LocalHandle{1}).value_.as<Scalar::i64>() == 49);
+
+    // nothing is left to evaluate.
+    pass.run(module, analyses);
+    BOOST_TEST(pass.evaluated() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(evaluate_constants_keeps_arguments_read_before) {
+    fun::IR::Module module = ::evaluator_tests::read_before_written();
+    fun::pass::AnalysisManager analyses;
+    fun::pass::EvaluateConstants pass;
+
+    // g is passed b as it was before h, which is not yet constant.
+    pass.run(module, analyses);
+    BOOST_TEST(pass.evaluated() == 0);
+    fun::IR::Lambda const &lambda = *module.find(fun::IR::Label{"main"});
+    BOOST_TEST(lambda.body()[0].size() == 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
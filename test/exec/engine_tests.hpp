@@ -0,0 +1,374 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file engine_tests.hpp
+ * @brief Defines tests for [Engine](@ref Engine)
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <limits>
+
+#include <boost/test/unit_test.hpp>
+
+#include "eval/evaluator_tests.hpp"
+#include "exec/engine.hpp"
+#include "pass/bounds_checks_tests.hpp"
+
+namespace engine_tests {
+
+inline std::atomic<int> native_calls{0};
+
+/// the native code of square(x: i64) -> i64
+inline void native_square(std::uint64_t const *arguments,
+                          std::uint64_t *result) {
+    ++native_calls;
+    std::int64_t x;
+    std::memcpy(&x, arguments, sizeof(x));
+    std::int64_t y = x * x;
+    std::memcpy(result, &y, sizeof(y));
+}
+
+struct FakeCompiler : fun::exec::Compiler {
+    std::atomic<int> &compiles;
+
+    explicit FakeCompiler(std::atomic<int> &compiles) : compiles{compiles} {}
+
+    fun::exec::Native compile(fun::IR::Module const &,
+                              fun::IR::Lambda const &lambda) override {
+        ++compiles;
+        return lambda.name().name == "square" ? &native_square : nullptr;
+    }
+};
+
+/**
+ * square(x: i64) -> i64 { let r: i64; mul %1, %0, %0; ret %1 }
+ * twice(x: i64) -> i64 { let r: i64; call %1, @square, %0; add %1, %1, %1;
+ *                        ret %1 }
+ */
+inline fun::IR::Module make_module() {
+    using fun::IR::Instruction;
+    using fun::IR::Label;
+    using fun::IR::LocalHandle;
+    using fun::IR::Type;
+    auto i64 = [] { return std::make_unique<Type>(Type::i64{}); };
+
+    fun::IR::Module module;
+    for (std::string_view name : {"square", "twice"}) {
+        fun::IR::Lambda::Arguments arguments;
+        arguments.emplace_back(Label{"x"}, i64());
+        fun::IR::Lambda lambda{Label{name}, i64(), std::move(arguments)};
+        lambda.declare(fun::IR::Local{Label{"r"}, i64(), {}});
+        fun::IR::Block &block = lambda.body().emplace_back();
+        if (name == "square") {
+            block.append(Instruction::Opcode::Mul,
+                         LocalHandle{1},
+                         LocalHandle{0},
+                         LocalHandle{0});
+        } else {
+            block.append(Instruction::Opcode::Call,
+                         LocalHandle{1},
+                         Label{"square"},
+                         LocalHandle{0});
+            block.append(Instruction::Opcode::Add,
+                         LocalHandle{1},
+                         LocalHandle{1},
+                         LocalHandle{1});
+        }
+        block.append(Instruction::Opcode::Ret, LocalHandle{1});
+        module.append(std::move(lambda));
+    }
+    return module;
+}
+
+/**
+ * total() -> u64 {
+ *     let a: [u64; 4]; let s: [u64]; let r: u64; let i: u64;
+ * #0:
+ *     jge #2, %3, 4
+ * #1:
+ *     insert %0, %3, %3
+ *     add %3, %3, 1
+ *     jmp #0
+ * #2:
+ *     slice %1, %0
+ *     call %2, @sum, %1
+ *     ret %2
+ * }
+ *
+ * along with the sum of a slice, whose subscript is checked.
+ */
+inline fun::IR::Module make_array_module() {
+    using fun::IR::BlockHandle;
+    using fun::IR::Instruction;
+    using fun::IR::Label;
+    using fun::IR::LocalHandle;
+    using fun::IR::Scalar;
+    using fun::IR::Type;
+    auto u64 = [] { return std::make_unique<Type>(Type::u64{}); };
+
+    fun::IR::Lambda lambda{Label{"total"}, u64(), {}};
+    lambda.declare(fun::IR::Local{
+        Label{"a"}, std::make_unique<Type>(Type::Array{u64(), 4}), {}});
+    lambda.declare(fun::IR::Local{
+        Label{"s"}, std::make_unique<Type>(Type::Slice{u64()}), {}});
+    lambda.declare(fun::IR::Local{Label{"r"}, u64(), {}});
+    lambda.declare(fun::IR::Local{Label{"i"}, u64(), {}});
+    fun::IR::Lambda::Body &body = lambda.body();
+    body.emplace_back().append(Instruction::Opcode::Jge,
+                               BlockHandle{2},
+                               LocalHandle{3},
+                               Scalar::u64{4});
+    fun::IR::Block &loop = body.emplace_back();
+    loop.append(Instruction::Opcode::Insert,
+                LocalHandle{0},
+                LocalHandle{3},
+                LocalHandle{3});
+    loop.append(Instruction::Opcode::Add,
+                LocalHandle{3},
+                LocalHandle{3},
+                Scalar::u64{1});
+    loop.append(Instruction::Opcode::Jmp, BlockHandle{0});
+    fun::IR::Block &done = body.emplace_back();
+    done.append(Instruction::Opcode::Slice, LocalHandle{1}, LocalHandle{0});
+    done.append(Instruction::Opcode::Call,
+                LocalHandle{2},
+                Label{"sum"},
+                LocalHandle{1});
+    done.append(Instruction::Opcode::Ret, LocalHandle{2});
+
+    fun::IR::Module module;
+    module.append(std::move(lambda));
+    module.append(::bounds_checks_tests::sum(LocalHandle{1}));
+    return module;
+}
+
+/**
+ * area() -> i64 {
+ *     let p: struct { w: i64, h: i64 }; let q: struct { w: i64, h: i64 };
+ *     let r: i64;
+ *     load %0.0, 3
+ *     load %0.1, 4
+ *     load %1, %0
+ *     mul %2, %1.0, %1.1
+ *     ret %2
+ * }
+ */
+inline fun::IR::Lambda make_area() {
+    using fun::IR::FieldHandle;
+    using fun::IR::Instruction;
+    using fun::IR::Label;
+    using fun::IR::LocalHandle;
+    using fun::IR::Scalar;
+    using fun::IR::Type;
+    auto i64  = [] { return std::make_unique<Type>(Type::i64{}); };
+    auto rect = [&] {
+        Type::Struct::Fields fields;
+        fields.emplace_back(Label{"w"}, i64());
+        fields.emplace_back(Label{"h"}, i64());
+        return std::make_unique<Type>(std::move(fields),
+                                      Type::Struct::Order::Reordered);
+    };
+
+    fun::IR::Lambda lambda{Label{"area"}, i64(), {}};
+    lambda.declare(fun::IR::Local{Label{"p"}, rect(), {}});
+    lambda.declare(fun::IR::Local{Label{"q"}, rect(), {}});
+    lambda.declare(fun::IR::Local{Label{"r"}, i64(), {}});
+    fun::IR::Block &block = lambda.body().emplace_back();
+    block.append(Instruction::Opcode::Load,
+                 FieldHandle{LocalHandle{0}, 0},
+                 Scalar::i64{3});
+    block.append(Instruction::Opcode::Load,
+                 FieldHandle{LocalHandle{0}, 1},
+                 Scalar::i64{4});
+    block.append(Instruction::Opcode::Load, LocalHandle{1}, LocalHandle{0});
+    block.append(Instruction::Opcode::Mul,
+                 LocalHandle{2},
+                 FieldHandle{LocalHandle{1}, 0},
+                 FieldHandle{LocalHandle{1}, 1});
+    block.append(Instruction::Opcode::Ret, LocalHandle{2});
+    return lambda;
+}
+
+} // namespace engine_tests
+
+BOOST_AUTO_TEST_SUITE(engine_tests)
+
+BOOST_AUTO_TEST_CASE(engine_interprets) {
+    using fun::IR::Scalar;
+    fun::IR::Module module = ::engine_tests::make_module();
+    fun::exec::Engine engine{module, nullptr};
+
+    Scalar const arguments[] = {Scalar{Scalar::i64{5}}};
+    auto result = engine.call(fun::IR::Label{"twice"}, arguments);
+    BOOST_TEST(result.error == fun::eval::Error::None);
+    BOOST_TEST(result.value.as<Scalar::i64>() == 50);
+    BOOST_TEST(engine.profile(fun::IR::Label{"square"})->calls == 1);
+    BOOST_TEST(!engine.profile(fun::IR::Label{"nope"}).has_value());
+}
+
+BOOST_AUTO_TEST_CASE(engine_tiers_up) {
+    using fun::IR::Scalar;
+    using namespace ::engine_tests;
+    fun::IR::Module module = make_module();
+    std::atomic<int> compiles{0};
+    fun::exec::Engine engine{module,
+                             std::make_unique<FakeCompiler>(compiles),
+                             {.threshold = 3, .background = true}};
+
+    native_calls             = 0;
+    Scalar const arguments[] = {Scalar{Scalar::i64{3}}};
+    for (int call = 0; call < 3; ++call) {
+        auto result = engine.call(fun::IR::Label{"twice"}, arguments);
+        BOOST_TEST(result.value.as<Scalar::i64>() == 18);
+    }
+    engine.wait();
+    BOOST_TEST(compiles == 2);
+    BOOST_TEST(native_calls == 0);
+    BOOST_TEST(engine.profile(fun::IR::Label{"square"})->native);
+    // twice could not be compiled, and keeps being interpreted.
+    BOOST_TEST(!engine.profile(fun::IR::Label{"twice"})->native);
+
+    auto result = engine.call(fun::IR::Label{"twice"}, arguments);
+    BOOST_TEST(result.value.as<Scalar::i64>() == 18);
+    BOOST_TEST(native_calls == 1);
+    BOOST_TEST(compiles == 2);
+}
+
+BOOST_AUTO_TEST_CASE(engine_counts_backedges) {
+    using fun::IR::Scalar;
+    fun::IR::Module module;
+    module.append(::evaluator_tests::sum());
+    std::atomic<int> compiles{0};
+    fun::exec::Engine engine{
+        module,
+        std::make_unique<::engine_tests::FakeCompiler>(compiles),
+        {.threshold = 3, .background = false}};
+
+    // sum(5) jumps back to its loop four times, and is hot after three.
+    Scalar const arguments[] = {Scalar{Scalar::i64{5}}};
+    auto result = engine.call(fun::IR::Label{"sum"}, arguments);
+    BOOST_TEST(result.value.as<Scalar::i64>() == 10);
+    BOOST_TEST(engine.profile(fun::IR::Label{"sum"})->calls == 1);
+    BOOST_TEST(engine.profile(fun::IR::Label{"sum"})->backedges == 4);
+    BOOST_TEST(compiles == 1);
+}
+
+BOOST_AUTO_TEST_CASE(engine_interprets_what_may_fail) {
+    using fun::IR::Scalar;
+    fun::IR::Module module = ::engine_tests::make_module();
+    module.find(fun::IR::Label{"square"})->checked(true);
+    std::atomic<int> compiles{0};
+    fun::exec::Engine engine{
+        module,
+        std::make_unique<::engine_tests::FakeCompiler>(compiles),
+        {.threshold = 1, .background = false}};
+
+    // the checked square of 2^32 overflows, which native code could only
+    // trap on; neither square nor twice, which calls it, is compiled.
+    Scalar const large[] = {Scalar{Scalar::i64{std::int64_t{1} << 32}}};
+    for (int call = 0; call < 2; ++call) {
+        BOOST_TEST(engine.call(fun::IR::Label{"twice"}, large).error ==
+                   fun::eval::Error::Overflow);
+    }
+    BOOST_TEST(compiles == 0);
+    BOOST_TEST(!engine.profile(fun::IR::Label{"square"})->native);
+    BOOST_TEST(!engine.profile(fun::IR::Label{"twice"})->native);
+}
+
+BOOST_AUTO_TEST_CASE(engine_follows_fast_math) {
+    using fun::IR::Instruction;
+    using fun::IR::LocalHandle;
+    using fun::IR::Scalar;
+    using fun::IR::Type;
+    auto f64 = [] { return std::make_unique<Type>(Type::f64{}); };
+
+    // double(x: f64) -> f64 { let r: f64; add %1, %0, %0; ret %1 }
+    fun::IR::Lambda::Arguments arguments;
+    arguments.emplace_back(fun::IR::Label{"x"}, f64());
+    fun::IR::Lambda lambda{
+        fun::IR::Label{"double"}, f64(), std::move(arguments)};
+    lambda.declare(fun::IR::Local{fun::IR::Label{"r"}, f64(), {}});
+    fun::IR::Block &block = lambda.body().emplace_back();
+    block.append(Instruction::Opcode::Add,
+                 LocalHandle{1},
+                 LocalHandle{0},
+                 LocalHandle{0});
+    block.append(Instruction::Opcode::Ret, LocalHandle{1});
+    lambda.fast_math(fun::IR::FastMath::NoNaNs);
+    fun::IR::Module module;
+    module.append(std::move(lambda));
+    fun::exec::Engine engine{module, nullptr};
+
+    // a NaN is poison to a lambda which assumes there are none.
+    Scalar const nan[] = {
+        Scalar{Scalar::f64{std::numeric_limits<double>::quiet_NaN()}}};
+    BOOST_TEST(engine.call(fun::IR::Label{"double"}, nan).error ==
+               fun::eval::Error::Poison);
+    Scalar const two[] = {Scalar{Scalar::f64{2.0}}};
+    auto result = engine.call(fun::IR::Label{"double"}, two);
+    BOOST_TEST(result.error == fun::eval::Error::None);
+    BOOST_TEST(result.value.as<Scalar::f64>() == 4.0);
+}
+
+BOOST_AUTO_TEST_CASE(engine_interprets_arrays_and_slices) {
+    using fun::IR::Scalar;
+    fun::IR::Module module = ::engine_tests::make_array_module();
+    std::atomic<int> compiles{0};
+    fun::exec::Engine engine{
+        module,
+        std::make_unique<::engine_tests::FakeCompiler>(compiles),
+        {.threshold = 1000, .background = false}};
+
+    // 0 + 1 + 2 + 3, well below the threshold, so nothing is compiled.
+    auto result = engine.call(fun::IR::Label{"total"}, {});
+    BOOST_TEST(result.error == fun::eval::Error::None);
+    BOOST_TEST(result.value.as<Scalar::u64>() == 6U);
+    BOOST_TEST(engine.profile(fun::IR::Label{"sum"})->calls == 1U);
+    BOOST_TEST(compiles == 0);
+
+    // a slice cannot be passed from outside.
+    Scalar const cells[] = {Scalar{Scalar::u64{0}}, Scalar{Scalar::u64{4}}};
+    BOOST_TEST(engine.call(fun::IR::Label{"sum"}, cells).error ==
+               fun::eval::Error::TypeMismatch);
+}
+
+BOOST_AUTO_TEST_CASE(engine_interprets_structs) {
+    using fun::IR::Scalar;
+    fun::IR::Module module;
+    module.append(::engine_tests::make_area());
+    fun::exec::Engine engine{module, nullptr};
+
+    auto result = engine.call(fun::IR::Label{"area"}, {});
+    BOOST_TEST(result.error == fun::eval::Error::None);
+    BOOST_TEST(result.value.as<Scalar::i64>() == 12);
+}
+
+BOOST_AUTO_TEST_CASE(engine_reports_indices_out_of_bounds) {
+    fun::IR::Module module;
+    module.append(::bounds_checks_tests::fill(9));
+    std::atomic<int> compiles{0};
+    fun::exec::Engine engine{
+        module,
+        std::make_unique<::engine_tests::FakeCompiler>(compiles),
+        {.threshold = 1, .background = false}};
+
+    // the ninth insert into eight elements would trap in native code, so
+    // fill is never compiled, and keeps reporting it.
+    for (int call = 0; call < 2; ++call) {
+        BOOST_TEST(engine.call(fun::IR::Label{"fill"}, {}).error ==
+                   fun::eval::Error::OutOfBounds);
+    }
+    BOOST_TEST(compiles == 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
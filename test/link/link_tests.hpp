@@ -0,0 +1,138 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file link_tests.hpp
+ * @brief Defines tests for [link_executable](@ref
+ * fun::link::link_executable) and [link_object](@ref fun::link::link_object)
+ */
+
+#pragma once
+
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <boost/test/unit_test.hpp>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/TargetSelect.h>
+
+#include "codegen/entry.hpp"
+#include "codegen/to_llvm.hpp"
+#include "env/context.hpp"
+#include "link/link.hpp"
+#include "scan/parse.hpp"
+
+namespace link_tests {
+
+namespace fs = std::filesystem;
+
+/// main returns 6 * 6 + 1, through lambdas which may be emitted apart
+constexpr std::string_view program = "fn square(x: i64) -> i64 {\n"
+                                     "    mul %0, %0, %0\n"
+                                     "    ret %0\n"
+                                     "}\n"
+                                     "fn increment(x: i64) -> i64 {\n"
+                                     "    add %0, %0, 1\n"
+                                     "    ret %0\n"
+                                     "}\n"
+                                     "fn main() -> i64 {\n"
+                                     "    let r: i64\n"
+                                     "    call %0, @square, 6\n"
+                                     "    call %0, @increment, %0\n"
+                                     "    ret %0\n"
+                                     "}\n";
+
+/// a directory of its own for the files of a test
+struct Scratch {
+    fs::path directory = fs::temp_directory_path() /
+                         ("fun_link_tests." + std::to_string(::getpid()));
+
+    Scratch() { fs::create_directories(directory); }
+    Scratch(Scratch const &)            = delete;
+    Scratch &operator=(Scratch const &) = delete;
+    ~Scratch() {
+        std::error_code error;
+        fs::remove_all(directory, error);
+    }
+};
+
+/// compiles the program into objects, emitted in @p parts
+inline std::vector<llvm::SmallVector<char, 0>> compile(unsigned parts) {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+
+    std::vector<llvm::SmallVector<char, 0>> objects;
+    fun::env::Context ctx{"program.fun"};
+    BOOST_REQUIRE(fun::scan::parse(program, ctx));
+    BOOST_REQUIRE(fun::codegen::to_llvm(ctx.ir(), ctx));
+    BOOST_REQUIRE(fun::codegen::emit_entry(ctx.intern_string("main"), ctx) !=
+                  nullptr);
+    BOOST_REQUIRE(ctx.emit_objects(parts, objects));
+    return objects;
+}
+
+inline std::vector<llvm::StringRef>
+files(std::vector<llvm::SmallVector<char, 0>> const &objects) {
+    std::vector<llvm::StringRef> views;
+    for (llvm::SmallVector<char, 0> const &object : objects) {
+        views.emplace_back(object.data(), object.size());
+    }
+    return views;
+}
+
+/// the exit status of @p executable, or -1 if it did not exit
+inline int run(fs::path const &executable) {
+    int const status = std::system(executable.c_str());
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+BOOST_AUTO_TEST_SUITE(link_tests)
+
+BOOST_AUTO_TEST_CASE(split_builds_run_as_whole_ones) {
+    Scratch const scratch;
+    fs::path const whole = scratch.directory / "whole";
+    fs::path const split = scratch.directory / "split";
+
+    auto const one = compile(1);
+    BOOST_TEST(one.size() == 1U);
+    BOOST_TEST(fun::link::link_executable(files(one), whole));
+
+    auto const three = compile(3);
+    BOOST_TEST(three.size() == 3U);
+    BOOST_TEST(fun::link::link_executable(files(three), split));
+
+    BOOST_TEST(run(whole) == 37);
+    BOOST_TEST(run(split) == run(whole));
+}
+
+BOOST_AUTO_TEST_CASE(split_objects_link_into_one) {
+    Scratch const scratch;
+    fs::path const object     = scratch.directory / "program.o";
+    fs::path const executable = scratch.directory / "program";
+
+    auto const three = compile(3);
+    BOOST_TEST(fun::link::link_object(files(three), object));
+
+    auto buffer = llvm::MemoryBuffer::getFile(object.string());
+    BOOST_REQUIRE(static_cast<bool>(buffer));
+    llvm::StringRef const linked = (*buffer)->getBuffer();
+    BOOST_TEST(fun::link::link_executable({&linked, 1}, executable));
+    BOOST_TEST(run(executable) == 37);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace link_tests
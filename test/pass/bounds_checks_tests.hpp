@@ -0,0 +1,187 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file bounds_checks_tests.hpp
+ * @brief Defines tests for [Range](@ref Range) and
+ * [EliminateBoundsChecks](@ref EliminateBoundsChecks)
+ */
+
+#pragma once
+
+#include <limits>
+
+#include <boost/test/unit_test.hpp>
+
+#include "pass/bounds_checks.hpp"
+
+namespace bounds_checks_tests {
+
+using fun::IR::BlockHandle;
+using fun::IR::Instruction;
+using fun::IR::Label;
+using fun::IR::LocalHandle;
+using fun::IR::Scalar;
+using fun::IR::Type;
+using fun::pass::Range;
+
+inline Type::Ptr u64() { return std::make_unique<Type>(Type::u64{}); }
+
+/**
+ * sum(s: [u64]) -> u64 {
+ *     let n: u64; let i: u64; let x: u64; let t: u64;
+ *     length %1, %0
+ * #1:
+ *     jge #3, %2, bound
+ * #2:
+ *     subscript %3, %0, %2
+ *     add %4, %4, %3
+ *     add %2, %2, 1
+ *     jmp #1
+ * #3:
+ *     ret %4
+ * }
+ *
+ * which loops up to the length of the slice, unless @p bound is another
+ * local.
+ */
+inline fun::IR::Lambda sum(LocalHandle bound) {
+    fun::IR::Lambda::Arguments arguments;
+    arguments.emplace_back(Label{"s"},
+                           std::make_unique<Type>(Type::Slice{u64()}));
+    fun::IR::Lambda lambda{Label{"sum"}, u64(), std::move(arguments)};
+    for (char const *name : {"n", "i", "x", "t"}) {
+        lambda.declare(fun::IR::Local{Label{name}, u64(), {}});
+    }
+    fun::IR::Lambda::Body &body = lambda.body();
+    body.emplace_back().append(
+        Instruction::Opcode::Length, LocalHandle{1}, LocalHandle{0});
+    body.emplace_back().append(
+        Instruction::Opcode::Jge, BlockHandle{3}, LocalHandle{2}, bound);
+    fun::IR::Block &loop = body.emplace_back();
+    loop.append(Instruction::Opcode::Subscript,
+                LocalHandle{3},
+                LocalHandle{0},
+                LocalHandle{2});
+    loop.append(Instruction::Opcode::Add,
+                LocalHandle{4},
+                LocalHandle{4},
+                LocalHandle{3});
+    loop.append(Instruction::Opcode::Add,
+                LocalHandle{2},
+                LocalHandle{2},
+                Scalar::u64{1});
+    loop.append(Instruction::Opcode::Jmp, BlockHandle{1});
+    body.emplace_back().append(Instruction::Opcode::Ret, LocalHandle{4});
+    return lambda;
+}
+
+/**
+ * fill() -> nil {
+ *     let a: [i32; 8]; let i: i64;
+ * #0:
+ *     jge #2, %1, bound
+ * #1:
+ *     insert %0, %1, 7
+ *     add %1, %1, 1
+ *     jmp #0
+ * #2:
+ *     ret nil
+ * }
+ */
+inline fun::IR::Lambda fill(std::int64_t bound) {
+    fun::IR::Lambda lambda{
+        Label{"fill"}, std::make_unique<Type>(Type::Nil{}), {}};
+    lambda.declare(fun::IR::Local{
+        Label{"a"},
+        std::make_unique<Type>(
+            Type::Array{std::make_unique<Type>(Type::i32{}), 8}),
+        {}});
+    lambda.declare(fun::IR::Local{
+        Label{"i"}, std::make_unique<Type>(Type::i64{}), {}});
+    fun::IR::Lambda::Body &body = lambda.body();
+    body.emplace_back().append(Instruction::Opcode::Jge,
+                               BlockHandle{2},
+                               LocalHandle{1},
+                               Scalar::i64{bound});
+    fun::IR::Block &loop = body.emplace_back();
+    loop.append(Instruction::Opcode::Insert,
+                LocalHandle{0},
+                LocalHandle{1},
+                Scalar::i32{7});
+    loop.append(Instruction::Opcode::Add,
+                LocalHandle{1},
+                LocalHandle{1},
+                Scalar::i64{1});
+    loop.append(Instruction::Opcode::Jmp, BlockHandle{0});
+    body.emplace_back().append(Instruction::Opcode::Ret, Scalar{});
+    return lambda;
+}
+
+/// runs EliminateBoundsChecks on @p lambda, and returns how many it removed
+inline std::uint64_t eliminate(fun::IR::Lambda &lambda) {
+    fun::pass::FunctionAnalyses analyses{lambda};
+    fun::pass::EliminateBoundsChecks pass;
+    pass.run(lambda, analyses);
+    return pass.eliminated();
+}
+
+} // namespace bounds_checks_tests
+
+BOOST_AUTO_TEST_SUITE(bounds_checks_tests)
+
+BOOST_AUTO_TEST_CASE(range_arithmetic_gives_up_on_overflow) {
+    using namespace ::bounds_checks_tests;
+    Range const small{0, 10};
+    BOOST_TEST((small + Range{5, 5} == Range{5, 15}));
+    BOOST_TEST((small - Range{1, 2} == Range{-2, 9}));
+    BOOST_TEST(!(small + Range{}).bounded());
+    BOOST_TEST(!(Range{Range::above - 1, Range::above - 1} + small).bounded());
+
+    Range const u8 = Range::of_type(2);
+    BOOST_TEST(((small + Range{250, 250}).wrap(u8) == u8));
+    BOOST_TEST(((small + Range{5, 5}).wrap(u8) == Range{5, 15}));
+    BOOST_TEST((Range::of(Scalar{Scalar::u64{
+                    std::numeric_limits<std::uint64_t>::max()}}) ==
+                Range{Range::above, Range::above}));
+}
+
+BOOST_AUTO_TEST_CASE(loop_over_slice_needs_no_checks) {
+    using namespace ::bounds_checks_tests;
+    fun::IR::Lambda lambda = sum(LocalHandle{1});
+    BOOST_TEST(eliminate(lambda) == 1U);
+    BOOST_TEST((lambda.body()[2][0].opcode() ==
+                Instruction::Opcode::UncheckedSubscript));
+    BOOST_TEST((lambda.body()[2][0].C() == LocalHandle{2}));
+}
+
+BOOST_AUTO_TEST_CASE(loop_over_array_needs_no_checks) {
+    using namespace ::bounds_checks_tests;
+    fun::IR::Lambda lambda = fill(8);
+    BOOST_TEST(eliminate(lambda) == 1U);
+    BOOST_TEST((lambda.body()[1][0].opcode() ==
+                Instruction::Opcode::UncheckedInsert));
+}
+
+BOOST_AUTO_TEST_CASE(unproven_indices_keep_their_checks) {
+    using namespace ::bounds_checks_tests;
+    // the loop runs past the end of the array.
+    fun::IR::Lambda array = fill(9);
+    BOOST_TEST(eliminate(array) == 0U);
+    BOOST_TEST(
+        (array.body()[1][0].opcode() == Instruction::Opcode::Insert));
+
+    // the loop is bounded by a local which is not the length of the slice.
+    fun::IR::Lambda slice = sum(LocalHandle{4});
+    BOOST_TEST(eliminate(slice) == 0U);
+    BOOST_TEST(
+        (slice.body()[2][0].opcode() == Instruction::Opcode::Subscript));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,162 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file merge_lambdas_tests.hpp
+ * @brief Defines tests for [structural_hash](@ref structural_hash),
+ * [same_structure](@ref same_structure) and
+ * [MergeLambdas](@ref MergeLambdas)
+ */
+
+#pragma once
+
+#include <string_view>
+
+#include <boost/test/unit_test.hpp>
+
+#include "eval/evaluator.hpp"
+#include "eval/evaluator_tests.hpp"
+#include "pass/merge_lambdas.hpp"
+#include "pass/purity_tests.hpp"
+
+namespace merge_lambdas_tests {
+
+using fun::IR::Instruction;
+using fun::IR::LocalHandle;
+using fun::IR::Scalar;
+using fun::IR::Type;
+
+/// name(argument: i64) -> i64 { let r: i64; mul %1, %0, %0; ret %1 }
+inline fun::IR::Lambda square(std::string_view name,
+                              std::string_view argument) {
+    fun::IR::Lambda::Arguments arguments;
+    arguments.emplace_back(fun::IR::Label{argument}, evaluator_tests::i64());
+    fun::IR::Lambda lambda{
+        fun::IR::Label{name}, evaluator_tests::i64(), std::move(arguments)};
+    lambda.declare(
+        fun::IR::Local{fun::IR::Label{"r"}, evaluator_tests::i64(), {}});
+    fun::IR::Block &block = lambda.body().emplace_back();
+    block.append(Instruction::Opcode::Mul,
+                 LocalHandle{1},
+                 LocalHandle{0},
+                 LocalHandle{0});
+    block.append(Instruction::Opcode::Ret, LocalHandle{1});
+    return lambda;
+}
+
+/**
+ * name() -> i64 {
+ *     let x: i64 = 7
+ *     let y: i64
+ *     call %1, @callee, %0
+ *     ret %1
+ * }
+ */
+inline fun::IR::Lambda caller(std::string_view name,
+                              std::string_view callee) {
+    fun::IR::Lambda lambda{fun::IR::Label{name}, evaluator_tests::i64(), {}};
+    lambda.declare(fun::IR::Local{
+        fun::IR::Label{"x"}, evaluator_tests::i64(), Scalar{Scalar::i64{7}}});
+    lambda.declare(
+        fun::IR::Local{fun::IR::Label{"y"}, evaluator_tests::i64(), {}});
+    fun::IR::Block &block = lambda.body().emplace_back();
+    block.append(Instruction::Opcode::Call,
+                 LocalHandle{1},
+                 fun::IR::Label{callee},
+                 LocalHandle{0});
+    block.append(Instruction::Opcode::Ret, LocalHandle{1});
+    return lambda;
+}
+
+/// name() -> f64 { ret value }
+inline fun::IR::Lambda constant(std::string_view name, double value) {
+    fun::IR::Lambda lambda{
+        fun::IR::Label{name}, std::make_unique<Type>(Type::f64{}), {}};
+    lambda.body().emplace_back().append(Instruction::Opcode::Ret,
+                                        Scalar{Scalar::f64{value}});
+    return lambda;
+}
+
+} // namespace merge_lambdas_tests
+
+BOOST_AUTO_TEST_SUITE(merge_lambdas_tests)
+
+BOOST_AUTO_TEST_CASE(structure_ignores_names) {
+    using namespace ::merge_lambdas_tests;
+    using fun::IR::same_structure;
+    using fun::IR::structural_hash;
+    fun::IR::Lambda f = square("f", "x");
+    fun::IR::Lambda g = square("g", "y");
+    BOOST_TEST(same_structure(f, g));
+    BOOST_TEST(structural_hash(f) == structural_hash(g));
+
+    // each loop calls itself, so both are the same.
+    fun::IR::Lambda loop = evaluator_tests::loop();
+    fun::IR::Lambda spin = purity_tests::calls("spin", "spin");
+    BOOST_TEST(same_structure(loop, spin));
+    BOOST_TEST(structural_hash(loop) == structural_hash(spin));
+    BOOST_TEST(!same_structure(
+        loop, purity_tests::calls("spin", "elsewhere")));
+
+    BOOST_TEST(!same_structure(f, evaluator_tests::main()));
+    BOOST_TEST(!same_structure(caller("a", "f"), caller("b", "g")));
+    BOOST_TEST(same_structure(caller("a", "f"), caller("b", "f")));
+}
+
+BOOST_AUTO_TEST_CASE(structure_compares_bits) {
+    using namespace ::merge_lambdas_tests;
+    using fun::IR::same_structure;
+    BOOST_TEST(same_structure(constant("a", 0.5), constant("b", 0.5)));
+    BOOST_TEST(!same_structure(constant("a", 0.0), constant("b", -0.0)));
+    BOOST_TEST(
+        !same_structure(constant("a", 1.0), constant("b", 1.0 + 1e-12)));
+
+    fun::IR::Lambda fast = constant("c", 0.5);
+    fast.fast_math(fun::IR::FastMath::All);
+    BOOST_TEST(!same_structure(constant("a", 0.5), fast));
+}
+
+BOOST_AUTO_TEST_CASE(merge_lambdas_folds_duplicates) {
+    using namespace ::merge_lambdas_tests;
+    fun::IR::Module module;
+    module.append(square("f", "x"));
+    module.append(square("g", "y"));
+    module.append(caller("a", "f"));
+    module.append(caller("b", "g"));
+    module.append(constant("c", 0.0));
+    module.append(constant("d", -0.0));
+
+    fun::pass::AnalysisManager analyses;
+    fun::pass::MergeLambdas merge;
+    merge.run(module, analyses);
+
+    // g is merged into f, which makes b the same as a.
+    BOOST_TEST(merge.merged() == 2);
+    fun::IR::Block const &g = module.find(fun::IR::Label{"g"})->body()[0];
+    BOOST_TEST(g.size() == 2);
+    BOOST_TEST((g[0].B().as<fun::IR::Label>() == fun::IR::Label{"f"}));
+    fun::IR::Block const &b = module.find(fun::IR::Label{"b"})->body()[0];
+    BOOST_TEST((b[0].B().as<fun::IR::Label>() == fun::IR::Label{"a"}));
+    BOOST_TEST(module.find(fun::IR::Label{"d"})->body()[0].size() == 1);
+
+    fun::eval::Evaluator evaluator{module};
+    Scalar const three[] = {Scalar{Scalar::i64{3}}};
+    auto result = evaluator.call(fun::IR::Label{"g"}, three);
+    BOOST_TEST(result.error == fun::eval::Error::None);
+    BOOST_TEST(result.value.as<Scalar::i64>() == 9);
+    result = evaluator.call(fun::IR::Label{"b"}, {});
+    BOOST_TEST(result.error == fun::eval::Error::None);
+    BOOST_TEST(result.value.as<Scalar::i64>() == 49);
+
+    // thunks are not merged again.
+    merge.run(module, analyses);
+    BOOST_TEST(merge.merged() == 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
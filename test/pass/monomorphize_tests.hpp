@@ -0,0 +1,260 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file monomorphize_tests.hpp
+ * @brief Defines tests for [Monomorphize](@ref Monomorphize) and
+ * [SpecializationCache](@ref SpecializationCache)
+ */
+
+#pragma once
+
+#include <functional>
+#include <set>
+#include <string>
+#include <string_view>
+
+#include <boost/test/unit_test.hpp>
+
+#include "eval/evaluator.hpp"
+#include "pass/merge_lambdas_tests.hpp"
+#include "pass/monomorphize.hpp"
+
+namespace monomorphize_tests {
+
+using fun::IR::Instruction;
+using fun::IR::Label;
+using fun::IR::LocalHandle;
+using fun::IR::Scalar;
+using fun::IR::Type;
+
+/// the strings of a module, as an env::Context would hold them
+struct Strings {
+    std::set<std::string, std::less<>> strings;
+
+    fun::pass::Intern intern() {
+        return [this](std::string_view string) {
+            return Label{*strings.emplace(string).first};
+        };
+    }
+};
+
+inline Type::Ptr parameter(std::string_view name) {
+    return std::make_unique<Type>(Type::Parameter{Label{name}});
+}
+
+/// square<T>(x: T) -> T { let r: T; mul %1, %0, %0; ret %1 }
+inline fun::IR::Lambda square() {
+    fun::IR::Lambda::Arguments arguments;
+    arguments.emplace_back(Label{"x"}, parameter("T"));
+    fun::IR::Lambda lambda{
+        Label{"square"}, parameter("T"), std::move(arguments)};
+    lambda.type_parameters({Label{"T"}});
+    lambda.declare(fun::IR::Local{Label{"r"}, parameter("T"), {}});
+    fun::IR::Block &block = lambda.body().emplace_back();
+    block.append(Instruction::Opcode::Mul,
+                 LocalHandle{1},
+                 LocalHandle{0},
+                 LocalHandle{0});
+    block.append(Instruction::Opcode::Ret, LocalHandle{1});
+    return lambda;
+}
+
+/// name() -> f64 { let x: f64 = 1.5; let y: f64; call %1, @square, %0 }
+inline fun::IR::Lambda real_caller(std::string_view name) {
+    fun::IR::Lambda lambda{
+        Label{name}, std::make_unique<Type>(Type::f64{}), {}};
+    lambda.declare(fun::IR::Local{Label{"x"},
+                                  std::make_unique<Type>(Type::f64{}),
+                                  Scalar{Scalar::f64{1.5}}});
+    lambda.declare(fun::IR::Local{
+        Label{"y"}, std::make_unique<Type>(Type::f64{}), {}});
+    fun::IR::Block &block = lambda.body().emplace_back();
+    block.append(Instruction::Opcode::Call,
+                 LocalHandle{1},
+                 Label{"square"},
+                 LocalHandle{0});
+    block.append(Instruction::Opcode::Ret, LocalHandle{1});
+    return lambda;
+}
+
+/**
+ * name() -> [element; length] { let x: [element; length];
+ *                               let y: [element; length];
+ *                               call %1, @identity, %0; ret %1 }
+ *
+ * and identity<T>(x: T) -> T { ret %0 }, which it calls.
+ */
+inline fun::IR::Module
+array_caller(std::string_view name, Type::Ptr element, std::uint64_t length) {
+    auto array = [&] {
+        return std::make_unique<Type>(Type::Array{element->clone(), length});
+    };
+    fun::IR::Module module;
+    fun::IR::Lambda::Arguments arguments;
+    arguments.emplace_back(Label{"x"}, parameter("T"));
+    fun::IR::Lambda identity{
+        Label{"identity"}, parameter("T"), std::move(arguments)};
+    identity.type_parameters({Label{"T"}});
+    identity.body().emplace_back().append(Instruction::Opcode::Ret,
+                                          LocalHandle{0});
+    module.append(std::move(identity));
+
+    fun::IR::Lambda lambda{Label{name}, array(), {}};
+    lambda.declare(fun::IR::Local{Label{"x"}, array(), {}});
+    lambda.declare(fun::IR::Local{Label{"y"}, array(), {}});
+    fun::IR::Block &block = lambda.body().emplace_back();
+    block.append(Instruction::Opcode::Call,
+                 LocalHandle{1},
+                 Label{"identity"},
+                 LocalHandle{0});
+    block.append(Instruction::Opcode::Ret, LocalHandle{1});
+    module.append(std::move(lambda));
+    return module;
+}
+
+/// the callee of the first instruction of @p name
+inline Label callee(fun::IR::Module const &module, std::string_view name) {
+    return module.find(Label{name})->body()[0][0].B().as<Label>();
+}
+
+} // namespace monomorphize_tests
+
+BOOST_AUTO_TEST_SUITE(monomorphize_tests)
+
+BOOST_AUTO_TEST_CASE(monomorphize_instantiates_once_per_type) {
+    using namespace ::monomorphize_tests;
+    Strings strings;
+    fun::IR::Module module;
+    module.append(square());
+    module.append(merge_lambdas_tests::caller("a", "square"));
+    module.append(merge_lambdas_tests::caller("b", "square"));
+    module.append(real_caller("c"));
+
+    fun::pass::AnalysisManager analyses;
+    fun::pass::Monomorphize monomorphize{strings.intern()};
+    monomorphize.run(module, analyses);
+
+    BOOST_TEST(monomorphize.errors().empty());
+    BOOST_TEST(monomorphize.instantiated() == 2U);
+    BOOST_TEST(module.size() == 5U);
+    BOOST_TEST(module.find(Label{"square"}) == nullptr);
+    BOOST_TEST((callee(module, "a") == Label{"square<i64>"}));
+    BOOST_TEST((callee(module, "b") == Label{"square<i64>"}));
+    BOOST_TEST((callee(module, "c") == Label{"square<f64>"}));
+    BOOST_TEST(!module.find(Label{"square<f64>"})->generic());
+    BOOST_TEST(
+        module.find(Label{"square<f64>"})->return_type()->is<Type::f64>());
+
+    fun::eval::Evaluator evaluator{module};
+    auto result = evaluator.call(Label{"a"}, {});
+    BOOST_TEST(result.error == fun::eval::Error::None);
+    BOOST_TEST(result.value.as<Scalar::i64>() == 49);
+    result = evaluator.call(Label{"c"}, {});
+    BOOST_TEST(result.error == fun::eval::Error::None);
+    BOOST_TEST(result.value.as<Scalar::f64>() == 2.25);
+}
+
+BOOST_AUTO_TEST_CASE(specialization_cache_is_shared_by_modules) {
+    using namespace ::monomorphize_tests;
+    fun::pass::SpecializationCache cache;
+    Strings second;
+    fun::IR::Module later;
+    {
+        Strings first;
+        fun::IR::Module module;
+        module.append(square());
+        module.append(merge_lambdas_tests::caller("a", "square"));
+        fun::pass::AnalysisManager analyses;
+        fun::pass::Monomorphize monomorphize{first.intern(), &cache};
+        monomorphize.run(module, analyses);
+    }
+    // the first module and its strings are gone by now.
+    later.append(square());
+    later.append(merge_lambdas_tests::caller("b", "square"));
+    fun::pass::AnalysisManager analyses;
+    fun::pass::Monomorphize monomorphize{second.intern(), &cache};
+    monomorphize.run(later, analyses);
+
+    BOOST_TEST(cache.size() == 1U);
+    BOOST_TEST(cache.hits() == 1U);
+    BOOST_TEST((callee(later, "b") == Label{"square<i64>"}));
+    fun::eval::Evaluator evaluator{later};
+    auto result = evaluator.call(Label{"b"}, {});
+    BOOST_TEST(result.error == fun::eval::Error::None);
+    BOOST_TEST(result.value.as<Scalar::i64>() == 49);
+}
+
+BOOST_AUTO_TEST_CASE(specialization_cache_tells_types_apart) {
+    using namespace ::monomorphize_tests;
+    fun::pass::SpecializationCache cache;
+    Strings strings;
+    auto monomorphize = [&](fun::IR::Module &module) {
+        fun::pass::AnalysisManager analyses;
+        fun::pass::Monomorphize pass{strings.intern(), &cache};
+        pass.run(module, analyses);
+        BOOST_TEST(pass.errors().empty());
+    };
+
+    // arrays are one kind of type, but of different elements and lengths
+    // they are different instances.
+    fun::IR::Module narrow =
+        array_caller("a", std::make_unique<Type>(Type::i32{}), 4);
+    fun::IR::Module wide =
+        array_caller("b", std::make_unique<Type>(Type::i64{}), 2);
+    fun::IR::Module again =
+        array_caller("c", std::make_unique<Type>(Type::i32{}), 4);
+    monomorphize(narrow);
+    monomorphize(wide);
+    monomorphize(again);
+    BOOST_TEST(cache.size() == 2U);
+    BOOST_TEST(cache.hits() == 1U);
+
+    Type const &result = *wide.find(callee(wide, "b"))->return_type();
+    BOOST_TEST(result.is<Type::Array>());
+    BOOST_TEST(result.as<Type::Array>().length == 2U);
+    BOOST_TEST(result.as<Type::Array>().element->is<Type::i64>());
+    BOOST_TEST(fun::IR::same_structure(
+        *again.find(callee(again, "c"))->return_type(),
+        *narrow.find(callee(narrow, "a"))->return_type()));
+}
+
+BOOST_AUTO_TEST_CASE(monomorphize_reports_conflicting_types) {
+    using namespace ::monomorphize_tests;
+    Strings strings;
+    // same<T>(x: T, y: T) -> T, called with an f64 and an i64.
+    fun::IR::Lambda::Arguments arguments;
+    arguments.emplace_back(Label{"x"}, parameter("T"));
+    arguments.emplace_back(Label{"y"}, parameter("T"));
+    fun::IR::Lambda same{Label{"same"}, parameter("T"), std::move(arguments)};
+    same.type_parameters({Label{"T"}});
+    same.body().emplace_back().append(Instruction::Opcode::Ret,
+                                      LocalHandle{0});
+
+    fun::IR::Lambda caller = real_caller("c");
+    caller.body()[0][0] = Instruction{Instruction::Opcode::Call,
+                                      LocalHandle{1},
+                                      Label{"same"},
+                                      LocalHandle{1}};
+    caller.declare(fun::IR::Local{
+        Label{"z"}, std::make_unique<Type>(Type::i64{}), {}});
+
+    fun::IR::Module module;
+    module.append(std::move(same));
+    module.append(std::move(caller));
+    fun::pass::AnalysisManager analyses;
+    fun::pass::Monomorphize monomorphize{strings.intern()};
+    monomorphize.run(module, analyses);
+
+    BOOST_TEST(monomorphize.errors().size() == 1U);
+    BOOST_TEST(monomorphize.instantiated() == 0U);
+    BOOST_TEST((callee(module, "c") == Label{"same"}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
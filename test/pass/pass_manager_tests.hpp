@@ -0,0 +1,185 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file pass_manager_tests.hpp
+ * @brief Defines tests for [PassManager](@ref PassManager)
+ */
+
+#pragma once
+
+#include <atomic>
+#include <sstream>
+
+#include <boost/test/unit_test.hpp>
+
+#include "pass/pass_manager.hpp"
+
+namespace pass_manager_tests {
+
+inline std::atomic<int> instruction_count_runs{0};
+
+struct InstructionCount {
+    using Result = std::uint64_t;
+
+    static Result run(fun::IR::Lambda const &lambda,
+                      fun::pass::FunctionAnalyses &) {
+        ++instruction_count_runs;
+        Result count = 0;
+        for (fun::IR::Block const &block : lambda.body()) {
+            count += block.size();
+        }
+        return count;
+    }
+};
+
+struct AppendRet : fun::pass::FunctionPass {
+    std::string_view name() const noexcept override { return "append-ret"; }
+
+    fun::pass::Preserved run(fun::IR::Lambda &lambda,
+                             fun::pass::FunctionAnalyses &) override {
+        lambda.body().back().append(fun::IR::Instruction::Opcode::Ret,
+                                    fun::IR::Scalar{0});
+        return fun::pass::Preserved::none();
+    }
+};
+
+struct QueryCount : fun::pass::FunctionPass {
+    std::string_view name() const noexcept override { return "query-count"; }
+
+    fun::pass::Preserved run(fun::IR::Lambda &,
+                             fun::pass::FunctionAnalyses &analyses) override {
+        analyses.get<InstructionCount>();
+        return fun::pass::Preserved::all();
+    }
+};
+
+struct CountLambdas : fun::pass::ModulePass {
+    std::uint64_t count = 0;
+
+    std::string_view name() const noexcept override { return "count-lambdas"; }
+
+    fun::pass::Preserved run(fun::IR::Module &module,
+                             fun::pass::AnalysisManager &) override {
+        count = module.size();
+        return fun::pass::Preserved::all();
+    }
+};
+
+inline fun::IR::Module make_module(std::span<std::string_view const> names) {
+    fun::IR::Module module;
+    for (std::string_view name : names) {
+        fun::IR::Lambda lambda{
+            fun::IR::Label{name},
+            std::make_unique<fun::IR::Type>(fun::IR::Type::i32{}),
+            {}};
+        lambda.body().emplace_back();
+        module.append(std::move(lambda));
+    }
+    return module;
+}
+
+} // namespace pass_manager_tests
+
+BOOST_AUTO_TEST_SUITE(pass_manager_tests)
+
+BOOST_AUTO_TEST_CASE(analysis_is_cached) {
+    using namespace ::pass_manager_tests;
+    std::string_view const names[] = {"f"};
+    fun::IR::Module module         = make_module(names);
+    fun::pass::AnalysisManager analyses;
+
+    instruction_count_runs = 0;
+    BOOST_TEST(analyses.get<InstructionCount>(module[0]) == 0);
+    BOOST_TEST(analyses.get<InstructionCount>(module[0]) == 0);
+    BOOST_TEST(instruction_count_runs == 1);
+
+    module[0].body()[0].append(fun::IR::Instruction::Opcode::Ret,
+                               fun::IR::Scalar{0});
+    analyses.invalidate(module[0]);
+    BOOST_TEST(analyses.get<InstructionCount>(module[0]) == 1);
+    BOOST_TEST(instruction_count_runs == 2);
+}
+
+BOOST_AUTO_TEST_CASE(preserved_analysis_survives) {
+    using namespace ::pass_manager_tests;
+    std::string_view const names[] = {"f"};
+    fun::IR::Module module         = make_module(names);
+    fun::pass::AnalysisManager analyses;
+
+    instruction_count_runs = 0;
+    analyses.get<InstructionCount>(module[0]);
+    analyses.invalidate(
+        module[0], fun::pass::Preserved::none().preserve<InstructionCount>());
+    BOOST_TEST(analyses.on(module[0]).cached<InstructionCount>() != nullptr);
+    analyses.invalidate(module[0]);
+    BOOST_TEST(analyses.on(module[0]).cached<InstructionCount>() == nullptr);
+    BOOST_TEST(instruction_count_runs == 1);
+}
+
+BOOST_AUTO_TEST_CASE(mutation_invalidates_analysis) {
+    using namespace ::pass_manager_tests;
+    std::string_view const names[] = {"f", "g"};
+    fun::IR::Module module         = make_module(names);
+    fun::pass::AnalysisManager analyses;
+    fun::pass::PassManager manager;
+    manager.add<QueryCount>();
+    manager.add<AppendRet>();
+    manager.add<QueryCount>();
+
+    instruction_count_runs = 0;
+    manager.run(module, analyses);
+    BOOST_TEST(instruction_count_runs == 4);
+    BOOST_TEST(*analyses.on(module[0]).cached<InstructionCount>() == 1);
+    BOOST_TEST(*analyses.on(module[1]).cached<InstructionCount>() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_function_passes) {
+    using namespace ::pass_manager_tests;
+    std::string_view const names[] = {"a", "b", "c", "d", "e", "f", "g", "h"};
+    fun::IR::Module module         = make_module(names);
+    fun::pass::AnalysisManager analyses;
+    fun::pass::PassManager manager{{.parallel = true, .threads = 4}};
+    manager.add<AppendRet>();
+    CountLambdas &counter = manager.add<CountLambdas>();
+    manager.add<AppendRet>();
+    manager.add<QueryCount>();
+
+    manager.run(module, analyses);
+    BOOST_TEST(counter.count == 8);
+    for (fun::IR::Lambda const &lambda : module) {
+        BOOST_TEST(lambda.body()[0].size() == 2);
+        BOOST_TEST(*analyses.on(lambda).cached<InstructionCount>() == 2);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(pass_timings) {
+    using namespace ::pass_manager_tests;
+    std::string_view const names[] = {"f", "g", "h"};
+    fun::IR::Module module         = make_module(names);
+    fun::pass::AnalysisManager analyses;
+    fun::pass::PassManager manager;
+    manager.add<AppendRet>();
+    manager.add<CountLambdas>();
+
+    manager.run(module, analyses);
+    auto timings = manager.timings();
+    BOOST_REQUIRE(timings.size() == 2);
+    BOOST_TEST(timings[0].name == "append-ret");
+    BOOST_TEST(timings[0].runs == 3);
+    BOOST_TEST(timings[1].name == "count-lambdas");
+    BOOST_TEST(timings[1].runs == 1);
+
+    std::ostringstream out;
+    manager.print_timings(out);
+    BOOST_TEST(out.str().find("append-ret") != std::string::npos);
+    BOOST_TEST(out.str().find("count-lambdas") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
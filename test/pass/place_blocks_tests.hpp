@@ -0,0 +1,207 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file place_blocks_tests.hpp
+ * @brief Defines tests for [CFG](@ref CFG) and
+ * [PlaceBlocks](@ref PlaceBlocks)
+ */
+
+#pragma once
+
+#include <limits>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "eval/evaluator.hpp"
+#include "eval/evaluator_tests.hpp"
+#include "pass/place_blocks.hpp"
+
+namespace place_blocks_tests {
+
+using fun::IR::BlockHandle;
+using fun::IR::Instruction;
+using fun::IR::LocalHandle;
+using fun::IR::Scalar;
+using fun::IR::Type;
+
+/**
+ * pick(x: T) -> i64 {
+ *     opcode #2, %0, zero
+ * #1:
+ *     ret 1
+ * #2:
+ *     ret 2
+ * }
+ */
+inline fun::IR::Lambda pick(Instruction::Opcode opcode, Type type) {
+    fun::IR::Lambda::Arguments arguments;
+    Scalar const zero = fun::eval::zero(type);
+    arguments.emplace_back(fun::IR::Label{"x"},
+                           std::make_unique<Type>(std::move(type)));
+    fun::IR::Lambda lambda{fun::IR::Label{"pick"},
+                           std::make_unique<Type>(Type::i64{}),
+                           std::move(arguments)};
+    fun::IR::Lambda::Body &body = lambda.body();
+    body.emplace_back().append(opcode, BlockHandle{2}, LocalHandle{0}, zero);
+    body.emplace_back().append(Instruction::Opcode::Ret, Scalar::i64{1});
+    body.emplace_back().append(Instruction::Opcode::Ret, Scalar::i64{2});
+    return lambda;
+}
+
+/// places the blocks of @p lambda
+inline void place(fun::IR::Lambda &lambda) {
+    fun::pass::FunctionAnalyses analyses{lambda};
+    fun::pass::PlaceBlocks{}.run(lambda, analyses);
+}
+
+/**
+ * @brief places the blocks of @p lambda, and checks that it gives the
+ * same results for each of @p arguments as it did before.
+ *
+ * @return the lambda, once placed
+ */
+inline fun::IR::Lambda const &
+place_same(fun::IR::Module &module,
+           fun::IR::Lambda lambda,
+           std::vector<Scalar> const &arguments) {
+    fun::IR::Lambda &placed = module.append(std::move(lambda));
+    auto run = [&] {
+        // a new evaluator, as the memo of the last one is stale.
+        fun::eval::Evaluator evaluator{module};
+        std::vector<Scalar> values;
+        for (Scalar const &argument : arguments) {
+            Scalar const given[] = {argument};
+            auto result = evaluator.call(placed.name(), given);
+            BOOST_TEST(result.error == fun::eval::Error::None);
+            values.push_back(result.value);
+        }
+        return values;
+    };
+
+    std::vector<Scalar> const before = run();
+    place(placed);
+    std::vector<Scalar> const after = run();
+    for (std::size_t index = 0; index < arguments.size(); ++index) {
+        BOOST_TEST(before[index].as<Scalar::i64>() ==
+                   after[index].as<Scalar::i64>());
+    }
+    return placed;
+}
+
+} // namespace place_blocks_tests
+
+BOOST_AUTO_TEST_SUITE(place_blocks_tests)
+
+BOOST_AUTO_TEST_CASE(cfg_edges) {
+    fun::IR::Lambda lambda = ::evaluator_tests::sum();
+    fun::pass::CFG cfg{lambda};
+    BOOST_REQUIRE(cfg.size() == 3U);
+    BOOST_TEST((cfg.successors(0) == std::vector<std::uint64_t>{2, 1}));
+    BOOST_TEST((cfg.successors(1) == std::vector<std::uint64_t>{1, 2}));
+    BOOST_TEST(cfg.successors(2).empty());
+    BOOST_TEST((cfg.predecessors(1) == std::vector<std::uint64_t>{0, 1}));
+    BOOST_TEST((cfg.predecessors(2) == std::vector<std::uint64_t>{0, 1}));
+    BOOST_TEST(*cfg[1].terminator == 3U);
+    BOOST_TEST(!cfg.exits(1));
+    BOOST_TEST(cfg.exits(2));
+}
+
+BOOST_AUTO_TEST_CASE(place_blocks_keeps_likely_order) {
+    using namespace ::place_blocks_tests;
+    // a loop which loops, and values which are seldom equal, fall through
+    // already.
+    fun::IR::Lambda lambda = ::evaluator_tests::sum();
+    place(lambda);
+    BOOST_TEST(lambda.body()[1].size() == 4U);
+
+    fun::IR::Lambda equal = pick(Instruction::Opcode::Jeq, Type::i64{});
+    place(equal);
+    BOOST_TEST(equal.body()[0][0].opcode() == Instruction::Opcode::Jeq);
+    BOOST_TEST(equal.body()[0][0].A().as<BlockHandle>().index == 2U);
+}
+
+BOOST_AUTO_TEST_CASE(place_blocks_inverts_branches) {
+    using namespace ::place_blocks_tests;
+    fun::IR::Module module;
+    fun::IR::Lambda const &lambda =
+        place_same(module,
+                   pick(Instruction::Opcode::Jne, Type::i64{}),
+                   {Scalar{Scalar::i64{0}}, Scalar{Scalar::i64{3}}});
+
+    // jne #2 is likely taken, so #2 follows #0, and the branch becomes
+    // jeq to the block which used to follow.
+    BOOST_REQUIRE(lambda.body().size() == 3U);
+    Instruction const &branch = lambda.body()[0][0];
+    BOOST_TEST(branch.opcode() == Instruction::Opcode::Jeq);
+    BOOST_TEST(branch.A().as<BlockHandle>().index == 2U);
+    BOOST_TEST(lambda.body()[1][0].A().as<Scalar::i64>() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(place_blocks_splits_float_branches) {
+    using namespace ::place_blocks_tests;
+    fun::IR::Lambda less = pick(Instruction::Opcode::Jlt, Type::f64{});
+    less.body()[0].weights(fun::IR::Block::Weights{100, 1});
+    fun::IR::Module module;
+    fun::IR::Lambda const &lambda = place_same(
+        module,
+        std::move(less),
+        {Scalar{Scalar::f64{-1.0}},
+         Scalar{Scalar::f64{1.0}},
+         Scalar{Scalar::f64{std::numeric_limits<double>::quiet_NaN()}}});
+
+    // NaN is neither less than, nor at least, zero, so jlt cannot become
+    // jge: a new block jumps to the block which used to follow.
+    BOOST_REQUIRE(lambda.body().size() == 4U);
+    BOOST_TEST(lambda.body()[0][0].opcode() == Instruction::Opcode::Jlt);
+    BOOST_TEST(lambda.body()[0][0].A().as<BlockHandle>().index == 2U);
+    BOOST_TEST(lambda.body()[1][0].opcode() == Instruction::Opcode::Jmp);
+    BOOST_TEST(lambda.body()[1][0].A().as<BlockHandle>().index == 3U);
+    BOOST_TEST(lambda.body()[0].weights()->taken == 100U);
+}
+
+BOOST_AUTO_TEST_CASE(place_blocks_inverts_fast_float_branches) {
+    using namespace ::place_blocks_tests;
+    fun::IR::Lambda less = pick(Instruction::Opcode::Jlt, Type::f64{});
+    less.body()[0].weights(fun::IR::Block::Weights{100, 1});
+    less.fast_math(fun::IR::FastMath::NoNaNs);
+    fun::IR::Module module;
+    fun::IR::Lambda const &lambda =
+        place_same(module,
+                   std::move(less),
+                   {Scalar{Scalar::f64{-1.0}}, Scalar{Scalar::f64{1.0}}});
+
+    // assuming there is no NaN, jlt is the inverse of jge.
+    BOOST_REQUIRE(lambda.body().size() == 3U);
+    BOOST_TEST(lambda.body()[0][0].opcode() == Instruction::Opcode::Jge);
+    BOOST_TEST(lambda.body()[0][0].A().as<BlockHandle>().index == 2U);
+    BOOST_TEST(lambda.body()[0].weights()->taken == 1U);
+}
+
+BOOST_AUTO_TEST_CASE(place_blocks_keeps_falling_out) {
+    using namespace ::place_blocks_tests;
+    // #2 falls out of the lambda, returning zero, and is likelier than #1.
+    fun::IR::Lambda nonzero = pick(Instruction::Opcode::Jnz, Type::i64{});
+    nonzero.body()[0].weights(fun::IR::Block::Weights{10, 1});
+    nonzero.body()[2] = fun::IR::Block{};
+    fun::IR::Module module;
+    fun::IR::Lambda const &lambda =
+        place_same(module,
+                   std::move(nonzero),
+                   {Scalar{Scalar::i64{0}}, Scalar{Scalar::i64{3}}});
+
+    BOOST_REQUIRE(lambda.body().size() == 3U);
+    BOOST_TEST(lambda.body()[0][0].opcode() == Instruction::Opcode::Jz);
+    BOOST_TEST(lambda.body()[0].weights()->taken == 1U);
+    BOOST_TEST(lambda.body()[1][0].opcode() == Instruction::Opcode::Ret);
+    BOOST_TEST(lambda.body()[1][0].A().as<Scalar::i64>() == 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
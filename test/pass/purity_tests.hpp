@@ -0,0 +1,137 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file purity_tests.hpp
+ * @brief Defines tests for [Purity](@ref Purity)
+ */
+
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "eval/evaluator_tests.hpp"
+#include "pass/purity.hpp"
+
+namespace purity_tests {
+
+using fun::IR::Instruction;
+using fun::IR::LocalHandle;
+using fun::pass::Effects;
+using fun::pass::Memory;
+
+/// name() -> i64 { let r: i64; call %0, @callee; ret %0 }
+inline fun::IR::Lambda calls(std::string_view name, std::string_view callee) {
+    fun::IR::Lambda lambda{
+        fun::IR::Label{name}, evaluator_tests::i64(), {}};
+    lambda.declare(
+        fun::IR::Local{fun::IR::Label{"r"}, evaluator_tests::i64(), {}});
+    fun::IR::Block &block = lambda.body().emplace_back();
+    block.append(
+        Instruction::Opcode::Call, LocalHandle{0}, fun::IR::Label{callee});
+    block.append(Instruction::Opcode::Ret, LocalHandle{0});
+    return lambda;
+}
+
+/// divide(x: i64) -> i64 { let r: i64; div %1, %0, divisor; ret %1 }
+inline fun::IR::Lambda divide(fun::IR::Operand divisor) {
+    fun::IR::Lambda::Arguments arguments;
+    arguments.emplace_back(fun::IR::Label{"x"}, evaluator_tests::i64());
+    fun::IR::Lambda lambda{fun::IR::Label{"divide"},
+                           evaluator_tests::i64(),
+                           std::move(arguments)};
+    lambda.declare(
+        fun::IR::Local{fun::IR::Label{"r"}, evaluator_tests::i64(), {}});
+    fun::IR::Block &block = lambda.body().emplace_back();
+    block.append(
+        Instruction::Opcode::Div, LocalHandle{1}, LocalHandle{0}, divisor);
+    block.append(Instruction::Opcode::Ret, LocalHandle{1});
+    lambda.checked(true);
+    return lambda;
+}
+
+constexpr Effects pure{Memory::None, false, true};
+constexpr Effects pure_but_loops{Memory::None, false, false};
+
+} // namespace purity_tests
+
+BOOST_AUTO_TEST_SUITE(purity_tests)
+
+BOOST_AUTO_TEST_CASE(purity_of_lambdas) {
+    fun::IR::Module module;
+    module.append(evaluator_tests::main());
+    module.append(evaluator_tests::square());
+    module.append(evaluator_tests::sum());
+    module.append(evaluator_tests::loop());
+    fun::pass::Purity purity{module};
+
+    BOOST_TEST((purity.find(fun::IR::Label{"square"}) == pure));
+    BOOST_TEST((purity.find(fun::IR::Label{"main"}) == pure));
+    BOOST_TEST((purity.find(fun::IR::Label{"sum"}) == pure_but_loops));
+    BOOST_TEST((purity.find(fun::IR::Label{"loop"}) == pure_but_loops));
+    BOOST_TEST((purity.find(fun::IR::Label{"missing"}) ==
+                fun::pass::Purity::unknown));
+}
+
+BOOST_AUTO_TEST_CASE(purity_through_calls) {
+    fun::IR::Module module;
+    module.append(purity_tests::calls("a", "b"));
+    module.append(purity_tests::calls("b", "c"));
+    module.append(evaluator_tests::sum());
+    module.append(purity_tests::calls("c", "sum"));
+    module.append(purity_tests::calls("even", "odd"));
+    module.append(purity_tests::calls("odd", "even"));
+    module.append(purity_tests::calls("extern", "missing"));
+    fun::pass::Purity purity{module};
+
+    BOOST_TEST((purity.find(fun::IR::Label{"a"}) == pure_but_loops));
+    BOOST_TEST((purity.find(fun::IR::Label{"even"}) == pure_but_loops));
+    BOOST_TEST((purity.find(fun::IR::Label{"odd"}) == pure_but_loops));
+    BOOST_TEST((purity.find(fun::IR::Label{"extern"}) ==
+                fun::pass::Purity::unknown));
+}
+
+BOOST_AUTO_TEST_CASE(purity_of_some_lambdas) {
+    fun::IR::Lambda main   = evaluator_tests::main();
+    fun::IR::Lambda square = evaluator_tests::square();
+    std::vector<fun::IR::Lambda const *> both{&main, &square};
+    std::vector<fun::IR::Lambda const *> alone{&main};
+
+    BOOST_TEST((fun::pass::Purity{both}.find(fun::IR::Label{"main"}) ==
+                purity_tests::pure));
+    BOOST_TEST((fun::pass::Purity{alone}.find(fun::IR::Label{"main"}) ==
+                fun::pass::Purity::unknown));
+}
+
+BOOST_AUTO_TEST_CASE(purity_of_checked_lambdas) {
+    using fun::IR::Scalar;
+    auto effects = [](fun::IR::Lambda const &lambda) {
+        std::vector<fun::IR::Lambda const *> alone{&lambda};
+        return fun::pass::Purity{alone}.find(lambda.name());
+    };
+
+    // x * x overflows for a large enough x, and traps, so a call of it may
+    // not return.
+    fun::IR::Lambda square = evaluator_tests::square();
+    BOOST_TEST((effects(square) == purity_tests::pure));
+    square.checked(true);
+    BOOST_TEST((effects(square) == purity_tests::pure_but_loops));
+
+    BOOST_TEST((effects(purity_tests::divide(Scalar::i64{2})) ==
+                purity_tests::pure));
+    BOOST_TEST((effects(purity_tests::divide(Scalar::i64{-1})) ==
+                purity_tests::pure_but_loops));
+    BOOST_TEST((effects(purity_tests::divide(LocalHandle{0})) ==
+                purity_tests::pure_but_loops));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,109 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file ranges_tests.hpp
+ * @brief Defines tests for [Range](@ref Range) and [Ranges](@ref Ranges)
+ */
+
+#pragma once
+
+#include <boost/test/unit_test.hpp>
+
+#include "pass/ranges.hpp"
+
+namespace ranges_tests {
+
+using fun::IR::Instruction;
+using fun::IR::Label;
+using fun::IR::LocalHandle;
+using fun::IR::Scalar;
+using fun::IR::Type;
+using fun::pass::Range;
+using fun::pass::Ranges;
+
+/// arithmetic() -> nil { let a: u8; let b: i64; let c: i64; }
+inline fun::IR::Lambda arithmetic() {
+    fun::IR::Lambda lambda{
+        Label{"arithmetic"}, std::make_unique<Type>(Type::Nil{}), {}};
+    lambda.declare(
+        fun::IR::Local{Label{"a"}, std::make_unique<Type>(Type::u8{}), {}});
+    for (char const *name : {"b", "c"}) {
+        lambda.declare(fun::IR::Local{
+            Label{name}, std::make_unique<Type>(Type::i64{}), {}});
+    }
+    return lambda;
+}
+
+} // namespace ranges_tests
+
+BOOST_AUTO_TEST_SUITE(ranges_tests)
+
+BOOST_AUTO_TEST_CASE(range_multiplies_and_negates) {
+    using namespace ::ranges_tests;
+    BOOST_TEST((Range{-2, 3} * Range{4, 5} == Range{-10, 15}));
+    BOOST_TEST((Range{-2, 3} * Range{-1, -1} == Range{-3, 2}));
+    BOOST_TEST(!(Range{0, Range::above - 1} * Range{2, 2}).bounded());
+    BOOST_TEST((-Range{-2, 3} == Range{-3, 2}));
+    BOOST_TEST(!(-Range{0, Range::above}).bounded());
+}
+
+BOOST_AUTO_TEST_CASE(range_divides_around_zero) {
+    using namespace ::ranges_tests;
+    BOOST_TEST((Range{10, 100} / Range{2, 5} == Range{2, 50}));
+    BOOST_TEST((Range{-100, 100} / Range{-2, 2} == Range{-100, 100}));
+    BOOST_TEST((Range{7, 7} / Range{0, 2} == Range{3, 7}));
+    BOOST_TEST(!(Range{1, 1} / Range{0, 0}).bounded());
+
+    BOOST_TEST((Range{0, 1000} % Range{10, 10} == Range{0, 9}));
+    BOOST_TEST((Range{-1000, 5} % Range{-8, 8} == Range{-7, 5}));
+    BOOST_TEST((Range{3, 4} % Range{10, 20} == Range{3, 4}));
+    // a remainder is bounded even when the dividend is not.
+    BOOST_TEST((Range{} % Range{1, 4} == Range{-3, 3}));
+    BOOST_TEST(!(Range{1, 1} % Range{0, 0}).bounded());
+}
+
+BOOST_AUTO_TEST_CASE(step_follows_arithmetic) {
+    using namespace ::ranges_tests;
+    using Opcode                 = Instruction::Opcode;
+    fun::IR::Lambda const lambda = arithmetic();
+    Ranges::State state{{Range::of_type(2), Range{-10, 10}, Range{}},
+                        {std::nullopt, std::nullopt, std::nullopt},
+                        {}};
+    auto step = [&](Instruction const &instruction) {
+        Ranges::step(lambda, state, instruction);
+        return state.ranges[instruction.A().as<LocalHandle>().index];
+    };
+
+    BOOST_TEST((step({Opcode::Mul,
+                      LocalHandle{1},
+                      LocalHandle{1},
+                      Scalar::i64{3}}) == Range{-30, 30}));
+    BOOST_TEST((step({Opcode::Div,
+                      LocalHandle{2},
+                      LocalHandle{1},
+                      Scalar::i64{4}}) == Range{-7, 7}));
+    BOOST_TEST((step({Opcode::Rem,
+                      LocalHandle{2},
+                      LocalHandle{1},
+                      Scalar::i64{8}}) == Range{-7, 7}));
+    BOOST_TEST((step({Opcode::Neg, LocalHandle{2}, LocalHandle{1}}) ==
+                Range{-30, 30}));
+    BOOST_TEST((step({Opcode::Rem,
+                      LocalHandle{0},
+                      LocalHandle{0},
+                      Scalar::u8{10}}) == Range{0, 9}));
+    // which may wrap around, as a u8 holds no more than 255.
+    BOOST_TEST((step({Opcode::Mul,
+                      LocalHandle{0},
+                      LocalHandle{0},
+                      Scalar::u8{30}}) == Range::of_type(2)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
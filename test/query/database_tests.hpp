@@ -0,0 +1,144 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file database_tests.hpp
+ * @brief Defines tests for [Database](@ref Database)
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+#include "query/database.hpp"
+
+namespace database_tests {
+
+using fun::query::Database;
+using fun::query::Fingerprint;
+
+/// an input, which holds a number per name
+struct Number {
+    using Key   = std::string;
+    using Value = std::int64_t;
+
+    static Fingerprint fingerprint(Value value) noexcept {
+        return static_cast<Fingerprint>(value);
+    }
+};
+
+/// whether a number is odd
+struct Odd {
+    using Key   = std::string;
+    using Value = bool;
+
+    static Value compute(Database &database, Key const &key) {
+        return database.get<Number>(key) % 2 != 0;
+    }
+
+    static Fingerprint fingerprint(Value value) noexcept { return value; }
+};
+
+/// "odd" or "even", which only changes when the parity of a number does
+struct Describe {
+    using Key   = std::string;
+    using Value = std::string;
+
+    static Value compute(Database &database, Key const &key) {
+        return key + " is " + (database.get<Odd>(key) ? "odd" : "even");
+    }
+
+    static Fingerprint fingerprint(Value const &value) noexcept {
+        return std::hash<std::string>{}(value);
+    }
+};
+
+/// the sum of the numbers a and b
+struct Sum {
+    using Key   = int;
+    using Value = std::int64_t;
+
+    static Value compute(Database &database, Key) {
+        return database.get<Number>("a") + database.get<Number>("b");
+    }
+
+    static Fingerprint fingerprint(Value value) noexcept {
+        return static_cast<Fingerprint>(value);
+    }
+};
+
+} // namespace database_tests
+
+BOOST_AUTO_TEST_SUITE(database_tests)
+
+BOOST_AUTO_TEST_CASE(queries_are_memoized) {
+    using namespace ::database_tests;
+    Database database;
+    database.set<Number>("a", 3);
+
+    BOOST_TEST(database.get<Describe>("a") == "a is odd");
+    BOOST_TEST(database.get<Describe>("a") == "a is odd");
+    BOOST_TEST(database.computed<Describe>() == 1);
+    BOOST_TEST(database.computed<Odd>() == 1);
+
+    // an input which was never set holds its default value.
+    BOOST_TEST(database.get<Describe>("b") == "b is even");
+    BOOST_TEST(database.computed<Describe>() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(unchanged_values_cut_off_recomputation) {
+    using namespace ::database_tests;
+    Database database;
+    database.set<Number>("a", 3);
+    database.get<Describe>("a");
+    fun::query::Revision const first = database.revision();
+
+    // the same value does not start a revision.
+    BOOST_TEST(!database.set<Number>("a", 3));
+    BOOST_TEST(database.revision() == first);
+
+    // a new number of the same parity recomputes Odd, but not Describe.
+    BOOST_TEST(database.set<Number>("a", 5));
+    BOOST_TEST(database.revision() > first);
+    BOOST_TEST(database.get<Describe>("a") == "a is odd");
+    BOOST_TEST(database.computed<Odd>() == 2);
+    BOOST_TEST(database.computed<Describe>() == 1);
+
+    BOOST_TEST(database.set<Number>("a", 8));
+    BOOST_TEST(database.get<Describe>("a") == "a is even");
+    BOOST_TEST(database.computed<Odd>() == 3);
+    BOOST_TEST(database.computed<Describe>() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(only_dependents_are_recomputed) {
+    using namespace ::database_tests;
+    Database database;
+    database.set<Number>("a", 1);
+    database.set<Number>("b", 2);
+    database.set<Number>("c", 4);
+    BOOST_TEST(database.get<Sum>(0) == 3);
+    BOOST_TEST(database.get<Describe>("c") == "c is even");
+
+    database.set<Number>("c", 7);
+    BOOST_TEST(database.get<Sum>(0) == 3);
+    BOOST_TEST(database.computed<Sum>() == 1);
+    BOOST_TEST(database.get<Describe>("c") == "c is odd");
+
+    database.set<Number>("b", 10);
+    BOOST_TEST(database.get<Sum>(0) == 11);
+    BOOST_TEST(database.computed<Sum>() == 2);
+    BOOST_TEST(database.get<Describe>("c") == "c is odd");
+    BOOST_TEST(database.computed<Describe>() == 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
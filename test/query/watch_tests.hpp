@@ -0,0 +1,100 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file watch_tests.hpp
+ * @brief Defines tests for [rebuild](@ref fun::query::rebuild)
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+#include <boost/test/unit_test.hpp>
+#include <llvm/Support/TargetSelect.h>
+
+#include "query/compile.hpp"
+#include "query/watch.hpp"
+
+namespace watch_tests {
+
+namespace fs = std::filesystem;
+
+using fun::query::Database;
+using fun::query::LambdaObject;
+
+/// a program whose main returns what seven does, which is @p value
+inline std::string program(int value) {
+    return "fn seven() -> i64 {\n"
+           "    let r: i64\n"
+           "    load %0, " +
+           std::to_string(value) +
+           "\n"
+           "    ret %0\n"
+           "}\n"
+           "fn main() -> i64 {\n"
+           "    let r: i64\n"
+           "    call %0, @seven\n"
+           "    ret %0\n"
+           "}\n";
+}
+
+inline void write(fs::path const &path, std::string const &text) {
+    std::ofstream{path, std::ios::trunc} << text;
+}
+
+BOOST_AUTO_TEST_SUITE(watch_tests)
+
+BOOST_AUTO_TEST_CASE(rebuild_compiles_only_what_changed) {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+
+    fs::path const directory =
+        fs::temp_directory_path() /
+        ("fun_watch_tests." + std::to_string(::getpid()));
+    fs::create_directories(directory);
+    fs::path const source = directory / "program.fun";
+
+    Database database;
+    database.set<fun::query::Configure>({}, fun::query::Options{});
+    write(source, program(7));
+    BOOST_TEST(fun::query::load(database, source));
+    fun::query::Rebuilt first = fun::query::rebuild(database, source, {});
+    BOOST_TEST(first.built);
+    BOOST_TEST(first.compiled == 2U);
+    BOOST_TEST(fs::is_regular_file(directory / "program"));
+
+    LambdaObject::Value const caller =
+        database.get<LambdaObject>({source, "main"});
+    LambdaObject::Value const callee =
+        database.get<LambdaObject>({source, "seven"});
+
+    // only the body of seven changes, which main does not depend on.
+    write(source, program(8));
+    BOOST_TEST(fun::query::load(database, source));
+    fun::query::Rebuilt second = fun::query::rebuild(database, source, {});
+    BOOST_TEST(second.built);
+    BOOST_TEST(second.compiled == 1U);
+    BOOST_TEST(database.get<LambdaObject>({source, "main"}) == caller);
+    BOOST_TEST(database.get<LambdaObject>({source, "seven"}) != callee);
+
+    // an unchanged file compiles nothing.
+    BOOST_TEST(!fun::query::load(database, source));
+    BOOST_TEST(fun::query::rebuild(database, source, {}).compiled == 0U);
+
+    fs::remove_all(directory);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace watch_tests
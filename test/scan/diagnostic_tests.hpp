@@ -0,0 +1,42 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file diagnostic_tests.hpp
+ * @brief Defines tests for [Diagnostic](@ref Diagnostic)
+ */
+
+#pragma once
+
+#include <sstream>
+
+#include <boost/test/unit_test.hpp>
+
+#include "scan/diagnostic.hpp"
+
+BOOST_AUTO_TEST_SUITE(diagnostic_tests)
+
+BOOST_AUTO_TEST_CASE(diagnostic_print) {
+    std::string_view source = "fn a() -> nil {\n    ret %\n}\nfn a";
+    fun::scan::Diagnostic const diagnostics[] = {
+        {24, fun::scan::Diagnostic::Kind::Error, "expected local"},
+        {28, fun::scan::Diagnostic::Kind::Warning, "redefinition of a"},
+    };
+
+    std::ostringstream out;
+    fun::scan::print(out, "a.fun", source, diagnostics);
+    BOOST_TEST(out.str() == "a.fun:2:9: error: expected local\n"
+                            "    ret %\n"
+                            "        ^\n"
+                            "a.fun:4:1: warning: redefinition of a\n"
+                            "fn a\n"
+                            "^\n");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,162 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file literal_tests.hpp
+ * @brief Defines tests for [scan_integer](@ref scan_integer)
+ */
+
+#pragma once
+
+#include <string_view>
+
+#include <boost/test/unit_test.hpp>
+
+#include "scan/literal.hpp"
+
+namespace literal_tests {
+
+struct Scanned {
+    fun::scan::LiteralError error;
+    fun::IR::Scalar value;
+    std::size_t length;
+};
+
+inline Scanned scan(std::string_view text) {
+    Scanned scanned{fun::scan::LiteralError::None, {}, 0};
+    char const *first = text.data();
+    char const *last  = text.data() + text.size();
+    scanned.error     = fun::scan::scan_integer(first, last, scanned.value);
+    scanned.length    = static_cast<std::size_t>(first - text.data());
+    return scanned;
+}
+
+} // namespace literal_tests
+
+BOOST_AUTO_TEST_SUITE(literal_tests)
+
+BOOST_AUTO_TEST_CASE(literal_decimal) {
+    using fun::scan::LiteralError;
+    using ::literal_tests::scan;
+
+    auto A = scan("42");
+    BOOST_TEST(A.error == LiteralError::None);
+    BOOST_TEST(A.length == 2);
+    BOOST_TEST(A.value.is<fun::IR::Scalar::i64>());
+    BOOST_TEST(A.value.as<fun::IR::Scalar::i64>() == 42);
+
+    auto B = scan("-9223372036854775808");
+    BOOST_TEST(B.error == LiteralError::None);
+    BOOST_TEST(B.value.is<fun::IR::Scalar::i64>());
+    BOOST_TEST(B.value.as<fun::IR::Scalar::i64>() ==
+               std::numeric_limits<std::int64_t>::min());
+
+    auto C = scan("18446744073709551615");
+    BOOST_TEST(C.error == LiteralError::None);
+    BOOST_TEST(C.value.is<fun::IR::Scalar::u64>());
+    BOOST_TEST(C.value.as<fun::IR::Scalar::u64>() ==
+               std::numeric_limits<std::uint64_t>::max());
+
+    auto D = scan("18446744073709551616");
+    BOOST_TEST(D.error == LiteralError::OutOfRange);
+    BOOST_TEST(D.length == 20);
+
+    auto E = scan("1234567890123456 ");
+    BOOST_TEST(E.error == LiteralError::None);
+    BOOST_TEST(E.length == 16);
+    BOOST_TEST(E.value.as<fun::IR::Scalar::i64>() == 1234567890123456);
+}
+
+BOOST_AUTO_TEST_CASE(literal_suffix) {
+    using fun::scan::LiteralError;
+    using ::literal_tests::scan;
+
+    auto A = scan("255u8");
+    BOOST_TEST(A.error == LiteralError::None);
+    BOOST_TEST(A.length == 5);
+    BOOST_TEST(A.value.is<fun::IR::Scalar::u8>());
+    BOOST_TEST(A.value.as<fun::IR::Scalar::u8>() == 255);
+
+    auto B = scan("256u8");
+    BOOST_TEST(B.error == LiteralError::OutOfRange);
+    BOOST_TEST(B.value.is<fun::IR::Scalar::u8>());
+
+    auto C = scan("-128i8");
+    BOOST_TEST(C.error == LiteralError::None);
+    BOOST_TEST(C.value.as<fun::IR::Scalar::i8>() == -128);
+
+    auto D = scan("-129i8");
+    BOOST_TEST(D.error == LiteralError::OutOfRange);
+
+    auto E = scan("-1u32");
+    BOOST_TEST(E.error == LiteralError::OutOfRange);
+    BOOST_TEST(E.value.is<fun::IR::Scalar::u32>());
+
+    auto F = scan("65535u16");
+    BOOST_TEST(F.value.as<fun::IR::Scalar::u16>() == 65535);
+
+    auto G = scan("-2147483648i32");
+    BOOST_TEST(G.value.as<fun::IR::Scalar::i32>() ==
+               std::numeric_limits<std::int32_t>::min());
+
+    auto H = scan("7u7");
+    BOOST_TEST(H.error == LiteralError::InvalidSuffix);
+}
+
+BOOST_AUTO_TEST_CASE(literal_prefix) {
+    using fun::scan::LiteralError;
+    using ::literal_tests::scan;
+
+    auto A = scan("0xFFu8");
+    BOOST_TEST(A.error == LiteralError::None);
+    BOOST_TEST(A.value.as<fun::IR::Scalar::u8>() == 255);
+
+    auto B = scan("0b1010");
+    BOOST_TEST(B.error == LiteralError::None);
+    BOOST_TEST(B.value.as<fun::IR::Scalar::i64>() == 10);
+
+    auto C = scan("0O777u16");
+    BOOST_TEST(C.error == LiteralError::None);
+    BOOST_TEST(C.value.as<fun::IR::Scalar::u16>() == 511);
+
+    auto D = scan("0xFFFFFFFFFFFFFFFF");
+    BOOST_TEST(D.value.as<fun::IR::Scalar::u64>() ==
+               std::numeric_limits<std::uint64_t>::max());
+
+    auto E = scan("0x10000000000000000");
+    BOOST_TEST(E.error == LiteralError::OutOfRange);
+
+    auto F = scan("0x80i8");
+    BOOST_TEST(F.error == LiteralError::OutOfRange);
+
+    auto G = scan("0x");
+    BOOST_TEST(G.error == LiteralError::MissingDigits);
+}
+
+BOOST_AUTO_TEST_CASE(literal_no_match) {
+    using fun::scan::LiteralError;
+    using ::literal_tests::scan;
+
+    auto A = scan("nil");
+    BOOST_TEST(A.error == LiteralError::NoMatch);
+    BOOST_TEST(A.length == 0);
+
+    auto B = scan("1.5");
+    BOOST_TEST(B.error == LiteralError::NoMatch);
+    BOOST_TEST(B.length == 0);
+
+    auto C = scan("12345678e3");
+    BOOST_TEST(C.error == LiteralError::NoMatch);
+
+    auto D = scan("-");
+    BOOST_TEST(D.error == LiteralError::NoMatch);
+    BOOST_TEST(D.length == 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,60 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file split_tests.hpp
+ * @brief Defines tests for [split_definitions](@ref split_definitions)
+ */
+
+#pragma once
+
+#include <boost/test/unit_test.hpp>
+
+#include "scan/split.hpp"
+
+BOOST_AUTO_TEST_SUITE(split_tests)
+
+BOOST_AUTO_TEST_CASE(split_each_definition) {
+    std::string_view source = "fn a() -> nil {\n ret nil\n}\n"
+                              "fn b() -> nil {\n ret nil\n}\n"
+                              "fn c() -> nil {\n ret nil\n}\n";
+    auto chunks = fun::scan::split_definitions(source);
+    BOOST_REQUIRE(chunks.size() == 3);
+    BOOST_TEST(chunks[0].starts_with("fn a"));
+    BOOST_TEST(chunks[1].starts_with("fn b"));
+    BOOST_TEST(chunks[2].starts_with("fn c"));
+    BOOST_TEST(chunks[0].size() + chunks[1].size() + chunks[2].size() ==
+               source.size());
+}
+
+BOOST_AUTO_TEST_CASE(split_ignores_indented_and_prefixed) {
+    std::string_view source = "\n\nfn a() -> nil {\n fn\n}\n"
+                              "fnord\n"
+                              "fn b() -> nil {\n}\n";
+    auto chunks = fun::scan::split_definitions(source);
+    BOOST_REQUIRE(chunks.size() == 2);
+    BOOST_TEST(chunks[0].starts_with("\n\nfn a"));
+    BOOST_TEST(chunks[0].ends_with("fnord\n"));
+    BOOST_TEST(chunks[1].starts_with("fn b"));
+}
+
+BOOST_AUTO_TEST_CASE(split_merges_to_grain) {
+    std::string_view source = "fn a() -> nil {\n}\n"
+                              "fn b() -> nil {\n}\n"
+                              "fn c() -> nil {\n}\n";
+    auto chunks = fun::scan::split_definitions(source, 20);
+    BOOST_REQUIRE(chunks.size() == 2);
+    BOOST_TEST(chunks[0].starts_with("fn a"));
+    BOOST_TEST(chunks[1].starts_with("fn c"));
+
+    BOOST_TEST(fun::scan::split_definitions(source, 1024).size() == 1);
+    BOOST_TEST(fun::scan::split_definitions("").empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,111 @@
+// fun (c) by Cade Weinberg
+//
+// To the extent possible under law, the person who associated CC0 with
+// fun has waived all copyright and related or neighboring rights
+// to fun.
+//
+// You should have received a copy of the CC0 legalcode along with this
+// work.  If not, see <https://creativecommons.org/publicdomain/zero/1.0/>.
+
+/**
+ * @file task_graph_tests.hpp
+ * @brief Defines tests for [TaskGraph](@ref TaskGraph)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "support/task_graph.hpp"
+
+namespace task_graph_tests {
+
+/// records the order tasks ran in, from any thread
+struct Log {
+    std::mutex mutex;
+    std::vector<int> order;
+
+    fun::support::TaskGraph::Work record(int task, bool succeed = true) {
+        return [this, task, succeed] {
+            std::lock_guard lock{mutex};
+            order.push_back(task);
+            return succeed;
+        };
+    }
+
+    std::ptrdiff_t position(int task) {
+        return std::ranges::find(order, task) - order.begin();
+    }
+};
+
+} // namespace task_graph_tests
+
+BOOST_AUTO_TEST_SUITE(task_graph_tests)
+
+BOOST_AUTO_TEST_CASE(tasks_follow_their_dependencies) {
+    using namespace ::task_graph_tests;
+    Log log;
+    fun::support::TaskGraph graph;
+    auto read  = graph.add(log.record(0));
+    auto left  = graph.add(log.record(1), {read});
+    auto right = graph.add(log.record(2), {read});
+    graph.add(log.record(3), {left, right});
+    for (int task = 4; task < 64; ++task) { graph.add(log.record(task)); }
+
+    BOOST_TEST(graph.run(4));
+    BOOST_TEST(log.order.size() == 64U);
+    BOOST_TEST(log.position(0) < log.position(1));
+    BOOST_TEST(log.position(0) < log.position(2));
+    BOOST_TEST(log.position(1) < log.position(3));
+    BOOST_TEST(log.position(2) < log.position(3));
+}
+
+BOOST_AUTO_TEST_CASE(failures_skip_dependents) {
+    using namespace ::task_graph_tests;
+    Log log;
+    fun::support::TaskGraph graph;
+    auto parse = graph.add(log.record(0, false));
+    auto lower = graph.add(log.record(1), {parse});
+    graph.add(log.record(2), {lower});
+    graph.add(log.record(3));
+
+    BOOST_TEST(!graph.run(2));
+    std::ranges::sort(log.order);
+    BOOST_TEST((log.order == std::vector<int>{0, 3}));
+}
+
+BOOST_AUTO_TEST_CASE(reservations_stay_within_budget) {
+    std::atomic<int> live{0};
+    std::atomic<int> most{0};
+    fun::support::TaskGraph graph;
+    for (int file = 0; file < 16; ++file) {
+        auto start = graph.add([&] {
+            int now = ++live;
+            int seen = most.load();
+            while (now > seen && !most.compare_exchange_weak(seen, now)) {}
+            return true;
+        });
+        auto middle = graph.add([] { return true; }, {start});
+        auto end    = graph.add(
+            [&] {
+                --live;
+                return true;
+            },
+            {middle});
+        graph.reserve(start, 10, end);
+    }
+    // larger than the budget, so it runs alone.
+    auto huge = graph.add([&] { return live == 0; });
+    graph.reserve(huge, 100, graph.add([] { return true; }, {huge}));
+
+    BOOST_TEST(graph.run(4, 25));
+    BOOST_TEST(most.load() <= 2);
+    BOOST_TEST(live.load() == 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
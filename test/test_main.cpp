@@ -12,7 +12,30 @@
 #include <boost/test/unit_test.hpp>
 
 #include "IR/block_tests.hpp"
+#include "IR/fast_math_tests.hpp"
 #include "IR/instruction_tests.hpp"
+#include "IR/layout_tests.hpp"
 #include "IR/operand_tests.hpp"
 #include "IR/scalar_tests.hpp"
-#include "IR/value_tests.hpp"
\ No newline at end of file
+#include "IR/value_tests.hpp"
+#include "codegen/instrument_tests.hpp"
+#include "codegen/multiversion_tests.hpp"
+#include "codegen/pgo_tests.hpp"
+#include "codegen/profile_tests.hpp"
+#include "codegen/to_llvm_tests.hpp"
+#include "eval/evaluator_tests.hpp"
+#include "exec/engine_tests.hpp"
+#include "link/link_tests.hpp"
+#include "pass/bounds_checks_tests.hpp"
+#include "pass/pass_manager_tests.hpp"
+#include "pass/merge_lambdas_tests.hpp"
+#include "pass/monomorphize_tests.hpp"
+#include "pass/place_blocks_tests.hpp"
+#include "pass/purity_tests.hpp"
+#include "pass/ranges_tests.hpp"
+#include "query/database_tests.hpp"
+#include "query/watch_tests.hpp"
+#include "scan/diagnostic_tests.hpp"
+#include "scan/literal_tests.hpp"
+#include "scan/split_tests.hpp"
+#include "support/task_graph_tests.hpp"
\ No newline at end of file